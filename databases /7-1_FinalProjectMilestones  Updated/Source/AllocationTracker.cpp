@@ -0,0 +1,339 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.cpp
+// ============
+// count the heap allocations of each subsystem, per frame and in total
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationTracker.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// declare the global variables
+namespace
+{
+    // stored in front of every block, so a free knows the size and
+    // the tag of what it releases
+    struct BLOCK_HEADER
+    {
+        size_t size;
+        uint32_t tag;
+    };
+    // the header is padded so the block keeps the alignment malloc
+    // gives
+    const size_t HEADER_SIZE =
+        (sizeof(BLOCK_HEADER) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    // header tag of the blocks allocated while counting was off
+    const uint32_t UNCOUNTED_TAG = ALLOCATION_TAG_COUNT;
+
+    // whether the allocations are counted; read before anything
+    // else, so the shared counters are not touched when it is off
+    std::atomic<bool> g_bCountAllocations(false);
+
+    // tag of the allocations of the current thread
+    thread_local ALLOCATION_TAG t_allocationTag = ALLOCATION_UNTAGGED;
+
+    // running totals per tag; zero-initialized before any
+    // allocation can happen
+    std::atomic<uint64_t> g_Allocations[ALLOCATION_TAG_COUNT];
+    std::atomic<uint64_t> g_Frees[ALLOCATION_TAG_COUNT];
+    std::atomic<uint64_t> g_BytesAllocated[ALLOCATION_TAG_COUNT];
+    std::atomic<uint64_t> g_BytesFreed[ALLOCATION_TAG_COUNT];
+
+    // totals at the end of the last frame, and the frame statistics;
+    // only used by the thread that closes the frames
+    ALLOCATION_COUNTERS g_FrameStart[ALLOCATION_TAG_COUNT];
+    ALLOCATION_FRAME_STATS g_FrameStats;
+
+    const char* const g_TagNames[ALLOCATION_TAG_COUNT] =
+    {
+        "untagged", "scene manager", "view manager", "shader manager", "meshes"
+    };
+
+    /***********************************************************
+     *  AllocateBlock()
+     *
+     *  Allocate a block behind a header and count it for the
+     *  tag of the calling thread; nullptr when out of memory.
+     ***********************************************************/
+    void* AllocateBlock(size_t size)
+    {
+        unsigned char* pBlock = static_cast<unsigned char*>(std::malloc(HEADER_SIZE + size));
+        if (pBlock == nullptr)
+        {
+            return nullptr;
+        }
+
+        BLOCK_HEADER* pHeader = reinterpret_cast<BLOCK_HEADER*>(pBlock);
+        pHeader->size = size;
+        pHeader->tag = UNCOUNTED_TAG;
+        if (g_bCountAllocations.load(std::memory_order_relaxed))
+        {
+            pHeader->tag = static_cast<uint32_t>(t_allocationTag);
+            g_Allocations[t_allocationTag].fetch_add(1, std::memory_order_relaxed);
+            g_BytesAllocated[t_allocationTag].fetch_add(size, std::memory_order_relaxed);
+        }
+        return pBlock + HEADER_SIZE;
+    }
+
+    /***********************************************************
+     *  AllocateOrThrow()
+     *
+     *  Allocate a block the way operator new must: retry after
+     *  calling the new handler, and throw when there is none.
+     ***********************************************************/
+    void* AllocateOrThrow(size_t size)
+    {
+        for (;;)
+        {
+            void* pMemory = AllocateBlock(size);
+            if (pMemory != nullptr)
+            {
+                return pMemory;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (handler == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    /***********************************************************
+     *  FreeBlock()
+     *
+     *  Count a block for the tag it was allocated with, if it
+     *  was counted, and release it.
+     ***********************************************************/
+    void FreeBlock(void* pMemory)
+    {
+        if (pMemory == nullptr)
+        {
+            return;
+        }
+
+        unsigned char* pBlock = static_cast<unsigned char*>(pMemory) - HEADER_SIZE;
+        const BLOCK_HEADER* pHeader = reinterpret_cast<const BLOCK_HEADER*>(pBlock);
+        if (pHeader->tag != UNCOUNTED_TAG)
+        {
+            g_Frees[pHeader->tag].fetch_add(1, std::memory_order_relaxed);
+            g_BytesFreed[pHeader->tag].fetch_add(pHeader->size, std::memory_order_relaxed);
+        }
+        std::free(pBlock);
+    }
+
+    /***********************************************************
+     *  Subtract()
+     *
+     *  Difference of two snapshots of the counters of a tag.
+     ***********************************************************/
+    ALLOCATION_COUNTERS Subtract(const ALLOCATION_COUNTERS& end, const ALLOCATION_COUNTERS& start)
+    {
+        ALLOCATION_COUNTERS counters;
+        counters.allocations = end.allocations - start.allocations;
+        counters.frees = end.frees - start.frees;
+        counters.bytesAllocated = end.bytesAllocated - start.bytesAllocated;
+        counters.bytesFreed = end.bytesFreed - start.bytesFreed;
+        return counters;
+    }
+}
+
+/***********************************************************
+ *  operator new, operator delete
+ *
+ *  The replacements of the global allocation functions,
+ *  used by every allocation of the process.
+ ***********************************************************/
+void* operator new(std::size_t size)
+{
+    return AllocateOrThrow(size);
+}
+
+void* operator new[](std::size_t size)
+{
+    return AllocateOrThrow(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return AllocateBlock(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return AllocateBlock(size);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+    FreeBlock(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+    FreeBlock(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+    FreeBlock(pMemory);
+}
+
+void operator delete[](void* pMemory, std::size_t) noexcept
+{
+    FreeBlock(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+    FreeBlock(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+    FreeBlock(pMemory);
+}
+
+/***********************************************************
+ *  AllocationScope()
+ *
+ *  The constructor for the class; counts the allocations of
+ *  the calling thread for a tag until the destructor runs.
+ ***********************************************************/
+AllocationScope::AllocationScope(ALLOCATION_TAG tag)
+    : m_previousTag(t_allocationTag)
+{
+    t_allocationTag = tag;
+}
+
+/***********************************************************
+ *  ~AllocationScope()
+ *
+ *  The destructor for the class; restores the tag of the
+ *  enclosing scope.
+ ***********************************************************/
+AllocationScope::~AllocationScope()
+{
+    t_allocationTag = m_previousTag;
+}
+
+/***********************************************************
+ *  SetAllocationCounting()
+ *
+ *  Switch the counting of the allocations of all threads on
+ *  or off.
+ ***********************************************************/
+void SetAllocationCounting(bool bEnabled)
+{
+    g_bCountAllocations.store(bEnabled, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  GetAllocationTag()
+ *
+ *  Get the tag the allocations of the calling thread are
+ *  counted for.
+ ***********************************************************/
+ALLOCATION_TAG GetAllocationTag()
+{
+    return t_allocationTag;
+}
+
+/***********************************************************
+ *  GetAllocationTagName()
+ *
+ *  Get the name of a tag for reports.
+ ***********************************************************/
+const char* GetAllocationTagName(ALLOCATION_TAG tag)
+{
+    if (tag < 0 || tag >= ALLOCATION_TAG_COUNT)
+    {
+        return "unknown";
+    }
+    return g_TagNames[tag];
+}
+
+/***********************************************************
+ *  GetAllocationCounters()
+ *
+ *  Get the heap traffic of a tag since the process started.
+ *  The counters of a tag are read one after the other, so
+ *  they may be off by allocations made meanwhile.
+ ***********************************************************/
+void GetAllocationCounters(ALLOCATION_TAG tag, ALLOCATION_COUNTERS& counters)
+{
+    counters.allocations = g_Allocations[tag].load(std::memory_order_relaxed);
+    counters.frees = g_Frees[tag].load(std::memory_order_relaxed);
+    counters.bytesAllocated = g_BytesAllocated[tag].load(std::memory_order_relaxed);
+    counters.bytesFreed = g_BytesFreed[tag].load(std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  ResetAllocationFrames()
+ *
+ *  Start the next frame now and clear the frame statistics,
+ *  e.g. once loading is done.
+ ***********************************************************/
+void ResetAllocationFrames()
+{
+    for (int tag = 0; tag < ALLOCATION_TAG_COUNT; ++tag)
+    {
+        GetAllocationCounters(static_cast<ALLOCATION_TAG>(tag), g_FrameStart[tag]);
+        g_FrameStats.tags[tag] = ALLOCATION_COUNTERS();
+    }
+    g_FrameStats.frames = 0;
+    g_FrameStats.allocatingFrames = 0;
+    g_FrameStats.peakAllocations = 0;
+}
+
+/***********************************************************
+ *  EndAllocationFrame()
+ *
+ *  Get the heap traffic since the previous frame ended and
+ *  add it to the frame statistics.
+ ***********************************************************/
+void EndAllocationFrame(FRAME_ALLOCATIONS& frame)
+{
+    frame.allocations = 0;
+    frame.bytesAllocated = 0;
+
+    for (int tag = 0; tag < ALLOCATION_TAG_COUNT; ++tag)
+    {
+        ALLOCATION_COUNTERS counters;
+        GetAllocationCounters(static_cast<ALLOCATION_TAG>(tag), counters);
+        frame.tags[tag] = Subtract(counters, g_FrameStart[tag]);
+        g_FrameStart[tag] = counters;
+
+        frame.allocations += frame.tags[tag].allocations;
+        frame.bytesAllocated += frame.tags[tag].bytesAllocated;
+
+        ALLOCATION_COUNTERS& total = g_FrameStats.tags[tag];
+        total.allocations += frame.tags[tag].allocations;
+        total.frees += frame.tags[tag].frees;
+        total.bytesAllocated += frame.tags[tag].bytesAllocated;
+        total.bytesFreed += frame.tags[tag].bytesFreed;
+    }
+
+    ++g_FrameStats.frames;
+    if (frame.allocations > 0)
+    {
+        ++g_FrameStats.allocatingFrames;
+    }
+    if (frame.allocations > g_FrameStats.peakAllocations)
+    {
+        g_FrameStats.peakAllocations = frame.allocations;
+    }
+}
+
+/***********************************************************
+ *  GetAllocationFrameStats()
+ *
+ *  Get the heap traffic of the frames since the last reset.
+ ***********************************************************/
+ALLOCATION_FRAME_STATS GetAllocationFrameStats()
+{
+    return g_FrameStats;
+}
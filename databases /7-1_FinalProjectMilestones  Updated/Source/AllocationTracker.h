@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationtracker.h
+// ============
+// count the heap allocations of each subsystem, per frame and in total
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+// subsystem an allocation is counted for
+enum ALLOCATION_TAG
+{
+    // anything outside of a tagged scope
+    ALLOCATION_UNTAGGED = 0,
+    ALLOCATION_SCENE_MANAGER,
+    ALLOCATION_VIEW_MANAGER,
+    ALLOCATION_SHADER_MANAGER,
+    // the basic shape meshes
+    ALLOCATION_MESHES,
+    ALLOCATION_TAG_COUNT
+};
+
+// heap traffic of one tag
+struct ALLOCATION_COUNTERS
+{
+    uint64_t allocations;
+    uint64_t frees;
+    // bytes requested by the allocations and returned by the frees
+    uint64_t bytesAllocated;
+    uint64_t bytesFreed;
+};
+
+// heap traffic between two calls of EndAllocationFrame()
+struct FRAME_ALLOCATIONS
+{
+    ALLOCATION_COUNTERS tags[ALLOCATION_TAG_COUNT];
+    // sums over all tags
+    uint64_t allocations;
+    uint64_t bytesAllocated;
+};
+
+// heap traffic of all frames since ResetAllocationFrames()
+struct ALLOCATION_FRAME_STATS
+{
+    uint64_t frames;
+    // frames that allocated at all, and the most allocations of one
+    uint64_t allocatingFrames;
+    uint64_t peakAllocations;
+    ALLOCATION_COUNTERS tags[ALLOCATION_TAG_COUNT];
+};
+
+/***********************************************************
+ *  AllocationScope
+ *
+ *  Once counting is switched on, the global operator new
+ *  and delete of the application count every allocation
+ *  for the tag of the calling thread. A scope object sets that tag until it goes out
+ *  of scope, so the entry points of a subsystem only need
+ *  one line to have everything below them counted for it,
+ *  including the jobs they start. Frees are counted for
+ *  the tag the memory was allocated with, and not at all
+ *  for memory allocated while counting was off.
+ ***********************************************************/
+class AllocationScope
+{
+public:
+    explicit AllocationScope(ALLOCATION_TAG tag);
+    ~AllocationScope();
+
+private:
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+    ALLOCATION_TAG m_previousTag;
+};
+
+// switch the counting of the allocations on or off; it is off
+// by default, so the allocations only pay for a flag check
+void SetAllocationCounting(bool bEnabled);
+
+// tag of the calling thread
+ALLOCATION_TAG GetAllocationTag();
+// readable name of a tag
+const char* GetAllocationTagName(ALLOCATION_TAG tag);
+
+// heap traffic of a tag since the start of the process
+void GetAllocationCounters(ALLOCATION_TAG tag, ALLOCATION_COUNTERS& counters);
+
+// start counting frames from now, dropping the frame statistics
+void ResetAllocationFrames();
+// close a frame: the heap traffic of all threads since the last
+// call, which is added to the frame statistics
+void EndAllocationFrame(FRAME_ALLOCATIONS& frame);
+ALLOCATION_FRAME_STATS GetAllocationFrameStats();
@@ -0,0 +1,583 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.cpp
+// ============
+// command line benchmarks of the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmark.h"
+#include "SceneManager.h"
+#include "JobSystem.h"
+#include "SceneFile.h"
+#include "PrimitiveMeshes.h"
+#include "MeshOptimizer.h"
+#include "SoftwareRasterizer.h"
+#include "FrameArena.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// declare the global variables
+namespace
+{
+    // objects in the synthetic benchmark scene
+    const int BENCHMARK_OBJECT_COUNT = 100000;
+    // frames measured per thread count, after the warm-up frames
+    const int BENCHMARK_WARMUP_FRAMES = 5;
+    const int BENCHMARK_FRAMES = 50;
+
+    // scene file written by the scene load benchmark
+    const char* const BENCHMARK_SCENE_FILE = "benchmark.scnb";
+
+    // quads per side of the scrambled grid in the mesh benchmark
+    const int BENCHMARK_GRID_SIZE = 256;
+    // quads per side of the vertex format benchmark grid, the most
+    // that still fits 16-bit indices
+    const int VERTEX_BENCHMARK_GRID_SIZE = 255;
+    // draws per timed run and timed runs per layout
+    const int VERTEX_BENCHMARK_DRAWS = 100;
+    const int VERTEX_BENCHMARK_RUNS = 5;
+
+    // objects and frame size of the software rasterizer benchmark,
+    // and the frames measured per run
+    const int RASTER_BENCHMARK_OBJECT_COUNT = 2000;
+    const int RASTER_BENCHMARK_WIDTH = 1000;
+    const int RASTER_BENCHMARK_HEIGHT = 800;
+    const int RASTER_BENCHMARK_FRAMES = 10;
+
+    /***********************************************************
+     *  BuildGridMesh()
+     *
+     *  Build a rolling height field of gridSize quads per side.
+     *  Scrambled grids have their triangles in random order,
+     *  like a mesh exported without any care for the vertex
+     *  cache.
+     ***********************************************************/
+    void BuildGridMesh(MESH_DATA& mesh, int gridSize, bool bScrambled)
+    {
+        const int rowSize = gridSize + 1;
+        mesh.vertices.resize(rowSize * rowSize);
+        for (int z = 0; z < rowSize; ++z)
+        {
+            for (int x = 0; x < rowSize; ++x)
+            {
+                // height = sin(x / 8) * cos(z / 8) * 2
+                const float fx = static_cast<float>(x);
+                const float fz = static_cast<float>(z);
+                const float slopeX = std::cos(fx / 8.0f) * std::cos(fz / 8.0f) * 0.25f;
+                const float slopeZ = -std::sin(fx / 8.0f) * std::sin(fz / 8.0f) * 0.25f;
+
+                MESH_VERTEX& vertex = mesh.vertices[z * rowSize + x];
+                vertex.position = glm::vec3(fx, std::sin(fx / 8.0f) * std::cos(fz / 8.0f) * 2.0f, fz);
+                vertex.normal = glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ));
+                vertex.uv = glm::vec2(fx / gridSize, fz / gridSize);
+            }
+        }
+
+        mesh.indices.clear();
+        for (int z = 0; z < gridSize; ++z)
+        {
+            for (int x = 0; x < gridSize; ++x)
+            {
+                const uint32_t a = z * rowSize + x;
+                const uint32_t quad[6] = { a, a + rowSize, a + 1, a + 1, a + rowSize, a + rowSize + 1 };
+                mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+            }
+        }
+        if (!bScrambled)
+        {
+            return;
+        }
+
+        const std::vector<uint32_t> gridIndices = mesh.indices;
+        std::vector<size_t> triangleOrder(gridIndices.size() / 3);
+        for (size_t i = 0; i < triangleOrder.size(); ++i)
+        {
+            triangleOrder[i] = i;
+        }
+        std::mt19937 random(12345);
+        std::shuffle(triangleOrder.begin(), triangleOrder.end(), random);
+
+        mesh.indices.clear();
+        for (size_t triangle : triangleOrder)
+        {
+            mesh.indices.insert(mesh.indices.end(),
+                                gridIndices.begin() + triangle * 3,
+                                gridIndices.begin() + triangle * 3 + 3);
+        }
+    }
+
+    /***********************************************************
+     *  ReportMeshOptimization()
+     *
+     *  Print the cache statistics of a mesh before and after
+     *  each optimization level, with the time the passes took.
+     ***********************************************************/
+    void ReportMeshOptimization(const char* name, const MESH_DATA& source)
+    {
+        const VERTEX_CACHE_STATS before = AnalyzeVertexCache(
+            source.indices.data(), source.indices.size(), source.vertices.size());
+        std::cout << "  " << std::left << std::setw(18) << name << std::right
+                  << std::setw(7) << source.indices.size() / 3 << " triangles"
+                  << "  ACMR " << std::fixed << std::setprecision(3) << before.acmr
+                  << "  ATVR " << before.atvr << std::endl;
+
+        const MESH_OPTIMIZATION levels[] = { MESH_OPTIMIZE_VERTEX_CACHE, MESH_OPTIMIZE_OVERDRAW };
+        const char* levelNames[] = { "cache", "overdraw" };
+        for (int i = 0; i < 2; ++i)
+        {
+            MESH_DATA mesh = source;
+            auto start = std::chrono::high_resolution_clock::now();
+            OptimizeMesh(mesh, levels[i]);
+            auto stop = std::chrono::high_resolution_clock::now();
+
+            const VERTEX_CACHE_STATS after = AnalyzeVertexCache(
+                mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+            const VERTEX_CACHE_STATS after32 = AnalyzeVertexCache(
+                mesh.indices.data(), mesh.indices.size(), mesh.vertices.size(), 32);
+            std::cout << "    " << std::left << std::setw(9) << levelNames[i] << std::right
+                      << "  ACMR " << after.acmr << "  ATVR " << after.atvr
+                      << "  (32 entries: " << after32.acmr << " / " << after32.atvr << ")"
+                      << "  " << std::chrono::duration<double, std::milli>(stop - start).count() << " ms"
+                      << std::endl;
+        }
+    }
+
+    /***********************************************************
+     *  TimeMeshDraws()
+     *
+     *  Draw an uploaded mesh VERTEX_BENCHMARK_DRAWS times per
+     *  run and return the fastest run in milliseconds. Each run
+     *  waits for the GPU, so the time covers the whole run.
+     ***********************************************************/
+    double TimeMeshDraws(const PrimitiveMeshes::GPU_MESH& gpuMesh)
+    {
+        // warm up, so the buffers are resident before timing
+        for (int draw = 0; draw < 10; ++draw)
+        {
+            PrimitiveMeshes::DrawUploadedMesh(gpuMesh);
+        }
+        glFinish();
+
+        double bestTime = 0.0;
+        for (int run = 0; run < VERTEX_BENCHMARK_RUNS; ++run)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int draw = 0; draw < VERTEX_BENCHMARK_DRAWS; ++draw)
+            {
+                PrimitiveMeshes::DrawUploadedMesh(gpuMesh);
+            }
+            glFinish();
+            auto stop = std::chrono::high_resolution_clock::now();
+
+            const double time = std::chrono::duration<double, std::milli>(stop - start).count();
+            if (run == 0 || time < bestTime)
+            {
+                bestTime = time;
+            }
+        }
+        return bestTime;
+    }
+
+    /***********************************************************
+     *  ReportPackingError()
+     *
+     *  Print the largest position, normal and texture
+     *  coordinate errors of the packed layout for a mesh.
+     ***********************************************************/
+    void ReportPackingError(const MESH_DATA& mesh)
+    {
+        PACKED_MESH_DATA packed;
+        PackMesh(mesh, packed);
+
+        float positionError = 0.0f;
+        float normalError = 0.0f;
+        float uvError = 0.0f;
+        for (size_t i = 0; i < mesh.vertices.size(); ++i)
+        {
+            const MESH_VERTEX decoded = UnpackVertex(packed, packed.vertices[i]);
+            const MESH_VERTEX& source = mesh.vertices[i];
+            positionError = std::max(positionError, glm::length(decoded.position - source.position));
+            const float cosine = std::min(glm::dot(decoded.normal, source.normal), 1.0f);
+            normalError = std::max(normalError, std::acos(cosine) * 57.2957795f);
+            uvError = std::max(uvError, std::fabs(decoded.uv.x - source.uv.x));
+            uvError = std::max(uvError, std::fabs(decoded.uv.y - source.uv.y));
+        }
+
+        std::cout << "  packing error: position " << std::setprecision(5) << positionError
+                  << " (bounds diagonal " << glm::length(packed.positionScale) << ")"
+                  << ", normal " << normalError << " degrees"
+                  << ", texture coordinate " << uvError << std::endl;
+    }
+
+    /***********************************************************
+     *  TimeSoftwareFrames()
+     *
+     *  Draw a built frame packet RASTER_BENCHMARK_FRAMES times
+     *  after a warm-up frame and return the average time of a
+     *  frame in milliseconds.
+     ***********************************************************/
+    double TimeSoftwareFrames(SceneManager& scene, const FRAME_PACKET& packet)
+    {
+        scene.SubmitFramePacket(packet);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < RASTER_BENCHMARK_FRAMES; ++frame)
+        {
+            scene.SubmitFramePacket(packet);
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        return std::chrono::duration<double, std::milli>(stop - start).count() / RASTER_BENCHMARK_FRAMES;
+    }
+
+    /***********************************************************
+     *  FillBenchmarkScene()
+     *
+     *  Add a grid of objects of every mesh type with varying
+     *  materials, spread around a camera in the middle.
+     ***********************************************************/
+    void FillBenchmarkScene(SceneManager& scene, int objectCount)
+    {
+        const char* materials[] = { "gold", "cement", "wood", "tile", "glass", "clay", "ceramic" };
+        const int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+
+        scene.DefineObjectMaterials();
+        for (int i = 0; i < objectCount; ++i)
+        {
+            float x = static_cast<float>(i % gridSize) - gridSize * 0.5f;
+            float z = static_cast<float>(i / gridSize) - gridSize * 0.5f;
+            scene.AddSceneObject(
+                static_cast<MESH_TYPE>(i % MESH_COUNT),
+                glm::vec3(0.4f, 0.4f + 0.1f * (i % 5), 0.4f),
+                0.0f, static_cast<float>(i % 360), 0.0f,
+                glm::vec3(x, 0.0f, z),
+                materials[i % 7], "");
+        }
+    }
+}
+
+/***********************************************************
+ *  RunJobSystemBenchmark()
+ *
+ *  This function is used to measure how the per-frame
+ *  preparation of the scene (transform update, frustum
+ *  culling and draw list building) scales with the number
+ *  of job system threads.
+ ***********************************************************/
+int RunJobSystemBenchmark(unsigned maxThreads)
+{
+    if (maxThreads == 0)
+    {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::cout << "INFO: Frame preparation benchmark, "
+              << BENCHMARK_OBJECT_COUNT << " objects, "
+              << BENCHMARK_FRAMES << " frames per run" << std::endl;
+
+    FRAME_PACKET packet;
+    packet.frameIndex = 0;
+    packet.viewPosition = glm::vec3(0.0f, 5.0f, 0.0f);
+    packet.view = glm::lookAt(packet.viewPosition, glm::vec3(10.0f, 0.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    packet.projection = glm::perspective(glm::radians(80.0f), 1.25f, 0.1f, 100.0f);
+
+    double singleThreadMs = 0.0;
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (unsigned threads : threadCounts)
+    {
+        JobSystem jobSystem(threads);
+        SceneManager scene(nullptr);
+        scene.SetJobSystem(&jobSystem);
+        FillBenchmarkScene(scene, BENCHMARK_OBJECT_COUNT);
+
+        for (int frame = 0; frame < BENCHMARK_WARMUP_FRAMES; ++frame)
+        {
+            scene.BuildFramePacket(packet);
+            AdvanceFrameArenas();
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+        {
+            scene.BuildFramePacket(packet);
+            AdvanceFrameArenas();
+        }
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        double frameMs = std::chrono::duration<double, std::milli>(stop - start).count() / BENCHMARK_FRAMES;
+        if (threads == 1)
+        {
+            singleThreadMs = frameMs;
+        }
+
+        std::cout << "  threads: " << std::setw(3) << threads
+                  << "  frame: " << std::fixed << std::setprecision(3) << std::setw(8) << frameMs << " ms"
+                  << "  speedup: " << std::setprecision(2) << singleThreadMs / frameMs << "x"
+                  << "  visible: " << packet.drawCommands.size() << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/***********************************************************
+ *  RunSceneLoadBenchmark()
+ *
+ *  This function is used to compare loading a large scene
+ *  from a memory mapped scene file with building the same
+ *  scene through AddSceneObject().
+ ***********************************************************/
+int RunSceneLoadBenchmark(unsigned objectCount)
+{
+    const char* materials[] = { "gold", "cement", "wood", "tile", "glass", "clay", "ceramic" };
+    const int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+
+    std::cout << "INFO: Scene load benchmark, " << objectCount << " objects" << std::endl;
+
+    // the same grid as the frame preparation benchmark
+    SceneFileWriter writer;
+    const float white[3] = { 1.0f, 1.0f, 1.0f };
+    for (int i = 0; i < 7; ++i)
+    {
+        writer.AddMaterial(materials[i], white, 0.2f, white, white, 8.0f);
+    }
+    for (unsigned i = 0; i < objectCount; ++i)
+    {
+        const float scale[3] = { 0.4f, 0.4f + 0.1f * (i % 5), 0.4f };
+        const float rotation[3] = { 0.0f, static_cast<float>(i % 360), 0.0f };
+        const float position[3] = {
+            static_cast<float>(i % gridSize) - gridSize * 0.5f,
+            0.0f,
+            static_cast<float>(i / gridSize) - gridSize * 0.5f };
+        const float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        writer.AddObject(static_cast<uint8_t>(i % MESH_COUNT), scale, rotation, position, color, i % 7, -1);
+    }
+    if (!writer.Write(BENCHMARK_SCENE_FILE))
+    {
+        return EXIT_FAILURE;
+    }
+
+    // mapped scene file, used in place
+    {
+        SceneManager scene(nullptr);
+        auto start = std::chrono::high_resolution_clock::now();
+        bool bLoaded = scene.LoadSceneFile(BENCHMARK_SCENE_FILE);
+        auto stop = std::chrono::high_resolution_clock::now();
+        if (!bLoaded)
+        {
+            return EXIT_FAILURE;
+        }
+        std::cout << "  scene file:       " << std::fixed << std::setprecision(3)
+                  << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << std::endl;
+    }
+
+    // the same objects added one by one
+    {
+        SceneManager scene(nullptr);
+        auto start = std::chrono::high_resolution_clock::now();
+        FillBenchmarkScene(scene, static_cast<int>(objectCount));
+        auto stop = std::chrono::high_resolution_clock::now();
+        std::cout << "  AddSceneObject(): " << std::fixed << std::setprecision(3)
+                  << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << std::endl;
+    }
+
+    std::remove(BENCHMARK_SCENE_FILE);
+    return EXIT_SUCCESS;
+}
+
+/***********************************************************
+ *  RunMeshOptimizationBenchmark()
+ *
+ *  This function is used to show what the mesh optimizer
+ *  gains on the basic shapes and on a scrambled mesh, with
+ *  a 16 entry FIFO cache unless noted.
+ ***********************************************************/
+int RunMeshOptimizationBenchmark()
+{
+    const char* meshNames[MESH_COUNT] =
+    {
+        "box", "plane", "cylinder", "cone", "prism",
+        "pyramid4", "sphere", "tapered cylinder", "torus",
+    };
+
+    std::cout << "INFO: Mesh optimization benchmark" << std::endl;
+
+    MESH_DATA mesh;
+    for (int i = 0; i < MESH_COUNT; ++i)
+    {
+        PrimitiveMeshes::GenerateMesh(static_cast<MESH_TYPE>(i), mesh);
+        ReportMeshOptimization(meshNames[i], mesh);
+    }
+
+    BuildGridMesh(mesh, BENCHMARK_GRID_SIZE, true);
+    ReportMeshOptimization("scrambled grid", mesh);
+
+    return EXIT_SUCCESS;
+}
+
+/***********************************************************
+ *  RunVertexFormatBenchmark()
+ *
+ *  This function is used to compare the float and packed
+ *  vertex layouts where vertex fetch is the limit: drawing
+ *  into a single pixel with color writes off leaves almost
+ *  nothing for the rasterizer to do. Rasterizer discard is
+ *  not used since drivers may then skip the vertex shader.
+ *  The scene program must be bound.
+ ***********************************************************/
+int RunVertexFormatBenchmark()
+{
+    std::cout << "INFO: Vertex format benchmark, " << VERTEX_BENCHMARK_DRAWS
+              << " draws per run" << std::endl;
+
+    const char* layoutNames[] = { "float", "packed" };
+    const VERTEX_FORMAT layouts[] = { VERTEX_FORMAT_FLOAT, VERTEX_FORMAT_PACKED };
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glViewport(0, 0, 1, 1);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+
+    for (int scrambled = 0; scrambled < 2; ++scrambled)
+    {
+        MESH_DATA mesh;
+        BuildGridMesh(mesh, VERTEX_BENCHMARK_GRID_SIZE, scrambled != 0);
+        if (scrambled == 0)
+        {
+            OptimizeMesh(mesh, MESH_OPTIMIZE_VERTEX_CACHE);
+        }
+
+        std::cout << (scrambled != 0 ? "  scrambled grid, " : "  optimized grid, ")
+                  << mesh.vertices.size() << " vertices, "
+                  << mesh.indices.size() / 3 << " triangles" << std::endl;
+        if (scrambled == 0)
+        {
+            ReportPackingError(mesh);
+        }
+
+        double floatTime = 0.0;
+        for (int i = 0; i < 2; ++i)
+        {
+            PrimitiveMeshes::GPU_MESH gpuMesh;
+            PrimitiveMeshes::UploadMesh(mesh, layouts[i], gpuMesh);
+
+            const double time = TimeMeshDraws(gpuMesh);
+            if (i == 0)
+            {
+                floatTime = time;
+            }
+            const double verticesPerSecond =
+                static_cast<double>(mesh.indices.size()) * VERTEX_BENCHMARK_DRAWS / (time / 1000.0);
+
+            std::cout << "    " << std::left << std::setw(7) << layoutNames[i] << std::right
+                      << std::setw(10) << gpuMesh.bufferBytes << " bytes"
+                      << std::fixed << std::setprecision(3)
+                      << std::setw(10) << time / VERTEX_BENCHMARK_DRAWS << " ms per draw"
+                      << std::setw(10) << std::setprecision(1) << verticesPerSecond / 1000000.0 << " M indices/s"
+                      << std::setw(8) << std::setprecision(2) << floatTime / time << "x"
+                      << std::defaultfloat << std::endl;
+
+            PrimitiveMeshes::DeleteUploadedMesh(gpuMesh);
+        }
+    }
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    return EXIT_SUCCESS;
+}
+
+/***********************************************************
+ *  RunSoftwareRasterBenchmark()
+ *
+ *  This function is used to measure the throughput of the
+ *  software rasterizer per number of job system threads.
+ *  The binning and the tile passes are both included; the
+ *  draw list is built once up front.
+ ***********************************************************/
+int RunSoftwareRasterBenchmark(unsigned maxThreads)
+{
+    if (maxThreads == 0)
+    {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const bool bSimd = SoftwareRasterizer::IsSimdSupported();
+    std::cout << "INFO: Software rasterizer benchmark, "
+              << RASTER_BENCHMARK_OBJECT_COUNT << " objects at "
+              << RASTER_BENCHMARK_WIDTH << "x" << RASTER_BENCHMARK_HEIGHT << ", "
+              << (bSimd ? "AVX2" : "scalar") << " edge functions" << std::endl;
+
+    FRAME_PACKET packet;
+    packet.frameIndex = 0;
+    packet.time = 0.0f;
+    packet.deltaTime = 0.0f;
+    packet.viewportSize = glm::vec2(static_cast<float>(RASTER_BENCHMARK_WIDTH),
+                                    static_cast<float>(RASTER_BENCHMARK_HEIGHT));
+    packet.viewPosition = glm::vec3(0.0f, 5.0f, 0.0f);
+    packet.view = glm::lookAt(packet.viewPosition, glm::vec3(10.0f, 0.0f, 10.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    packet.projection = glm::perspective(glm::radians(80.0f), 1.25f, 0.1f, 100.0f);
+    const double pixels = static_cast<double>(RASTER_BENCHMARK_WIDTH) * RASTER_BENCHMARK_HEIGHT;
+
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    double singleThreadMs = 0.0;
+    for (unsigned threads : threadCounts)
+    {
+        JobSystem jobSystem(threads);
+        SoftwareRasterizer rasterizer(&jobSystem);
+        SceneManager scene(nullptr);
+        scene.SetJobSystem(&jobSystem);
+        scene.SetSoftwareRasterizer(&rasterizer);
+        FillBenchmarkScene(scene, RASTER_BENCHMARK_OBJECT_COUNT);
+        scene.DefineSceneLights();
+        scene.SetupSceneLights();
+        scene.BuildFramePacket(packet);
+
+        const double frameMs = TimeSoftwareFrames(scene, packet);
+        if (threads == 1)
+        {
+            singleThreadMs = frameMs;
+        }
+
+        std::cout << "  threads: " << std::setw(3) << threads
+                  << "  frame: " << std::fixed << std::setprecision(3) << std::setw(8) << frameMs << " ms"
+                  << "  speedup: " << std::setprecision(2) << singleThreadMs / frameMs << "x"
+                  << "  " << std::setprecision(1) << std::setw(7) << pixels / frameMs / 1000.0 << " M pixels/s"
+                  << "  " << std::setw(6) << rasterizer.GetTriangleCount() / frameMs / 1000.0 << " M triangles/s"
+                  << std::defaultfloat << std::endl;
+
+        if (bSimd && threads == maxThreads)
+        {
+            rasterizer.SetUseSimd(false);
+            const double scalarMs = TimeSoftwareFrames(scene, packet);
+            std::cout << "  scalar edge functions on " << threads << " threads: "
+                      << std::fixed << std::setprecision(3) << scalarMs << " ms, AVX2 "
+                      << std::setprecision(2) << scalarMs / frameMs << "x faster"
+                      << std::defaultfloat << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
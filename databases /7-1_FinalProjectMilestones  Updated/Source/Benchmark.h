@@ -0,0 +1,33 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.h
+// ============
+// command line benchmarks of the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// measure the frame preparation time of a large synthetic scene
+// with the job system running on 1 to maxThreads threads; a
+// maxThreads of 0 uses every hardware thread
+int RunJobSystemBenchmark(unsigned maxThreads);
+
+// write a synthetic scene of objectCount objects to a binary scene
+// file and measure how long mapping and loading it takes, compared
+// to adding the same objects in code
+int RunSceneLoadBenchmark(unsigned objectCount);
+
+// report the vertex cache efficiency (ACMR and ATVR) of the basic
+// shapes and of a scrambled grid mesh, standing in for an imported
+// mesh, before and after each mesh optimization level
+int RunMeshOptimizationBenchmark();
+
+// compare the draw time of the float and packed vertex layouts on
+// a dense grid drawn into a single pixel; needs the OpenGL context
+// and the scene program
+int RunVertexFormatBenchmark();
+
+// measure how fast the software rasterizer draws a synthetic scene
+// with the job system running on 1 to maxThreads threads, and the
+// AVX2 edge functions against the scalar ones; a maxThreads of 0
+// uses every hardware thread
+int RunSoftwareRasterBenchmark(unsigned maxThreads);
@@ -0,0 +1,439 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// draw the scene at a resolution that follows the measured GPU frame time
+// and upscale it to the window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declare the global variables
+namespace
+{
+    // default budget: 90% of a 60 Hz frame, leaving room for
+    // the upscale and the buffer swap
+    const float DEFAULT_TARGET_FRAME_TIME = 15.0f;
+    const float DEFAULT_MIN_SCALE = 0.5f;
+    const float DEFAULT_MAX_SCALE = 1.0f;
+    const float DEFAULT_SMOOTHING = 0.1f;
+    const float DEFAULT_ADJUST_RATE = 0.2f;
+    const float DEFAULT_SHARPNESS = 0.5f;
+
+    // the scale is kept while the ideal one is within this share
+    // of it, so small timing noise does not move it every frame
+    const float SCALE_DEAD_ZONE = 0.03f;
+    // smallest scale the settings may ask for
+    const float SMALLEST_SCALE = 0.1f;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution()
+    : m_bCreated(false),
+      m_framebuffer(0),
+      m_colorTexture(0),
+      m_depthBuffer(0),
+      m_emptyVertexArray(0),
+      m_targetWidth(0),
+      m_targetHeight(0),
+      m_windowWidth(0),
+      m_windowHeight(0),
+      m_renderWidth(0),
+      m_renderHeight(0),
+      m_nextQuery(0),
+      m_oldestQuery(0),
+      m_bTiming(false),
+      m_scale(DEFAULT_MAX_SCALE),
+      m_gpuFrameTime(0.0f),
+      m_scaleSum(0.0),
+      m_frameCount(0)
+{
+    m_settings.targetFrameTime = DEFAULT_TARGET_FRAME_TIME;
+    m_settings.minScale = DEFAULT_MIN_SCALE;
+    m_settings.maxScale = DEFAULT_MAX_SCALE;
+    m_settings.smoothing = DEFAULT_SMOOTHING;
+    m_settings.adjustRate = DEFAULT_ADJUST_RATE;
+    m_settings.filter = UPSCALE_BILINEAR;
+    m_settings.sharpness = DEFAULT_SHARPNESS;
+
+    for (int i = 0; i < TIMER_QUERY_COUNT; ++i)
+    {
+        m_queries[i] = 0;
+        m_bQueryPending[i] = false;
+    }
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+    Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used to check if the current context can
+ *  measure GPU time.
+ ***********************************************************/
+bool DynamicResolution::IsSupported()
+{
+    return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used to load the upscale shaders and to
+ *  create the timer queries. The target is created by the
+ *  first frame, when the window size is known.
+ ***********************************************************/
+bool DynamicResolution::Create()
+{
+    Destroy();
+
+    if (!IsSupported())
+    {
+        return false;
+    }
+
+    // loading makes the upscale program current; the scene
+    // program is put back so the caller does not need to know
+    GLint program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    const GLuint upscaleProgram = m_upscaleShader.LoadShaders(
+        "shaders/upscaleVertexShader.glsl",
+        "shaders/upscaleFragmentShader.glsl");
+    glUseProgram(static_cast<GLuint>(program));
+    if (0 == upscaleProgram)
+    {
+        std::cout << "ERROR: Could not load the upscale shaders" << std::endl;
+        return false;
+    }
+
+    glGenQueries(TIMER_QUERY_COUNT, m_queries);
+    // the core profile draws nothing without a vertex array, even
+    // when the vertices come from gl_VertexID alone
+    glGenVertexArrays(1, &m_emptyVertexArray);
+
+    m_scale = m_settings.maxScale;
+    m_gpuFrameTime = 0.0f;
+    m_scaleSum = 0.0;
+    m_frameCount = 0;
+    m_bCreated = true;
+    return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used to delete all OpenGL objects.
+ ***********************************************************/
+void DynamicResolution::Destroy()
+{
+    if (!m_bCreated)
+    {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteTextures(1, &m_colorTexture);
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+    glDeleteVertexArrays(1, &m_emptyVertexArray);
+    glDeleteQueries(TIMER_QUERY_COUNT, m_queries);
+    glDeleteProgram(m_upscaleShader.m_programID);
+
+    m_framebuffer = 0;
+    m_colorTexture = 0;
+    m_depthBuffer = 0;
+    m_emptyVertexArray = 0;
+    m_upscaleShader.m_programID = 0;
+    m_targetWidth = 0;
+    m_targetHeight = 0;
+    m_windowWidth = 0;
+    m_windowHeight = 0;
+    for (int i = 0; i < TIMER_QUERY_COUNT; ++i)
+    {
+        m_queries[i] = 0;
+        m_bQueryPending[i] = false;
+    }
+    m_nextQuery = 0;
+    m_oldestQuery = 0;
+    m_bTiming = false;
+    m_bCreated = false;
+}
+
+/***********************************************************
+ *  SetSettings()
+ *
+ *  This method is used to change the budget, limits and
+ *  filter; the scale is clamped to the new limits.
+ ***********************************************************/
+void DynamicResolution::SetSettings(const SETTINGS& settings)
+{
+    m_settings = settings;
+    m_settings.maxScale = glm::clamp(m_settings.maxScale, SMALLEST_SCALE, 1.0f);
+    m_settings.minScale = glm::clamp(m_settings.minScale, SMALLEST_SCALE, m_settings.maxScale);
+    m_settings.smoothing = glm::clamp(m_settings.smoothing, 0.01f, 1.0f);
+    m_settings.adjustRate = glm::clamp(m_settings.adjustRate, 0.01f, 1.0f);
+    m_settings.sharpness = glm::clamp(m_settings.sharpness, 0.0f, 1.0f);
+    m_scale = glm::clamp(m_scale, m_settings.minScale, m_settings.maxScale);
+}
+
+/***********************************************************
+ *  GetAverageScale()
+ *
+ *  This method is used to get the average scale of all
+ *  frames drawn so far.
+ ***********************************************************/
+float DynamicResolution::GetAverageScale() const
+{
+    return m_frameCount > 0 ? static_cast<float>(m_scaleSum / m_frameCount) : m_scale;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used to pick the scale of the frame from
+ *  the timings that have arrived, and to redirect the scene
+ *  into the matching part of the offscreen target.
+ ***********************************************************/
+float DynamicResolution::BeginFrame(int windowWidth, int windowHeight)
+{
+    if (!m_bCreated || windowWidth <= 0 || windowHeight <= 0)
+    {
+        return 1.0f;
+    }
+
+    CollectTimings();
+
+    if ((windowWidth != m_windowWidth || windowHeight != m_windowHeight) &&
+        !ResizeTarget(windowWidth, windowHeight))
+    {
+        return 1.0f;
+    }
+
+    m_renderWidth = std::max(1, std::min(m_targetWidth, static_cast<int>(windowWidth * m_scale + 0.5f)));
+    m_renderHeight = std::max(1, std::min(m_targetHeight, static_cast<int>(windowHeight * m_scale + 0.5f)));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+    // with every query still in flight the GPU is far behind;
+    // the frame is drawn without timing rather than waiting
+    m_bTiming = !m_bQueryPending[m_nextQuery];
+    if (m_bTiming)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, m_queries[m_nextQuery]);
+    }
+
+    m_scaleSum += m_scale;
+    ++m_frameCount;
+    return m_scale;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used to stop timing the scene and to
+ *  stretch it over the window. The upscale is not timed,
+ *  as its cost depends on the window size only.
+ ***********************************************************/
+void DynamicResolution::EndFrame()
+{
+    if (!m_bCreated || 0 == m_framebuffer)
+    {
+        return;
+    }
+
+    if (m_bTiming)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_bQueryPending[m_nextQuery] = true;
+        m_nextQuery = (m_nextQuery + 1) % TIMER_QUERY_COUNT;
+        m_bTiming = false;
+    }
+
+    Upscale();
+}
+
+/***********************************************************
+ *  CollectTimings()
+ *
+ *  This method is used to read the timer queries whose
+ *  results are available, oldest first, without waiting
+ *  for the ones that are not.
+ ***********************************************************/
+void DynamicResolution::CollectTimings()
+{
+    while (m_bQueryPending[m_oldestQuery])
+    {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(m_queries[m_oldestQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (GL_FALSE == available)
+        {
+            break;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(m_queries[m_oldestQuery], GL_QUERY_RESULT, &elapsed);
+        m_bQueryPending[m_oldestQuery] = false;
+        m_oldestQuery = (m_oldestQuery + 1) % TIMER_QUERY_COUNT;
+
+        UpdateScale(static_cast<float>(elapsed / 1000000.0));
+    }
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used to fold one GPU timing into the
+ *  smoothed time and to move the scale toward the one that
+ *  would meet the budget. The fragment work grows with the
+ *  pixel count, which is the square of the scale.
+ ***********************************************************/
+void DynamicResolution::UpdateScale(float gpuFrameTime)
+{
+    if (m_gpuFrameTime <= 0.0f)
+    {
+        m_gpuFrameTime = gpuFrameTime;
+    }
+    else
+    {
+        m_gpuFrameTime += (gpuFrameTime - m_gpuFrameTime) * m_settings.smoothing;
+    }
+    if (m_gpuFrameTime <= 0.0f)
+    {
+        return;
+    }
+
+    const float idealScale = glm::clamp(
+        m_scale * std::sqrt(m_settings.targetFrameTime / m_gpuFrameTime),
+        m_settings.minScale, m_settings.maxScale);
+    if (std::fabs(idealScale - m_scale) < SCALE_DEAD_ZONE * m_scale)
+    {
+        return;
+    }
+
+    m_scale += (idealScale - m_scale) * m_settings.adjustRate;
+}
+
+/***********************************************************
+ *  ResizeTarget()
+ *
+ *  This method is used to create the target at the largest
+ *  scale of a window size.
+ ***********************************************************/
+bool DynamicResolution::ResizeTarget(int windowWidth, int windowHeight)
+{
+    m_windowWidth = windowWidth;
+    m_windowHeight = windowHeight;
+    m_targetWidth = std::max(1, static_cast<int>(windowWidth * m_settings.maxScale + 0.5f));
+    m_targetHeight = std::max(1, static_cast<int>(windowHeight * m_settings.maxScale + 0.5f));
+
+    if (0 == m_framebuffer)
+    {
+        glGenFramebuffers(1, &m_framebuffer);
+        glGenTextures(1, &m_colorTexture);
+        glGenRenderbuffers(1, &m_depthBuffer);
+    }
+
+    // the scene keeps its textures bound across frames, so the
+    // binding of the active unit is put back afterwards
+    GLint texture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_targetWidth, m_targetHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(texture));
+
+    glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_targetWidth, m_targetHeight);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    const bool bComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!bComplete)
+    {
+        std::cout << "ERROR: Could not create the dynamic resolution target" << std::endl;
+        m_windowWidth = 0;
+        m_windowHeight = 0;
+        return false;
+    }
+    return true;
+}
+
+/***********************************************************
+ *  Upscale()
+ *
+ *  This method is used to draw the scaled frame over the
+ *  window. The state it changes is restored, because the
+ *  scene sets its program, textures and vertex arrays only
+ *  when they change.
+ ***********************************************************/
+void DynamicResolution::Upscale()
+{
+    GLint program = 0;
+    GLint vertexArray = 0;
+    GLint activeTexture = GL_TEXTURE0;
+    GLint texture = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+    glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    const GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+    const GLboolean bBlend = glIsEnabled(GL_BLEND);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, m_windowWidth, m_windowHeight);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    m_upscaleShader.use();
+    glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+    m_upscaleShader.setSampler2DValue("sceneColor", 0);
+    m_upscaleShader.setVec2Value("sourceScale",
+        static_cast<float>(m_renderWidth) / m_targetWidth,
+        static_cast<float>(m_renderHeight) / m_targetHeight);
+    m_upscaleShader.setVec2Value("sourceTexelSize",
+        1.0f / m_targetWidth,
+        1.0f / m_targetHeight);
+    m_upscaleShader.setFloatValue("sharpness",
+        UPSCALE_SHARPEN == m_settings.filter ? m_settings.sharpness : 0.0f);
+
+    glBindVertexArray(m_emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindVertexArray(static_cast<GLuint>(vertexArray));
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(texture));
+    glActiveTexture(static_cast<GLenum>(activeTexture));
+    glUseProgram(static_cast<GLuint>(program));
+    if (bDepthTest)
+    {
+        glEnable(GL_DEPTH_TEST);
+    }
+    if (bBlend)
+    {
+        glEnable(GL_BLEND);
+    }
+}
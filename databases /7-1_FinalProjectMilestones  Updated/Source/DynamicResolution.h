@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// draw the scene at a resolution that follows the measured GPU frame time
+// and upscale it to the window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+// filter used to stretch the scaled frame over the window
+enum UPSCALE_FILTER
+{
+    UPSCALE_BILINEAR = 0,
+    // bilinear followed by a sharpening pass limited to the range of
+    // the neighbouring pixels
+    UPSCALE_SHARPEN
+};
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  This class draws the scene into an offscreen target
+ *  that is allocated once at the largest scale; each frame
+ *  uses the lower left part of it that matches the current
+ *  scale, so changing the scale never reallocates. The GPU
+ *  time of the scene is measured with a ring of timer
+ *  queries that are read a few frames later, when their
+ *  results are available, so timing never stalls the
+ *  pipeline. A controller smooths the timings and moves the
+ *  scale toward the one that fits the frame budget.
+ *
+ *  All methods must be called on the thread that owns the
+ *  OpenGL context.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+    // timer queries in flight; results are read this many
+    // frames after they were issued at the latest
+    static const int TIMER_QUERY_COUNT = 4;
+
+    struct SETTINGS
+    {
+        // GPU time the scene may take per frame, in milliseconds
+        float targetFrameTime;
+        // limits of the scale of each window axis
+        float minScale;
+        float maxScale;
+        // weight of a new timing in the smoothed GPU time
+        float smoothing;
+        // share of the way to the ideal scale taken per timing
+        float adjustRate;
+        UPSCALE_FILTER filter;
+        // strength of UPSCALE_SHARPEN, 0 to 1
+        float sharpness;
+    };
+
+    // constructor
+    DynamicResolution();
+    // destructor
+    ~DynamicResolution();
+
+    // true when the driver supports timer queries
+    static bool IsSupported();
+
+    // load the upscale shaders and create the timer queries
+    bool Create();
+    // delete the target, queries and shaders
+    void Destroy();
+
+    void SetSettings(const SETTINGS& settings);
+    const SETTINGS& GetSettings() const { return m_settings; }
+
+    // read the finished timings, update the scale, bind the
+    // offscreen target with a viewport of the scaled size and
+    // start timing; returns the scale of this frame
+    float BeginFrame(int windowWidth, int windowHeight);
+    // stop timing and upscale the frame into the window
+    void EndFrame();
+
+    float GetScale() const { return m_scale; }
+    // smoothed GPU time of the scene, in milliseconds
+    float GetGpuFrameTime() const { return m_gpuFrameTime; }
+    // average scale of all frames drawn so far
+    float GetAverageScale() const;
+
+private:
+    // read the results of the finished timer queries
+    void CollectTimings();
+    // move the scale toward the budget for one new timing
+    void UpdateScale(float gpuFrameTime);
+    // (re)create the target for a window size
+    bool ResizeTarget(int windowWidth, int windowHeight);
+    // draw the scaled frame over the window
+    void Upscale();
+
+    SETTINGS m_settings;
+    ShaderManager m_upscaleShader;
+    bool m_bCreated;
+
+    GLuint m_framebuffer;
+    GLuint m_colorTexture;
+    GLuint m_depthBuffer;
+    GLuint m_emptyVertexArray;
+    // size of the target and of the window it was made for
+    int m_targetWidth;
+    int m_targetHeight;
+    int m_windowWidth;
+    int m_windowHeight;
+    // part of the target drawn this frame
+    int m_renderWidth;
+    int m_renderHeight;
+
+    GLuint m_queries[TIMER_QUERY_COUNT];
+    bool m_bQueryPending[TIMER_QUERY_COUNT];
+    // query of the next frame, and of the oldest pending one
+    int m_nextQuery;
+    int m_oldestQuery;
+    bool m_bTiming;
+
+    float m_scale;
+    float m_gpuFrameTime;
+    double m_scaleSum;
+    unsigned long m_frameCount;
+};
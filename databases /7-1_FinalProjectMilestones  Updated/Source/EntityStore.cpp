@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.cpp
+// ============
+// scene objects as entities with generational handles, their components
+// kept in dense arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#include "EntityStore.h"
+
+// declare the global variables
+namespace
+{
+    // slot of an entity index that is not alive
+    const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    /***********************************************************
+     *  RemoveSlot()
+     *
+     *  Move the last element of a component array into a slot
+     *  and drop the last element.
+     ***********************************************************/
+    template <typename T>
+    void RemoveSlot(std::vector<T>& values, size_t slot)
+    {
+        values[slot] = values.back();
+        values.pop_back();
+    }
+}
+
+/***********************************************************
+ *  EntityStore()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+EntityStore::EntityStore()
+    : m_dirtyCount(0)
+{
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  Add an entity at the end of the component arrays. An
+ *  index of a destroyed entity is used again, with the
+ *  generation it got when that entity was destroyed.
+ ***********************************************************/
+ENTITY_HANDLE EntityStore::Create(const ENTITY_COMPONENTS& components)
+{
+    ENTITY_HANDLE entity;
+    if (!m_freeIndices.empty())
+    {
+        entity.index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else
+    {
+        entity.index = static_cast<uint32_t>(m_slots.size());
+        m_slots.push_back(NO_SLOT);
+        m_generations.push_back(1);
+    }
+    entity.generation = m_generations[entity.index];
+    m_slots[entity.index] = static_cast<uint32_t>(m_entityIndices.size());
+
+    m_entityIndices.push_back(entity.index);
+    m_scaleXYZ.push_back(components.scaleXYZ);
+    m_rotationDegrees.push_back(components.rotationDegrees);
+    m_positionXYZ.push_back(components.positionXYZ);
+    m_color.push_back(components.color);
+    m_mesh.push_back(components.mesh);
+    m_materialIndex.push_back(components.materialIndex);
+    m_textureSlot.push_back(components.textureSlot);
+    m_model.push_back(glm::mat4(1.0f));
+    m_worldBounds.push_back(glm::vec4(0.0f));
+    m_flags.push_back(ENTITY_FLAG_TRANSFORM_DIRTY);
+    ++m_dirtyCount;
+
+    return entity;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  Remove an entity by moving the last one into its slot,
+ *  and retire its handle by advancing the generation of its
+ *  index. Handles that are not alive are ignored.
+ ***********************************************************/
+void EntityStore::Destroy(ENTITY_HANDLE entity)
+{
+    const int slot = GetSlot(entity);
+    if (slot < 0)
+    {
+        return;
+    }
+
+    if (m_flags[slot] & ENTITY_FLAG_TRANSFORM_DIRTY)
+    {
+        --m_dirtyCount;
+    }
+
+    const uint32_t movedIndex = m_entityIndices.back();
+    RemoveSlot(m_entityIndices, slot);
+    RemoveSlot(m_scaleXYZ, slot);
+    RemoveSlot(m_rotationDegrees, slot);
+    RemoveSlot(m_positionXYZ, slot);
+    RemoveSlot(m_color, slot);
+    RemoveSlot(m_mesh, slot);
+    RemoveSlot(m_materialIndex, slot);
+    RemoveSlot(m_textureSlot, slot);
+    RemoveSlot(m_model, slot);
+    RemoveSlot(m_worldBounds, slot);
+    RemoveSlot(m_flags, slot);
+    m_slots[movedIndex] = static_cast<uint32_t>(slot);
+
+    m_slots[entity.index] = NO_SLOT;
+    ++m_generations[entity.index];
+    m_freeIndices.push_back(entity.index);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  Remove all entities. The generations are kept, so the
+ *  handles of the removed entities stay dead after their
+ *  indices are used again.
+ ***********************************************************/
+void EntityStore::Clear()
+{
+    for (uint32_t index : m_entityIndices)
+    {
+        m_slots[index] = NO_SLOT;
+        ++m_generations[index];
+        m_freeIndices.push_back(index);
+    }
+
+    m_entityIndices.clear();
+    m_scaleXYZ.clear();
+    m_rotationDegrees.clear();
+    m_positionXYZ.clear();
+    m_color.clear();
+    m_mesh.clear();
+    m_materialIndex.clear();
+    m_textureSlot.clear();
+    m_model.clear();
+    m_worldBounds.clear();
+    m_flags.clear();
+    m_dirtyCount = 0;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  Grow the component arrays once for a number of entities
+ *  about to be created.
+ ***********************************************************/
+void EntityStore::Reserve(size_t count)
+{
+    m_entityIndices.reserve(count);
+    m_scaleXYZ.reserve(count);
+    m_rotationDegrees.reserve(count);
+    m_positionXYZ.reserve(count);
+    m_color.reserve(count);
+    m_mesh.reserve(count);
+    m_materialIndex.reserve(count);
+    m_textureSlot.reserve(count);
+    m_model.reserve(count);
+    m_worldBounds.reserve(count);
+    m_flags.reserve(count);
+}
+
+/***********************************************************
+ *  IsAlive()
+ *
+ *  Check whether a handle names an entity that exists.
+ ***********************************************************/
+bool EntityStore::IsAlive(ENTITY_HANDLE entity) const
+{
+    return GetSlot(entity) >= 0;
+}
+
+/***********************************************************
+ *  GetSlot()
+ *
+ *  Get the position of an entity in the component arrays,
+ *  or -1 when the handle is not alive.
+ ***********************************************************/
+int EntityStore::GetSlot(ENTITY_HANDLE entity) const
+{
+    if (entity.index >= m_slots.size() ||
+        m_generations[entity.index] != entity.generation ||
+        m_slots[entity.index] == NO_SLOT)
+    {
+        return -1;
+    }
+    return static_cast<int>(m_slots[entity.index]);
+}
+
+/***********************************************************
+ *  GetHandle()
+ *
+ *  Get the handle of the entity in a slot.
+ ***********************************************************/
+ENTITY_HANDLE EntityStore::GetHandle(size_t slot) const
+{
+    ENTITY_HANDLE entity;
+    entity.index = m_entityIndices[slot];
+    entity.generation = m_generations[entity.index];
+    return entity;
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  Move, turn or resize a live entity, and flag it as one
+ *  that moves.
+ ***********************************************************/
+void EntityStore::SetTransform(
+    ENTITY_HANDLE entity,
+    const glm::vec3& scaleXYZ,
+    const glm::vec3& rotationDegrees,
+    const glm::vec3& positionXYZ)
+{
+    const int slot = GetSlot(entity);
+    if (slot < 0)
+    {
+        return;
+    }
+
+    m_scaleXYZ[slot] = scaleXYZ;
+    m_rotationDegrees[slot] = rotationDegrees;
+    m_positionXYZ[slot] = positionXYZ;
+    m_flags[slot] |= ENTITY_FLAG_MOVED;
+    MarkDirty(slot);
+}
+
+/***********************************************************
+ *  SetHidden()
+ *
+ *  Hide a live entity from the draw lists, or show it.
+ ***********************************************************/
+void EntityStore::SetHidden(ENTITY_HANDLE entity, bool bHidden)
+{
+    const int slot = GetSlot(entity);
+    if (slot < 0)
+    {
+        return;
+    }
+
+    if (bHidden)
+    {
+        m_flags[slot] |= ENTITY_FLAG_HIDDEN;
+    }
+    else
+    {
+        m_flags[slot] = static_cast<uint8_t>(m_flags[slot] & ~ENTITY_FLAG_HIDDEN);
+    }
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  Flag a slot for the next transform update.
+ ***********************************************************/
+void EntityStore::MarkDirty(size_t slot)
+{
+    if (!(m_flags[slot] & ENTITY_FLAG_TRANSFORM_DIRTY))
+    {
+        m_flags[slot] |= ENTITY_FLAG_TRANSFORM_DIRTY;
+        ++m_dirtyCount;
+    }
+}
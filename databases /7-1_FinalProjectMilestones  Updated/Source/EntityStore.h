@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// entitystore.h
+// ============
+// scene objects as entities with generational handles, their components
+// kept in dense arrays
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// names an entity; a handle whose entity was destroyed no longer
+// matches the generation of its index and is simply not alive
+struct ENTITY_HANDLE
+{
+    uint32_t index;
+    uint32_t generation;
+};
+
+// live generations start at 1, so this never names an entity
+const ENTITY_HANDLE INVALID_ENTITY = { 0, 0 };
+
+// bits of the flags component
+enum ENTITY_FLAGS
+{
+    // the model matrix and world bounds are out of date
+    ENTITY_FLAG_TRANSFORM_DIRTY = 0x01,
+    // skipped by the culling and draw building
+    ENTITY_FLAG_HIDDEN = 0x02,
+    // transformed again after it was created, so it is not
+    // merged into the static geometry
+    ENTITY_FLAG_MOVED = 0x04,
+    // drawn as part of a static batch rather than on its own
+    ENTITY_FLAG_BATCHED = 0x08
+};
+
+// component values of a new entity
+struct ENTITY_COMPONENTS
+{
+    glm::vec3 scaleXYZ;
+    glm::vec3 rotationDegrees;
+    glm::vec3 positionXYZ;
+    glm::vec4 color;
+    uint8_t mesh;
+    int16_t materialIndex;
+    int16_t textureSlot;
+};
+
+/***********************************************************
+ *  EntityStore
+ *
+ *  This class keeps each component of the scene objects in
+ *  an array of its own, packed without gaps and in the same
+ *  order for every component, so a system that works on a
+ *  few components streams through just those arrays. The
+ *  handles index a sparse array that holds the dense slot of
+ *  each entity; destroying one moves the last entity into
+ *  its slot, and a handle stays valid across such moves.
+ *
+ *  Every scene object has all components, so they share one
+ *  sparse set. The model matrix and world bounds are only
+ *  written by the transform system of the owner, for the
+ *  entities flagged as dirty. The arrays may move whenever
+ *  an entity is created or destroyed.
+ ***********************************************************/
+class EntityStore
+{
+public:
+    EntityStore();
+
+    // add an entity, with its transform flagged as dirty
+    ENTITY_HANDLE Create(const ENTITY_COMPONENTS& components);
+    // remove a live entity; other handles stay valid
+    void Destroy(ENTITY_HANDLE entity);
+    // remove all entities; their handles are never alive again
+    void Clear();
+    // make room for a number of entities
+    void Reserve(size_t count);
+
+    bool IsAlive(ENTITY_HANDLE entity) const;
+    // dense slot of a live entity, or -1
+    int GetSlot(ENTITY_HANDLE entity) const;
+    ENTITY_HANDLE GetHandle(size_t slot) const;
+    size_t GetCount() const { return m_entityIndices.size(); }
+
+    // change the components of a live entity
+    void SetTransform(ENTITY_HANDLE entity, const glm::vec3& scaleXYZ,
+        const glm::vec3& rotationDegrees, const glm::vec3& positionXYZ);
+    void SetHidden(ENTITY_HANDLE entity, bool bHidden);
+
+    // entities whose transform changed since the last update
+    size_t GetDirtyCount() const { return m_dirtyCount; }
+    // called by the transform system once it has cleared the
+    // dirty flags
+    void ClearDirtyCount() { m_dirtyCount = 0; }
+
+    // the component arrays, GetCount() entries each
+    const glm::vec3* GetScales() const { return m_scaleXYZ.data(); }
+    const glm::vec3* GetRotations() const { return m_rotationDegrees.data(); }
+    const glm::vec3* GetPositions() const { return m_positionXYZ.data(); }
+    const glm::vec4* GetColors() const { return m_color.data(); }
+    const uint8_t* GetMeshes() const { return m_mesh.data(); }
+    const int16_t* GetMaterialIndices() const { return m_materialIndex.data(); }
+    const int16_t* GetTextureSlots() const { return m_textureSlot.data(); }
+    const glm::mat4* GetModelMatrices() const { return m_model.data(); }
+    const glm::vec4* GetWorldBounds() const { return m_worldBounds.data(); }
+    const uint8_t* GetFlags() const { return m_flags.data(); }
+
+    // written by the transform system
+    glm::mat4* GetModelMatrices() { return m_model.data(); }
+    glm::vec4* GetWorldBounds() { return m_worldBounds.data(); }
+    uint8_t* GetFlags() { return m_flags.data(); }
+
+private:
+    // flag the transform of a slot as dirty
+    void MarkDirty(size_t slot);
+
+    // per entity index: its dense slot, or NO_SLOT when it is not
+    // alive, and its current generation
+    std::vector<uint32_t> m_slots;
+    std::vector<uint32_t> m_generations;
+    // entity indices that can be used again
+    std::vector<uint32_t> m_freeIndices;
+
+    // dense components, by slot
+    std::vector<uint32_t> m_entityIndices;
+    std::vector<glm::vec3> m_scaleXYZ;
+    std::vector<glm::vec3> m_rotationDegrees;
+    std::vector<glm::vec3> m_positionXYZ;
+    std::vector<glm::vec4> m_color;
+    std::vector<uint8_t> m_mesh;
+    std::vector<int16_t> m_materialIndex;
+    std::vector<int16_t> m_textureSlot;
+    std::vector<glm::mat4> m_model;
+    std::vector<glm::vec4> m_worldBounds;
+    std::vector<uint8_t> m_flags;
+
+    size_t m_dirtyCount;
+};
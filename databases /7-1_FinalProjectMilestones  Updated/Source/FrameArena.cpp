@@ -0,0 +1,213 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// per-thread linear memory for the data that only lives for one frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+// declare the global variables
+namespace
+{
+    // the main block grows in steps of this, with a quarter of the
+    // frame as headroom, so a frame that is a little larger than
+    // the last does not grow it again
+    const size_t ARENA_GROWTH_STEP = 64 * 1024;
+
+    // the arenas of one thread, one per frame buffer
+    struct THREAD_FRAME_ARENAS
+    {
+        FrameArena arenas[FRAME_ARENA_BUFFERS];
+    };
+
+    // arenas of all threads, for the reset at the end of a frame
+    std::mutex g_ArenaMutex;
+    std::vector<THREAD_FRAME_ARENAS*> g_ThreadArenas;
+
+    // buffer of the frame being prepared
+    std::atomic<int> g_CurrentBuffer(0);
+
+    // usage of the finished frames; written under g_ArenaMutex
+    size_t g_LastFrameBytes = 0;
+    size_t g_PeakFrameBytes = 0;
+    // overflows of the arenas of threads that have ended
+    uint64_t g_EndedThreadOverflows = 0;
+
+    /***********************************************************
+     *  THREAD_ARENA_OWNER
+     *
+     *  Registers the arenas of a thread when it first asks for
+     *  one, and removes and deletes them when it ends.
+     ***********************************************************/
+    struct THREAD_ARENA_OWNER
+    {
+        THREAD_FRAME_ARENAS* pArenas;
+
+        THREAD_ARENA_OWNER()
+            : pArenas(new THREAD_FRAME_ARENAS())
+        {
+            std::lock_guard<std::mutex> lock(g_ArenaMutex);
+            g_ThreadArenas.push_back(pArenas);
+        }
+
+        ~THREAD_ARENA_OWNER()
+        {
+            {
+                std::lock_guard<std::mutex> lock(g_ArenaMutex);
+                g_ThreadArenas.erase(std::find(g_ThreadArenas.begin(), g_ThreadArenas.end(), pArenas));
+                for (const FrameArena& arena : pArenas->arenas)
+                {
+                    g_EndedThreadOverflows += arena.GetOverflowCount();
+                }
+            }
+            delete pArenas;
+        }
+    };
+
+    /***********************************************************
+     *  AlignUp()
+     *
+     *  Round an offset up to a power of two.
+     ***********************************************************/
+    size_t AlignUp(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t capacity)
+    : m_pBlock(new unsigned char[capacity]),
+      m_capacity(capacity),
+      m_used(0),
+      m_overflowUsed(0),
+      m_peak(0),
+      m_overflowCount(0)
+{
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  Reserve size bytes after the previous allocation. When
+ *  the main block is full, the request gets a heap block of
+ *  its own, which lives until the next reset.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    // the block start is only aligned for the fundamental types,
+    // so align the address rather than the offset
+    const uintptr_t base = reinterpret_cast<uintptr_t>(m_pBlock.get());
+    const size_t offset = AlignUp(base + m_used, alignment) - base;
+    if (offset + size <= m_capacity)
+    {
+        m_used = offset + size;
+        return m_pBlock.get() + offset;
+    }
+
+    std::unique_ptr<unsigned char[]> pOverflow(new unsigned char[size + alignment]);
+    unsigned char* pMemory = reinterpret_cast<unsigned char*>(
+        AlignUp(reinterpret_cast<uintptr_t>(pOverflow.get()), alignment));
+    m_overflowBlocks.push_back(std::move(pOverflow));
+    m_overflowUsed += size + alignment;
+    return pMemory;
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  Rewind to the start of the main block. If the frame did
+ *  not fit, the overflow blocks are freed and the main block
+ *  is replaced by one that holds the whole frame.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+    const size_t used = GetUsedBytes();
+    m_peak = std::max(m_peak, used);
+
+    if (!m_overflowBlocks.empty())
+    {
+        m_overflowBlocks.clear();
+        m_overflowBlocks.shrink_to_fit();
+        m_capacity = AlignUp(used + used / 4, ARENA_GROWTH_STEP);
+        m_pBlock.reset(new unsigned char[m_capacity]);
+        ++m_overflowCount;
+    }
+
+    m_used = 0;
+    m_overflowUsed = 0;
+}
+
+/***********************************************************
+ *  GetFrameArena()
+ *
+ *  Get the arena of the calling thread for the frame being
+ *  prepared. The first call on a thread creates its arenas.
+ ***********************************************************/
+FrameArena& GetFrameArena()
+{
+    thread_local THREAD_ARENA_OWNER owner;
+    return owner.pArenas->arenas[g_CurrentBuffer.load(std::memory_order_acquire)];
+}
+
+/***********************************************************
+ *  AdvanceFrameArenas()
+ *
+ *  Add up what the threads allocated for the frame that
+ *  ends, then reset the arenas of the other buffer, which
+ *  hold the frame before it, and prepare the next frame in
+ *  them. The memory of the frame that ends stays valid
+ *  until the next call.
+ ***********************************************************/
+void AdvanceFrameArenas()
+{
+    std::lock_guard<std::mutex> lock(g_ArenaMutex);
+
+    const int current = g_CurrentBuffer.load(std::memory_order_relaxed);
+    const int next = (current + 1) % FRAME_ARENA_BUFFERS;
+
+    size_t frameBytes = 0;
+    for (THREAD_FRAME_ARENAS* pArenas : g_ThreadArenas)
+    {
+        frameBytes += pArenas->arenas[current].GetUsedBytes();
+        pArenas->arenas[next].Reset();
+    }
+    g_LastFrameBytes = frameBytes;
+    g_PeakFrameBytes = std::max(g_PeakFrameBytes, frameBytes);
+
+    g_CurrentBuffer.store(next, std::memory_order_release);
+}
+
+/***********************************************************
+ *  GetFrameArenaStats()
+ *
+ *  Get the arena usage of the frames so far.
+ ***********************************************************/
+FRAME_ARENA_STATS GetFrameArenaStats()
+{
+    std::lock_guard<std::mutex> lock(g_ArenaMutex);
+
+    FRAME_ARENA_STATS stats;
+    stats.threadCount = g_ThreadArenas.size();
+    stats.lastFrameBytes = g_LastFrameBytes;
+    stats.peakFrameBytes = g_PeakFrameBytes;
+    stats.capacityBytes = 0;
+    stats.overflows = g_EndedThreadOverflows;
+    for (const THREAD_FRAME_ARENAS* pArenas : g_ThreadArenas)
+    {
+        for (const FrameArena& arena : pArenas->arenas)
+        {
+            stats.capacityBytes += arena.GetCapacity();
+            stats.overflows += arena.GetOverflowCount();
+        }
+    }
+    return stats;
+}
@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// per-thread linear memory for the data that only lives for one frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  A bump allocator: an allocation moves a pointer through
+ *  one block, nothing is freed on its own, and Reset() makes
+ *  the whole block available again by rewinding the pointer.
+ *  Requests that do not fit are served from extra heap
+ *  blocks; the next Reset() frees those and grows the main
+ *  block to what the frame needed, so a settled frame
+ *  neither allocates nor frees.
+ *
+ *  An arena is not thread-safe; each thread allocates from
+ *  its own, see GetFrameArena().
+ ***********************************************************/
+class FrameArena
+{
+public:
+    // size of the main block of a new arena
+    static const size_t DEFAULT_CAPACITY = 256 * 1024;
+
+    explicit FrameArena(size_t capacity = DEFAULT_CAPACITY);
+
+    // reserve size bytes aligned to the given power of two; never
+    // returns nullptr, and throws std::bad_alloc when the heap is
+    // exhausted
+    void* Allocate(size_t size, size_t alignment);
+    // uninitialized room for count objects of type T
+    template <typename T>
+    T* AllocateArray(size_t count)
+    {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // release everything allocated since the last reset
+    void Reset();
+
+    // bytes allocated since the last reset, including overflow
+    size_t GetUsedBytes() const { return m_used + m_overflowUsed; }
+    // most bytes allocated between two resets
+    size_t GetPeakBytes() const { return m_peak; }
+    size_t GetCapacity() const { return m_capacity; }
+    // resets after which the main block had to grow
+    uint64_t GetOverflowCount() const { return m_overflowCount; }
+
+private:
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    std::unique_ptr<unsigned char[]> m_pBlock;
+    size_t m_capacity;
+    size_t m_used;
+
+    // heap blocks of the requests that did not fit, and their bytes
+    std::vector<std::unique_ptr<unsigned char[]>> m_overflowBlocks;
+    size_t m_overflowUsed;
+
+    size_t m_peak;
+    uint64_t m_overflowCount;
+};
+
+/***********************************************************
+ *  FrameAllocator
+ *
+ *  Allocator for the standard containers that takes its
+ *  memory from a frame arena. Deallocation does nothing;
+ *  the memory comes back when the arena is reset, so a
+ *  container must be emptied or rebound to a new arena
+ *  before that. An allocator without an arena uses the
+ *  heap, so a default constructed container still works.
+ ***********************************************************/
+template <typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef FrameAllocator<U> other;
+    };
+
+    FrameAllocator() noexcept : m_pArena(nullptr) {}
+    explicit FrameAllocator(FrameArena* pArena) noexcept : m_pArena(pArena) {}
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other) noexcept : m_pArena(other.GetArena()) {}
+
+    T* allocate(size_t count)
+    {
+        if (m_pArena == nullptr)
+        {
+            return static_cast<T*>(::operator new(count * sizeof(T)));
+        }
+        return m_pArena->AllocateArray<T>(count);
+    }
+
+    void deallocate(T* pMemory, size_t) noexcept
+    {
+        if (m_pArena == nullptr)
+        {
+            ::operator delete(pMemory);
+        }
+    }
+
+    FrameArena* GetArena() const noexcept { return m_pArena; }
+
+private:
+    FrameArena* m_pArena;
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) noexcept
+{
+    return a.GetArena() == b.GetArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) noexcept
+{
+    return a.GetArena() != b.GetArena();
+}
+
+// vector whose storage lives in a frame arena
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+// frames whose arena memory is valid at the same time, so the
+// frame being prepared does not overwrite the one before it
+const int FRAME_ARENA_BUFFERS = 2;
+
+// arena usage over all threads
+struct FRAME_ARENA_STATS
+{
+    // threads that have allocated from an arena
+    size_t threadCount;
+    // bytes allocated by all threads in the last frame, and the
+    // most of any frame
+    size_t lastFrameBytes;
+    size_t peakFrameBytes;
+    // main block bytes of all arenas
+    size_t capacityBytes;
+    // times an arena had to grow
+    uint64_t overflows;
+};
+
+// the arena of the calling thread for the current frame; created
+// on first use and released when the thread ends
+FrameArena& GetFrameArena();
+// close the current frame: record its usage, switch to the other
+// buffer and reset the arenas of all threads in it. Call it from
+// the main loop once the frame preparation is done, while no
+// other thread is allocating from an arena
+void AdvanceFrameArenas();
+FRAME_ARENA_STATS GetFrameArenaStats();
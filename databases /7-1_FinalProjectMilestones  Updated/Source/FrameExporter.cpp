@@ -0,0 +1,747 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameexporter.cpp
+// ============
+// read the rendered frames back without stalling and write them out as
+// image sequences or raw video on a background thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameExporter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declare the global variables
+namespace
+{
+    // how long a single fence wait may block, in nanoseconds
+    const GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+
+    // longest time a waiting thread sleeps before checking its
+    // queue again, in case a wake-up was missed
+    const std::chrono::milliseconds WAKE_TIMEOUT(2);
+
+    // LZ77 window and match limits of deflate
+    const size_t DEFLATE_WINDOW = 32768;
+    const size_t MIN_MATCH = 3;
+    const size_t MAX_MATCH = 258;
+    // the hash table of the matcher has 1 << HASH_BITS entries
+    const int HASH_BITS = 15;
+
+    const uint16_t LENGTH_BASE[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LENGTH_EXTRA[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DISTANCE_BASE[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+        8193, 12289, 16385, 24577 };
+    const uint8_t DISTANCE_EXTRA[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    /***********************************************************
+     *  BitWriter
+     *
+     *  Appends bit fields least significant bit first, as
+     *  deflate stores them.
+     ***********************************************************/
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<uint8_t>& output)
+            : m_output(output), m_bits(0), m_bitCount(0) {}
+
+        void PutBits(uint32_t value, int count)
+        {
+            m_bits |= value << m_bitCount;
+            m_bitCount += count;
+            while (m_bitCount >= 8)
+            {
+                m_output.push_back(static_cast<uint8_t>(m_bits));
+                m_bits >>= 8;
+                m_bitCount -= 8;
+            }
+        }
+
+        // Huffman codes are defined most significant bit first
+        void PutCode(uint32_t code, int length)
+        {
+            uint32_t reversed = 0;
+            for (int i = 0; i < length; ++i)
+            {
+                reversed = (reversed << 1) | ((code >> i) & 1);
+            }
+            PutBits(reversed, length);
+        }
+
+        void Flush()
+        {
+            if (m_bitCount > 0)
+            {
+                m_output.push_back(static_cast<uint8_t>(m_bits));
+            }
+            m_bits = 0;
+            m_bitCount = 0;
+        }
+
+    private:
+        std::vector<uint8_t>& m_output;
+        uint32_t m_bits;
+        int m_bitCount;
+    };
+
+    /***********************************************************
+     *  PutLiteralLength()
+     *
+     *  Write a literal or length symbol with the fixed Huffman
+     *  code of deflate.
+     ***********************************************************/
+    void PutLiteralLength(BitWriter& writer, uint32_t symbol)
+    {
+        if (symbol < 144)
+        {
+            writer.PutCode(0x30 + symbol, 8);
+        }
+        else if (symbol < 256)
+        {
+            writer.PutCode(0x190 + symbol - 144, 9);
+        }
+        else if (symbol < 280)
+        {
+            writer.PutCode(symbol - 256, 7);
+        }
+        else
+        {
+            writer.PutCode(0xC0 + symbol - 280, 8);
+        }
+    }
+
+    /***********************************************************
+     *  PutMatch()
+     *
+     *  Write a back reference of the LZ77 matcher.
+     ***********************************************************/
+    void PutMatch(BitWriter& writer, size_t length, size_t distance)
+    {
+        int lengthCode = 28;
+        while (LENGTH_BASE[lengthCode] > length)
+        {
+            --lengthCode;
+        }
+        PutLiteralLength(writer, 257 + lengthCode);
+        writer.PutBits(static_cast<uint32_t>(length - LENGTH_BASE[lengthCode]), LENGTH_EXTRA[lengthCode]);
+
+        int distanceCode = 29;
+        while (DISTANCE_BASE[distanceCode] > distance)
+        {
+            --distanceCode;
+        }
+        writer.PutCode(distanceCode, 5);
+        writer.PutBits(static_cast<uint32_t>(distance - DISTANCE_BASE[distanceCode]), DISTANCE_EXTRA[distanceCode]);
+    }
+
+    /***********************************************************
+     *  Deflate()
+     *
+     *  Compress data into a zlib stream of one fixed Huffman
+     *  block. The matcher only tries the last position with
+     *  the same three bytes, which trades some file size for
+     *  an encoder that keeps up with the frame rate. The hash
+     *  table of the matcher is passed in to be reused.
+     ***********************************************************/
+    void Deflate(const std::vector<uint8_t>& data, std::vector<int32_t>& lastPosition, std::vector<uint8_t>& output)
+    {
+        output.clear();
+        output.push_back(0x78);                             // deflate, 32K window
+        output.push_back(0x01);                             // fastest compression
+
+        BitWriter writer(output);
+        writer.PutBits(1, 1);                               // last block
+        writer.PutBits(1, 2);                               // fixed Huffman codes
+
+        lastPosition.assign(size_t(1) << HASH_BITS, -1);
+        const size_t size = data.size();
+        size_t position = 0;
+        while (position < size)
+        {
+            size_t matchLength = 0;
+            size_t matchDistance = 0;
+            uint32_t hash = 0;
+            if (position + MIN_MATCH <= size)
+            {
+                hash = (data[position] << 16) | (data[position + 1] << 8) | data[position + 2];
+                hash = (hash * 2654435761u) >> (32 - HASH_BITS);
+
+                const int32_t candidate = lastPosition[hash];
+                lastPosition[hash] = static_cast<int32_t>(position);
+                if (candidate >= 0 && position - candidate <= DEFLATE_WINDOW)
+                {
+                    const size_t limit = std::min(MAX_MATCH, size - position);
+                    size_t length = 0;
+                    while (length < limit && data[candidate + length] == data[position + length])
+                    {
+                        ++length;
+                    }
+                    if (length >= MIN_MATCH)
+                    {
+                        matchLength = length;
+                        matchDistance = position - candidate;
+                    }
+                }
+            }
+
+            if (matchLength > 0)
+            {
+                PutMatch(writer, matchLength, matchDistance);
+                position += matchLength;
+            }
+            else
+            {
+                PutLiteralLength(writer, data[position]);
+                ++position;
+            }
+        }
+        PutLiteralLength(writer, 256);                      // end of block
+        writer.Flush();
+
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (size_t i = 0; i < size; ++i)
+        {
+            a = (a + data[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        const uint32_t adler = (b << 16) | a;
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            output.push_back(static_cast<uint8_t>(adler >> shift));
+        }
+    }
+
+    /***********************************************************
+     *  GetCrc32()
+     *
+     *  The CRC of a PNG chunk.
+     ***********************************************************/
+    uint32_t GetCrc32(const uint8_t* pData, size_t size)
+    {
+        static uint32_t table[256];
+        static bool bTableReady = false;
+        if (!bTableReady)
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t value = i;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+                }
+                table[i] = value;
+            }
+            bTableReady = true;
+        }
+
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    /***********************************************************
+     *  PutChunk()
+     *
+     *  Append a PNG chunk with its length and CRC.
+     ***********************************************************/
+    void PutChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data)
+    {
+        const uint32_t length = static_cast<uint32_t>(data.size());
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            png.push_back(static_cast<uint8_t>(length >> shift));
+        }
+        const size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        const uint32_t crc = GetCrc32(png.data() + start, png.size() - start);
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            png.push_back(static_cast<uint8_t>(crc >> shift));
+        }
+    }
+
+    /***********************************************************
+     *  GetPaethPredictor()
+     *
+     *  The neighbour closest to left + above - upper left.
+     ***********************************************************/
+    int GetPaethPredictor(int left, int above, int upperLeft)
+    {
+        const int estimate = left + above - upperLeft;
+        const int distanceLeft = abs(estimate - left);
+        const int distanceAbove = abs(estimate - above);
+        const int distanceUpperLeft = abs(estimate - upperLeft);
+        if (distanceLeft <= distanceAbove && distanceLeft <= distanceUpperLeft)
+        {
+            return left;
+        }
+        return distanceAbove <= distanceUpperLeft ? above : upperLeft;
+    }
+
+    /***********************************************************
+     *  FilterRow()
+     *
+     *  Apply one PNG filter to a row of RGB bytes; returns the
+     *  sum of the filtered bytes as signed values.
+     ***********************************************************/
+    uint32_t FilterRow(int filter, const uint8_t* pRow, const uint8_t* pAbove, size_t rowSize, uint8_t* pOutput)
+    {
+        const size_t PIXEL_SIZE = 3;
+        uint32_t sum = 0;
+        for (size_t i = 0; i < rowSize; ++i)
+        {
+            const int left = i >= PIXEL_SIZE ? pRow[i - PIXEL_SIZE] : 0;
+            const int above = pAbove != nullptr ? pAbove[i] : 0;
+            const int upperLeft = pAbove != nullptr && i >= PIXEL_SIZE ? pAbove[i - PIXEL_SIZE] : 0;
+
+            int prediction = 0;
+            switch (filter)
+            {
+            case 1: prediction = left; break;
+            case 2: prediction = above; break;
+            case 3: prediction = GetPaethPredictor(left, above, upperLeft); break;
+            default: break;
+            }
+            const uint8_t value = static_cast<uint8_t>(pRow[i] - prediction);
+            pOutput[i] = value;
+            sum += value < 128 ? value : 256 - value;
+        }
+        return sum;
+    }
+
+    /***********************************************************
+     *  EncodePng()
+     *
+     *  Encode bottom-up RGBA8 pixels as a top-down RGB PNG.
+     *  Each row uses the filter with the smallest sum of
+     *  absolute differences, the usual PNG heuristic; the
+     *  average filter is left out as it rarely wins on
+     *  rendered images. The file ends up in buffers.png.
+     ***********************************************************/
+    void EncodePng(const uint8_t* pPixels, int width, int height, PNG_ENCODER_BUFFERS& buffers)
+    {
+        // PNG filter types of the None, Sub, Up and Paeth filters
+        const uint8_t FILTER_TYPES[4] = { 0, 1, 2, 4 };
+
+        const size_t rowSize = static_cast<size_t>(width) * 3;
+        std::vector<uint8_t>& rows = buffers.rows;
+        std::vector<uint8_t>& candidate = buffers.candidate;
+        std::vector<uint8_t>& best = buffers.best;
+        std::vector<uint8_t>& filtered = buffers.filtered;
+        std::vector<uint8_t>& png = buffers.png;
+        rows.resize(rowSize * 2);
+        candidate.resize(rowSize);
+        best.resize(rowSize);
+
+        filtered.clear();
+        filtered.reserve((rowSize + 1) * height);
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* pRow = rows.data() + (y & 1) * rowSize;
+            const uint8_t* pAbove = y > 0 ? rows.data() + ((y - 1) & 1) * rowSize : nullptr;
+            const uint8_t* pSource = pPixels + static_cast<size_t>(height - 1 - y) * width * 4;
+            for (int x = 0; x < width; ++x)
+            {
+                pRow[x * 3 + 0] = pSource[x * 4 + 0];
+                pRow[x * 3 + 1] = pSource[x * 4 + 1];
+                pRow[x * 3 + 2] = pSource[x * 4 + 2];
+            }
+
+            int bestFilter = 0;
+            uint32_t bestSum = FilterRow(0, pRow, pAbove, rowSize, best.data());
+            for (int filter = 1; filter < 4; ++filter)
+            {
+                const uint32_t sum = FilterRow(filter, pRow, pAbove, rowSize, candidate.data());
+                if (sum < bestSum)
+                {
+                    bestSum = sum;
+                    bestFilter = filter;
+                    best.swap(candidate);
+                }
+            }
+
+            filtered.push_back(FILTER_TYPES[bestFilter]);
+            filtered.insert(filtered.end(), best.begin(), best.end());
+        }
+
+        const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        png.assign(SIGNATURE, SIGNATURE + sizeof(SIGNATURE));
+
+        std::vector<uint8_t>& header = buffers.header;
+        header.clear();
+        for (uint32_t value : { static_cast<uint32_t>(width), static_cast<uint32_t>(height) })
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+            {
+                header.push_back(static_cast<uint8_t>(value >> shift));
+            }
+        }
+        header.push_back(8);                                // bits per channel
+        header.push_back(2);                                // RGB
+        header.push_back(0);                                // deflate
+        header.push_back(0);                                // adaptive filters
+        header.push_back(0);                                // not interlaced
+        PutChunk(png, "IHDR", header);
+
+        Deflate(filtered, buffers.hashPositions, buffers.compressed);
+        PutChunk(png, "IDAT", buffers.compressed);
+        PutChunk(png, "IEND", std::vector<uint8_t>());
+    }
+}
+
+/***********************************************************
+ *  FrameExporter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameExporter::FrameExporter()
+    : m_format(EXPORT_PNG_SEQUENCE),
+      m_bOpen(false),
+      m_nextSlot(0),
+      m_nextFrameIndex(0),
+      m_streamWidth(0),
+      m_streamHeight(0),
+      m_bRunning(false),
+      m_bWriteFailed(false)
+{
+    for (auto& slot : m_slots)
+    {
+        slot.buffer = 0;
+        slot.fence = 0;
+        slot.width = 0;
+        slot.height = 0;
+        slot.capacity = 0;
+    }
+
+    // all frames start out unused
+    for (auto& frame : m_frames)
+    {
+        m_freeQueue.TryPush(&frame);
+    }
+
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~FrameExporter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameExporter::~FrameExporter()
+{
+    Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used to open the export target and start
+ *  the encoder thread. No OpenGL calls are made until the
+ *  first frame is captured.
+ ***********************************************************/
+bool FrameExporter::Open(const char* target, EXPORT_FORMAT format)
+{
+    Close();
+
+    m_format = format;
+    m_target = target;
+    if (EXPORT_RAW_STREAM == m_format)
+    {
+        m_stream.open(target, std::ios::binary | std::ios::trunc);
+        if (!m_stream)
+        {
+            std::cout << "ERROR: Could not open the export stream " << target << std::endl;
+            return false;
+        }
+    }
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_nextSlot = 0;
+    m_nextFrameIndex = 0;
+    m_streamWidth = 0;
+    m_streamHeight = 0;
+
+    m_bWriteFailed = false;
+    m_bRunning = true;
+    m_thread = std::thread(&FrameExporter::Run, this);
+    m_bOpen = true;
+    return true;
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is used to start the readback of the frame
+ *  that was just drawn into the next pixel pack buffer of
+ *  the ring. The readback that buffer held, issued
+ *  READBACK_SLOTS frames ago, is handed to the encoder
+ *  first. Called before the buffers are swapped.
+ ***********************************************************/
+void FrameExporter::CaptureFrame(int width, int height)
+{
+    if (!m_bOpen || width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // a raw stream has no header, so every frame must keep the
+    // size of the first one
+    if (EXPORT_RAW_STREAM == m_format)
+    {
+        if (0 == m_streamWidth)
+        {
+            m_streamWidth = width;
+            m_streamHeight = height;
+            std::cout << "INFO: Exporting " << width << "x" << height << " RGBA frames to " << m_target << std::endl;
+        }
+        else if (width != m_streamWidth || height != m_streamHeight)
+        {
+            ++m_stats.framesSkipped;
+            return;
+        }
+    }
+
+    READBACK_SLOT& slot = m_slots[m_nextSlot];
+    m_nextSlot = (m_nextSlot + 1) % READBACK_SLOTS;
+    ResolveSlot(slot);
+
+    const size_t size = static_cast<size_t>(width) * height * 4;
+    if (0 == slot.buffer)
+    {
+        glGenBuffers(1, &slot.buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (size > slot.capacity)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+
+    // with a pack buffer bound the copy is queued on the GPU and
+    // the call returns at once
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    m_stats.captureTime += std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+/***********************************************************
+ *  ResolveSlot()
+ *
+ *  This method is used to map a finished readback, copy
+ *  its pixels into a free frame and queue the frame for
+ *  the encoder. It only blocks when the GPU is more than
+ *  READBACK_SLOTS frames behind or the encoder has no
+ *  free frame left.
+ ***********************************************************/
+void FrameExporter::ResolveSlot(READBACK_SLOT& slot)
+{
+    if (0 == slot.fence)
+    {
+        return;
+    }
+
+    GLenum result = glClientWaitSync(slot.fence, 0, 0);
+    if (GL_TIMEOUT_EXPIRED == result)
+    {
+        ++m_stats.readbackWaits;
+
+        // the first wait flushes, so the fence is guaranteed to signal
+        GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        do
+        {
+            result = glClientWaitSync(slot.fence, waitFlags, FENCE_WAIT_TIMEOUT);
+            waitFlags = 0;
+        } while (GL_TIMEOUT_EXPIRED == result);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    EXPORT_FRAME* pFrame = nullptr;
+    if (!m_freeQueue.TryPop(pFrame))
+    {
+        ++m_stats.encoderWaits;
+        while (!m_freeQueue.TryPop(pFrame))
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_freeSignal.wait_for(lock, WAKE_TIMEOUT);
+        }
+    }
+
+    const size_t size = static_cast<size_t>(slot.width) * slot.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (pMapped != nullptr)
+    {
+        pFrame->pixels.resize(size);
+        memcpy(pFrame->pixels.data(), pMapped, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else
+    {
+        // the encoder returns empty frames without writing them
+        pFrame->pixels.clear();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pFrame->width = slot.width;
+    pFrame->height = slot.height;
+    pFrame->index = m_nextFrameIndex++;
+    if (pMapped != nullptr)
+    {
+        ++m_stats.framesExported;
+    }
+
+    // the queue holds every frame, so it can never be full
+    m_encodeQueue.TryPush(pFrame);
+    m_encodeSignal.notify_one();
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used to hand the readbacks still in the
+ *  ring to the encoder, oldest first, wait until they are
+ *  written and release the pixel pack buffers.
+ ***********************************************************/
+void FrameExporter::Close()
+{
+    if (!m_bOpen)
+    {
+        return;
+    }
+
+    for (int i = 0; i < READBACK_SLOTS; ++i)
+    {
+        ResolveSlot(m_slots[(m_nextSlot + i) % READBACK_SLOTS]);
+    }
+
+    m_bRunning = false;
+    m_encodeSignal.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    for (auto& slot : m_slots)
+    {
+        if (slot.buffer != 0)
+        {
+            glDeleteBuffers(1, &slot.buffer);
+        }
+        slot.buffer = 0;
+        slot.capacity = 0;
+    }
+
+    if (m_stream.is_open())
+    {
+        m_stream.close();
+    }
+    m_bOpen = false;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is the encoder thread entry point. It
+ *  writes the queued frames in order and returns them to
+ *  the free queue until the exporter is closed and the
+ *  queue is empty.
+ ***********************************************************/
+void FrameExporter::Run()
+{
+    PNG_ENCODER_BUFFERS buffers;
+
+    for (;;)
+    {
+        EXPORT_FRAME* pFrame = nullptr;
+        if (m_encodeQueue.TryPop(pFrame))
+        {
+            // after a failed write the frames are only returned, so
+            // the render thread never waits for a dead encoder
+            if (!m_bWriteFailed && !pFrame->pixels.empty() &&
+                !WriteFrame(*pFrame, buffers))
+            {
+                m_bWriteFailed = true;
+            }
+
+            m_freeQueue.TryPush(pFrame);
+            m_freeSignal.notify_one();
+            continue;
+        }
+
+        // the flag is cleared after the last push, so an empty
+        // queue seen after it is final
+        if (!m_bRunning && m_encodeQueue.IsEmpty())
+        {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_encodeSignal.wait_for(lock, WAKE_TIMEOUT);
+    }
+}
+
+/***********************************************************
+ *  WriteFrame()
+ *
+ *  This method is used to write one frame as the next PNG
+ *  file of the sequence or to append it to the raw stream,
+ *  top row first.
+ ***********************************************************/
+bool FrameExporter::WriteFrame(const EXPORT_FRAME& frame, PNG_ENCODER_BUFFERS& buffers)
+{
+    if (EXPORT_RAW_STREAM == m_format)
+    {
+        const size_t rowSize = static_cast<size_t>(frame.width) * 4;
+        for (int y = frame.height - 1; y >= 0; --y)
+        {
+            m_stream.write(reinterpret_cast<const char*>(frame.pixels.data() + y * rowSize), rowSize);
+        }
+        if (!m_stream)
+        {
+            std::cout << "ERROR: Could not write to the export stream " << m_target << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    std::ostringstream filename;
+    filename << m_target << std::setw(6) << std::setfill('0') << frame.index + 1 << ".png";
+
+    EncodePng(frame.pixels.data(), frame.width, frame.height, buffers);
+    std::ofstream file(filename.str(), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(buffers.png.data()), buffers.png.size());
+    if (!file)
+    {
+        std::cout << "ERROR: Could not write the exported frame " << filename.str() << std::endl;
+        return false;
+    }
+    return true;
+}
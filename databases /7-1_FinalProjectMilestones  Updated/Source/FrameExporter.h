@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameexporter.h
+// ============
+// read the rendered frames back without stalling and write them out as
+// image sequences or raw video on a background thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SpscQueue.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// how the exported frames are written
+enum EXPORT_FORMAT
+{
+    // one PNG file per frame, named prefix000001.png and so on
+    EXPORT_PNG_SEQUENCE = 0,
+    // top-down RGBA8 frames without a header, appended to one file or
+    // named pipe, e.g. for ffmpeg -f rawvideo -pix_fmt rgba
+    EXPORT_RAW_STREAM
+};
+
+// buffers of the PNG encoder; the encoder thread keeps one set, so
+// their capacity carries over from frame to frame
+struct PNG_ENCODER_BUFFERS
+{
+    // the current and the previous row as RGB bytes
+    std::vector<uint8_t> rows;
+    // a row through the filter being tried and through the best one
+    std::vector<uint8_t> candidate;
+    std::vector<uint8_t> best;
+    // the filtered rows, each after its filter type
+    std::vector<uint8_t> filtered;
+    // last position of each hash of three bytes, for the matcher
+    std::vector<int32_t> hashPositions;
+    std::vector<uint8_t> header;
+    std::vector<uint8_t> compressed;
+    // the encoded file
+    std::vector<uint8_t> png;
+};
+
+/***********************************************************
+ *  FrameExporter
+ *
+ *  This class copies the back buffer of every frame into a
+ *  ring of pixel pack buffers with an asynchronous
+ *  glReadPixels and fences the copy. A buffer is only
+ *  mapped READBACK_SLOTS frames later, when the GPU has long
+ *  finished with it, so the readback never waits for the
+ *  frame that was just submitted. The pixels are handed to
+ *  an encoder thread through a lock-free queue; a second
+ *  queue returns the frame memory, which bounds the frames
+ *  in flight and avoids per-frame allocations.
+ *
+ *  CaptureFrame() and Close() must be called on the thread
+ *  that owns the OpenGL context.
+ ***********************************************************/
+class FrameExporter
+{
+public:
+    // frames read back by the GPU before the oldest is mapped
+    static const int READBACK_SLOTS = 3;
+    // frames waiting for or being written by the encoder
+    static const size_t ENCODE_QUEUE_FRAMES = 8;
+
+    // what the export cost the render thread
+    struct STATS
+    {
+        unsigned long framesExported;
+        // mapped readbacks whose fence had not signaled yet
+        unsigned long readbackWaits;
+        // frames that waited for the encoder to free memory
+        unsigned long encoderWaits;
+        // frames skipped because their size changed mid-stream
+        unsigned long framesSkipped;
+        // time spent in CaptureFrame(), in milliseconds
+        double captureTime;
+    };
+
+    // constructor
+    FrameExporter();
+    // destructor
+    ~FrameExporter();
+
+    // start the encoder thread; target is the file name prefix of
+    // a PNG sequence or the file or pipe of a raw stream
+    bool Open(const char* target, EXPORT_FORMAT format);
+    // queue the readback of the back buffer of the frame that was
+    // just drawn, and hand the oldest finished readback to the
+    // encoder
+    void CaptureFrame(int width, int height);
+    // hand the pending readbacks to the encoder, write them out
+    // and stop the encoder thread
+    void Close();
+
+    bool IsOpen() const { return m_bOpen; }
+    STATS GetStats() const { return m_stats; }
+
+private:
+    // one readback in the ring of pixel pack buffers
+    struct READBACK_SLOT
+    {
+        GLuint buffer;
+        GLsync fence;
+        int width;
+        int height;
+        size_t capacity;
+    };
+
+    // the pixels of one frame, owned by the render thread while
+    // it is in the free queue and by the encoder otherwise
+    struct EXPORT_FRAME
+    {
+        std::vector<uint8_t> pixels;
+        int width;
+        int height;
+        unsigned long index;
+    };
+
+    // map a finished readback and queue its pixels for encoding
+    void ResolveSlot(READBACK_SLOT& slot);
+    // encoder thread entry point
+    void Run();
+    // write one frame in the export format, encoding it in the
+    // buffers of the encoder thread
+    bool WriteFrame(const EXPORT_FRAME& frame, PNG_ENCODER_BUFFERS& buffers);
+
+    EXPORT_FORMAT m_format;
+    std::string m_target;
+    std::ofstream m_stream;
+    bool m_bOpen;
+
+    READBACK_SLOT m_slots[READBACK_SLOTS];
+    int m_nextSlot;
+    unsigned long m_nextFrameIndex;
+    // size of the first frame, which a raw stream keeps
+    int m_streamWidth;
+    int m_streamHeight;
+
+    EXPORT_FRAME m_frames[ENCODE_QUEUE_FRAMES];
+    // render thread -> encoder thread
+    SpscQueue<EXPORT_FRAME*, ENCODE_QUEUE_FRAMES> m_encodeQueue;
+    // encoder thread -> render thread
+    SpscQueue<EXPORT_FRAME*, ENCODE_QUEUE_FRAMES> m_freeQueue;
+
+    std::thread m_thread;
+    std::atomic<bool> m_bRunning;
+    std::atomic<bool> m_bWriteFailed;
+
+    // used only to sleep while a queue is empty
+    std::mutex m_wakeMutex;
+    std::condition_variable m_encodeSignal;
+    std::condition_variable m_freeSignal;
+
+    STATS m_stats;
+};
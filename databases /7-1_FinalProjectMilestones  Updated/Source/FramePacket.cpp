@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacket.cpp
+// ============
+// everything the GL submission needs to draw one frame, produced by the
+// scene and view managers without touching OpenGL
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacket.h"
+
+#include <cstring>
+
+/***********************************************************
+ *  MakeDrawSortKey()
+ *
+ *  This function is used to build a 64-bit sort key:
+ *
+ *    opaque       0 | mesh:7 | material:16 | texture:8 | depth:32
+ *    translucent  1 | 0:31                             | ~depth:32
+ *
+ *  so sorting groups the opaque draws by state and then
+ *  front to back, and draws the translucent ones last and
+ *  back to front. A non-negative float keeps its order when
+ *  its bits are compared as an unsigned integer.
+ ***********************************************************/
+uint64_t MakeDrawSortKey(
+    MESH_TYPE mesh,
+    int materialIndex,
+    int textureSlot,
+    bool bTranslucent,
+    float viewDistance)
+{
+    uint32_t depthBits = 0;
+    if (viewDistance > 0.0f)
+    {
+        std::memcpy(&depthBits, &viewDistance, sizeof(depthBits));
+    }
+
+    if (bTranslucent)
+    {
+        return (uint64_t(1) << 63) | uint64_t(~depthBits);
+    }
+
+    return (uint64_t(mesh & 0x7F) << 56) |
+           (uint64_t((materialIndex + 1) & 0xFFFF) << 40) |
+           (uint64_t((textureSlot + 1) & 0xFF) << 32) |
+           uint64_t(depthBits);
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacket.h
+// ============
+// everything the GL submission needs to draw one frame, produced by the
+// scene and view managers without touching OpenGL
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+// basic shape meshes that can be referenced by a draw command
+enum MESH_TYPE
+{
+    MESH_BOX = 0,
+    MESH_PLANE,
+    MESH_CYLINDER,
+    MESH_CONE,
+    MESH_PRISM,
+    MESH_PYRAMID4,
+    MESH_SPHERE,
+    MESH_TAPERED_CYLINDER,
+    MESH_TORUS,
+    MESH_COUNT
+};
+
+// a single mesh draw with its resolved shader settings
+struct DRAW_COMMAND
+{
+    // submission order: opaque draws grouped by mesh, material and
+    // texture, then front to back; translucent draws last, back to
+    // front (see MakeDrawSortKey())
+    uint64_t sortKey;
+    // position in the scene object list, breaks sort key ties so
+    // the order does not depend on which thread built the command
+    uint32_t objectIndex;
+
+    glm::mat4 model;
+    glm::vec4 color;
+    MESH_TYPE mesh;
+    // index into the material list, -1 keeps the current material
+    int materialIndex;
+    // texture slot to sample, -1 draws with the solid color
+    int textureSlot;
+    // index into the static batches of the packet, drawn instead
+    // of the mesh with an identity model; -1 draws the mesh
+    int staticBatch;
+};
+
+// build the sort key of a draw command from its state and its
+// distance to the camera
+uint64_t MakeDrawSortKey(
+    MESH_TYPE mesh,
+    int materialIndex,
+    int textureSlot,
+    bool bTranslucent,
+    float viewDistance);
+
+// merged geometry of static objects, see StaticBatcher.h
+struct STATIC_BATCH_SET;
+// object table of the GPU culling, see GpuCuller.h
+struct GPU_OBJECT_SET;
+
+// order draw commands by sort key, then by object index
+inline bool DrawCommandLess(const DRAW_COMMAND& a, const DRAW_COMMAND& b)
+{
+    return a.sortKey != b.sortKey ? a.sortKey < b.sortKey : a.objectIndex < b.objectIndex;
+}
+
+// the view settings and draw list for one frame
+struct FRAME_PACKET
+{
+    unsigned long frameIndex;
+
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPosition;
+
+    // seconds since start and since the previous frame
+    float time;
+    float deltaTime;
+    // framebuffer size in pixels
+    glm::vec2 viewportSize;
+
+    std::vector<DRAW_COMMAND> drawCommands;
+    // batches the draw commands refer to, nullptr without static
+    // batching; held so they outlive a newer set
+    std::shared_ptr<const STATIC_BATCH_SET> staticBatches;
+    // objects culled and drawn by the GPU, nullptr without GPU
+    // culling; the draw commands then only hold the translucent
+    // objects, indexing this table
+    std::shared_ptr<const GPU_OBJECT_SET> gpuObjects;
+};
@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.cpp
+// ============
+// view frustum planes and bounding sphere visibility tests
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Frustum.h"
+
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This function is used to extract the six frustum planes
+ *  from a projection * view matrix (Gribb/Hartmann method).
+ *  The planes are normalized so sphere tests can compare
+ *  against the radius directly.
+ ***********************************************************/
+FRUSTUM ExtractFrustum(const glm::mat4& viewProjection)
+{
+    // rows of the column-major matrix
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        row[i] = glm::vec4(
+            viewProjection[0][i],
+            viewProjection[1][i],
+            viewProjection[2][i],
+            viewProjection[3][i]);
+    }
+
+    FRUSTUM frustum;
+    frustum.planes[0] = row[3] + row[0];    // left
+    frustum.planes[1] = row[3] - row[0];    // right
+    frustum.planes[2] = row[3] + row[1];    // bottom
+    frustum.planes[3] = row[3] - row[1];    // top
+    frustum.planes[4] = row[3] + row[2];    // near
+    frustum.planes[5] = row[3] - row[2];    // far
+
+    for (auto& plane : frustum.planes)
+    {
+        float length = glm::length(glm::vec3(plane.x, plane.y, plane.z));
+        if (length > 0.0f)
+        {
+            plane = plane / length;
+        }
+    }
+
+    return frustum;
+}
+
+/***********************************************************
+ *  IsSphereInFrustum()
+ *
+ *  This function is used to test whether a world-space
+ *  bounding sphere intersects the frustum.
+ ***********************************************************/
+bool IsSphereInFrustum(const FRUSTUM& frustum, const glm::vec3& center, float radius)
+{
+    for (const auto& plane : frustum.planes)
+    {
+        float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+        if (distance < -radius)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/***********************************************************
+ *  TransformBoundingSphere()
+ *
+ *  This function is used to move a model-space bounding
+ *  sphere (center, radius) into world space. The radius is
+ *  scaled by the largest axis scale of the model matrix.
+ ***********************************************************/
+glm::vec4 TransformBoundingSphere(const glm::mat4& model, const glm::vec4& localSphere)
+{
+    glm::vec4 center = model * glm::vec4(localSphere.x, localSphere.y, localSphere.z, 1.0f);
+
+    float scaleX = glm::length(glm::vec3(model[0].x, model[0].y, model[0].z));
+    float scaleY = glm::length(glm::vec3(model[1].x, model[1].y, model[1].z));
+    float scaleZ = glm::length(glm::vec3(model[2].x, model[2].y, model[2].z));
+    float maxScale = std::max(scaleX, std::max(scaleY, scaleZ));
+
+    return glm::vec4(center.x, center.y, center.z, localSphere.w * maxScale);
+}
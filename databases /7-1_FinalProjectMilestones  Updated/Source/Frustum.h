@@ -0,0 +1,25 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.h
+// ============
+// view frustum planes and bounding sphere visibility tests
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+// the six clip planes of a view frustum; each plane is stored as
+// (normal, distance) with the normal pointing into the frustum
+struct FRUSTUM
+{
+    glm::vec4 planes[6];
+};
+
+// extract the frustum planes from a combined projection * view matrix
+FRUSTUM ExtractFrustum(const glm::mat4& viewProjection);
+
+// true when the sphere is at least partially inside the frustum
+bool IsSphereInFrustum(const FRUSTUM& frustum, const glm::vec3& center, float radius);
+
+// transform a model-space bounding sphere into world space
+glm::vec4 TransformBoundingSphere(const glm::mat4& model, const glm::vec4& localSphere);
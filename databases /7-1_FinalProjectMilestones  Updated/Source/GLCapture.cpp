@@ -0,0 +1,1411 @@
+///////////////////////////////////////////////////////////////////////////////
+// glcapture.cpp
+// ============
+// record the OpenGL calls of whole frames, with the resources they use,
+// into a file that GLReplay.h can run without the scene code
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLCapture.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// declare the global variables
+namespace
+{
+    // texture units, uniform buffer binding points and vertex
+    // attributes whose state is recorded at the start of a capture
+    const GLint CAPTURED_TEXTURE_UNITS = 16;
+    const GLuint CAPTURED_UNIFORM_BINDINGS = 16;
+    const GLuint CAPTURED_VERTEX_ATTRIBS = 16;
+    // shader objects read from a program
+    const GLsizei MAX_CAPTURED_SHADERS = 8;
+
+    /***********************************************************
+     *  CommandStream
+     *
+     *  The commands of one capture file section. The byte size
+     *  of a command is filled in by End(), so the arguments
+     *  can be appended one by one.
+     ***********************************************************/
+    class CommandStream
+    {
+    public:
+        CommandStream() : m_sizeOffset(0), m_commandCount(0) {}
+
+        void Begin(CAPTURE_OPCODE opcode)
+        {
+            Put<uint32_t>(static_cast<uint32_t>(opcode));
+            m_sizeOffset = m_data.size();
+            Put<uint32_t>(0);
+        }
+
+        void End()
+        {
+            const uint32_t size = static_cast<uint32_t>(m_data.size() - m_sizeOffset - sizeof(uint32_t));
+            memcpy(&m_data[m_sizeOffset], &size, sizeof(size));
+            ++m_commandCount;
+        }
+
+        template <typename T>
+        void Put(const T& value)
+        {
+            PutBytes(&value, sizeof(T));
+        }
+
+        void PutBytes(const void* pData, size_t size)
+        {
+            if (size > 0)
+            {
+                const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+                m_data.insert(m_data.end(), pBytes, pBytes + size);
+            }
+        }
+
+        void PutData(const void* pData, size_t size)
+        {
+            Put<uint64_t>(pData != nullptr ? size : 0);
+            if (pData != nullptr)
+            {
+                PutBytes(pData, size);
+            }
+        }
+
+        void PutString(const std::string& text)
+        {
+            Put<uint32_t>(static_cast<uint32_t>(text.size()));
+            PutBytes(text.data(), text.size());
+        }
+
+        void Clear()
+        {
+            m_data.clear();
+            m_commandCount = 0;
+        }
+
+        const std::vector<uint8_t>& GetData() const { return m_data; }
+        size_t GetCommandCount() const { return m_commandCount; }
+
+    private:
+        std::vector<uint8_t> m_data;
+        size_t m_sizeOffset;
+        size_t m_commandCount;
+    };
+
+    // a uniform of a program, with its value when the program was
+    // first used by the capture
+    struct CAPTURED_UNIFORM
+    {
+        std::string name;
+        GLint location;
+        GLenum type;
+        std::vector<uint8_t> value;
+    };
+
+    // the file and length of the requested capture
+    std::string g_CaptureFilename;
+    unsigned g_RequestedFrames = 0;
+    unsigned g_CapturedFrames = 0;
+    bool g_bCaptureRequested = false;
+    // calls are recorded between the first BeginGLCaptureFrame() and
+    // the last EndGLCaptureFrame() of the capture
+    bool g_bCapturing = false;
+    GLint g_CaptureViewport[4] = {};
+
+    CommandStream g_Sections[CAPTURE_SECTION_COUNT];
+    CommandStream& g_Resources = g_Sections[CAPTURE_SECTION_RESOURCES];
+    CommandStream& g_State = g_Sections[CAPTURE_SECTION_STATE];
+    CommandStream& g_Frames = g_Sections[CAPTURE_SECTION_FRAMES];
+
+    // objects the replay already knows about, either recorded as a
+    // resource or created by a recorded call
+    std::unordered_set<GLuint> g_KnownBuffers;
+    std::unordered_set<GLuint> g_KnownTextures;
+    std::unordered_set<GLuint> g_KnownVertexArrays;
+    std::unordered_set<GLuint> g_KnownPrograms;
+
+    // vertex and fragment shader files of the loaded programs
+    std::unordered_map<GLuint, std::pair<std::string, std::string>> g_ShaderFiles;
+
+    /***********************************************************
+     *  ReadTextFile()
+     *
+     *  Read a whole shader file, empty if it cannot be opened.
+     ***********************************************************/
+    std::string ReadTextFile(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        std::stringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+    /***********************************************************
+     *  IsBufferPersistentlyMapped()
+     *
+     *  Check if the CPU may write into a buffer without any
+     *  OpenGL call the capture could see.
+     ***********************************************************/
+    bool IsBufferPersistentlyMapped(GLuint buffer)
+    {
+        GLint mapped = GL_FALSE;
+        glGetNamedBufferParameteriv(buffer, GL_BUFFER_MAPPED, &mapped);
+        if (GL_FALSE == mapped)
+        {
+            return false;
+        }
+        GLint accessFlags = 0;
+        glGetNamedBufferParameteriv(buffer, GL_BUFFER_ACCESS_FLAGS, &accessFlags);
+        return 0 != (accessFlags & GL_MAP_PERSISTENT_BIT);
+    }
+
+    /***********************************************************
+     *  IsBufferReadable()
+     *
+     *  Check if the contents of a buffer can be read back; a
+     *  mapped buffer can only be read if it is mapped
+     *  persistently.
+     ***********************************************************/
+    bool IsBufferReadable(GLuint buffer)
+    {
+        GLint mapped = GL_FALSE;
+        glGetNamedBufferParameteriv(buffer, GL_BUFFER_MAPPED, &mapped);
+        return GL_FALSE == mapped || IsBufferPersistentlyMapped(buffer);
+    }
+
+    /***********************************************************
+     *  DefineBuffer()
+     *
+     *  Record a buffer that existed before the capture, with
+     *  its current contents, the first time it is used.
+     ***********************************************************/
+    void DefineBuffer(GLuint buffer)
+    {
+        if (0 == buffer || !g_KnownBuffers.insert(buffer).second)
+        {
+            return;
+        }
+
+        // a name that was generated but never bound has no storage
+        if (!glIsBuffer(buffer))
+        {
+            g_Resources.Begin(CAPTURE_GEN_BUFFER);
+            g_Resources.Put<uint32_t>(buffer);
+            g_Resources.End();
+            return;
+        }
+
+        GLint64 size = 0;
+        GLint usage = GL_STATIC_DRAW;
+        glGetNamedBufferParameteri64v(buffer, GL_BUFFER_SIZE, &size);
+        glGetNamedBufferParameteriv(buffer, GL_BUFFER_USAGE, &usage);
+
+        std::vector<uint8_t> contents(static_cast<size_t>(size), 0);
+        if (size > 0 && IsBufferReadable(buffer))
+        {
+            glGetNamedBufferSubData(buffer, 0, static_cast<GLsizeiptr>(size), contents.data());
+        }
+
+        g_Resources.Begin(CAPTURE_DEFINE_BUFFER);
+        g_Resources.Put<uint32_t>(buffer);
+        g_Resources.Put<uint32_t>(static_cast<uint32_t>(usage));
+        g_Resources.PutData(contents.data(), contents.size());
+        g_Resources.End();
+    }
+
+    /***********************************************************
+     *  DefineTexture()
+     *
+     *  Record a 2D texture that existed before the capture,
+     *  with its sampling parameters and the texels of its
+     *  first level, the first time it is used. The replay
+     *  rebuilds the mip chain.
+     ***********************************************************/
+    void DefineTexture(GLuint texture)
+    {
+        if (0 == texture || !g_KnownTextures.insert(texture).second)
+        {
+            return;
+        }
+
+        GLint target = 0;
+        if (glIsTexture(texture))
+        {
+            glGetTextureParameteriv(texture, GL_TEXTURE_TARGET, &target);
+        }
+        if (GL_TEXTURE_2D != target)
+        {
+            if (0 != target)
+            {
+                std::cout << "WARNING: GL capture only records 2D textures, texture "
+                          << texture << " is replayed empty" << std::endl;
+            }
+            g_Resources.Begin(CAPTURE_GEN_TEXTURE);
+            g_Resources.Put<uint32_t>(texture);
+            g_Resources.End();
+            return;
+        }
+
+        GLint width = 0;
+        GLint height = 0;
+        GLint internalFormat = GL_RGBA8;
+        GLint parameters[4] = { GL_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT };
+        glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+        glGetTextureParameteriv(texture, GL_TEXTURE_MIN_FILTER, &parameters[0]);
+        glGetTextureParameteriv(texture, GL_TEXTURE_MAG_FILTER, &parameters[1]);
+        glGetTextureParameteriv(texture, GL_TEXTURE_WRAP_S, &parameters[2]);
+        glGetTextureParameteriv(texture, GL_TEXTURE_WRAP_T, &parameters[3]);
+
+        std::vector<uint8_t> texels(static_cast<size_t>(width) * height * 4);
+        if (!texels.empty())
+        {
+            // read into client memory even if the application left
+            // a pixel pack buffer bound
+            GLint packBuffer = 0;
+            glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &packBuffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glGetTextureImage(texture, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                              static_cast<GLsizei>(texels.size()), texels.data());
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, static_cast<GLuint>(packBuffer));
+        }
+
+        g_Resources.Begin(CAPTURE_DEFINE_TEXTURE);
+        g_Resources.Put<uint32_t>(texture);
+        g_Resources.Put<int32_t>(internalFormat);
+        g_Resources.Put<int32_t>(width);
+        g_Resources.Put<int32_t>(height);
+        for (GLint parameter : parameters)
+        {
+            g_Resources.Put<int32_t>(parameter);
+        }
+        g_Resources.PutData(texels.data(), texels.size());
+        g_Resources.End();
+    }
+
+    /***********************************************************
+     *  DefineVertexArray()
+     *
+     *  Record the attribute setup of a vertex array that
+     *  existed before the capture, the first time it is
+     *  bound. The vertex array must be the bound one.
+     ***********************************************************/
+    void DefineVertexArray(GLuint vertexArray)
+    {
+        if (0 == vertexArray || !g_KnownVertexArrays.insert(vertexArray).second)
+        {
+            return;
+        }
+
+        GLint elementBuffer = 0;
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &elementBuffer);
+        DefineBuffer(static_cast<GLuint>(elementBuffer));
+
+        // index, enabled, size, type, normalized, integer, stride,
+        // buffer, followed by the offset
+        struct ATTRIBUTE
+        {
+            GLint values[8];
+            uint64_t offset;
+        };
+        std::vector<ATTRIBUTE> attributes;
+        for (GLuint index = 0; index < CAPTURED_VERTEX_ATTRIBS; ++index)
+        {
+            ATTRIBUTE attribute;
+            attribute.values[0] = static_cast<GLint>(index);
+            glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &attribute.values[1]);
+            glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attribute.values[2]);
+            glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_TYPE, &attribute.values[3]);
+            glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attribute.values[4]);
+            glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_INTEGER, &attribute.values[5]);
+            glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attribute.values[6]);
+            glGetVertexAttribiv(index, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &attribute.values[7]);
+            if (0 == attribute.values[1] && 0 == attribute.values[7])
+            {
+                continue;
+            }
+
+            void* pointer = nullptr;
+            glGetVertexAttribPointerv(index, GL_VERTEX_ATTRIB_ARRAY_POINTER, &pointer);
+            attribute.offset = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer));
+            DefineBuffer(static_cast<GLuint>(attribute.values[7]));
+            attributes.push_back(attribute);
+        }
+
+        g_Resources.Begin(CAPTURE_DEFINE_VERTEX_ARRAY);
+        g_Resources.Put<uint32_t>(vertexArray);
+        g_Resources.Put<uint32_t>(static_cast<uint32_t>(elementBuffer));
+        g_Resources.Put<uint32_t>(static_cast<uint32_t>(attributes.size()));
+        for (const ATTRIBUTE& attribute : attributes)
+        {
+            for (GLint value : attribute.values)
+            {
+                g_Resources.Put<int32_t>(value);
+            }
+            g_Resources.Put<uint64_t>(attribute.offset);
+        }
+        g_Resources.End();
+    }
+
+    /***********************************************************
+     *  DefineProgram()
+     *
+     *  Record a program the first time it is used: the source
+     *  of its shaders, the location and current value of each
+     *  uniform, and the binding of each uniform block. The
+     *  values set at load time are never set again per frame,
+     *  so the replay needs them to draw the same pixels.
+     ***********************************************************/
+    void DefineProgram(GLuint program)
+    {
+        if (0 == program || !g_KnownPrograms.insert(program).second)
+        {
+            return;
+        }
+
+        // the sources of the attached shaders, or the files the
+        // program was loaded from once they have been detached
+        std::vector<std::pair<GLenum, std::string>> shaders;
+        GLuint attached[MAX_CAPTURED_SHADERS];
+        GLsizei attachedCount = 0;
+        glGetAttachedShaders(program, MAX_CAPTURED_SHADERS, &attachedCount, attached);
+        for (GLsizei i = 0; i < attachedCount; ++i)
+        {
+            GLint type = 0;
+            GLint length = 0;
+            glGetShaderiv(attached[i], GL_SHADER_TYPE, &type);
+            glGetShaderiv(attached[i], GL_SHADER_SOURCE_LENGTH, &length);
+            if (length > 1)
+            {
+                std::vector<GLchar> source(static_cast<size_t>(length));
+                glGetShaderSource(attached[i], length, nullptr, source.data());
+                shaders.push_back(std::make_pair(static_cast<GLenum>(type), std::string(source.data())));
+            }
+        }
+        auto files = g_ShaderFiles.find(program);
+        if (shaders.empty() && files != g_ShaderFiles.end())
+        {
+            shaders.push_back(std::make_pair(static_cast<GLenum>(GL_VERTEX_SHADER), ReadTextFile(files->second.first)));
+            shaders.push_back(std::make_pair(static_cast<GLenum>(GL_FRAGMENT_SHADER), ReadTextFile(files->second.second)));
+        }
+        if (shaders.empty())
+        {
+            std::cout << "WARNING: GL capture found no shader source for program " << program
+                      << ", its draws are not replayed" << std::endl;
+        }
+
+        // every element of the uniform arrays has its own location
+        std::vector<CAPTURED_UNIFORM> uniforms;
+        GLint uniformCount = 0;
+        GLint maxNameLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+        std::vector<GLchar> nameBuffer(static_cast<size_t>(maxNameLength) + 1);
+        for (GLint i = 0; i < uniformCount; ++i)
+        {
+            GLsizei nameLength = 0;
+            GLint arraySize = 0;
+            GLenum type = 0;
+            glGetActiveUniform(program, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+                               &nameLength, &arraySize, &type, nameBuffer.data());
+
+            bool bInteger = false;
+            const int components = GetCaptureUniformComponents(type, bInteger);
+            if (0 == components)
+            {
+                continue;
+            }
+
+            std::string name(nameBuffer.data(), static_cast<size_t>(nameLength));
+            if (arraySize > 1 && name.size() > 3 && 0 == name.compare(name.size() - 3, 3, "[0]"))
+            {
+                name.resize(name.size() - 3);
+            }
+
+            for (GLint element = 0; element < arraySize; ++element)
+            {
+                CAPTURED_UNIFORM uniform;
+                uniform.name = arraySize > 1 ? name + "[" + std::to_string(element) + "]" : name;
+                uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+                uniform.type = type;
+                if (uniform.location < 0)
+                {
+                    // members of uniform blocks have no location
+                    continue;
+                }
+
+                uniform.value.resize(static_cast<size_t>(components) * 4);
+                if (bInteger)
+                {
+                    glGetUniformiv(program, uniform.location, reinterpret_cast<GLint*>(uniform.value.data()));
+                }
+                else
+                {
+                    glGetUniformfv(program, uniform.location, reinterpret_cast<GLfloat*>(uniform.value.data()));
+                }
+                uniforms.push_back(uniform);
+            }
+        }
+
+        GLint blockCount = 0;
+        GLint maxBlockNameLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength);
+        std::vector<GLchar> blockName(static_cast<size_t>(maxBlockNameLength) + 1);
+
+        g_Resources.Begin(CAPTURE_DEFINE_PROGRAM);
+        g_Resources.Put<uint32_t>(program);
+        g_Resources.Put<uint32_t>(static_cast<uint32_t>(shaders.size()));
+        for (const auto& shader : shaders)
+        {
+            g_Resources.Put<uint32_t>(shader.first);
+            g_Resources.PutString(shader.second);
+        }
+        g_Resources.Put<uint32_t>(static_cast<uint32_t>(uniforms.size()));
+        for (const CAPTURED_UNIFORM& uniform : uniforms)
+        {
+            g_Resources.PutString(uniform.name);
+            g_Resources.Put<int32_t>(uniform.location);
+            g_Resources.Put<uint32_t>(uniform.type);
+            g_Resources.Put<uint32_t>(1);
+            g_Resources.PutBytes(uniform.value.data(), uniform.value.size());
+        }
+        g_Resources.Put<uint32_t>(static_cast<uint32_t>(blockCount));
+        for (GLint i = 0; i < blockCount; ++i)
+        {
+            GLsizei nameLength = 0;
+            GLint binding = 0;
+            glGetActiveUniformBlockName(program, static_cast<GLuint>(i), static_cast<GLsizei>(blockName.size()),
+                                        &nameLength, blockName.data());
+            glGetActiveUniformBlockiv(program, static_cast<GLuint>(i), GL_UNIFORM_BLOCK_BINDING, &binding);
+            g_Resources.PutString(std::string(blockName.data(), static_cast<size_t>(nameLength)));
+            g_Resources.Put<uint32_t>(static_cast<uint32_t>(binding));
+        }
+        g_Resources.End();
+    }
+
+    /***********************************************************
+     *  RecordMappedRange()
+     *
+     *  Record what the CPU wrote into a persistently mapped
+     *  range, at the point the range is bound for the GPU.
+     ***********************************************************/
+    void RecordMappedRange(GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        if (0 == buffer || !IsBufferPersistentlyMapped(buffer))
+        {
+            return;
+        }
+        if (size <= 0)
+        {
+            GLint64 bufferSize = 0;
+            glGetNamedBufferParameteri64v(buffer, GL_BUFFER_SIZE, &bufferSize);
+            size = static_cast<GLsizeiptr>(bufferSize - offset);
+        }
+
+        std::vector<uint8_t> contents(static_cast<size_t>(size));
+        glGetNamedBufferSubData(buffer, offset, size, contents.data());
+
+        g_Frames.Begin(CAPTURE_UPDATE_BUFFER);
+        g_Frames.Put<uint32_t>(buffer);
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(offset));
+        g_Frames.PutData(contents.data(), contents.size());
+        g_Frames.End();
+    }
+
+    /***********************************************************
+     *  RecordContextState()
+     *
+     *  Record the state the first frame starts from, as the
+     *  commands that recreate it: the fixed function settings,
+     *  the program, the bound textures, uniform buffers and
+     *  vertex array, and the constant vertex attributes.
+     ***********************************************************/
+    void RecordContextState()
+    {
+        glGetIntegerv(GL_VIEWPORT, g_CaptureViewport);
+        g_State.Begin(CAPTURE_VIEWPORT);
+        for (GLint value : g_CaptureViewport)
+        {
+            g_State.Put<int32_t>(value);
+        }
+        g_State.End();
+
+        GLfloat clearColor[4] = {};
+        glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+        g_State.Begin(CAPTURE_CLEAR_COLOR);
+        g_State.PutBytes(clearColor, sizeof(clearColor));
+        g_State.End();
+
+        GLboolean colorMask[4] = { GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE };
+        glGetBooleanv(GL_COLOR_WRITEMASK, colorMask);
+        g_State.Begin(CAPTURE_COLOR_MASK);
+        for (GLboolean value : colorMask)
+        {
+            g_State.Put<uint32_t>(value);
+        }
+        g_State.End();
+
+        const GLenum capabilities[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE };
+        for (GLenum capability : capabilities)
+        {
+            g_State.Begin(glIsEnabled(capability) ? CAPTURE_ENABLE : CAPTURE_DISABLE);
+            g_State.Put<uint32_t>(capability);
+            g_State.End();
+        }
+
+        GLint blendSource = GL_ONE;
+        GLint blendDestination = GL_ZERO;
+        glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource);
+        glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination);
+        g_State.Begin(CAPTURE_BLEND_FUNC);
+        g_State.Put<uint32_t>(static_cast<uint32_t>(blendSource));
+        g_State.Put<uint32_t>(static_cast<uint32_t>(blendDestination));
+        g_State.End();
+
+        GLint program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        DefineProgram(static_cast<GLuint>(program));
+        g_State.Begin(CAPTURE_USE_PROGRAM);
+        g_State.Put<uint32_t>(static_cast<uint32_t>(program));
+        g_State.End();
+
+        GLint activeTexture = GL_TEXTURE0;
+        glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+        for (GLint unit = 0; unit < CAPTURED_TEXTURE_UNITS; ++unit)
+        {
+            GLint texture = 0;
+            glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(unit));
+            glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+            if (0 == texture)
+            {
+                continue;
+            }
+            DefineTexture(static_cast<GLuint>(texture));
+            g_State.Begin(CAPTURE_ACTIVE_TEXTURE);
+            g_State.Put<uint32_t>(GL_TEXTURE0 + static_cast<GLenum>(unit));
+            g_State.End();
+            g_State.Begin(CAPTURE_BIND_TEXTURE);
+            g_State.Put<uint32_t>(GL_TEXTURE_2D);
+            g_State.Put<uint32_t>(static_cast<uint32_t>(texture));
+            g_State.End();
+        }
+        glActiveTexture(static_cast<GLenum>(activeTexture));
+        g_State.Begin(CAPTURE_ACTIVE_TEXTURE);
+        g_State.Put<uint32_t>(static_cast<uint32_t>(activeTexture));
+        g_State.End();
+
+        for (GLuint index = 0; index < CAPTURED_UNIFORM_BINDINGS; ++index)
+        {
+            GLint buffer = 0;
+            GLint64 start = 0;
+            GLint64 size = 0;
+            glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, index, &buffer);
+            if (0 == buffer)
+            {
+                continue;
+            }
+            glGetInteger64i_v(GL_UNIFORM_BUFFER_START, index, &start);
+            glGetInteger64i_v(GL_UNIFORM_BUFFER_SIZE, index, &size);
+            DefineBuffer(static_cast<GLuint>(buffer));
+
+            g_State.Begin(0 == size ? CAPTURE_BIND_BUFFER_BASE : CAPTURE_BIND_BUFFER_RANGE);
+            g_State.Put<uint32_t>(GL_UNIFORM_BUFFER);
+            g_State.Put<uint32_t>(index);
+            g_State.Put<uint32_t>(static_cast<uint32_t>(buffer));
+            if (0 != size)
+            {
+                g_State.Put<uint64_t>(static_cast<uint64_t>(start));
+                g_State.Put<uint64_t>(static_cast<uint64_t>(size));
+            }
+            g_State.End();
+        }
+
+        const GLenum bufferTargets[][2] =
+        {
+            { GL_UNIFORM_BUFFER, GL_UNIFORM_BUFFER_BINDING },
+            { GL_ARRAY_BUFFER,   GL_ARRAY_BUFFER_BINDING },
+        };
+        for (const auto& target : bufferTargets)
+        {
+            GLint buffer = 0;
+            glGetIntegerv(target[1], &buffer);
+            DefineBuffer(static_cast<GLuint>(buffer));
+            g_State.Begin(CAPTURE_BIND_BUFFER);
+            g_State.Put<uint32_t>(target[0]);
+            g_State.Put<uint32_t>(static_cast<uint32_t>(buffer));
+            g_State.End();
+        }
+
+        for (GLuint index = 0; index < CAPTURED_VERTEX_ATTRIBS; ++index)
+        {
+            GLfloat value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            glGetVertexAttribfv(index, GL_CURRENT_VERTEX_ATTRIB, value);
+            g_State.Begin(CAPTURE_VERTEX_ATTRIB_4F);
+            g_State.Put<uint32_t>(index);
+            g_State.PutBytes(value, sizeof(value));
+            g_State.End();
+        }
+
+        GLint vertexArray = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArray);
+        DefineVertexArray(static_cast<GLuint>(vertexArray));
+        g_State.Begin(CAPTURE_BIND_VERTEX_ARRAY);
+        g_State.Put<uint32_t>(static_cast<uint32_t>(vertexArray));
+        g_State.End();
+    }
+
+    /***********************************************************
+     *  WriteCaptureFile()
+     *
+     *  Write the recorded sections behind a header; false if
+     *  the file cannot be written.
+     ***********************************************************/
+    bool WriteCaptureFile()
+    {
+        CAPTURE_FILE_HEADER header;
+        memset(&header, 0, sizeof(header));
+        header.magic      = CAPTURE_FILE_MAGIC;
+        header.version    = CAPTURE_FILE_VERSION;
+        header.headerSize = sizeof(CAPTURE_FILE_HEADER);
+        header.frameCount = g_CapturedFrames;
+        for (int i = 0; i < 4; ++i)
+        {
+            header.viewport[i] = g_CaptureViewport[i];
+        }
+
+        uint64_t offset = sizeof(CAPTURE_FILE_HEADER);
+        for (int i = 0; i < CAPTURE_SECTION_COUNT; ++i)
+        {
+            header.sections[i].offset = offset;
+            header.sections[i].size = g_Sections[i].GetData().size();
+            offset += header.sections[i].size;
+        }
+
+        std::ofstream file(g_CaptureFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            std::cout << "Could not write GL capture file: " << g_CaptureFilename << std::endl;
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (int i = 0; i < CAPTURE_SECTION_COUNT; ++i)
+        {
+            const std::vector<uint8_t>& data = g_Sections[i].GetData();
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        }
+        file.close();
+
+        if (!file)
+        {
+            std::cout << "Could not write GL capture file: " << g_CaptureFilename << std::endl;
+            return false;
+        }
+
+        std::cout << "INFO: Captured " << g_CapturedFrames << " frames into " << g_CaptureFilename << ", "
+                  << g_Resources.GetCommandCount() << " resources, "
+                  << g_Frames.GetCommandCount() << " commands, "
+                  << offset / 1024 << " KB" << std::endl;
+        return true;
+    }
+
+    /***********************************************************
+     *  ResetCapture()
+     *
+     *  Free the recorded data once the file is written.
+     ***********************************************************/
+    void ResetCapture()
+    {
+        for (CommandStream& section : g_Sections)
+        {
+            section.Clear();
+        }
+        g_KnownBuffers.clear();
+        g_KnownTextures.clear();
+        g_KnownVertexArrays.clear();
+        g_KnownPrograms.clear();
+        g_CapturedFrames = 0;
+    }
+
+    /***********************************************************
+     *  RecordUniform()
+     *
+     *  Record a uniform call on the current program.
+     ***********************************************************/
+    void RecordUniform(GLint location, GLenum type, GLsizei count, GLboolean transpose, const void* pValues)
+    {
+        bool bInteger = false;
+        const int components = GetCaptureUniformComponents(type, bInteger);
+
+        g_Frames.Begin(CAPTURE_UNIFORM);
+        g_Frames.Put<int32_t>(location);
+        g_Frames.Put<uint32_t>(type);
+        g_Frames.Put<uint32_t>(static_cast<uint32_t>(count));
+        g_Frames.Put<uint32_t>(transpose);
+        g_Frames.PutBytes(pValues, static_cast<size_t>(count) * components * 4);
+        g_Frames.End();
+    }
+
+    /***********************************************************
+     *  RecordNames()
+     *
+     *  Record the objects a Gen or Delete call created or
+     *  deleted, one command per name.
+     ***********************************************************/
+    void RecordNames(CAPTURE_OPCODE opcode, GLsizei n, const GLuint* pNames)
+    {
+        for (GLsizei i = 0; i < n; ++i)
+        {
+            g_Frames.Begin(opcode);
+            g_Frames.Put<uint32_t>(pNames[i]);
+            g_Frames.End();
+        }
+    }
+
+    /***********************************************************
+     *  RecordValues()
+     *
+     *  Record a command whose arguments are all 32-bit values.
+     ***********************************************************/
+    template <typename... T>
+    void RecordValues(CAPTURE_OPCODE opcode, T... values)
+    {
+        g_Frames.Begin(opcode);
+        const uint32_t packed[] = { static_cast<uint32_t>(values)... };
+        g_Frames.PutBytes(packed, sizeof(packed));
+        g_Frames.End();
+    }
+
+    /***********************************************************
+     *  GetPixelDataSize()
+     *
+     *  Number of bytes glTexImage2D() reads for an image, with
+     *  each row but the last padded to the unpack alignment.
+     ***********************************************************/
+    size_t GetPixelDataSize(GLsizei width, GLsizei height, GLenum format, GLenum type, GLint alignment)
+    {
+        size_t components = 4;
+        switch (format)
+        {
+        case GL_RED:
+        case GL_RED_INTEGER:
+        case GL_DEPTH_COMPONENT:
+            components = 1;
+            break;
+        case GL_RG:
+            components = 2;
+            break;
+        case GL_RGB:
+        case GL_BGR:
+            components = 3;
+            break;
+        default:
+            break;
+        }
+
+        size_t componentSize = 1;
+        switch (type)
+        {
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            componentSize = 2;
+            break;
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            componentSize = 4;
+            break;
+        default:
+            break;
+        }
+
+        if (width <= 0 || height <= 0)
+        {
+            return 0;
+        }
+        const size_t rowSize = static_cast<size_t>(width) * components * componentSize;
+        const size_t rowStride = (rowSize + alignment - 1) / alignment * alignment;
+        return rowStride * (height - 1) + rowSize;
+    }
+}
+
+/***********************************************************
+ *  RequestGLCapture()
+ *
+ *  This function is used to arm a capture of the next
+ *  frameCount frames.
+ ***********************************************************/
+bool RequestGLCapture(const char* filename, unsigned frameCount)
+{
+    if (nullptr == filename || 0 == frameCount || g_bCapturing)
+    {
+        return false;
+    }
+
+    g_CaptureFilename = filename;
+    g_RequestedFrames = frameCount;
+    g_bCaptureRequested = true;
+    return true;
+}
+
+/***********************************************************
+ *  IsGLCaptureActive()
+ *
+ *  This function is used to check if calls are recorded.
+ ***********************************************************/
+bool IsGLCaptureActive()
+{
+    return g_bCapturing;
+}
+
+/***********************************************************
+ *  BeginGLCaptureFrame()
+ *
+ *  This function is used to start recording at the first
+ *  frame after a capture was requested. The objects that
+ *  already exist are read back with direct state access,
+ *  so the application bindings stay untouched.
+ ***********************************************************/
+void BeginGLCaptureFrame()
+{
+    if (!g_bCaptureRequested || g_bCapturing)
+    {
+        return;
+    }
+
+    if (!(GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access))
+    {
+        std::cout << "ERROR: GL capture needs direct state access (OpenGL 4.5)" << std::endl;
+        g_bCaptureRequested = false;
+        return;
+    }
+
+    ResetCapture();
+    RecordContextState();
+    g_bCapturing = true;
+}
+
+/***********************************************************
+ *  EndGLCaptureFrame()
+ *
+ *  This function is used to close a recorded frame, and to
+ *  write the capture file after the last one.
+ ***********************************************************/
+void EndGLCaptureFrame()
+{
+    if (!g_bCapturing)
+    {
+        return;
+    }
+
+    g_Frames.Begin(CAPTURE_END_FRAME);
+    g_Frames.End();
+
+    if (++g_CapturedFrames >= g_RequestedFrames)
+    {
+        WriteCaptureFile();
+        ResetCapture();
+        g_bCapturing = false;
+        g_bCaptureRequested = false;
+    }
+}
+
+/***********************************************************
+ *  GetCaptureUniformComponents()
+ *
+ *  This function is used to get the number of values of a
+ *  uniform type and whether they are set as integers.
+ ***********************************************************/
+int GetCaptureUniformComponents(GLenum type, bool& bInteger)
+{
+    bInteger = false;
+    switch (type)
+    {
+    case GL_FLOAT:          return 1;
+    case GL_FLOAT_VEC2:     return 2;
+    case GL_FLOAT_VEC3:     return 3;
+    case GL_FLOAT_VEC4:     return 4;
+    case GL_FLOAT_MAT3:     return 9;
+    case GL_FLOAT_MAT4:     return 16;
+    default:
+        break;
+    }
+
+    bInteger = true;
+    switch (type)
+    {
+    case GL_INT:
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_CUBE:
+        return 1;
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:
+        return 2;
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:
+        return 3;
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:
+        return 4;
+    default:
+        break;
+    }
+
+    bInteger = false;
+    return 0;
+}
+
+/***********************************************************
+ *  SetGLCaptureShaderFiles()
+ *
+ *  This function is used to remember the files a program
+ *  was loaded from.
+ ***********************************************************/
+void SetGLCaptureShaderFiles(GLuint program, const char* vertexFilename, const char* fragmentFilename)
+{
+    g_ShaderFiles[program] = std::make_pair(std::string(vertexFilename), std::string(fragmentFilename));
+}
+
+/***********************************************************
+ *  Capture...()
+ *
+ *  The recording versions of the OpenGL calls. Each one
+ *  first records the objects the call uses that the replay
+ *  does not know yet, then the call, then makes it.
+ ***********************************************************/
+void CaptureActiveTexture(GLenum texture)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_ACTIVE_TEXTURE, texture);
+    }
+    glActiveTexture(texture);
+}
+
+void CaptureBindBuffer(GLenum target, GLuint buffer)
+{
+    if (g_bCapturing)
+    {
+        DefineBuffer(buffer);
+        RecordValues(CAPTURE_BIND_BUFFER, target, buffer);
+    }
+    glBindBuffer(target, buffer);
+}
+
+void CaptureBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    if (g_bCapturing)
+    {
+        DefineBuffer(buffer);
+        RecordMappedRange(buffer, 0, 0);
+        RecordValues(CAPTURE_BIND_BUFFER_BASE, target, index, buffer);
+    }
+    glBindBufferBase(target, index, buffer);
+}
+
+void CaptureBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (g_bCapturing)
+    {
+        DefineBuffer(buffer);
+        RecordMappedRange(buffer, offset, size);
+        g_Frames.Begin(CAPTURE_BIND_BUFFER_RANGE);
+        g_Frames.Put<uint32_t>(target);
+        g_Frames.Put<uint32_t>(index);
+        g_Frames.Put<uint32_t>(buffer);
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(offset));
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(size));
+        g_Frames.End();
+    }
+    glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void CaptureBindTexture(GLenum target, GLuint texture)
+{
+    if (g_bCapturing)
+    {
+        DefineTexture(texture);
+        RecordValues(CAPTURE_BIND_TEXTURE, target, texture);
+    }
+    glBindTexture(target, texture);
+}
+
+void CaptureBindVertexArray(GLuint array)
+{
+    glBindVertexArray(array);
+    if (g_bCapturing)
+    {
+        // the attribute setup is read from the bound vertex array
+        DefineVertexArray(array);
+        RecordValues(CAPTURE_BIND_VERTEX_ARRAY, array);
+    }
+}
+
+void CaptureBlendFunc(GLenum sfactor, GLenum dfactor)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_BLEND_FUNC, sfactor, dfactor);
+    }
+    glBlendFunc(sfactor, dfactor);
+}
+
+void CaptureBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+    if (g_bCapturing)
+    {
+        g_Frames.Begin(CAPTURE_BUFFER_DATA);
+        g_Frames.Put<uint32_t>(target);
+        g_Frames.Put<uint32_t>(usage);
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(size));
+        g_Frames.PutData(data, static_cast<size_t>(size));
+        g_Frames.End();
+    }
+    glBufferData(target, size, data, usage);
+}
+
+void CaptureBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+{
+    if (g_bCapturing)
+    {
+        g_Frames.Begin(CAPTURE_BUFFER_DATA);
+        g_Frames.Put<uint32_t>(target);
+        g_Frames.Put<uint32_t>(GL_DYNAMIC_DRAW);
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(size));
+        g_Frames.PutData(data, static_cast<size_t>(size));
+        g_Frames.End();
+    }
+    glBufferStorage(target, size, data, flags);
+}
+
+void CaptureClear(GLbitfield mask)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_CLEAR, mask);
+    }
+    glClear(mask);
+}
+
+void CaptureClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+    if (g_bCapturing)
+    {
+        const GLfloat color[4] = { red, green, blue, alpha };
+        g_Frames.Begin(CAPTURE_CLEAR_COLOR);
+        g_Frames.PutBytes(color, sizeof(color));
+        g_Frames.End();
+    }
+    glClearColor(red, green, blue, alpha);
+}
+
+void CaptureColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_COLOR_MASK, red, green, blue, alpha);
+    }
+    glColorMask(red, green, blue, alpha);
+}
+
+void CaptureDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+    if (g_bCapturing)
+    {
+        RecordNames(CAPTURE_DELETE_BUFFER, n, buffers);
+    }
+    glDeleteBuffers(n, buffers);
+}
+
+void CaptureDeleteTextures(GLsizei n, const GLuint* textures)
+{
+    if (g_bCapturing)
+    {
+        RecordNames(CAPTURE_DELETE_TEXTURE, n, textures);
+    }
+    glDeleteTextures(n, textures);
+}
+
+void CaptureDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+    if (g_bCapturing)
+    {
+        RecordNames(CAPTURE_DELETE_VERTEX_ARRAY, n, arrays);
+    }
+    glDeleteVertexArrays(n, arrays);
+}
+
+void CaptureDisable(GLenum cap)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_DISABLE, cap);
+    }
+    glDisable(cap);
+}
+
+void CaptureDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+    if (g_bCapturing)
+    {
+        // the indices are an offset into the bound element buffer
+        g_Frames.Begin(CAPTURE_DRAW_ELEMENTS);
+        g_Frames.Put<uint32_t>(mode);
+        g_Frames.Put<uint32_t>(static_cast<uint32_t>(count));
+        g_Frames.Put<uint32_t>(type);
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(indices)));
+        g_Frames.End();
+    }
+    glDrawElements(mode, count, type, indices);
+}
+
+void CaptureDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount)
+{
+    if (g_bCapturing)
+    {
+        g_Frames.Begin(CAPTURE_DRAW_ELEMENTS_INSTANCED);
+        g_Frames.Put<uint32_t>(mode);
+        g_Frames.Put<uint32_t>(static_cast<uint32_t>(count));
+        g_Frames.Put<uint32_t>(type);
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(indices)));
+        g_Frames.Put<uint32_t>(static_cast<uint32_t>(instanceCount));
+        g_Frames.End();
+    }
+    glDrawElementsInstanced(mode, count, type, indices, instanceCount);
+}
+
+void CaptureEnable(GLenum cap)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_ENABLE, cap);
+    }
+    glEnable(cap);
+}
+
+void CaptureEnableVertexAttribArray(GLuint index)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+    }
+    glEnableVertexAttribArray(index);
+}
+
+void CaptureFinish()
+{
+    if (g_bCapturing)
+    {
+        g_Frames.Begin(CAPTURE_FINISH);
+        g_Frames.End();
+    }
+    glFinish();
+}
+
+void CaptureGenBuffers(GLsizei n, GLuint* buffers)
+{
+    glGenBuffers(n, buffers);
+    if (g_bCapturing)
+    {
+        g_KnownBuffers.insert(buffers, buffers + n);
+        RecordNames(CAPTURE_GEN_BUFFER, n, buffers);
+    }
+}
+
+void CaptureGenerateMipmap(GLenum target)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_GENERATE_MIPMAP, target);
+    }
+    glGenerateMipmap(target);
+}
+
+void CaptureGenTextures(GLsizei n, GLuint* textures)
+{
+    glGenTextures(n, textures);
+    if (g_bCapturing)
+    {
+        g_KnownTextures.insert(textures, textures + n);
+        RecordNames(CAPTURE_GEN_TEXTURE, n, textures);
+    }
+}
+
+void CaptureGenVertexArrays(GLsizei n, GLuint* arrays)
+{
+    glGenVertexArrays(n, arrays);
+    if (g_bCapturing)
+    {
+        g_KnownVertexArrays.insert(arrays, arrays + n);
+        RecordNames(CAPTURE_GEN_VERTEX_ARRAY, n, arrays);
+    }
+}
+
+void CaptureTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                       GLint border, GLenum format, GLenum type, const void* pixels)
+{
+    if (g_bCapturing)
+    {
+        GLint alignment = 4;
+        GLint unpackBuffer = 0;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+        if (0 != unpackBuffer && nullptr != pixels)
+        {
+            std::cout << "WARNING: GL capture does not record texture uploads from pixel buffers" << std::endl;
+        }
+
+        g_Frames.Begin(CAPTURE_TEX_IMAGE_2D);
+        g_Frames.Put<uint32_t>(target);
+        g_Frames.Put<int32_t>(level);
+        g_Frames.Put<int32_t>(internalformat);
+        g_Frames.Put<int32_t>(width);
+        g_Frames.Put<int32_t>(height);
+        g_Frames.Put<uint32_t>(format);
+        g_Frames.Put<uint32_t>(type);
+        g_Frames.Put<int32_t>(alignment);
+        g_Frames.PutData(0 == unpackBuffer ? pixels : nullptr,
+                         GetPixelDataSize(width, height, format, type, alignment));
+        g_Frames.End();
+    }
+    glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+void CaptureTexParameteri(GLenum target, GLenum pname, GLint param)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_TEX_PARAMETER, target, pname, param);
+    }
+    glTexParameteri(target, pname, param);
+}
+
+void CaptureUniform1f(GLint location, GLfloat v0)
+{
+    if (g_bCapturing)
+    {
+        RecordUniform(location, GL_FLOAT, 1, GL_FALSE, &v0);
+    }
+    glUniform1f(location, v0);
+}
+
+void CaptureUniform1i(GLint location, GLint v0)
+{
+    if (g_bCapturing)
+    {
+        RecordUniform(location, GL_INT, 1, GL_FALSE, &v0);
+    }
+    glUniform1i(location, v0);
+}
+
+void CaptureUniform3fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    if (g_bCapturing)
+    {
+        RecordUniform(location, GL_FLOAT_VEC3, count, GL_FALSE, value);
+    }
+    glUniform3fv(location, count, value);
+}
+
+void CaptureUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+    if (g_bCapturing)
+    {
+        RecordUniform(location, GL_FLOAT_VEC4, count, GL_FALSE, value);
+    }
+    glUniform4fv(location, count, value);
+}
+
+void CaptureUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+    if (g_bCapturing)
+    {
+        RecordUniform(location, GL_FLOAT_MAT4, count, transpose, value);
+    }
+    glUniformMatrix4fv(location, count, transpose, value);
+}
+
+void CaptureUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
+{
+    if (g_bCapturing)
+    {
+        // block indices may differ between drivers, names do not
+        GLchar name[256] = {};
+        glGetActiveUniformBlockName(program, uniformBlockIndex, sizeof(name), nullptr, name);
+
+        DefineProgram(program);
+        g_Frames.Begin(CAPTURE_UNIFORM_BLOCK_BINDING);
+        g_Frames.Put<uint32_t>(program);
+        g_Frames.PutString(name);
+        g_Frames.Put<uint32_t>(uniformBlockBinding);
+        g_Frames.End();
+    }
+    glUniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+}
+
+void CaptureUseProgram(GLuint program)
+{
+    if (g_bCapturing)
+    {
+        DefineProgram(program);
+        RecordValues(CAPTURE_USE_PROGRAM, program);
+    }
+    glUseProgram(program);
+}
+
+void CaptureVertexAttrib3f(GLuint index, GLfloat x, GLfloat y, GLfloat z)
+{
+    CaptureVertexAttrib4f(index, x, y, z, 1.0f);
+}
+
+void CaptureVertexAttrib4f(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
+{
+    if (g_bCapturing)
+    {
+        const GLfloat value[4] = { x, y, z, w };
+        g_Frames.Begin(CAPTURE_VERTEX_ATTRIB_4F);
+        g_Frames.Put<uint32_t>(index);
+        g_Frames.PutBytes(value, sizeof(value));
+        g_Frames.End();
+    }
+    glVertexAttrib4f(index, x, y, z, w);
+}
+
+void CaptureVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                GLsizei stride, const void* pointer)
+{
+    if (g_bCapturing)
+    {
+        // the pointer is an offset into the bound array buffer
+        g_Frames.Begin(CAPTURE_VERTEX_ATTRIB_POINTER);
+        g_Frames.Put<uint32_t>(index);
+        g_Frames.Put<int32_t>(size);
+        g_Frames.Put<uint32_t>(type);
+        g_Frames.Put<uint32_t>(normalized);
+        g_Frames.Put<int32_t>(stride);
+        g_Frames.Put<uint64_t>(static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pointer)));
+        g_Frames.End();
+    }
+    glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+
+void CaptureViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (g_bCapturing)
+    {
+        RecordValues(CAPTURE_VIEWPORT, x, y, width, height);
+    }
+    glViewport(x, y, width, height);
+}
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// glcapture.h
+// ============
+// record the OpenGL calls of whole frames, with the resources they use,
+// into a file that GLReplay.h can run without the scene code
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+
+// "GLCP" read as a little-endian 32-bit value
+const uint32_t CAPTURE_FILE_MAGIC = 0x50434C47;
+// bumped whenever the layout or the commands below change
+const uint32_t CAPTURE_FILE_VERSION = 1;
+
+// the sections of a capture file, each a stream of commands
+enum CAPTURE_FILE_SECTION_ID
+{
+    // the objects that existed before the capture started and were
+    // used by it, replayed once
+    CAPTURE_SECTION_RESOURCES = 0,
+    // the context state at the start of the first frame, replayed
+    // before every run of the frames
+    CAPTURE_SECTION_STATE,
+    // the recorded calls, each frame closed by CAPTURE_END_FRAME
+    CAPTURE_SECTION_FRAMES,
+    CAPTURE_SECTION_COUNT
+};
+
+// location of a section, relative to the start of the file
+struct CAPTURE_FILE_SECTION
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+// first bytes of every capture file
+struct CAPTURE_FILE_HEADER
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t frameCount;
+    // viewport of the first frame; the replay target has its size
+    int32_t viewport[4];
+    CAPTURE_FILE_SECTION sections[CAPTURE_SECTION_COUNT];
+};
+
+// every command is a uint32_t opcode and the uint32_t byte size of
+// its arguments, followed by the arguments. Data is stored as a
+// uint64_t byte count and the bytes, strings as a uint32_t length and
+// the characters. Object names are the ones of the recording context
+// and are mapped by the replay
+enum CAPTURE_OPCODE
+{
+    CAPTURE_END_FRAME = 0,
+    // name, usage, data
+    CAPTURE_DEFINE_BUFFER,
+    // name, internal format, width, height, min and mag filter,
+    // s and t wrap, RGBA8 texels of level 0
+    CAPTURE_DEFINE_TEXTURE,
+    // name, element buffer, attribute count, per attribute: index,
+    // enabled, size, type, normalized, integer, stride, buffer, offset
+    CAPTURE_DEFINE_VERTEX_ARRAY,
+    // name, shader count, per shader: type, source; uniform count,
+    // per uniform: name, location, type, count, values; block count, per
+    // block: name, binding
+    CAPTURE_DEFINE_PROGRAM,
+    // name, offset, size, data; the contents of a persistently
+    // mapped range, written by the CPU without a GL call
+    CAPTURE_UPDATE_BUFFER,
+    CAPTURE_GEN_BUFFER,
+    CAPTURE_DELETE_BUFFER,
+    CAPTURE_BIND_BUFFER,
+    CAPTURE_BIND_BUFFER_BASE,
+    CAPTURE_BIND_BUFFER_RANGE,
+    // target, usage, size, data; immutable storage is replayed as
+    // mutable
+    CAPTURE_BUFFER_DATA,
+    CAPTURE_GEN_TEXTURE,
+    CAPTURE_DELETE_TEXTURE,
+    CAPTURE_ACTIVE_TEXTURE,
+    CAPTURE_BIND_TEXTURE,
+    CAPTURE_TEX_PARAMETER,
+    // target, level, internal format, width, height, format, type,
+    // unpack alignment, data
+    CAPTURE_TEX_IMAGE_2D,
+    CAPTURE_GENERATE_MIPMAP,
+    CAPTURE_GEN_VERTEX_ARRAY,
+    CAPTURE_DELETE_VERTEX_ARRAY,
+    CAPTURE_BIND_VERTEX_ARRAY,
+    CAPTURE_VERTEX_ATTRIB_POINTER,
+    CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY,
+    CAPTURE_VERTEX_ATTRIB_4F,
+    CAPTURE_USE_PROGRAM,
+    // location, type, count, transpose, values
+    CAPTURE_UNIFORM,
+    // program, block name, binding
+    CAPTURE_UNIFORM_BLOCK_BINDING,
+    // mode, count, index type, index buffer offset
+    CAPTURE_DRAW_ELEMENTS,
+    CAPTURE_ENABLE,
+    CAPTURE_DISABLE,
+    CAPTURE_BLEND_FUNC,
+    CAPTURE_CLEAR_COLOR,
+    CAPTURE_CLEAR,
+    CAPTURE_COLOR_MASK,
+    CAPTURE_VIEWPORT,
+    CAPTURE_FINISH,
+    // mode, count, index type, index buffer offset, instance count
+    CAPTURE_DRAW_ELEMENTS_INSTANCED,
+    CAPTURE_OPCODE_COUNT
+};
+
+// arm a capture of the next frameCount frames into a file; the
+// capture starts at the next BeginGLCaptureFrame()
+bool RequestGLCapture(const char* filename, unsigned frameCount);
+// whether calls are being recorded right now
+bool IsGLCaptureActive();
+
+// mark the frame boundaries; called on the thread that owns the
+// context, around everything drawn for a frame. The file is
+// written when the last requested frame ends
+void BeginGLCaptureFrame();
+void EndGLCaptureFrame();
+
+// number of values of a uniform type and whether they are integers;
+// 0 for the types the capture does not record
+int GetCaptureUniformComponents(GLenum type, bool& bInteger);
+
+// shader files of a program, embedded in the capture when the
+// program no longer has its shader objects attached
+void SetGLCaptureShaderFiles(GLuint program, const char* vertexFilename, const char* fragmentFilename);
+
+// the recording versions of the OpenGL calls; GLCaptureCalls.h
+// redirects the calls of a source file to them. Outside a capture
+// they only forward the call
+void CaptureActiveTexture(GLenum texture);
+void CaptureBindBuffer(GLenum target, GLuint buffer);
+void CaptureBindBufferBase(GLenum target, GLuint index, GLuint buffer);
+void CaptureBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+void CaptureBindTexture(GLenum target, GLuint texture);
+void CaptureBindVertexArray(GLuint array);
+void CaptureBlendFunc(GLenum sfactor, GLenum dfactor);
+void CaptureBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+void CaptureBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+void CaptureClear(GLbitfield mask);
+void CaptureClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void CaptureColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha);
+void CaptureDeleteBuffers(GLsizei n, const GLuint* buffers);
+void CaptureDeleteTextures(GLsizei n, const GLuint* textures);
+void CaptureDeleteVertexArrays(GLsizei n, const GLuint* arrays);
+void CaptureDisable(GLenum cap);
+void CaptureDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void CaptureDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount);
+void CaptureEnable(GLenum cap);
+void CaptureEnableVertexAttribArray(GLuint index);
+void CaptureFinish();
+void CaptureGenBuffers(GLsizei n, GLuint* buffers);
+void CaptureGenerateMipmap(GLenum target);
+void CaptureGenTextures(GLsizei n, GLuint* textures);
+void CaptureGenVertexArrays(GLsizei n, GLuint* arrays);
+void CaptureTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                       GLint border, GLenum format, GLenum type, const void* pixels);
+void CaptureTexParameteri(GLenum target, GLenum pname, GLint param);
+void CaptureUniform1f(GLint location, GLfloat v0);
+void CaptureUniform1i(GLint location, GLint v0);
+void CaptureUniform3fv(GLint location, GLsizei count, const GLfloat* value);
+void CaptureUniform4fv(GLint location, GLsizei count, const GLfloat* value);
+void CaptureUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value);
+void CaptureUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding);
+void CaptureUseProgram(GLuint program);
+void CaptureVertexAttrib3f(GLuint index, GLfloat x, GLfloat y, GLfloat z);
+void CaptureVertexAttrib4f(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w);
+void CaptureVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                GLsizei stride, const void* pointer);
+void CaptureViewport(GLint x, GLint y, GLsizei width, GLsizei height);
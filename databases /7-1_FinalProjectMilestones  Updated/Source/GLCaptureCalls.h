@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// glcapturecalls.h
+// ============
+// redirect the OpenGL calls of a source file to the capture layer; must be
+// the last include of the file, after every header that uses OpenGL
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLCapture.h"
+
+// GLEW declares most entry points as macros over function pointers,
+// so the names are undefined before they are redirected
+#undef glActiveTexture
+#undef glBindBuffer
+#undef glBindBufferBase
+#undef glBindBufferRange
+#undef glBindTexture
+#undef glBindVertexArray
+#undef glBlendFunc
+#undef glBufferData
+#undef glBufferStorage
+#undef glClear
+#undef glClearColor
+#undef glColorMask
+#undef glDeleteBuffers
+#undef glDeleteTextures
+#undef glDeleteVertexArrays
+#undef glDisable
+#undef glDrawElements
+#undef glDrawElementsInstanced
+#undef glEnable
+#undef glEnableVertexAttribArray
+#undef glFinish
+#undef glGenBuffers
+#undef glGenerateMipmap
+#undef glGenTextures
+#undef glGenVertexArrays
+#undef glTexImage2D
+#undef glTexParameteri
+#undef glUniform1f
+#undef glUniform1i
+#undef glUniform3fv
+#undef glUniform4fv
+#undef glUniformMatrix4fv
+#undef glUniformBlockBinding
+#undef glUseProgram
+#undef glVertexAttrib3f
+#undef glVertexAttrib4f
+#undef glVertexAttribPointer
+#undef glViewport
+
+#define glActiveTexture             CaptureActiveTexture
+#define glBindBuffer                CaptureBindBuffer
+#define glBindBufferBase            CaptureBindBufferBase
+#define glBindBufferRange           CaptureBindBufferRange
+#define glBindTexture               CaptureBindTexture
+#define glBindVertexArray           CaptureBindVertexArray
+#define glBlendFunc                 CaptureBlendFunc
+#define glBufferData                CaptureBufferData
+#define glBufferStorage             CaptureBufferStorage
+#define glClear                     CaptureClear
+#define glClearColor                CaptureClearColor
+#define glColorMask                 CaptureColorMask
+#define glDeleteBuffers             CaptureDeleteBuffers
+#define glDeleteTextures            CaptureDeleteTextures
+#define glDeleteVertexArrays        CaptureDeleteVertexArrays
+#define glDisable                   CaptureDisable
+#define glDrawElements              CaptureDrawElements
+#define glDrawElementsInstanced     CaptureDrawElementsInstanced
+#define glEnable                    CaptureEnable
+#define glEnableVertexAttribArray   CaptureEnableVertexAttribArray
+#define glFinish                    CaptureFinish
+#define glGenBuffers                CaptureGenBuffers
+#define glGenerateMipmap            CaptureGenerateMipmap
+#define glGenTextures               CaptureGenTextures
+#define glGenVertexArrays           CaptureGenVertexArrays
+#define glTexImage2D                CaptureTexImage2D
+#define glTexParameteri             CaptureTexParameteri
+#define glUniform1f                 CaptureUniform1f
+#define glUniform1i                 CaptureUniform1i
+#define glUniform3fv                CaptureUniform3fv
+#define glUniform4fv                CaptureUniform4fv
+#define glUniformMatrix4fv          CaptureUniformMatrix4fv
+#define glUniformBlockBinding       CaptureUniformBlockBinding
+#define glUseProgram                CaptureUseProgram
+#define glVertexAttrib3f            CaptureVertexAttrib3f
+#define glVertexAttrib4f            CaptureVertexAttrib4f
+#define glVertexAttribPointer       CaptureVertexAttribPointer
+#define glViewport                  CaptureViewport
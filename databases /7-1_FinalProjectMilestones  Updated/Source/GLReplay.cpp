@@ -0,0 +1,1078 @@
+///////////////////////////////////////////////////////////////////////////////
+// glreplay.cpp
+// ============
+// run the frames of a GL capture file in a timed loop, without the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLReplay.h"
+#include "GLCapture.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// declare the global variables
+namespace
+{
+    // measured runs when none are requested
+    const unsigned DEFAULT_REPLAY_RUNS = 10;
+
+    /***********************************************************
+     *  ArgumentReader
+     *
+     *  Reads the arguments of one command. Reading past the
+     *  end of the command sets the error flag and returns
+     *  zeros, so a damaged file cannot read out of bounds.
+     ***********************************************************/
+    class ArgumentReader
+    {
+    public:
+        ArgumentReader(const uint8_t* pData, size_t size)
+            : m_pData(pData), m_size(size), m_offset(0), m_bError(false) {}
+
+        template <typename T>
+        T Get()
+        {
+            T value;
+            memset(&value, 0, sizeof(T));
+            const void* pBytes = GetBytes(sizeof(T));
+            if (pBytes != nullptr)
+            {
+                memcpy(&value, pBytes, sizeof(T));
+            }
+            return value;
+        }
+
+        const void* GetBytes(size_t size)
+        {
+            if (size > m_size - m_offset)
+            {
+                m_bError = true;
+                return nullptr;
+            }
+            const void* pBytes = m_pData + m_offset;
+            m_offset += size;
+            return pBytes;
+        }
+
+        // data stored with its byte count; nullptr when empty
+        const void* GetData(size_t& size)
+        {
+            size = static_cast<size_t>(Get<uint64_t>());
+            return size > 0 ? GetBytes(size) : nullptr;
+        }
+
+        std::string GetString()
+        {
+            const uint32_t length = Get<uint32_t>();
+            const char* pText = static_cast<const char*>(GetBytes(length));
+            return pText != nullptr ? std::string(pText, length) : std::string();
+        }
+
+        bool HasError() const { return m_bError; }
+
+    private:
+        const uint8_t* m_pData;
+        size_t m_size;
+        size_t m_offset;
+        bool m_bError;
+    };
+
+    // the work of the replayed frames, counted in the first run
+    struct REPLAY_WORK
+    {
+        size_t commands;
+        size_t draws;
+        size_t triangles;
+        size_t stateChanges;
+        size_t uniformUpdates;
+        size_t objectChanges;
+        size_t uploadBytes;
+    };
+
+    // a replayed program, and the locations of its uniforms by
+    // the location they had when they were recorded
+    struct REPLAY_PROGRAM
+    {
+        GLuint program;
+        std::unordered_map<GLint, GLint> locations;
+    };
+
+    /***********************************************************
+     *  CaptureReplayer
+     *
+     *  Executes the commands of a mapped capture file, with
+     *  the recorded object names mapped to the objects it
+     *  creates, and draws into its own framebuffer.
+     ***********************************************************/
+    class CaptureReplayer
+    {
+    public:
+        CaptureReplayer();
+        ~CaptureReplayer();
+
+        // map and validate a capture file; errors are printed
+        bool Open(const char* filename);
+        // create and bind the offscreen target
+        bool CreateTarget();
+        // execute every command of the resource or state section
+        bool ExecuteSection(CAPTURE_FILE_SECTION_ID section);
+        // execute the frames once and append the time each frame
+        // took to submit and to finish, in milliseconds
+        bool ExecuteFrames(std::vector<double>& submitTimes, std::vector<double>& frameTimes);
+
+        uint32_t GetFrameCount() const { return m_pHeader->frameCount; }
+        int GetWidth() const { return std::max(1, m_pHeader->viewport[2]); }
+        int GetHeight() const { return std::max(1, m_pHeader->viewport[3]); }
+        const REPLAY_WORK& GetWork() const { return m_work; }
+
+    private:
+        // execute one command; false if its arguments are damaged
+        bool Execute(uint32_t opcode, ArgumentReader& args);
+        void DefineProgram(ArgumentReader& args);
+        void CountWork(uint32_t opcode);
+        GLuint FindObject(const std::unordered_map<GLuint, GLuint>& objects, uint32_t name) const;
+        void ReleaseObjects();
+
+        MappedFile m_file;
+        const CAPTURE_FILE_HEADER* m_pHeader;
+
+        std::unordered_map<GLuint, GLuint> m_buffers;
+        std::unordered_map<GLuint, GLuint> m_textures;
+        std::unordered_map<GLuint, GLuint> m_vertexArrays;
+        std::unordered_map<GLuint, REPLAY_PROGRAM> m_programs;
+        const REPLAY_PROGRAM* m_pCurrentProgram;
+
+        GLuint m_framebuffer;
+        GLuint m_renderbuffers[2];
+
+        REPLAY_WORK m_work;
+        bool m_bCountWork;
+    };
+
+    /***********************************************************
+     *  SetUniformValues()
+     *
+     *  Set a uniform of the current program from the values
+     *  stored for its type.
+     ***********************************************************/
+    void SetUniformValues(GLint location, GLenum type, GLsizei count, GLboolean transpose, const void* pValues)
+    {
+        const GLfloat* pFloats = static_cast<const GLfloat*>(pValues);
+        const GLint* pInts = static_cast<const GLint*>(pValues);
+        switch (type)
+        {
+        case GL_FLOAT:      glUniform1fv(location, count, pFloats); break;
+        case GL_FLOAT_VEC2: glUniform2fv(location, count, pFloats); break;
+        case GL_FLOAT_VEC3: glUniform3fv(location, count, pFloats); break;
+        case GL_FLOAT_VEC4: glUniform4fv(location, count, pFloats); break;
+        case GL_FLOAT_MAT3: glUniformMatrix3fv(location, count, transpose, pFloats); break;
+        case GL_FLOAT_MAT4: glUniformMatrix4fv(location, count, transpose, pFloats); break;
+        case GL_INT_VEC2:
+        case GL_BOOL_VEC2:  glUniform2iv(location, count, pInts); break;
+        case GL_INT_VEC3:
+        case GL_BOOL_VEC3:  glUniform3iv(location, count, pInts); break;
+        case GL_INT_VEC4:
+        case GL_BOOL_VEC4:  glUniform4iv(location, count, pInts); break;
+        default:            glUniform1iv(location, count, pInts); break;
+        }
+    }
+
+    /***********************************************************
+     *  CompileShader()
+     *
+     *  Compile one recorded shader; 0 with the log printed if
+     *  it does not compile on this driver.
+     ***********************************************************/
+    GLuint CompileShader(GLenum type, const std::string& source)
+    {
+        GLuint shader = glCreateShader(type);
+        const GLchar* pSource = source.c_str();
+        glShaderSource(shader, 1, &pSource, nullptr);
+        glCompileShader(shader);
+
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (GL_FALSE == status)
+        {
+            GLchar log[1024] = {};
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR: Replayed shader does not compile: " << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    /***********************************************************
+     *  GetAverage()
+     *
+     *  Average of a list of frame times.
+     ***********************************************************/
+    double GetAverage(const std::vector<double>& times)
+    {
+        double total = 0.0;
+        for (double time : times)
+        {
+            total += time;
+        }
+        return times.empty() ? 0.0 : total / times.size();
+    }
+
+    /***********************************************************
+     *  CaptureReplayer()
+     *
+     *  The constructor for the class
+     ***********************************************************/
+    CaptureReplayer::CaptureReplayer()
+        : m_pHeader(nullptr),
+          m_pCurrentProgram(nullptr),
+          m_framebuffer(0),
+          m_bCountWork(true)
+    {
+        m_renderbuffers[0] = 0;
+        m_renderbuffers[1] = 0;
+        memset(&m_work, 0, sizeof(m_work));
+    }
+
+    /***********************************************************
+     *  ~CaptureReplayer()
+     *
+     *  The destructor for the class
+     ***********************************************************/
+    CaptureReplayer::~CaptureReplayer()
+    {
+        ReleaseObjects();
+    }
+
+    /***********************************************************
+     *  Open()
+     *
+     *  Map a capture file and check that its header and its
+     *  sections are valid.
+     ***********************************************************/
+    bool CaptureReplayer::Open(const char* filename)
+    {
+        if (!m_file.Open(filename))
+        {
+            std::cout << "Could not open GL capture file: " << filename << std::endl;
+            return false;
+        }
+
+        const CAPTURE_FILE_HEADER* pHeader = reinterpret_cast<const CAPTURE_FILE_HEADER*>(m_file.GetData());
+        if (m_file.GetSize() < sizeof(CAPTURE_FILE_HEADER) ||
+            pHeader->magic != CAPTURE_FILE_MAGIC ||
+            pHeader->version != CAPTURE_FILE_VERSION ||
+            pHeader->headerSize != sizeof(CAPTURE_FILE_HEADER))
+        {
+            std::cout << "Not a GL capture file of version " << CAPTURE_FILE_VERSION << ": " << filename << std::endl;
+            return false;
+        }
+        for (int i = 0; i < CAPTURE_SECTION_COUNT; ++i)
+        {
+            if (pHeader->sections[i].offset > m_file.GetSize() ||
+                pHeader->sections[i].size > m_file.GetSize() - pHeader->sections[i].offset)
+            {
+                std::cout << "GL capture file is truncated: " << filename << std::endl;
+                return false;
+            }
+        }
+
+        m_pHeader = pHeader;
+        return true;
+    }
+
+    /***********************************************************
+     *  CreateTarget()
+     *
+     *  Create and bind a framebuffer of the captured viewport
+     *  size, so the replay does not depend on a window.
+     ***********************************************************/
+    bool CaptureReplayer::CreateTarget()
+    {
+        glGenRenderbuffers(2, m_renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, GetWidth(), GetHeight());
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, GetWidth(), GetHeight());
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &m_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffers[1]);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR: Could not create the replay framebuffer" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /***********************************************************
+     *  ExecuteSection()
+     *
+     *  Execute the resource or the state commands.
+     ***********************************************************/
+    bool CaptureReplayer::ExecuteSection(CAPTURE_FILE_SECTION_ID section)
+    {
+        const uint8_t* pCommand = m_file.GetData() + m_pHeader->sections[section].offset;
+        const uint8_t* pEnd = pCommand + m_pHeader->sections[section].size;
+
+        // the resources and the state are not part of the frame work
+        const bool bCountWork = m_bCountWork;
+        m_bCountWork = false;
+
+        bool bValid = true;
+        while (bValid && pCommand < pEnd)
+        {
+            uint32_t command[2];
+            if (static_cast<size_t>(pEnd - pCommand) < sizeof(command))
+            {
+                bValid = false;
+                break;
+            }
+            memcpy(command, pCommand, sizeof(command));
+            pCommand += sizeof(command);
+            if (command[1] > static_cast<size_t>(pEnd - pCommand))
+            {
+                bValid = false;
+                break;
+            }
+
+            ArgumentReader args(pCommand, command[1]);
+            bValid = Execute(command[0], args);
+            pCommand += command[1];
+        }
+
+        m_bCountWork = bCountWork;
+        return bValid;
+    }
+
+    /***********************************************************
+     *  ExecuteFrames()
+     *
+     *  Execute the recorded frames. The submit time ends when
+     *  the last call of a frame is issued, the frame time
+     *  when glFinish() returns, so the difference is the time
+     *  the GPU needed beyond the driver.
+     ***********************************************************/
+    bool CaptureReplayer::ExecuteFrames(std::vector<double>& submitTimes, std::vector<double>& frameTimes)
+    {
+        const uint8_t* pCommand = m_file.GetData() + m_pHeader->sections[CAPTURE_SECTION_FRAMES].offset;
+        const uint8_t* pEnd = pCommand + m_pHeader->sections[CAPTURE_SECTION_FRAMES].size;
+
+        auto start = std::chrono::high_resolution_clock::now();
+        while (pCommand < pEnd)
+        {
+            uint32_t command[2];
+            if (static_cast<size_t>(pEnd - pCommand) < sizeof(command))
+            {
+                return false;
+            }
+            memcpy(command, pCommand, sizeof(command));
+            pCommand += sizeof(command);
+            if (command[1] > static_cast<size_t>(pEnd - pCommand))
+            {
+                return false;
+            }
+
+            if (CAPTURE_END_FRAME == command[0])
+            {
+                auto submitted = std::chrono::high_resolution_clock::now();
+                glFinish();
+                auto finished = std::chrono::high_resolution_clock::now();
+                submitTimes.push_back(std::chrono::duration<double, std::milli>(submitted - start).count());
+                frameTimes.push_back(std::chrono::duration<double, std::milli>(finished - start).count());
+                start = finished;
+            }
+            else
+            {
+                if (m_bCountWork)
+                {
+                    CountWork(command[0]);
+                }
+
+                ArgumentReader args(pCommand, command[1]);
+                if (!Execute(command[0], args))
+                {
+                    return false;
+                }
+            }
+            pCommand += command[1];
+        }
+
+        m_bCountWork = false;
+        return true;
+    }
+
+    /***********************************************************
+     *  CountWork()
+     *
+     *  Add a command to the work of the frames.
+     ***********************************************************/
+    void CaptureReplayer::CountWork(uint32_t opcode)
+    {
+        ++m_work.commands;
+        switch (opcode)
+        {
+        case CAPTURE_DRAW_ELEMENTS:
+        case CAPTURE_DRAW_ELEMENTS_INSTANCED:
+            ++m_work.draws;
+            break;
+        case CAPTURE_UNIFORM:
+            ++m_work.uniformUpdates;
+            break;
+        case CAPTURE_GEN_BUFFER:
+        case CAPTURE_DELETE_BUFFER:
+        case CAPTURE_GEN_TEXTURE:
+        case CAPTURE_DELETE_TEXTURE:
+        case CAPTURE_GEN_VERTEX_ARRAY:
+        case CAPTURE_DELETE_VERTEX_ARRAY:
+            ++m_work.objectChanges;
+            break;
+        case CAPTURE_BUFFER_DATA:
+        case CAPTURE_UPDATE_BUFFER:
+        case CAPTURE_TEX_IMAGE_2D:
+        case CAPTURE_GENERATE_MIPMAP:
+        case CAPTURE_CLEAR:
+        case CAPTURE_FINISH:
+            // the upload sizes are added by Execute()
+            break;
+        default:
+            ++m_work.stateChanges;
+            break;
+        }
+    }
+
+    /***********************************************************
+     *  FindObject()
+     *
+     *  The replayed object of a recorded name, 0 for 0 and
+     *  for names the replay never created.
+     ***********************************************************/
+    GLuint CaptureReplayer::FindObject(const std::unordered_map<GLuint, GLuint>& objects, uint32_t name) const
+    {
+        auto found = objects.find(name);
+        return found != objects.end() ? found->second : 0;
+    }
+
+    /***********************************************************
+     *  DefineProgram()
+     *
+     *  Build a recorded program, map its uniform locations by
+     *  name and set the recorded uniform values and block
+     *  bindings.
+     ***********************************************************/
+    void CaptureReplayer::DefineProgram(ArgumentReader& args)
+    {
+        const uint32_t name = args.Get<uint32_t>();
+
+        REPLAY_PROGRAM& entry = m_programs[name];
+        entry.program = glCreateProgram();
+
+        bool bCompiled = true;
+        const uint32_t shaderCount = args.Get<uint32_t>();
+        std::vector<GLuint> shaders;
+        for (uint32_t i = 0; i < shaderCount && !args.HasError(); ++i)
+        {
+            const GLenum type = args.Get<uint32_t>();
+            const GLuint shader = CompileShader(type, args.GetString());
+            bCompiled = bCompiled && 0 != shader;
+            if (0 != shader)
+            {
+                glAttachShader(entry.program, shader);
+                shaders.push_back(shader);
+            }
+        }
+
+        if (bCompiled && shaderCount > 0)
+        {
+            glLinkProgram(entry.program);
+            GLint status = GL_FALSE;
+            glGetProgramiv(entry.program, GL_LINK_STATUS, &status);
+            bCompiled = GL_FALSE != status;
+        }
+        for (GLuint shader : shaders)
+        {
+            glDetachShader(entry.program, shader);
+            glDeleteShader(shader);
+        }
+        if (!bCompiled || 0 == shaderCount)
+        {
+            // draws with this program are skipped
+            std::cout << "ERROR: Recorded program " << name << " could not be built" << std::endl;
+            glDeleteProgram(entry.program);
+            entry.program = 0;
+        }
+
+        if (0 != entry.program)
+        {
+            glUseProgram(entry.program);
+        }
+
+        const uint32_t uniformCount = args.Get<uint32_t>();
+        for (uint32_t i = 0; i < uniformCount && !args.HasError(); ++i)
+        {
+            const std::string uniformName = args.GetString();
+            const GLint location = args.Get<int32_t>();
+            const GLenum type = args.Get<uint32_t>();
+            const GLsizei count = static_cast<GLsizei>(args.Get<uint32_t>());
+
+            bool bInteger = false;
+            const size_t components = static_cast<size_t>(GetCaptureUniformComponents(type, bInteger));
+            const void* pValues = args.GetBytes(components * count * 4);
+            if (0 == entry.program || nullptr == pValues)
+            {
+                continue;
+            }
+
+            const GLint replayLocation = glGetUniformLocation(entry.program, uniformName.c_str());
+            entry.locations[location] = replayLocation;
+            SetUniformValues(replayLocation, type, count, GL_FALSE, pValues);
+        }
+
+        const uint32_t blockCount = args.Get<uint32_t>();
+        for (uint32_t i = 0; i < blockCount && !args.HasError(); ++i)
+        {
+            const std::string blockName = args.GetString();
+            const GLuint binding = args.Get<uint32_t>();
+            const GLuint blockIndex = 0 != entry.program ?
+                glGetUniformBlockIndex(entry.program, blockName.c_str()) : GL_INVALID_INDEX;
+            if (GL_INVALID_INDEX != blockIndex)
+            {
+                glUniformBlockBinding(entry.program, blockIndex, binding);
+            }
+        }
+
+        glUseProgram(m_pCurrentProgram != nullptr ? m_pCurrentProgram->program : 0);
+    }
+
+    /***********************************************************
+     *  Execute()
+     *
+     *  Make the OpenGL call of one recorded command.
+     ***********************************************************/
+    bool CaptureReplayer::Execute(uint32_t opcode, ArgumentReader& args)
+    {
+        size_t dataSize = 0;
+        switch (opcode)
+        {
+        case CAPTURE_DEFINE_BUFFER:
+        {
+            const uint32_t name = args.Get<uint32_t>();
+            const GLenum usage = args.Get<uint32_t>();
+            const void* pData = args.GetData(dataSize);
+            GLuint& buffer = m_buffers[name];
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(dataSize), pData, usage);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            break;
+        }
+        case CAPTURE_DEFINE_TEXTURE:
+        {
+            const uint32_t name = args.Get<uint32_t>();
+            const GLint internalFormat = args.Get<int32_t>();
+            const GLsizei width = args.Get<int32_t>();
+            const GLsizei height = args.Get<int32_t>();
+            GLint parameters[4];
+            for (GLint& parameter : parameters)
+            {
+                parameter = args.Get<int32_t>();
+            }
+            const void* pTexels = args.GetData(dataSize);
+            if (args.HasError() || dataSize != static_cast<size_t>(width) * height * 4)
+            {
+                return false;
+            }
+
+            GLuint& texture = m_textures[name];
+            glGenTextures(1, &texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, parameters[0]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, parameters[1]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, parameters[2]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, parameters[3]);
+            if (pTexels != nullptr)
+            {
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pTexels);
+                if (GL_LINEAR != parameters[0] && GL_NEAREST != parameters[0])
+                {
+                    glGenerateMipmap(GL_TEXTURE_2D);
+                }
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+            break;
+        }
+        case CAPTURE_DEFINE_VERTEX_ARRAY:
+        {
+            const uint32_t name = args.Get<uint32_t>();
+            const uint32_t elementBuffer = args.Get<uint32_t>();
+            const uint32_t attributeCount = args.Get<uint32_t>();
+
+            GLuint& vertexArray = m_vertexArrays[name];
+            glGenVertexArrays(1, &vertexArray);
+            glBindVertexArray(vertexArray);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, FindObject(m_buffers, elementBuffer));
+            for (uint32_t i = 0; i < attributeCount && !args.HasError(); ++i)
+            {
+                int32_t values[8];
+                for (int32_t& value : values)
+                {
+                    value = args.Get<int32_t>();
+                }
+                const void* pOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(args.Get<uint64_t>()));
+                const GLuint buffer = FindObject(m_buffers, static_cast<uint32_t>(values[7]));
+                if (0 == buffer)
+                {
+                    continue;
+                }
+
+                glBindBuffer(GL_ARRAY_BUFFER, buffer);
+                if (0 != values[5])
+                {
+                    glVertexAttribIPointer(values[0], values[2], values[3], values[6], pOffset);
+                }
+                else
+                {
+                    glVertexAttribPointer(values[0], values[2], values[3],
+                                          static_cast<GLboolean>(values[4]), values[6], pOffset);
+                }
+                if (0 != values[1])
+                {
+                    glEnableVertexAttribArray(values[0]);
+                }
+            }
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            break;
+        }
+        case CAPTURE_DEFINE_PROGRAM:
+            DefineProgram(args);
+            break;
+        case CAPTURE_UPDATE_BUFFER:
+        {
+            const GLuint buffer = FindObject(m_buffers, args.Get<uint32_t>());
+            const GLintptr offset = static_cast<GLintptr>(args.Get<uint64_t>());
+            const void* pData = args.GetData(dataSize);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, static_cast<GLsizeiptr>(dataSize), pData);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            break;
+        }
+        case CAPTURE_GEN_BUFFER:
+        {
+            // the frames create their objects again in every run
+            GLuint& buffer = m_buffers[args.Get<uint32_t>()];
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            break;
+        }
+        case CAPTURE_DELETE_BUFFER:
+        {
+            auto found = m_buffers.find(args.Get<uint32_t>());
+            if (found != m_buffers.end())
+            {
+                glDeleteBuffers(1, &found->second);
+                m_buffers.erase(found);
+            }
+            break;
+        }
+        case CAPTURE_BIND_BUFFER:
+        {
+            const GLenum target = args.Get<uint32_t>();
+            glBindBuffer(target, FindObject(m_buffers, args.Get<uint32_t>()));
+            break;
+        }
+        case CAPTURE_BIND_BUFFER_BASE:
+        {
+            const GLenum target = args.Get<uint32_t>();
+            const GLuint index = args.Get<uint32_t>();
+            glBindBufferBase(target, index, FindObject(m_buffers, args.Get<uint32_t>()));
+            break;
+        }
+        case CAPTURE_BIND_BUFFER_RANGE:
+        {
+            const GLenum target = args.Get<uint32_t>();
+            const GLuint index = args.Get<uint32_t>();
+            const GLuint buffer = FindObject(m_buffers, args.Get<uint32_t>());
+            const GLintptr offset = static_cast<GLintptr>(args.Get<uint64_t>());
+            const GLsizeiptr size = static_cast<GLsizeiptr>(args.Get<uint64_t>());
+            glBindBufferRange(target, index, buffer, offset, size);
+            break;
+        }
+        case CAPTURE_BUFFER_DATA:
+        {
+            const GLenum target = args.Get<uint32_t>();
+            const GLenum usage = args.Get<uint32_t>();
+            const GLsizeiptr size = static_cast<GLsizeiptr>(args.Get<uint64_t>());
+            const void* pData = args.GetData(dataSize);
+            glBufferData(target, size, pData, usage);
+            break;
+        }
+        case CAPTURE_GEN_TEXTURE:
+        {
+            // the frames create their objects again in every run
+            GLuint& texture = m_textures[args.Get<uint32_t>()];
+            glDeleteTextures(1, &texture);
+            glGenTextures(1, &texture);
+            break;
+        }
+        case CAPTURE_DELETE_TEXTURE:
+        {
+            auto found = m_textures.find(args.Get<uint32_t>());
+            if (found != m_textures.end())
+            {
+                glDeleteTextures(1, &found->second);
+                m_textures.erase(found);
+            }
+            break;
+        }
+        case CAPTURE_ACTIVE_TEXTURE:
+            glActiveTexture(args.Get<uint32_t>());
+            break;
+        case CAPTURE_BIND_TEXTURE:
+        {
+            const GLenum target = args.Get<uint32_t>();
+            glBindTexture(target, FindObject(m_textures, args.Get<uint32_t>()));
+            break;
+        }
+        case CAPTURE_TEX_PARAMETER:
+        {
+            const GLenum target = args.Get<uint32_t>();
+            const GLenum parameter = args.Get<uint32_t>();
+            glTexParameteri(target, parameter, args.Get<int32_t>());
+            break;
+        }
+        case CAPTURE_TEX_IMAGE_2D:
+        {
+            const GLenum target = args.Get<uint32_t>();
+            const GLint level = args.Get<int32_t>();
+            const GLint internalFormat = args.Get<int32_t>();
+            const GLsizei width = args.Get<int32_t>();
+            const GLsizei height = args.Get<int32_t>();
+            const GLenum format = args.Get<uint32_t>();
+            const GLenum type = args.Get<uint32_t>();
+            const GLint alignment = args.Get<int32_t>();
+            const void* pPixels = args.GetData(dataSize);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+            glTexImage2D(target, level, internalFormat, width, height, 0, format, type, pPixels);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            break;
+        }
+        case CAPTURE_GENERATE_MIPMAP:
+            glGenerateMipmap(args.Get<uint32_t>());
+            break;
+        case CAPTURE_GEN_VERTEX_ARRAY:
+        {
+            // the frames create their objects again in every run
+            GLuint& vertexArray = m_vertexArrays[args.Get<uint32_t>()];
+            glDeleteVertexArrays(1, &vertexArray);
+            glGenVertexArrays(1, &vertexArray);
+            break;
+        }
+        case CAPTURE_DELETE_VERTEX_ARRAY:
+        {
+            auto found = m_vertexArrays.find(args.Get<uint32_t>());
+            if (found != m_vertexArrays.end())
+            {
+                glDeleteVertexArrays(1, &found->second);
+                m_vertexArrays.erase(found);
+            }
+            break;
+        }
+        case CAPTURE_BIND_VERTEX_ARRAY:
+            glBindVertexArray(FindObject(m_vertexArrays, args.Get<uint32_t>()));
+            break;
+        case CAPTURE_VERTEX_ATTRIB_POINTER:
+        {
+            const GLuint index = args.Get<uint32_t>();
+            const GLint size = args.Get<int32_t>();
+            const GLenum type = args.Get<uint32_t>();
+            const GLboolean normalized = static_cast<GLboolean>(args.Get<uint32_t>());
+            const GLsizei stride = args.Get<int32_t>();
+            const void* pOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(args.Get<uint64_t>()));
+            glVertexAttribPointer(index, size, type, normalized, stride, pOffset);
+            break;
+        }
+        case CAPTURE_ENABLE_VERTEX_ATTRIB_ARRAY:
+            glEnableVertexAttribArray(args.Get<uint32_t>());
+            break;
+        case CAPTURE_VERTEX_ATTRIB_4F:
+        {
+            const GLuint index = args.Get<uint32_t>();
+            const GLfloat* pValue = static_cast<const GLfloat*>(args.GetBytes(4 * sizeof(GLfloat)));
+            if (pValue != nullptr)
+            {
+                glVertexAttrib4fv(index, pValue);
+            }
+            break;
+        }
+        case CAPTURE_USE_PROGRAM:
+        {
+            auto found = m_programs.find(args.Get<uint32_t>());
+            m_pCurrentProgram = found != m_programs.end() ? &found->second : nullptr;
+            glUseProgram(m_pCurrentProgram != nullptr ? m_pCurrentProgram->program : 0);
+            break;
+        }
+        case CAPTURE_UNIFORM:
+        {
+            const GLint location = args.Get<int32_t>();
+            const GLenum type = args.Get<uint32_t>();
+            const GLsizei count = static_cast<GLsizei>(args.Get<uint32_t>());
+            const GLboolean transpose = static_cast<GLboolean>(args.Get<uint32_t>());
+            bool bInteger = false;
+            const size_t components = static_cast<size_t>(GetCaptureUniformComponents(type, bInteger));
+            const void* pValues = args.GetBytes(components * count * 4);
+            if (nullptr == m_pCurrentProgram || nullptr == pValues)
+            {
+                break;
+            }
+            auto found = m_pCurrentProgram->locations.find(location);
+            if (found != m_pCurrentProgram->locations.end())
+            {
+                SetUniformValues(found->second, type, count, transpose, pValues);
+            }
+            break;
+        }
+        case CAPTURE_UNIFORM_BLOCK_BINDING:
+        {
+            auto found = m_programs.find(args.Get<uint32_t>());
+            const std::string blockName = args.GetString();
+            const GLuint binding = args.Get<uint32_t>();
+            if (found != m_programs.end() && 0 != found->second.program)
+            {
+                const GLuint blockIndex = glGetUniformBlockIndex(found->second.program, blockName.c_str());
+                if (GL_INVALID_INDEX != blockIndex)
+                {
+                    glUniformBlockBinding(found->second.program, blockIndex, binding);
+                }
+            }
+            break;
+        }
+        case CAPTURE_DRAW_ELEMENTS:
+        {
+            const GLenum mode = args.Get<uint32_t>();
+            const GLsizei count = static_cast<GLsizei>(args.Get<uint32_t>());
+            const GLenum type = args.Get<uint32_t>();
+            const void* pOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(args.Get<uint64_t>()));
+            if (m_bCountWork && GL_TRIANGLES == mode)
+            {
+                m_work.triangles += static_cast<size_t>(count) / 3;
+            }
+            if (m_pCurrentProgram != nullptr && 0 != m_pCurrentProgram->program)
+            {
+                glDrawElements(mode, count, type, pOffset);
+            }
+            break;
+        }
+        case CAPTURE_DRAW_ELEMENTS_INSTANCED:
+        {
+            const GLenum mode = args.Get<uint32_t>();
+            const GLsizei count = static_cast<GLsizei>(args.Get<uint32_t>());
+            const GLenum type = args.Get<uint32_t>();
+            const void* pOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(args.Get<uint64_t>()));
+            const GLsizei instanceCount = static_cast<GLsizei>(args.Get<uint32_t>());
+            if (m_bCountWork && GL_TRIANGLES == mode)
+            {
+                m_work.triangles += static_cast<size_t>(count) / 3 * static_cast<size_t>(instanceCount);
+            }
+            if (m_pCurrentProgram != nullptr && 0 != m_pCurrentProgram->program)
+            {
+                glDrawElementsInstanced(mode, count, type, pOffset, instanceCount);
+            }
+            break;
+        }
+        case CAPTURE_ENABLE:
+            glEnable(args.Get<uint32_t>());
+            break;
+        case CAPTURE_DISABLE:
+            glDisable(args.Get<uint32_t>());
+            break;
+        case CAPTURE_BLEND_FUNC:
+        {
+            const GLenum source = args.Get<uint32_t>();
+            glBlendFunc(source, args.Get<uint32_t>());
+            break;
+        }
+        case CAPTURE_CLEAR_COLOR:
+        {
+            const GLfloat* pColor = static_cast<const GLfloat*>(args.GetBytes(4 * sizeof(GLfloat)));
+            if (pColor != nullptr)
+            {
+                glClearColor(pColor[0], pColor[1], pColor[2], pColor[3]);
+            }
+            break;
+        }
+        case CAPTURE_CLEAR:
+            glClear(args.Get<uint32_t>());
+            break;
+        case CAPTURE_COLOR_MASK:
+        {
+            GLboolean mask[4];
+            for (GLboolean& value : mask)
+            {
+                value = static_cast<GLboolean>(args.Get<uint32_t>());
+            }
+            glColorMask(mask[0], mask[1], mask[2], mask[3]);
+            break;
+        }
+        case CAPTURE_VIEWPORT:
+        {
+            GLint viewport[4];
+            for (GLint& value : viewport)
+            {
+                value = args.Get<int32_t>();
+            }
+            glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+            break;
+        }
+        case CAPTURE_FINISH:
+            glFinish();
+            break;
+        default:
+            // commands of a newer version are skipped
+            break;
+        }
+
+        if (m_bCountWork)
+        {
+            m_work.uploadBytes += dataSize;
+        }
+        return !args.HasError();
+    }
+
+    /***********************************************************
+     *  ReleaseObjects()
+     *
+     *  Delete everything the replay created.
+     ***********************************************************/
+    void CaptureReplayer::ReleaseObjects()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindVertexArray(0);
+        glUseProgram(0);
+
+        for (auto& buffer : m_buffers)
+        {
+            glDeleteBuffers(1, &buffer.second);
+        }
+        for (auto& texture : m_textures)
+        {
+            glDeleteTextures(1, &texture.second);
+        }
+        for (auto& vertexArray : m_vertexArrays)
+        {
+            glDeleteVertexArrays(1, &vertexArray.second);
+        }
+        for (auto& program : m_programs)
+        {
+            glDeleteProgram(program.second.program);
+        }
+        m_buffers.clear();
+        m_textures.clear();
+        m_vertexArrays.clear();
+        m_programs.clear();
+        m_pCurrentProgram = nullptr;
+
+        glDeleteFramebuffers(1, &m_framebuffer);
+        glDeleteRenderbuffers(2, m_renderbuffers);
+        m_framebuffer = 0;
+    }
+}
+
+/***********************************************************
+ *  RunGLReplay()
+ *
+ *  This function is used to time the frames of a capture
+ *  file on the current context. A first run creates the
+ *  driver state and counts the work; it is not measured.
+ ***********************************************************/
+int RunGLReplay(const char* filename, unsigned runs)
+{
+    if (0 == runs)
+    {
+        runs = DEFAULT_REPLAY_RUNS;
+    }
+
+    CaptureReplayer replayer;
+    if (!replayer.Open(filename) || !replayer.CreateTarget())
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<double> submitTimes;
+    std::vector<double> frameTimes;
+    if (!replayer.ExecuteSection(CAPTURE_SECTION_RESOURCES) ||
+        !replayer.ExecuteSection(CAPTURE_SECTION_STATE) ||
+        !replayer.ExecuteFrames(submitTimes, frameTimes))
+    {
+        std::cout << "ERROR: GL capture file is damaged: " << filename << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    size_t errorCount = 0;
+    while (glGetError() != GL_NO_ERROR)
+    {
+        ++errorCount;
+    }
+
+    const uint32_t frames = std::max(1u, replayer.GetFrameCount());
+    const REPLAY_WORK& work = replayer.GetWork();
+    std::cout << "INFO: Replaying " << replayer.GetFrameCount() << " frames of " << filename << " at "
+              << replayer.GetWidth() << "x" << replayer.GetHeight() << ", " << runs << " runs" << std::endl;
+    std::cout << "  per frame: " << work.commands / frames << " calls, "
+              << work.draws / frames << " draws, "
+              << work.triangles / frames << " triangles, "
+              << work.stateChanges / frames << " state changes, "
+              << work.uniformUpdates / frames << " uniform updates, "
+              << work.objectChanges / frames << " objects created or deleted, "
+              << work.uploadBytes / frames / 1024 << " KB uploaded" << std::endl;
+    if (errorCount > 0)
+    {
+        std::cout << "WARNING: The replay raised " << errorCount << " OpenGL errors" << std::endl;
+    }
+
+    double bestSubmit = 0.0;
+    double bestFrame = 0.0;
+    double totalSubmit = 0.0;
+    double totalFrame = 0.0;
+    for (unsigned run = 0; run < runs; ++run)
+    {
+        submitTimes.clear();
+        frameTimes.clear();
+        replayer.ExecuteSection(CAPTURE_SECTION_STATE);
+        replayer.ExecuteFrames(submitTimes, frameTimes);
+
+        const double submitMs = GetAverage(submitTimes);
+        const double frameMs = GetAverage(frameTimes);
+        std::cout << "  run " << std::setw(3) << run + 1
+                  << "  submit: " << std::fixed << std::setprecision(3) << std::setw(8) << submitMs << " ms"
+                  << "  frame: " << std::setw(8) << frameMs << " ms"
+                  << std::defaultfloat << std::endl;
+
+        if (0 == run || frameMs < bestFrame)
+        {
+            bestSubmit = submitMs;
+            bestFrame = frameMs;
+        }
+        totalSubmit += submitMs;
+        totalFrame += frameMs;
+    }
+
+    std::cout << "  average submit: " << std::fixed << std::setprecision(3) << totalSubmit / runs
+              << " ms, frame: " << totalFrame / runs << " ms; best run submit: "
+              << bestSubmit << " ms, frame: " << bestFrame << " ms" << std::defaultfloat << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,13 @@
+///////////////////////////////////////////////////////////////////////////////
+// glreplay.h
+// ============
+// run the frames of a GL capture file in a timed loop, without the scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// replay the frames of a capture file written by GLCapture.h runs
+// times into an offscreen target of the captured viewport size, and
+// report the work per frame with the time to submit the calls and to
+// finish the frame; needs a current OpenGL context
+int RunGLReplay(const char* filename, unsigned runs);
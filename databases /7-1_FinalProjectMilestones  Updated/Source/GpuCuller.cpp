@@ -0,0 +1,616 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.cpp
+// ============
+// cull the scene objects in a compute shader and draw the survivors with
+// one indirect call
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+#include "Frustum.h"
+#include "AllocationTracker.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// redirects the OpenGL calls below to the capture layer
+#include "GLCaptureCalls.h"
+
+// declare the global variables
+namespace
+{
+    const char* const g_CullShaderFilename = "shaders/gpuCullCompute.glsl";
+    const char* const g_PyramidShaderFilename = "shaders/depthPyramidCompute.glsl";
+
+    // work group sizes declared by the compute shaders
+    const GLuint CULL_GROUP_SIZE = 64;
+    const GLuint PYRAMID_GROUP_SIZE = 8;
+
+    // texture unit of the depth pyramid, after the units of the
+    // scene textures
+    const GLuint PYRAMID_TEXTURE_UNIT = MAX_SHADER_TEXTURES;
+
+    /***********************************************************
+     *  CreateComputeProgram()
+     *
+     *  Compile and link a compute shader file; 0 with the log
+     *  printed if it does not build on this driver.
+     ***********************************************************/
+    GLuint CreateComputeProgram(const char* filename)
+    {
+        std::ifstream file(filename, std::ios::in | std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR: Could not open the compute shader " << filename << std::endl;
+            return 0;
+        }
+        std::stringstream text;
+        text << file.rdbuf();
+        const std::string source = text.str();
+
+        GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+        const GLchar* pSource = source.c_str();
+        glShaderSource(shader, 1, &pSource, nullptr);
+        glCompileShader(shader);
+
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (GL_FALSE == status)
+        {
+            GLchar log[1024] = {};
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR: " << filename << " does not compile: " << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+
+        GLuint program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (GL_FALSE == status)
+        {
+            GLchar log[1024] = {};
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cout << "ERROR: " << filename << " does not link: " << log << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller()
+    : m_bOcclusion(false),
+      m_bMeshlets(false),
+      m_cullProgram(0),
+      m_pyramidProgram(0),
+      m_frustumPlanesLocation(-1),
+      m_objectCountLocation(-1),
+      m_useOcclusionLocation(-1),
+      m_useMeshletsLocation(-1),
+      m_viewPositionLocation(-1),
+      m_previousViewProjectionLocation(-1),
+      m_pyramidLevelsLocation(-1),
+      m_sourceLevelLocation(-1),
+      m_meshTableBuffer(0),
+      m_meshletTableBuffer(0),
+      m_meshletCount(0),
+      m_meshletTriangles(0),
+      m_meshletVertices(0),
+      m_objectBuffer(0),
+      m_commandBuffer(0),
+      m_countBuffer(0),
+      m_objectCount(0),
+      m_commandCapacity(0),
+      m_uploadedVersion(0),
+      m_depthTexture(0),
+      m_pyramidTexture(0),
+      m_pyramidWidth(0),
+      m_pyramidHeight(0),
+      m_pyramidLevels(0),
+      m_bPyramidValid(false),
+      m_viewProjection(1.0f),
+      m_pyramidViewProjection(1.0f)
+{
+    m_shapes.vertexArray = 0;
+    m_shapes.vertexBuffer = 0;
+    m_shapes.indexBuffer = 0;
+    m_shapes.indexCount = 0;
+    m_shapes.indexType = GL_UNSIGNED_INT;
+    m_shapes.format = VERTEX_FORMAT_FLOAT;
+    m_shapes.bufferBytes = 0;
+    m_shapes.positionOffset = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_shapes.positionScale = glm::vec3(1.0f, 1.0f, 1.0f);
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+    Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used to check for compute shaders and
+ *  storage buffers, for indirect draws whose count is read
+ *  from a buffer, and for the base instance in the vertex
+ *  shader.
+ ***********************************************************/
+bool GpuCuller::IsSupported()
+{
+    return GLEW_VERSION_4_6 ||
+           (GLEW_VERSION_4_3 && GLEW_ARB_indirect_parameters && GLEW_ARB_shader_draw_parameters);
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used to build the compute programs, merge
+ *  the basic shapes into one vertex and index buffer with a
+ *  table of where each one is, and create the buffers the
+ *  culling writes. The meshlets are built after the other
+ *  passes of the optimizer, since they fix the triangle
+ *  order of the shapes.
+ ***********************************************************/
+bool GpuCuller::Create(MESH_OPTIMIZATION optimization, bool bOcclusion, bool bMeshlets)
+{
+    AllocationScope scope(ALLOCATION_MESHES);
+
+    Destroy();
+
+    if (!IsSupported())
+    {
+        return false;
+    }
+
+    m_cullProgram = CreateComputeProgram(g_CullShaderFilename);
+    m_pyramidProgram = bOcclusion ? CreateComputeProgram(g_PyramidShaderFilename) : 0;
+    if (m_cullProgram == 0 || (bOcclusion && m_pyramidProgram == 0))
+    {
+        Destroy();
+        return false;
+    }
+    m_bOcclusion = bOcclusion;
+    m_bMeshlets = bMeshlets;
+
+    m_frustumPlanesLocation = glGetUniformLocation(m_cullProgram, "frustumPlanes");
+    m_objectCountLocation = glGetUniformLocation(m_cullProgram, "objectCount");
+    m_useOcclusionLocation = glGetUniformLocation(m_cullProgram, "bUseOcclusion");
+    m_useMeshletsLocation = glGetUniformLocation(m_cullProgram, "bUseMeshlets");
+    m_viewPositionLocation = glGetUniformLocation(m_cullProgram, "viewPosition");
+    m_previousViewProjectionLocation = glGetUniformLocation(m_cullProgram, "previousViewProjection");
+    m_pyramidLevelsLocation = glGetUniformLocation(m_cullProgram, "pyramidLevels");
+    glProgramUniform1i(m_cullProgram, glGetUniformLocation(m_cullProgram, "depthPyramid"),
+                       static_cast<GLint>(PYRAMID_TEXTURE_UNIT));
+    if (m_pyramidProgram != 0)
+    {
+        m_sourceLevelLocation = glGetUniformLocation(m_pyramidProgram, "sourceLevel");
+        glProgramUniform1i(m_pyramidProgram, glGetUniformLocation(m_pyramidProgram, "sourceDepth"),
+                           static_cast<GLint>(PYRAMID_TEXTURE_UNIT));
+    }
+
+    // the shapes one after the other, each indexed from its own
+    // first vertex, and their meshlets in the same order
+    MESH_DATA merged;
+    std::vector<GPU_MESHLET_ENTRY> meshletTable;
+    std::vector<MESHLET> meshlets;
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        MESH_DATA shape;
+        PrimitiveMeshes::GenerateMesh(static_cast<MESH_TYPE>(mesh), shape);
+        OptimizeMesh(shape, optimization);
+        meshlets.clear();
+        if (bMeshlets)
+        {
+            BuildMeshlets(shape, meshlets);
+        }
+
+        GPU_MESH_ENTRY& entry = m_meshTable[mesh];
+        entry.indexCount = static_cast<uint32_t>(shape.indices.size());
+        entry.firstIndex = static_cast<uint32_t>(merged.indices.size());
+        entry.baseVertex = static_cast<int32_t>(merged.vertices.size());
+        entry.firstMeshlet = static_cast<uint32_t>(meshletTable.size());
+        entry.meshletCount = static_cast<uint32_t>(meshlets.size());
+        entry.padding[0] = entry.padding[1] = entry.padding[2] = 0;
+        for (const auto& meshlet : meshlets)
+        {
+            GPU_MESHLET_ENTRY meshletEntry = {};
+            meshletEntry.bounds = meshlet.bounds;
+            meshletEntry.cone = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff);
+            meshletEntry.firstIndex = entry.firstIndex + meshlet.firstIndex;
+            meshletEntry.indexCount = meshlet.indexCount;
+            meshletTable.push_back(meshletEntry);
+            m_meshletTriangles += meshlet.indexCount / 3;
+            m_meshletVertices += meshlet.vertexCount;
+        }
+        merged.vertices.insert(merged.vertices.end(), shape.vertices.begin(), shape.vertices.end());
+        merged.indices.insert(merged.indices.end(), shape.indices.begin(), shape.indices.end());
+    }
+    PrimitiveMeshes::UploadMesh(merged, VERTEX_FORMAT_FLOAT, m_shapes);
+    m_meshletCount = meshletTable.size();
+
+    glGenBuffers(1, &m_meshTableBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshTableBuffer);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, sizeof(m_meshTable), m_meshTable, 0);
+
+    // a buffer of one empty entry keeps the binding valid without
+    // meshlets
+    meshletTable.resize(std::max<size_t>(meshletTable.size(), 1));
+    glGenBuffers(1, &m_meshletTableBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshletTableBuffer);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, meshletTable.size() * sizeof(GPU_MESHLET_ENTRY),
+                    meshletTable.data(), 0);
+
+    glGenBuffers(1, &m_objectBuffer);
+    glGenBuffers(1, &m_commandBuffer);
+    glGenBuffers(1, &m_countBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used to delete the programs, buffers and
+ *  textures. Nothing happens when nothing was created.
+ ***********************************************************/
+void GpuCuller::Destroy()
+{
+    DestroyDepthPyramid();
+
+    if (m_cullProgram != 0)
+    {
+        glDeleteProgram(m_cullProgram);
+        m_cullProgram = 0;
+    }
+    if (m_pyramidProgram != 0)
+    {
+        glDeleteProgram(m_pyramidProgram);
+        m_pyramidProgram = 0;
+    }
+
+    GLuint* const buffers[] = { &m_meshTableBuffer, &m_meshletTableBuffer, &m_objectBuffer,
+                                &m_commandBuffer, &m_countBuffer };
+    for (GLuint* pBuffer : buffers)
+    {
+        if (*pBuffer != 0)
+        {
+            glDeleteBuffers(1, pBuffer);
+            *pBuffer = 0;
+        }
+    }
+    PrimitiveMeshes::DeleteUploadedMesh(m_shapes);
+
+    m_objectCount = 0;
+    m_commandCapacity = 0;
+    m_uploadedVersion = 0;
+    m_meshletCount = 0;
+    m_meshletTriangles = 0;
+    m_meshletVertices = 0;
+    m_bOcclusion = false;
+    m_bMeshlets = false;
+}
+
+/***********************************************************
+ *  GetAverageMeshletTriangles()
+ *
+ *  This method is used to get the average triangle count of
+ *  the meshlets, 0 without meshlets.
+ ***********************************************************/
+float GpuCuller::GetAverageMeshletTriangles() const
+{
+    return (m_meshletCount > 0) ? static_cast<float>(m_meshletTriangles) / m_meshletCount : 0.0f;
+}
+
+/***********************************************************
+ *  GetAverageMeshletVertices()
+ *
+ *  This method is used to get the average vertex count of
+ *  the meshlets, 0 without meshlets.
+ ***********************************************************/
+float GpuCuller::GetAverageMeshletVertices() const
+{
+    return (m_meshletCount > 0) ? static_cast<float>(m_meshletVertices) / m_meshletCount : 0.0f;
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used to run the culling shader over the
+ *  object table with one thread per object. The draw count
+ *  is cleared first; the survivors take their command slots
+ *  with an atomic counter, so the order of the commands is
+ *  not fixed, which the depth test makes up for. The barrier
+ *  makes the commands and the count visible to the indirect
+ *  draw that reads them. The view position is only needed
+ *  to test the meshlet cones.
+ ***********************************************************/
+void GpuCuller::Cull(const GPU_OBJECT_SET& objects, const glm::mat4& viewProjection,
+                     const glm::vec3& viewPosition)
+{
+    if (m_cullProgram == 0)
+    {
+        return;
+    }
+    if (objects.version != m_uploadedVersion)
+    {
+        UploadObjects(objects);
+    }
+    m_viewProjection = viewProjection;
+
+    const GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_OBJECT_TABLE_BINDING, m_objectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_MESH_TABLE_BINDING, m_meshTableBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_DRAW_COMMANDS_BINDING, m_commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_DRAW_COUNT_BINDING, m_countBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_MESHLET_TABLE_BINDING, m_meshletTableBuffer);
+    if (m_objectCount == 0)
+    {
+        return;
+    }
+
+    const FRUSTUM frustum = ExtractFrustum(viewProjection);
+    const bool bUseOcclusion = m_bOcclusion && m_bPyramidValid;
+
+    // the scene program is put back for the draws
+    GLint program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+    glUseProgram(m_cullProgram);
+    glUniform4fv(m_frustumPlanesLocation, 6, glm::value_ptr(frustum.planes[0]));
+    glUniform1ui(m_objectCountLocation, static_cast<GLuint>(m_objectCount));
+    glUniform1i(m_useOcclusionLocation, bUseOcclusion ? 1 : 0);
+    glUniform1i(m_useMeshletsLocation, m_bMeshlets ? 1 : 0);
+    glUniform3fv(m_viewPositionLocation, 1, glm::value_ptr(viewPosition));
+    if (bUseOcclusion)
+    {
+        glUniformMatrix4fv(m_previousViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(m_pyramidViewProjection));
+        glUniform1i(m_pyramidLevelsLocation, m_pyramidLevels);
+        glActiveTexture(GL_TEXTURE0 + PYRAMID_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    const GLuint groupCount = (static_cast<GLuint>(m_objectCount) + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE;
+    glDispatchCompute(groupCount, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(static_cast<GLuint>(program));
+}
+
+/***********************************************************
+ *  DrawVisible()
+ *
+ *  This method is used to issue the commands of the last
+ *  Cull() with one call. The count comes from the count
+ *  buffer; the size of the command buffer bounds it.
+ ***********************************************************/
+void GpuCuller::DrawVisible()
+{
+    if (m_objectCount == 0)
+    {
+        return;
+    }
+
+    glBindVertexArray(m_shapes.vertexArray);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_countBuffer);
+    glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0,
+                                        static_cast<GLsizei>(m_commandCapacity), 0);
+    glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DrawObject()
+ *
+ *  This method is used to draw one object from the merged
+ *  shapes, with its index as the base instance so the
+ *  GPU-driven shaders find its values in the table.
+ ***********************************************************/
+void GpuCuller::DrawObject(const GPU_OBJECT_SET& objects, uint32_t objectIndex)
+{
+    if (objectIndex >= objects.objects.size() || objects.version != m_uploadedVersion)
+    {
+        return;
+    }
+
+    const GPU_MESH_ENTRY& mesh = m_meshTable[objects.objects[objectIndex].mesh];
+    const void* pIndices = reinterpret_cast<const void*>(static_cast<size_t>(mesh.firstIndex) * sizeof(uint32_t));
+
+    glBindVertexArray(m_shapes.vertexArray);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, static_cast<GLsizei>(mesh.indexCount),
+        GL_UNSIGNED_INT, pIndices, 1, mesh.baseVertex, objectIndex);
+    glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  UploadObjects()
+ *
+ *  This method is used to write the object table of a set
+ *  and to size the command buffer for every object being
+ *  kept, or every meshlet of them, which is the most the
+ *  culling can write.
+ ***********************************************************/
+void GpuCuller::UploadObjects(const GPU_OBJECT_SET& objects)
+{
+    AllocationScope scope(ALLOCATION_MESHES);
+
+    m_objectCount = objects.objects.size();
+    const size_t capacity = std::max<size_t>(m_objectCount, 1);
+
+    m_commandCapacity = 0;
+    for (const auto& object : objects.objects)
+    {
+        m_commandCapacity += std::max<size_t>(m_meshTable[object.mesh].meshletCount, 1);
+    }
+    const size_t commandCapacity = std::max<size_t>(m_commandCapacity, 1);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GPU_OBJECT_ENTRY), nullptr, GL_STATIC_DRAW);
+    if (m_objectCount > 0)
+    {
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_objectCount * sizeof(GPU_OBJECT_ENTRY), objects.objects.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, commandCapacity * sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    m_uploadedVersion = objects.version;
+}
+
+/***********************************************************
+ *  UpdateDepthPyramid()
+ *
+ *  This method is used to copy the depth of the viewport of
+ *  the bound framebuffer and reduce it level by level, each
+ *  texel keeping the farthest depth below it, so one texel
+ *  fetch tells whether anything in its area is nearer. The
+ *  pyramid is made again when the viewport size changes and
+ *  remembers the camera the next Cull() must project with.
+ ***********************************************************/
+void GpuCuller::UpdateDepthPyramid()
+{
+    if (!m_bOcclusion || m_objectCount == 0)
+    {
+        return;
+    }
+
+    GLint viewport[4] = {};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (viewport[2] <= 0 || viewport[3] <= 0)
+    {
+        return;
+    }
+    if (viewport[2] != m_pyramidWidth || viewport[3] != m_pyramidHeight)
+    {
+        CreateDepthPyramid(viewport[2], viewport[3]);
+    }
+
+    // the copy reads from the framebuffer the scene was drawn to,
+    // which is not the default one with dynamic resolution
+    GLint drawFramebuffer = 0;
+    GLint readFramebuffer = 0;
+    GLint program = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(drawFramebuffer));
+    glActiveTexture(GL_TEXTURE0 + PYRAMID_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(readFramebuffer));
+
+    glUseProgram(m_pyramidProgram);
+    for (int level = 0; level < m_pyramidLevels; ++level)
+    {
+        // level 0 is copied from the depth texture, every other
+        // level is reduced from the one above it
+        glBindTexture(GL_TEXTURE_2D, level == 0 ? m_depthTexture : m_pyramidTexture);
+        glUniform1i(m_sourceLevelLocation, level == 0 ? 0 : level - 1);
+        glBindImageTexture(0, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        const GLuint width = static_cast<GLuint>(std::max(m_pyramidWidth >> level, 1));
+        const GLuint height = static_cast<GLuint>(std::max(m_pyramidHeight >> level, 1));
+        glDispatchCompute((width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE,
+                          (height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(static_cast<GLuint>(program));
+
+    m_pyramidViewProjection = m_viewProjection;
+    m_bPyramidValid = true;
+}
+
+/***********************************************************
+ *  CreateDepthPyramid()
+ *
+ *  This method is used to create the depth copy and the
+ *  full mip chain of the pyramid for a viewport size. The
+ *  pyramid has no depth of a frame yet.
+ ***********************************************************/
+void GpuCuller::CreateDepthPyramid(int width, int height)
+{
+    DestroyDepthPyramid();
+
+    m_pyramidWidth = width;
+    m_pyramidHeight = height;
+    m_pyramidLevels = 1;
+    while ((std::max(width, height) >> m_pyramidLevels) > 0)
+    {
+        ++m_pyramidLevels;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + PYRAMID_TEXTURE_UNIT);
+
+    glGenTextures(1, &m_depthTexture);
+    glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glGenTextures(1, &m_pyramidTexture);
+    glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+    glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+/***********************************************************
+ *  DestroyDepthPyramid()
+ *
+ *  This method is used to delete the depth copy and the
+ *  pyramid; occlusion culling waits for the next one.
+ ***********************************************************/
+void GpuCuller::DestroyDepthPyramid()
+{
+    if (m_depthTexture != 0)
+    {
+        glDeleteTextures(1, &m_depthTexture);
+        m_depthTexture = 0;
+    }
+    if (m_pyramidTexture != 0)
+    {
+        glDeleteTextures(1, &m_pyramidTexture);
+        m_pyramidTexture = 0;
+    }
+    m_pyramidWidth = 0;
+    m_pyramidHeight = 0;
+    m_pyramidLevels = 0;
+    m_bPyramidValid = false;
+}
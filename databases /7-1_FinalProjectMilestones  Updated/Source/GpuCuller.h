@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// cull the scene objects in a compute shader and draw the survivors with
+// one indirect call
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "PrimitiveMeshes.h"
+#include "ShaderBlocks.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// the object table of a scene for the GPU culling. A set is never
+// changed once built; a frame packet keeps the one it was built
+// with, like the static batches
+struct GPU_OBJECT_SET
+{
+    // scene objects, then the objects of the streamed cells
+    std::vector<GPU_OBJECT_ENTRY> objects;
+    // entries flagged to skip the culling because they are
+    // blended; they are culled and sorted on the CPU
+    std::vector<uint32_t> translucentObjects;
+    // different for every set built by the process
+    uint64_t version;
+};
+
+/***********************************************************
+ *  GpuCuller
+ *
+ *  This class moves the culling and the draw list building
+ *  of the opaque objects to the GPU. The object table lives
+ *  in a storage buffer; a compute shader tests each object
+ *  against the view frustum and, optionally, against a
+ *  depth pyramid of the previous frame, and appends one
+ *  indirect draw command per survivor. The basic shapes are
+ *  merged into one vertex and index buffer, so all of the
+ *  commands are drawn by a single
+ *  glMultiDrawElementsIndirectCount() call whose draw count
+ *  never comes back to the CPU. The number of OpenGL calls
+ *  per frame does not depend on the number of objects.
+ *
+ *  The GPU-driven shaders read the object of each draw by
+ *  its base instance, which is its index in the table.
+ *  Objects occluded in the previous frame are tested with
+ *  that frame's camera, so one that comes into view from
+ *  behind an occluder appears one frame late.
+ *
+ *  With meshlets, the shapes are split into clusters of at
+ *  most 64 vertices and 124 triangles when the culler is
+ *  created, and each object that is kept gets one command
+ *  per cluster in the frustum that does not face wholly away
+ *  from the camera, so the back half of a closed shape is
+ *  mostly never sent to the vertex shader.
+ *
+ *  Only used on the thread that owns the context, which
+ *  must support OpenGL 4.3, ARB_indirect_parameters and
+ *  ARB_shader_draw_parameters, or OpenGL 4.6.
+ ***********************************************************/
+class GpuCuller
+{
+public:
+    GpuCuller();
+    ~GpuCuller();
+
+    // true when the context has compute shaders and indirect
+    // draws with a draw count from a buffer
+    static bool IsSupported();
+
+    // compile the compute shaders and upload the merged shapes,
+    // split into meshlets with bMeshlets
+    bool Create(MESH_OPTIMIZATION optimization, bool bOcclusion, bool bMeshlets);
+    void Destroy();
+
+    // write the draw commands of the objects of a set that are
+    // in view; the table is uploaded when the set changed
+    void Cull(const GPU_OBJECT_SET& objects, const glm::mat4& viewProjection,
+              const glm::vec3& viewPosition);
+    // draw what the last Cull() kept, with the program in use
+    void DrawVisible();
+    // draw one object of the table on its own, with the program
+    // in use
+    void DrawObject(const GPU_OBJECT_SET& objects, uint32_t objectIndex);
+    // reduce the depth of the bound framebuffer into the pyramid
+    // the next Cull() tests against; call once the occluders are
+    // drawn
+    void UpdateDepthPyramid();
+
+    bool IsOcclusionEnabled() const { return m_bOcclusion; }
+    bool IsMeshletCullingEnabled() const { return m_bMeshlets; }
+    // meshlets of all the shapes, and their average size
+    size_t GetMeshletCount() const { return m_meshletCount; }
+    float GetAverageMeshletTriangles() const;
+    float GetAverageMeshletVertices() const;
+    // objects in the table of the last Cull()
+    size_t GetObjectCount() const { return m_objectCount; }
+
+private:
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    // write the table of a set and size the command buffer for it
+    void UploadObjects(const GPU_OBJECT_SET& objects);
+    // create the depth copy and the pyramid for a viewport size
+    void CreateDepthPyramid(int width, int height);
+    void DestroyDepthPyramid();
+
+    bool m_bOcclusion;
+    bool m_bMeshlets;
+
+    GLuint m_cullProgram;
+    GLuint m_pyramidProgram;
+    GLint m_frustumPlanesLocation;
+    GLint m_objectCountLocation;
+    GLint m_useOcclusionLocation;
+    GLint m_useMeshletsLocation;
+    GLint m_viewPositionLocation;
+    GLint m_previousViewProjectionLocation;
+    GLint m_pyramidLevelsLocation;
+    GLint m_sourceLevelLocation;
+
+    // all basic shapes in the float layout, and where each is
+    PrimitiveMeshes::GPU_MESH m_shapes;
+    GPU_MESH_ENTRY m_meshTable[MESH_COUNT];
+    GLuint m_meshTableBuffer;
+    GLuint m_meshletTableBuffer;
+    size_t m_meshletCount;
+    size_t m_meshletTriangles;
+    size_t m_meshletVertices;
+
+    GLuint m_objectBuffer;
+    GLuint m_commandBuffer;
+    GLuint m_countBuffer;
+    size_t m_objectCount;
+    // most commands the culling can write for the object table:
+    // one per object, or one per meshlet of each object
+    size_t m_commandCapacity;
+    // version of the set in the object table, 0 when empty
+    uint64_t m_uploadedVersion;
+
+    // depth of the last frame, its max-reduced mip chain and
+    // the camera it was drawn with
+    GLuint m_depthTexture;
+    GLuint m_pyramidTexture;
+    int m_pyramidWidth;
+    int m_pyramidHeight;
+    int m_pyramidLevels;
+    bool m_bPyramidValid;
+    glm::mat4 m_viewProjection;
+    glm::mat4 m_pyramidViewProjection;
+};
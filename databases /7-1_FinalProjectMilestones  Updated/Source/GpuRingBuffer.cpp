@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuringbuffer.cpp
+// ============
+// persistently mapped buffer for streaming per-frame data to the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuRingBuffer.h"
+
+#include <iostream>
+
+// redirects the OpenGL calls below to the capture layer
+#include "GLCaptureCalls.h"
+
+// declare the global variables
+namespace
+{
+    // how long a single fence wait may block, in nanoseconds
+    const GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+
+    // regions start at multiples of this, which covers the range
+    // offset alignment of uniform and shader storage buffers
+    const size_t REGION_ALIGNMENT = 256;
+}
+
+/***********************************************************
+ *  GpuRingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuRingBuffer::GpuRingBuffer()
+    : m_buffer(0),
+      m_pMapped(nullptr),
+      m_regionSize(0),
+      m_currentRegion(0),
+      m_regionUsed(0),
+      m_requiredRegionSize(0)
+{
+    for (int i = 0; i < REGION_COUNT; ++i)
+    {
+        m_fences[i] = 0;
+    }
+}
+
+/***********************************************************
+ *  ~GpuRingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuRingBuffer::~GpuRingBuffer()
+{
+    Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used to check if the current context can
+ *  create persistently mapped buffers.
+ ***********************************************************/
+bool GpuRingBuffer::IsSupported()
+{
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used to create the immutable buffer
+ *  storage for all regions and to map it once for the
+ *  lifetime of the buffer.
+ ***********************************************************/
+bool GpuRingBuffer::Create(size_t regionSize)
+{
+    Destroy();
+
+    if (!IsSupported())
+    {
+        return false;
+    }
+
+    regionSize = (regionSize + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1);
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    const GLsizeiptr totalSize = static_cast<GLsizeiptr>(regionSize * REGION_COUNT);
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+    m_pMapped = static_cast<unsigned char*>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (m_pMapped == nullptr)
+    {
+        std::cout << "Could not map the GPU ring buffer" << std::endl;
+        Destroy();
+        return false;
+    }
+
+    m_regionSize = regionSize;
+    m_currentRegion = 0;
+    m_regionUsed = 0;
+    m_requiredRegionSize = 0;
+    return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used to release the fences and to unmap
+ *  and delete the buffer.
+ ***********************************************************/
+void GpuRingBuffer::Destroy()
+{
+    for (int i = 0; i < REGION_COUNT; ++i)
+    {
+        WaitForRegion(i);
+    }
+
+    if (m_buffer != 0)
+    {
+        if (m_pMapped != nullptr)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+
+    m_buffer = 0;
+    m_pMapped = nullptr;
+    m_regionSize = 0;
+}
+
+/***********************************************************
+ *  WaitForRegion()
+ *
+ *  This method is used to block until the GPU has finished
+ *  the commands that read from a region, then release the
+ *  fence of that region.
+ ***********************************************************/
+void GpuRingBuffer::WaitForRegion(int region)
+{
+    GLsync fence = m_fences[region];
+    if (fence == 0)
+    {
+        return;
+    }
+
+    // the first wait flushes, so the fence is guaranteed to signal
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    for (;;)
+    {
+        GLenum result = glClientWaitSync(fence, waitFlags, FENCE_WAIT_TIMEOUT);
+        if (result == GL_ALREADY_SIGNALED ||
+            result == GL_CONDITION_SATISFIED ||
+            result == GL_WAIT_FAILED)
+        {
+            break;
+        }
+        waitFlags = 0;
+    }
+
+    glDeleteSync(fence);
+    m_fences[region] = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used to move to the next region. The CPU
+ *  only stalls here when it is REGION_COUNT frames ahead of
+ *  the GPU.
+ ***********************************************************/
+void GpuRingBuffer::BeginFrame()
+{
+    if (m_requiredRegionSize > m_regionSize)
+    {
+        // a frame did not fit; replace the buffer with a larger one
+        size_t regionSize = m_requiredRegionSize;
+        std::cout << "Growing the GPU ring buffer to " << regionSize
+                  << " bytes per frame" << std::endl;
+        Create(regionSize);
+    }
+
+    m_currentRegion = (m_currentRegion + 1) % REGION_COUNT;
+    WaitForRegion(m_currentRegion);
+
+    m_regionUsed = 0;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used to fence the commands that read from
+ *  the current region.
+ ***********************************************************/
+void GpuRingBuffer::EndFrame()
+{
+    if (m_buffer == 0)
+    {
+        return;
+    }
+
+    m_fences[m_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    if (m_regionUsed > m_regionSize)
+    {
+        m_requiredRegionSize = m_regionUsed + m_regionUsed / 2;
+    }
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used to reserve memory in the region of
+ *  the current frame. The returned pointer is write-only
+ *  mapped memory; offset receives the position of the
+ *  allocation in the buffer for glBindBufferRange().
+ ***********************************************************/
+void* GpuRingBuffer::Allocate(size_t size, size_t alignment, GLintptr& offset)
+{
+    // failed requests still count, so EndFrame() knows how
+    // large the region would have had to be
+    size_t start = (m_regionUsed + alignment - 1) & ~(alignment - 1);
+    m_regionUsed = start + size;
+
+    if (m_pMapped == nullptr || m_regionUsed > m_regionSize)
+    {
+        return nullptr;
+    }
+
+    size_t bufferOffset = m_currentRegion * m_regionSize + start;
+    offset = static_cast<GLintptr>(bufferOffset);
+    return m_pMapped + bufferOffset;
+}
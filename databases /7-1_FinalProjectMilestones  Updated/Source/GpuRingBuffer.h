@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuringbuffer.h
+// ============
+// persistently mapped buffer for streaming per-frame data to the GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+
+/***********************************************************
+ *  GpuRingBuffer
+ *
+ *  A buffer created with glBufferStorage and mapped once,
+ *  persistently and coherently, for its whole lifetime. It is
+ *  split into one region per frame in flight; each frame
+ *  writes its data straight into the mapped pointer of its
+ *  region and binds the written ranges. A fence placed at the
+ *  end of the frame keeps the region from being overwritten
+ *  before the GPU has consumed it, so nothing is allocated,
+ *  mapped or orphaned per frame.
+ *
+ *  All methods must be called on the thread that owns the
+ *  OpenGL context. Requires OpenGL 4.4 or ARB_buffer_storage.
+ ***********************************************************/
+class GpuRingBuffer
+{
+public:
+    // frames the CPU may write ahead of the GPU
+    static const int REGION_COUNT = 3;
+
+    GpuRingBuffer();
+    ~GpuRingBuffer();
+
+    // true when the driver supports persistently mapped buffers
+    static bool IsSupported();
+
+    // create and map the buffer with regionSize bytes per frame
+    bool Create(size_t regionSize);
+    // unmap and delete the buffer
+    void Destroy();
+
+    // wait until the GPU is done with the next region and start
+    // writing into it; requests that overflowed the previous
+    // frame grow the buffer here
+    void BeginFrame();
+    // fence the region written during this frame
+    void EndFrame();
+
+    // reserve size bytes in the current region, aligned to the
+    // given power of two; returns nullptr when the region is full
+    void* Allocate(size_t size, size_t alignment, GLintptr& offset);
+
+    GLuint GetBuffer() const { return m_buffer; }
+    size_t GetRegionSize() const { return m_regionSize; }
+
+private:
+    // wait for the fence of a region and release it
+    void WaitForRegion(int region);
+
+    GLuint m_buffer;
+    unsigned char* m_pMapped;
+    size_t m_regionSize;
+
+    int m_currentRegion;
+    // bytes the current frame asked for, including failed requests
+    size_t m_regionUsed;
+    // grow the buffer to this region size at the next frame
+    size_t m_requiredRegionSize;
+
+    GLsync m_fences[REGION_COUNT];
+};
@@ -0,0 +1,422 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// work-stealing job scheduler for spreading frame work over all cores
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+// declare the global variables
+namespace
+{
+    // index of the worker running on the current thread
+    thread_local int t_workerIndex = -1;
+
+    // failed attempts to find work before an idle worker sleeps
+    const int IDLE_SPIN_COUNT = 16;
+    // held back jobs the deferred list has room for up front
+    const size_t DEFERRED_JOB_RESERVE = 64;
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class. The creating thread
+ *  becomes worker 0; threadCount - 1 more threads are
+ *  started.
+ ***********************************************************/
+JobSystem::JobSystem(unsigned threadCount)
+    : m_bRunning(true),
+      m_deferredCount(0),
+      m_sleepingWorkers(0),
+      m_queuedJobs(0)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const size_t slotCount = MAX_JOBS_PER_WORKER + threadCount;
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        WORKER* pWorker = new WORKER();
+        pWorker->jobs.resize(slotCount);
+        pWorker->jobInUse.reset(new std::atomic<bool>[slotCount]);
+        for (size_t slot = 0; slot < slotCount; ++slot)
+        {
+            pWorker->jobInUse[slot].store(false, std::memory_order_relaxed);
+        }
+        pWorker->nextJob = 0;
+        pWorker->stealSeed = 0x9E3779B9u * (i + 1);
+        m_workers.push_back(pWorker);
+    }
+    m_deferredJobs.reserve(DEFERRED_JOB_RESERVE);
+
+    t_workerIndex = 0;
+    for (unsigned i = 1; i < threadCount; ++i)
+    {
+        m_threads.push_back(std::thread(&JobSystem::WorkerMain, this, i));
+    }
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+    m_bRunning = false;
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wakeSignal.notify_all();
+    }
+    for (auto& thread : m_threads)
+    {
+        thread.join();
+    }
+    for (auto* pWorker : m_workers)
+    {
+        delete pWorker;
+    }
+    m_workers.clear();
+    t_workerIndex = -1;
+}
+
+/***********************************************************
+ *  GetCurrentWorkerIndex()
+ *
+ *  This method is used to get the index of the worker that
+ *  is running on the calling thread.
+ ***********************************************************/
+int JobSystem::GetCurrentWorkerIndex()
+{
+    return t_workerIndex;
+}
+
+/***********************************************************
+ *  CurrentWorker()
+ *
+ *  This method is used to get the worker that owns the
+ *  calling thread.
+ ***********************************************************/
+JobSystem::WORKER& JobSystem::CurrentWorker()
+{
+    return *m_workers[t_workerIndex];
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used to schedule a single job on the deque
+ *  of the calling worker. Threads outside the job system, or
+ *  a worker whose deque is full, run the job immediately
+ *  from the stack, without taking a slot. A worker holds a
+ *  job back instead when its dependency is still running.
+ ***********************************************************/
+void JobSystem::Run(
+    JobFunction function,
+    void* pData,
+    JobCounter* pCounter,
+    size_t begin,
+    size_t end,
+    JobCounter* pDependency)
+{
+    if (pCounter != nullptr)
+    {
+        pCounter->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (t_workerIndex >= 0 && pDependency != nullptr &&
+        pDependency->load(std::memory_order_acquire) > 0)
+    {
+        JOB job = { function, pData, begin, end, pCounter, pDependency, GetAllocationTag(), nullptr };
+        DeferJob(job);
+        return;
+    }
+
+    // only the owner pushes, so the size can only be too large
+    // while thieves take jobs, never too small
+    if (t_workerIndex < 0 || CurrentWorker().queue.Size() >= MAX_JOBS_PER_WORKER)
+    {
+        JOB job = { function, pData, begin, end, pCounter, pDependency, GetAllocationTag(), nullptr };
+        Execute(&job);
+        return;
+    }
+
+    WORKER& worker = CurrentWorker();
+    JOB* pJob = ClaimJobSlot(worker);
+    pJob->function    = function;
+    pJob->pData       = pData;
+    pJob->begin       = begin;
+    pJob->end         = end;
+    pJob->pCounter    = pCounter;
+    pJob->pDependency = pDependency;
+    pJob->allocationTag = GetAllocationTag();
+    pJob->pSlotInUse->store(true, std::memory_order_relaxed);
+
+    // counted before it can be taken, and before the sleepers are
+    // checked, so a worker going to sleep either sees the job or
+    // is woken for it
+    m_queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+    if (!worker.queue.Push(pJob))
+    {
+        m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        Execute(pJob);
+        return;
+    }
+
+    if (m_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wakeSignal.notify_one();
+    }
+}
+
+/***********************************************************
+ *  ClaimJobSlot()
+ *
+ *  This method is used to find the next slot of a worker
+ *  whose job has been copied out. With fewer jobs queued
+ *  than the deque holds, at most one slot per other thread
+ *  can still be waiting for a thief to copy it, so the
+ *  search ends within the pool.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::ClaimJobSlot(WORKER& worker)
+{
+    const size_t slotCount = worker.jobs.size();
+    for (;;)
+    {
+        const size_t slot = worker.nextJob++ % slotCount;
+        if (!worker.jobInUse[slot].load(std::memory_order_acquire))
+        {
+            JOB* pJob = &worker.jobs[slot];
+            pJob->pSlotInUse = &worker.jobInUse[slot];
+            return pJob;
+        }
+    }
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used to split the range [0, count) into
+ *  jobs of at most grainSize items each.
+ ***********************************************************/
+void JobSystem::ParallelFor(
+    size_t count,
+    size_t grainSize,
+    JobFunction function,
+    void* pData,
+    JobCounter* pCounter,
+    JobCounter* pDependency)
+{
+    grainSize = std::max<size_t>(1, grainSize);
+
+    for (size_t begin = 0; begin < count; begin += grainSize)
+    {
+        Run(function, pData, pCounter, begin,
+            std::min(count, begin + grainSize), pDependency);
+    }
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used to wait until every job signalling
+ *  the counter has finished. The waiting thread executes
+ *  queued jobs in the meantime.
+ ***********************************************************/
+void JobSystem::Wait(JobCounter* pCounter)
+{
+    while (pCounter->load(std::memory_order_acquire) > 0)
+    {
+        JOB* pJob = (t_workerIndex >= 0) ? FindJob(t_workerIndex) : nullptr;
+        if (pJob != nullptr)
+        {
+            Execute(pJob);
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/***********************************************************
+ *  FindJob()
+ *
+ *  This method is used to take the newest job from the deque
+ *  of the worker, or to steal the oldest job of another
+ *  worker, starting at a pseudo-random victim. When all the
+ *  deques are empty, a held back job that has become ready
+ *  is taken.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::FindJob(unsigned workerIndex)
+{
+    WORKER& worker = *m_workers[workerIndex];
+
+    JOB* pJob = worker.queue.Pop();
+    if (pJob != nullptr)
+    {
+        m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return pJob;
+    }
+
+    const unsigned workerCount = static_cast<unsigned>(m_workers.size());
+    if (workerCount < 2)
+    {
+        return TakeReadyJob(worker);
+    }
+
+    // xorshift to spread the thieves over the victims
+    worker.stealSeed ^= worker.stealSeed << 13;
+    worker.stealSeed ^= worker.stealSeed >> 17;
+    worker.stealSeed ^= worker.stealSeed << 5;
+
+    const unsigned start = worker.stealSeed % workerCount;
+    for (unsigned i = 0; i < workerCount; ++i)
+    {
+        unsigned victim = (start + i) % workerCount;
+        if (victim == workerIndex)
+        {
+            continue;
+        }
+        pJob = m_workers[victim]->queue.Steal();
+        if (pJob != nullptr)
+        {
+            m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return pJob;
+        }
+    }
+    return TakeReadyJob(worker);
+}
+
+/***********************************************************
+ *  DeferJob()
+ *
+ *  This method is used to hold back a job whose dependency
+ *  has not reached zero yet. The job stays off the deques,
+ *  so no worker takes it only to wait inside it; the threads
+ *  waiting on counters pick it up once it is ready.
+ ***********************************************************/
+void JobSystem::DeferJob(const JOB& job)
+{
+    std::lock_guard<std::mutex> lock(m_deferredMutex);
+    m_deferredJobs.push_back(job);
+    m_deferredCount.fetch_add(1, std::memory_order_release);
+}
+
+/***********************************************************
+ *  TakeReadyJob()
+ *
+ *  This method is used to find a held back job whose
+ *  dependency has completed, copy it to the worker and
+ *  remove it from the deferred list.
+ ***********************************************************/
+JobSystem::JOB* JobSystem::TakeReadyJob(WORKER& worker)
+{
+    if (m_deferredCount.load(std::memory_order_acquire) == 0)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_deferredMutex);
+    for (size_t i = 0; i < m_deferredJobs.size(); ++i)
+    {
+        if (m_deferredJobs[i].pDependency->load(std::memory_order_acquire) == 0)
+        {
+            worker.readyJob = m_deferredJobs[i];
+            m_deferredJobs[i] = m_deferredJobs.back();
+            m_deferredJobs.pop_back();
+            m_deferredCount.fetch_sub(1, std::memory_order_relaxed);
+            return &worker.readyJob;
+        }
+    }
+    return nullptr;
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method is used to run a job and to signal its
+ *  counter afterwards. A job taken while its dependency is
+ *  still running is held back again; only a thread outside
+ *  the job system, which cannot hold jobs back, waits for it.
+ ***********************************************************/
+void JobSystem::Execute(JOB* pJob)
+{
+    // copy the job and hand its slot back to the owner
+    JOB job = *pJob;
+    if (job.pSlotInUse != nullptr)
+    {
+        job.pSlotInUse->store(false, std::memory_order_release);
+    }
+
+    if (job.pDependency != nullptr && job.pDependency->load(std::memory_order_acquire) > 0)
+    {
+        if (t_workerIndex >= 0)
+        {
+            DeferJob(job);
+            return;
+        }
+        Wait(job.pDependency);
+    }
+
+    {
+        // count the allocations of the job for its scheduler
+        AllocationScope scope(job.allocationTag);
+        job.function(job.pData, job.begin, job.end);
+    }
+
+    if (job.pCounter != nullptr)
+    {
+        job.pCounter->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is the entry point of the worker threads.
+ *  Idle workers spin briefly, then sleep until new jobs are
+ *  pushed so an idle application does not burn CPU time. A
+ *  worker woken without finding work goes straight back to
+ *  sleep. Held back jobs do not wake the sleepers; the
+ *  thread waiting for them runs them.
+ ***********************************************************/
+void JobSystem::WorkerMain(unsigned workerIndex)
+{
+    t_workerIndex = static_cast<int>(workerIndex);
+
+    int idleCount = 0;
+    while (m_bRunning.load(std::memory_order_relaxed))
+    {
+        JOB* pJob = FindJob(workerIndex);
+        if (pJob != nullptr)
+        {
+            Execute(pJob);
+            idleCount = 0;
+            continue;
+        }
+
+        if (++idleCount < IDLE_SPIN_COUNT)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wakeSignal.wait(lock, [this]
+            {
+                return m_queuedJobs.load(std::memory_order_seq_cst) > 0 ||
+                       !m_bRunning.load(std::memory_order_relaxed);
+            });
+        }
+        m_sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,230 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// work-stealing job scheduler for spreading frame work over all cores
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AllocationTracker.h"
+#include "WorkStealingQueue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// number of unfinished jobs a caller can wait on
+typedef std::atomic<int> JobCounter;
+
+// job entry point, called with the range [begin, end) to process
+typedef void (*JobFunction)(void* pData, size_t begin, size_t end);
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs small jobs on a pool of worker threads.
+ *  Every worker, including the thread that created the job
+ *  system, owns a Chase-Lev deque; idle workers steal from
+ *  the others. Each job decrements a JobCounter when it is
+ *  done, and a job can depend on another counter, in which
+ *  case it is held back, off the deques, until that counter
+ *  reaches zero. Waiting on a counter executes other jobs
+ *  instead of blocking, so the waiting thread is never idle.
+ *
+ *  Jobs may only be submitted from the creating thread and
+ *  from inside other jobs.
+ ***********************************************************/
+class JobSystem
+{
+public:
+    // most jobs a single worker may have queued; more are run
+    // right away by the thread that schedules them
+    static const size_t MAX_JOBS_PER_WORKER = 4096;
+
+    // constructor; a thread count of 0 uses every hardware thread
+    explicit JobSystem(unsigned threadCount = 0);
+    // destructor
+    ~JobSystem();
+
+    // number of threads executing jobs, including the creator
+    unsigned GetThreadCount() const { return static_cast<unsigned>(m_workers.size()); }
+
+    // schedule one job over [begin, end); pCounter is incremented
+    // now and decremented when the job is done. If pDependency is
+    // given, the job starts only once it has reached zero.
+    void Run(
+        JobFunction function,
+        void* pData,
+        JobCounter* pCounter,
+        size_t begin = 0,
+        size_t end = 1,
+        JobCounter* pDependency = nullptr);
+
+    // split [0, count) into jobs of at most grainSize items
+    void ParallelFor(
+        size_t count,
+        size_t grainSize,
+        JobFunction function,
+        void* pData,
+        JobCounter* pCounter,
+        JobCounter* pDependency = nullptr);
+
+    // execute jobs until the counter has reached zero
+    void Wait(JobCounter* pCounter);
+
+    // run function(begin, end) over [0, count) and wait for it
+    template <typename Function>
+    void ParallelFor(size_t count, size_t grainSize, const Function& function)
+    {
+        JobCounter counter(0);
+        ParallelFor(count, grainSize, &InvokeRange<Function>,
+                    const_cast<Function*>(&function), &counter);
+        Wait(&counter);
+    }
+
+    // sort items with a parallel merge sort: chunks are sorted by
+    // separate jobs, then merged pairwise with one job per pair;
+    // scratch is used as the merge buffer and keeps its capacity
+    template <typename T, typename Less>
+    void ParallelSort(std::vector<T>& items, std::vector<T>& scratch, Less less)
+    {
+        const size_t MIN_SORT_CHUNK = 1024;
+        const size_t count = items.size();
+
+        size_t chunkCount = 1;
+        while (chunkCount < GetThreadCount() * 2)
+        {
+            chunkCount *= 2;
+        }
+        while (chunkCount > 1 && count / chunkCount < MIN_SORT_CHUNK)
+        {
+            chunkCount /= 2;
+        }
+        if (chunkCount == 1)
+        {
+            std::sort(items.begin(), items.end(), less);
+            return;
+        }
+
+        const size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+        scratch.resize(count);
+        T* pSource = items.data();
+        T* pTarget = scratch.data();
+
+        ParallelFor(chunkCount, 1, [&](size_t begin, size_t end)
+        {
+            for (size_t chunk = begin; chunk < end; ++chunk)
+            {
+                std::sort(pSource + std::min(count, chunk * chunkSize),
+                          pSource + std::min(count, (chunk + 1) * chunkSize),
+                          less);
+            }
+        });
+
+        for (size_t width = chunkSize; width < count; width *= 2)
+        {
+            const size_t pairCount = (count + 2 * width - 1) / (2 * width);
+            ParallelFor(pairCount, 1, [&](size_t begin, size_t end)
+            {
+                for (size_t pair = begin; pair < end; ++pair)
+                {
+                    const size_t low = pair * 2 * width;
+                    const size_t middle = std::min(count, low + width);
+                    const size_t high = std::min(count, low + 2 * width);
+                    std::merge(pSource + low, pSource + middle,
+                               pSource + middle, pSource + high,
+                               pTarget + low, less);
+                }
+            });
+            std::swap(pSource, pTarget);
+        }
+
+        if (pSource != items.data())
+        {
+            items.swap(scratch);
+        }
+    }
+
+    // index of the calling worker, 0 for the creating thread and
+    // -1 for threads outside of the job system
+    static int GetCurrentWorkerIndex();
+
+private:
+    // a scheduled unit of work
+    struct JOB
+    {
+        JobFunction function;
+        void* pData;
+        size_t begin;
+        size_t end;
+        JobCounter* pCounter;
+        JobCounter* pDependency;
+        // allocation tag of the thread that scheduled the job
+        ALLOCATION_TAG allocationTag;
+        // flag of the slot holding the job, cleared once the job
+        // is copied out of it; nullptr for a job on the stack
+        std::atomic<bool>* pSlotInUse;
+    };
+
+    // per-thread job storage and deque. A slot stays in use from
+    // the push until the job is copied out by whoever takes it,
+    // so it can outlive its deque entry while a thief copies it;
+    // there is one slot for every deque entry and one for every
+    // other thread that may be stealing
+    struct WORKER
+    {
+        WorkStealingQueue<JOB, MAX_JOBS_PER_WORKER> queue;
+        std::vector<JOB> jobs;
+        std::unique_ptr<std::atomic<bool>[]> jobInUse;
+        size_t nextJob;
+        unsigned stealSeed;
+        // a held back job whose dependency has completed, copied
+        // out of the deferred list for this worker to run
+        JOB readyJob;
+    };
+
+    template <typename Function>
+    static void InvokeRange(void* pData, size_t begin, size_t end)
+    {
+        (*static_cast<Function*>(pData))(begin, end);
+    }
+
+    // worker thread entry point
+    void WorkerMain(unsigned workerIndex);
+    // a free job slot of a worker, which has room in its deque
+    JOB* ClaimJobSlot(WORKER& worker);
+    // take a job from the own deque, steal one, or take a held
+    // back job that is ready
+    JOB* FindJob(unsigned workerIndex);
+    // hold back a job until its dependency reaches zero
+    void DeferJob(const JOB& job);
+    // move a held back job whose dependency is done to the worker
+    JOB* TakeReadyJob(WORKER& worker);
+    // run a job and signal its counter
+    void Execute(JOB* pJob);
+    // worker of the calling thread
+    WORKER& CurrentWorker();
+
+    std::vector<WORKER*> m_workers;
+    std::vector<std::thread> m_threads;
+    std::atomic<bool> m_bRunning;
+
+    // jobs held back by a dependency that has not completed;
+    // the count lets FindJob() skip the lock when there are none
+    std::mutex m_deferredMutex;
+    std::vector<JOB> m_deferredJobs;
+    std::atomic<int> m_deferredCount;
+
+    // idle workers sleep here until new jobs are pushed; the
+    // count of jobs in the deques is raised before a push and
+    // lowered when a job is taken out
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wakeSignal;
+    std::atomic<int> m_sleepingWorkers;
+    std::atomic<int> m_queuedJobs;
+};
@@ -1,5 +1,12 @@
 #include <iostream>         // error handling and output
+#include <cassert>          // allocation check
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // strcmp
+#include <algorithm>        // max
+#include <chrono>           // software frame time
+#include <cmath>            // camera circle
+#include <string>
+#include <vector>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -11,8 +18,23 @@
 
 #include "SceneManager.h"
 #include "ViewManager.h"
-#include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "RenderScheduler.h"
+#include "RenderThread.h"
+#include "JobSystem.h"
+#include "GpuRingBuffer.h"
+#include "GpuCuller.h"
+#include "Benchmark.h"
+#include "SceneConverter.h"
+#include "WorldStreamer.h"
+#include "SoftwareRasterizer.h"
+#include "GLReplay.h"
+#include "FrameExporter.h"
+#include "DynamicResolution.h"
+#include "MultiViewRenderer.h"
+#include "AllocationTracker.h"
+#include "FrameArena.h"
+#include "GLCaptureCalls.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,11 +51,165 @@ namespace
     ShaderManager* g_ShaderManager = nullptr;
     // view manager object for managing the 3D view setup and projection to 2D
     ViewManager* g_ViewManager = nullptr;
+
+    // decides when a new frame must be drawn in render-on-demand mode
+    RenderScheduler g_RenderScheduler;
+
+    // draws the frames on a dedicated thread when enabled
+    RenderThread* g_RenderThread = nullptr;
+    bool g_bUseRenderThread = false;
+
+    // frame packet used when drawing on the main thread
+    FRAME_PACKET g_FramePacket;
+
+    // spreads texture decoding and frame preparation over threads
+    JobSystem* g_JobSystem = nullptr;
+    // job system threads, 0 uses every hardware thread
+    unsigned g_JobThreadCount = 0;
+
+    // run the job system benchmark instead of the application
+    bool g_bRunJobBenchmark = false;
+    // objects of the scene load benchmark, 0 to not run it
+    unsigned g_SceneLoadBenchmarkObjects = 0;
+    // run the mesh optimization benchmark instead of the application
+    bool g_bRunMeshBenchmark = false;
+
+    // reordering of the basic shapes for the vertex cache and overdraw
+    MESH_OPTIMIZATION g_MeshOptimization = MESH_OPTIMIZE_OVERDRAW;
+    // vertex layout of the basic shapes
+    VERTEX_FORMAT g_VertexFormat = VERTEX_FORMAT_FLOAT;
+    // run the vertex format benchmark once the context exists
+    bool g_bRunVertexBenchmark = false;
+
+    // binary scene file that replaces the built-in scene
+    const char* g_SceneFilename = nullptr;
+    // scene description to convert instead of running the application
+    const char* g_ConvertSceneSource = nullptr;
+    const char* g_ConvertSceneTarget = nullptr;
+
+    // streams the cells of a large world around the camera
+    WorldStreamer* g_WorldStreamer = nullptr;
+    // world directory to stream, and its streaming settings
+    const char* g_WorldDirectory = nullptr;
+    float g_WorldLoadRadius = 0.0f;
+    unsigned g_WorldBudgetMB = 0;
+    // scene file to split into a world instead of running the application
+    const char* g_BuildWorldSource = nullptr;
+    float g_BuildWorldCellSize = 0.0f;
+    const char* g_BuildWorldTarget = nullptr;
+
+    // image file drawn by the software rasterizer instead of
+    // running the application
+    const char* g_SoftwareImageFilename = nullptr;
+    // use the AVX2 edge functions of the software rasterizer
+    bool g_bUseRasterSimd = true;
+    // run the software rasterizer benchmark instead of the application
+    bool g_bRunRasterBenchmark = false;
+    // draw one frame with OpenGL and with the software rasterizer
+    // and compare them instead of running the application
+    bool g_bCompareSoftwareRender = false;
+    // channel difference, out of 255, up to which two pixels count
+    // as the same, and the share of the pixels allowed to differ more
+    const int SOFTWARE_COMPARE_TOLERANCE = 16;
+    const double SOFTWARE_COMPARE_MAX_DIFFERENT = 0.01;
+
+    // file and number of frames of a GL capture, 0 frames to not capture
+    const char* g_CaptureFilename = nullptr;
+    unsigned g_CaptureFrames = 0;
+    // capture file to replay instead of running the application,
+    // and the number of timed runs
+    const char* g_ReplayFilename = nullptr;
+    unsigned g_ReplayRuns = 0;
+
+    // reads the drawn frames back and writes them out when exporting
+    FrameExporter* g_FrameExporter = nullptr;
+    // file name prefix of a PNG sequence or raw stream file to export to
+    const char* g_ExportTarget = nullptr;
+    EXPORT_FORMAT g_ExportFormat = EXPORT_PNG_SEQUENCE;
+
+    // draws the scene at a scale that follows the GPU frame time
+    DynamicResolution* g_DynamicResolution = nullptr;
+    // GPU time budget of the scene in milliseconds, 0 to draw at
+    // the full window resolution
+    float g_DynamicResolutionBudget = 0.0f;
+    float g_DynamicResolutionMinScale = 0.0f;
+    UPSCALE_FILTER g_UpscaleFilter = UPSCALE_BILINEAR;
+
+    // cameras of a multi-view render instead of running the
+    // application, 0 to not run it, and the prefix of its images
+    unsigned g_MultiViewCount = 0;
+    const char* g_MultiViewPrefix = nullptr;
+    MULTI_VIEW_TARGET g_MultiViewTarget = MULTI_VIEW_LAYERS;
+    // size of each view of a multi-view render
+    const int MULTI_VIEW_WIDTH = 320;
+    const int MULTI_VIEW_HEIGHT = 240;
+
+    // windows on the scene, the main one included; the others
+    // share its context objects and have cameras of their own
+    unsigned g_ViewCount = 1;
+    const unsigned MAX_VIEW_COUNT = 4;
+    // one more window and the draw list of its camera
+    struct SHARED_VIEW
+    {
+        ViewManager* pViewManager;
+        FRAME_PACKET packet;
+    };
+    std::vector<SHARED_VIEW> g_SharedViews;
+
+    // count the heap allocations of every drawn frame
+    bool g_bTrackAllocations = false;
+    // drawn frames after which a frame must not allocate at all,
+    // 0 to only report the allocations
+    unsigned g_AllocationWarmupFrames = 0;
+    // set when a frame after the warm-up allocated
+    bool g_bFrameAllocated = false;
+
+    // stream the shader values through a persistently mapped buffer
+    bool g_bUseGpuRingBuffer = false;
+    // draws per frame the ring buffer is first sized for
+    const size_t GPU_RING_BUFFER_DRAWS = 4096;
+
+    // draw the static objects of a draw state as merged geometry
+    bool g_bStaticBatching = false;
+
+    // cull the opaque objects in a compute shader and draw them
+    // with one indirect call, also against the last frame's depth
+    bool g_bGpuCulling = false;
+    bool g_bGpuOcclusion = false;
+    // cull the shapes by meshlets, which drops the triangles out
+    // of view or facing away in clusters
+    bool g_bMeshletCulling = false;
+
+    // drop the draws hidden behind the largest objects, tested
+    // against a small depth buffer rasterized on the CPU
+    bool g_bOcclusionCulling = false;
+
+    // the shader pairs the scene can be drawn with
+    enum SCENE_SHADERS
+    {
+        // values set with glUniform for every draw
+        SCENE_SHADERS_UNIFORM,
+        // object and material values from the uniform blocks
+        SCENE_SHADERS_BUFFERED,
+        // object values from the table of the GPU culling
+        SCENE_SHADERS_GPU_DRIVEN
+    };
 }
 
 // Function declarations
 bool InitializeGLFW();
 bool InitializeGLEW();
+void LoadSceneShaders(SCENE_SHADERS shaders);
+void ParseCommandLine(int argc, char* argv[]);
+int RenderSoftwareImage(const char* filename);
+int CompareSoftwareRender();
+int ReplayGLCapture(const char* filename, unsigned runs);
+int RenderMultiView(unsigned viewCount, const char* prefix);
+void OpenSharedViews(unsigned viewCount);
+void DrawSharedViews();
+void CloseSharedView(size_t index);
+void CheckFrameAllocations();
+void PrintOcclusionStats(const SceneManager& sceneManager);
 
 /***********************************************************
  *  main(int, char*)
@@ -43,6 +219,53 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+    // apply the command line options
+    ParseCommandLine(argc, argv);
+
+    if (g_bRunJobBenchmark)
+    {
+        return RunJobSystemBenchmark(g_JobThreadCount);
+    }
+    if (g_SceneLoadBenchmarkObjects > 0)
+    {
+        return RunSceneLoadBenchmark(g_SceneLoadBenchmarkObjects);
+    }
+    if (g_bRunMeshBenchmark)
+    {
+        return RunMeshOptimizationBenchmark();
+    }
+    if (g_bRunRasterBenchmark)
+    {
+        return RunSoftwareRasterBenchmark(g_JobThreadCount);
+    }
+    if (g_SoftwareImageFilename != nullptr)
+    {
+        return RenderSoftwareImage(g_SoftwareImageFilename);
+    }
+    if (g_bCompareSoftwareRender)
+    {
+        return CompareSoftwareRender();
+    }
+    if (g_ConvertSceneSource != nullptr)
+    {
+        return ConvertSceneText(g_ConvertSceneSource, g_ConvertSceneTarget) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (g_BuildWorldSource != nullptr)
+    {
+        return BuildWorldCells(g_BuildWorldSource, g_BuildWorldCellSize, g_BuildWorldTarget) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (g_ReplayFilename != nullptr)
+    {
+        return ReplayGLCapture(g_ReplayFilename, g_ReplayRuns);
+    }
+    if (g_MultiViewCount > 0)
+    {
+        return RenderMultiView(g_MultiViewCount, g_MultiViewPrefix);
+    }
+
+    // start the worker threads before any scene work is done
+    g_JobSystem = new JobSystem(g_JobThreadCount);
+
     // Initialize GLFW
     if (!InitializeGLFW())
     {
@@ -67,55 +290,1210 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    // load the shader code from the external GLSL files
-    g_ShaderManager->LoadShaders(
-        "../../Utilities/shaders/vertexShader.glsl",
-        "../../Utilities/shaders/fragmentShader.glsl");
-    g_ShaderManager->use();
+    // the capture layer does not record compute dispatches or
+    // indirect draws, and the vertex arrays of the culling are not
+    // shared with the contexts of the other windows
+    if (g_bGpuCulling && g_CaptureFrames > 0)
+    {
+        std::cout << "INFO: Culling on the CPU, since the GL capture does not record indirect draws" << std::endl;
+        g_bGpuCulling = false;
+    }
+    if (g_bGpuCulling && g_ViewCount > 1)
+    {
+        std::cout << "INFO: Culling on the CPU, since more than one view is open" << std::endl;
+        g_bGpuCulling = false;
+    }
+    bool bGpuDrivenShaders = g_bGpuCulling && GpuCuller::IsSupported();
+    if (g_bGpuCulling && !bGpuDrivenShaders)
+    {
+        std::cout << "INFO: Compute shaders or indirect draw counts are not supported, "
+                  << "culling on the CPU" << std::endl;
+    }
+
+    // the GPU-driven draws take their values from the object
+    // table, so there is nothing left to stream
+    if (bGpuDrivenShaders && g_bUseGpuRingBuffer)
+    {
+        std::cout << "INFO: The GPU ring buffer is not used with GPU culling" << std::endl;
+        g_bUseGpuRingBuffer = false;
+    }
+
+    // the ring buffer path needs persistently mapped buffers
+    bool bBufferedShaders = g_bUseGpuRingBuffer && GpuRingBuffer::IsSupported();
+    if (g_bUseGpuRingBuffer && !bBufferedShaders)
+    {
+        std::cout << "INFO: Persistently mapped buffers are not supported, "
+                  << "using glUniform for the shader values" << std::endl;
+    }
+
+    // load the shader code from the GLSL files
+    LoadSceneShaders(bGpuDrivenShaders ? SCENE_SHADERS_GPU_DRIVEN :
+                     bBufferedShaders ? SCENE_SHADERS_BUFFERED : SCENE_SHADERS_UNIFORM);
+
+    // record the first frames drawn from here on
+    if (g_CaptureFrames > 0)
+    {
+        RequestGLCapture(g_CaptureFilename, g_CaptureFrames);
+    }
+
+    if (g_bRunVertexBenchmark)
+    {
+        int result = RunVertexFormatBenchmark();
+        delete g_ViewManager;
+        delete g_ShaderManager;
+        delete g_JobSystem;
+        glfwTerminate();
+        return result;
+    }
 
     // create a new scene manager object and prepare the 3D scene
     g_SceneManager = new SceneManager(g_ShaderManager);
-    g_SceneManager->PrepareScene();
+    g_SceneManager->SetJobSystem(g_JobSystem);
+    g_SceneManager->SetMeshOptimization(g_MeshOptimization);
+    g_SceneManager->SetVertexFormat(g_VertexFormat);
+    g_SceneManager->PrepareScene(g_SceneFilename);
+
+    // the world tables replace the scene tables, so they must be
+    // loaded before the material table is uploaded
+    if (g_WorldDirectory != nullptr)
+    {
+        g_WorldStreamer = new WorldStreamer();
+        WorldStreamer::SETTINGS settings = g_WorldStreamer->GetSettings();
+        if (g_WorldLoadRadius > 0.0f)
+        {
+            settings.loadRadius = g_WorldLoadRadius;
+        }
+        if (g_WorldBudgetMB > 0)
+        {
+            settings.memoryBudget = static_cast<uint64_t>(g_WorldBudgetMB) * 1024 * 1024;
+        }
+        g_WorldStreamer->SetSettings(settings);
+        if (!g_WorldStreamer->Open(g_WorldDirectory, g_SceneManager))
+        {
+            std::cout << "INFO: Could not open the world " << g_WorldDirectory << std::endl;
+            delete g_WorldStreamer;
+            g_WorldStreamer = nullptr;
+        }
+    }
+
+    if (bBufferedShaders && !g_SceneManager->EnableGpuRingBuffer(GPU_RING_BUFFER_DRAWS))
+    {
+        std::cout << "INFO: Could not create the GPU ring buffer, "
+                  << "using glUniform for the shader values" << std::endl;
+        LoadSceneShaders(SCENE_SHADERS_UNIFORM);
+        g_SceneManager->SetupSceneLights();
+    }
+
+    if (bGpuDrivenShaders && !g_SceneManager->EnableGpuCulling(g_bGpuOcclusion, g_bMeshletCulling))
+    {
+        std::cout << "INFO: Could not create the GPU culling, "
+                  << "culling on the CPU" << std::endl;
+        bGpuDrivenShaders = false;
+        LoadSceneShaders(SCENE_SHADERS_UNIFORM);
+        g_SceneManager->SetupSceneLights();
+    }
+
+    // the culling draws every opaque object through the table, so
+    // there are no draw states to merge
+    if (g_bStaticBatching && bGpuDrivenShaders)
+    {
+        std::cout << "INFO: Static batching is not used with GPU culling" << std::endl;
+    }
+    else if (g_bStaticBatching && !g_SceneManager->EnableStaticBatching())
+    {
+        std::cout << "INFO: Could not enable static batching, "
+                  << "drawing every object on its own" << std::endl;
+    }
+
+    if (g_bOcclusionCulling && !g_SceneManager->EnableOcclusionCulling(g_bUseRasterSimd))
+    {
+        std::cout << "INFO: Occlusion culling on the CPU is not used with GPU culling" << std::endl;
+    }
+
+    if (g_ExportTarget != nullptr)
+    {
+        g_FrameExporter = new FrameExporter();
+        if (!g_FrameExporter->Open(g_ExportTarget, g_ExportFormat))
+        {
+            delete g_FrameExporter;
+            g_FrameExporter = nullptr;
+        }
+    }
+
+    if (g_DynamicResolutionBudget > 0.0f)
+    {
+        g_DynamicResolution = new DynamicResolution();
+        DynamicResolution::SETTINGS settings = g_DynamicResolution->GetSettings();
+        settings.targetFrameTime = g_DynamicResolutionBudget;
+        if (g_DynamicResolutionMinScale > 0.0f)
+        {
+            settings.minScale = g_DynamicResolutionMinScale;
+        }
+        settings.filter = g_UpscaleFilter;
+        g_DynamicResolution->SetSettings(settings);
+        if (!g_DynamicResolution->Create())
+        {
+            std::cout << "INFO: GPU timer queries are not supported, "
+                      << "drawing at the full resolution" << std::endl;
+            delete g_DynamicResolution;
+            g_DynamicResolution = nullptr;
+        }
+    }
+
+    // the other windows draw the same scene objects with the
+    // contexts of their own, so they stay on this thread
+    if (g_ViewCount > 1)
+    {
+        if (g_bUseRenderThread)
+        {
+            std::cout << "INFO: Drawing on the main thread, since more than one view is open" << std::endl;
+            g_bUseRenderThread = false;
+        }
+        OpenSharedViews(g_ViewCount);
+    }
+
+    // hand the OpenGL context over to the render thread
+    if (g_bUseRenderThread)
+    {
+        g_RenderThread = new RenderThread(g_Window, g_ViewManager, g_SceneManager);
+        g_RenderThread->SetFrameExporter(g_FrameExporter);
+        g_RenderThread->SetDynamicResolution(g_DynamicResolution);
+        g_RenderThread->Start();
+    }
+
+    // the allocations of the loading are not counted for a frame
+    if (g_bTrackAllocations)
+    {
+        SetAllocationCounting(true);
+        ResetAllocationFrames();
+    }
 
     // Main render loop
     while (!glfwWindowShouldClose(g_Window))
     {
-        // Enable z-depth
-        glEnable(GL_DEPTH_TEST);
+        // drop the views whose windows were closed
+        for (size_t i = g_SharedViews.size(); i > 0; --i)
+        {
+            if (glfwWindowShouldClose(g_SharedViews[i - 1].pViewManager->GetWindow()))
+            {
+                CloseSharedView(i - 1);
+            }
+        }
 
-        // Clear the frame and z buffers
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // update the camera from the latest input state
+        bool bViewChanged = g_ViewManager->UpdateSceneView();
+        for (auto& view : g_SharedViews)
+        {
+            bViewChanged = view.pViewManager->UpdateSceneView() || bViewChanged;
+        }
+
+        // in render-on-demand mode, only draw when something changed
+        const bool bDrawFrame = g_RenderScheduler.ShouldRenderFrame(bViewChanged);
+        if (!bDrawFrame)
+        {
+            // nothing to draw this iteration
+        }
+        else if (g_RenderThread != nullptr)
+        {
+            // build frame N+1 while the render thread draws frame N
+            FRAME_PACKET* pPacket = g_RenderThread->AcquireFramePacket();
+            g_ViewManager->CaptureSceneView(*pPacket);
+            g_SceneManager->BuildFramePacket(*pPacket);
+            g_RenderThread->SubmitFramePacket(pPacket);
+        }
+        else
+        {
+            // build the culled draw list for the current view
+            ++g_FramePacket.frameIndex;
+            g_ViewManager->CaptureSceneView(g_FramePacket);
+            g_SceneManager->BuildFramePacket(g_FramePacket);
+
+            // redirect the scene into the scaled offscreen target
+            float resolutionScale = 1.0f;
+            if (g_DynamicResolution != nullptr)
+            {
+                resolutionScale = g_DynamicResolution->BeginFrame(
+                    static_cast<int>(g_FramePacket.viewportSize.x),
+                    static_cast<int>(g_FramePacket.viewportSize.y));
+            }
+
+            BeginGLCaptureFrame();
+
+            // Enable z-depth
+            glEnable(GL_DEPTH_TEST);
+
+            // Clear the frame and z buffers
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // convert from 3D object space to 2D view
+            g_ViewManager->ApplyFrameView(g_FramePacket, resolutionScale);
+
+            // refresh the 3D scene
+            g_SceneManager->SubmitFramePacket(g_FramePacket);
+
+            EndGLCaptureFrame();
+
+            // stretch the scaled frame over the window
+            if (g_DynamicResolution != nullptr)
+            {
+                g_DynamicResolution->EndFrame();
+            }
 
-        // convert from 3D object space to 2D view
-        g_ViewManager->PrepareSceneView();
+            // queue the readback of the frame before it is presented
+            if (g_FrameExporter != nullptr)
+            {
+                g_FrameExporter->CaptureFrame(
+                    static_cast<int>(g_FramePacket.viewportSize.x),
+                    static_cast<int>(g_FramePacket.viewportSize.y));
+            }
 
-        // refresh the 3D scene
-        g_SceneManager->RenderScene();
+            // Swap buffers
+            glfwSwapBuffers(g_Window);
 
-        // Swap buffers
-        glfwSwapBuffers(g_Window);
+            // the same frame from the cameras of the other windows
+            DrawSharedViews();
+        }
 
-        // Query the latest GLFW events
-        glfwPollEvents();
+        // the transient data of the frame is done with; the arenas
+        // of the frame before it are rewound for the next one
+        if (bDrawFrame)
+        {
+            AdvanceFrameArenas();
+        }
+
+        // the heap traffic of the loop since the last drawn frame
+        if (bDrawFrame && g_bTrackAllocations)
+        {
+            CheckFrameAllocations();
+        }
+
+        // Query the latest GLFW events, sleeping while idle
+        g_RenderScheduler.WaitForEvents();
+    }
+
+    // take the OpenGL context back before the cleanup
+    if (g_RenderThread != nullptr)
+    {
+        g_RenderThread->Stop();
+        delete g_RenderThread;
+        g_RenderThread = nullptr;
     }
 
-    // Clean up allocated manager objects
+    // write out the frames still being read back
+    if (g_FrameExporter != nullptr)
+    {
+        g_FrameExporter->Close();
+        FrameExporter::STATS stats = g_FrameExporter->GetStats();
+        std::cout << "INFO: Exported " << stats.framesExported << " frames, "
+                  << stats.captureTime / std::max(1ul, stats.framesExported) << " ms per frame for the readback, "
+                  << stats.readbackWaits << " readback waits, " << stats.encoderWaits << " encoder waits";
+        if (stats.framesSkipped > 0)
+        {
+            std::cout << ", " << stats.framesSkipped << " frames of another size skipped";
+        }
+        std::cout << std::endl;
+        delete g_FrameExporter;
+        g_FrameExporter = nullptr;
+    }
+
+    if (g_DynamicResolution != nullptr)
+    {
+        std::cout << "INFO: Dynamic resolution averaged a scale of "
+                  << g_DynamicResolution->GetAverageScale() << ", last GPU frame time "
+                  << g_DynamicResolution->GetGpuFrameTime() << " ms" << std::endl;
+        delete g_DynamicResolution;
+        g_DynamicResolution = nullptr;
+    }
+
+    if (g_bTrackAllocations)
+    {
+        const ALLOCATION_FRAME_STATS stats = GetAllocationFrameStats();
+        const double frames = static_cast<double>(std::max<uint64_t>(1, stats.frames));
+        std::cout << "INFO: " << stats.allocatingFrames << " of " << stats.frames
+                  << " frames allocated, at most " << stats.peakAllocations << " times; per frame:";
+        for (int tag = 0; tag < ALLOCATION_TAG_COUNT; ++tag)
+        {
+            const ALLOCATION_COUNTERS& counters = stats.tags[tag];
+            std::cout << " " << GetAllocationTagName(static_cast<ALLOCATION_TAG>(tag)) << " "
+                      << counters.allocations / frames << " (" << counters.bytesAllocated / frames << " bytes)";
+        }
+        std::cout << std::endl;
+
+        const FRAME_ARENA_STATS arenaStats = GetFrameArenaStats();
+        std::cout << "INFO: Frame arenas of " << arenaStats.threadCount << " threads peaked at "
+                  << arenaStats.peakFrameBytes << " bytes per frame, last frame "
+                  << arenaStats.lastFrameBytes << " bytes, " << arenaStats.capacityBytes
+                  << " bytes reserved, grown " << arenaStats.overflows << " times" << std::endl;
+    }
+
+    if (!g_SharedViews.empty())
+    {
+        std::cout << "INFO: " << g_SharedViews.size() + 1 << " views drew from "
+                  << PrimitiveMeshes::GetShared().GetLoadedBytes() / 1024 << " KB of shared mesh buffers" << std::endl;
+    }
+    while (!g_SharedViews.empty())
+    {
+        CloseSharedView(g_SharedViews.size() - 1);
+    }
+
+    if (g_bOcclusionCulling)
+    {
+        PrintOcclusionStats(*g_SceneManager);
+    }
+
+    if (g_WorldStreamer != nullptr)
+    {
+        WorldStreamer::STATS stats = g_WorldStreamer->GetStats();
+        std::cout << "INFO: World streaming loaded " << stats.cellsLoaded << " cells, evicted "
+                  << stats.cellsEvicted << ", uploaded " << stats.texturesUploaded << " textures" << std::endl;
+    }
+
+    // Clean up allocated manager objects; the world streamer
+    // points into the scene manager
+    delete g_WorldStreamer;
     delete g_SceneManager;
     delete g_ViewManager;
     delete g_ShaderManager;
+    delete g_JobSystem;
 
+    g_WorldStreamer = nullptr;
     g_SceneManager = nullptr;
     g_ViewManager  = nullptr;
     g_ShaderManager = nullptr;
+    g_JobSystem = nullptr;
 
     // Terminate GLFW context
     glfwTerminate();
 
+    // a frame that allocated after the warm-up fails the run
+    if (g_bFrameAllocated)
+    {
+        return EXIT_FAILURE;
+    }
+
     // Terminates the program successfully
     return EXIT_SUCCESS;
 }
 
+/***********************************************************
+ *  ParseCommandLine()
+ *
+ *  This function is used to apply the command line options.
+ *
+ *    --on-demand    only redraw when the view or window changes
+ *    --continuous   redraw every loop iteration (default)
+ *    --render-thread  submit OpenGL calls on a dedicated thread
+ *    --jobs N         run the job system on N threads
+ *    --benchmark-jobs benchmark the frame preparation on 1..N threads
+ *    --gpu-ring-buffer  stream the shader values through a
+ *                       persistently mapped buffer (OpenGL 4.4)
+ *    --static-batching  merge the static objects that share a
+ *                       material, texture and color into one
+ *                       pre-transformed draw per group
+ *    --gpu-culling      cull the opaque objects in a compute
+ *                       shader and draw them with one indirect
+ *                       call (OpenGL 4.6)
+ *    --gpu-occlusion    also cull the objects hidden behind the
+ *                       depth of the last frame; implies
+ *                       --gpu-culling
+ *    --meshlet-culling  also cull the clusters of 64 vertices
+ *                       and 124 triangles of each shape that are
+ *                       out of view or face away; implies
+ *                       --gpu-culling
+ *    --occlusion-culling  drop the draws hidden behind the
+ *                       largest objects, rasterized into a
+ *                       small depth buffer on the CPU
+ *    --scene FILE       load a binary scene file instead of the
+ *                       built-in scene
+ *    --convert-scene TEXT FILE  convert a scene description into
+ *                       a binary scene file and exit
+ *    --benchmark-scene-load N  time loading a scene of N objects
+ *    --mesh-optimization none|cache|overdraw  reordering of the
+ *                       basic shapes (default overdraw)
+ *    --benchmark-meshes report the vertex cache efficiency of
+ *                       the meshes before and after optimization
+ *    --vertex-format float|packed  vertex layout of the basic
+ *                       shapes (default float)
+ *    --benchmark-vertex-formats  compare the draw time of the
+ *                       vertex layouts on a dense grid
+ *    --world DIR        stream the cells of a world directory
+ *                       around the camera
+ *    --world-radius R   load the cells within R units
+ *    --world-budget MB  keep at most MB megabytes of cells and
+ *                       textures in memory
+ *    --build-world FILE SIZE DIR  split a binary scene file into
+ *                       a world of SIZE unit cells and exit
+ *    --software-render FILE  draw one frame on the CPU into a
+ *                       TGA file and exit; needs no GPU
+ *    --no-simd          use the scalar edge functions of the
+ *                       software rasterizer and the occlusion
+ *                       culling
+ *    --benchmark-software-raster  time the software rasterizer
+ *                       on 1..N threads
+ *    --compare-software-render  draw one frame with OpenGL and
+ *                       the software rasterizer and fail when
+ *                       too many pixels differ
+ *    --capture-gl FILE N  record the OpenGL calls of the first N
+ *                       frames into a capture file
+ *    --replay-gl FILE N time N runs of the frames of a capture
+ *                       file in a hidden window and exit
+ *    --export-png PREFIX  write every drawn frame to
+ *                       PREFIX000001.png and onwards
+ *    --export-raw FILE  append every drawn frame as top-down
+ *                       RGBA8 to a file or named pipe
+ *    --dynamic-resolution MS  scale the resolution of the scene
+ *                       so it takes about MS ms of GPU time
+ *    --min-resolution-scale S  lowest scale of each window axis
+ *                       (default 0.5)
+ *    --upscale bilinear|sharpen  filter that stretches the scaled
+ *                       frame over the window (default bilinear)
+ *    --multi-view N PREFIX  draw N cameras circling the scene in
+ *                       one pass and write them to PREFIX000001.png
+ *                       and onwards, then exit
+ *    --multi-view-tiles write the views of --multi-view as tiles
+ *                       of a single image instead
+ *    --track-allocations  count the heap allocations of each
+ *                       frame per subsystem and report them
+ *    --assert-no-allocations N  fail when a frame after the
+ *                       first N drawn frames allocates at all
+ *    --views N          open N windows (at most 4) on the scene,
+ *                       the others looking from the front, the
+ *                       top and the side; they share the textures,
+ *                       meshes and shaders of the main window
+ ***********************************************************/
+void ParseCommandLine(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--on-demand") == 0)
+        {
+            g_RenderScheduler.SetOnDemand(true);
+        }
+        else if (strcmp(argv[i], "--continuous") == 0)
+        {
+            g_RenderScheduler.SetOnDemand(false);
+        }
+        else if (strcmp(argv[i], "--render-thread") == 0)
+        {
+            g_bUseRenderThread = true;
+        }
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+        {
+            g_JobThreadCount = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--benchmark-jobs") == 0)
+        {
+            g_bRunJobBenchmark = true;
+        }
+        else if (strcmp(argv[i], "--gpu-ring-buffer") == 0)
+        {
+            g_bUseGpuRingBuffer = true;
+        }
+        else if (strcmp(argv[i], "--static-batching") == 0)
+        {
+            g_bStaticBatching = true;
+        }
+        else if (strcmp(argv[i], "--gpu-culling") == 0)
+        {
+            g_bGpuCulling = true;
+        }
+        else if (strcmp(argv[i], "--gpu-occlusion") == 0)
+        {
+            g_bGpuCulling = true;
+            g_bGpuOcclusion = true;
+        }
+        else if (strcmp(argv[i], "--meshlet-culling") == 0)
+        {
+            g_bGpuCulling = true;
+            g_bMeshletCulling = true;
+        }
+        else if (strcmp(argv[i], "--occlusion-culling") == 0)
+        {
+            g_bOcclusionCulling = true;
+        }
+        else if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc)
+        {
+            g_SceneFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--convert-scene") == 0 && i + 2 < argc)
+        {
+            g_ConvertSceneSource = argv[++i];
+            g_ConvertSceneTarget = argv[++i];
+        }
+        else if (strcmp(argv[i], "--benchmark-scene-load") == 0 && i + 1 < argc)
+        {
+            g_SceneLoadBenchmarkObjects = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--mesh-optimization") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "none") == 0)
+            {
+                g_MeshOptimization = MESH_OPTIMIZE_NONE;
+            }
+            else if (strcmp(argv[i], "cache") == 0)
+            {
+                g_MeshOptimization = MESH_OPTIMIZE_VERTEX_CACHE;
+            }
+            else if (strcmp(argv[i], "overdraw") == 0)
+            {
+                g_MeshOptimization = MESH_OPTIMIZE_OVERDRAW;
+            }
+            else
+            {
+                std::cerr << "WARNING: Unknown mesh optimization ignored: " << argv[i] << std::endl;
+            }
+        }
+        else if (strcmp(argv[i], "--benchmark-meshes") == 0)
+        {
+            g_bRunMeshBenchmark = true;
+        }
+        else if (strcmp(argv[i], "--vertex-format") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "float") == 0)
+            {
+                g_VertexFormat = VERTEX_FORMAT_FLOAT;
+            }
+            else if (strcmp(argv[i], "packed") == 0)
+            {
+                g_VertexFormat = VERTEX_FORMAT_PACKED;
+            }
+            else
+            {
+                std::cerr << "WARNING: Unknown vertex format ignored: " << argv[i] << std::endl;
+            }
+        }
+        else if (strcmp(argv[i], "--benchmark-vertex-formats") == 0)
+        {
+            g_bRunVertexBenchmark = true;
+        }
+        else if (strcmp(argv[i], "--world") == 0 && i + 1 < argc)
+        {
+            g_WorldDirectory = argv[++i];
+        }
+        else if (strcmp(argv[i], "--world-radius") == 0 && i + 1 < argc)
+        {
+            g_WorldLoadRadius = static_cast<float>(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--world-budget") == 0 && i + 1 < argc)
+        {
+            g_WorldBudgetMB = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--build-world") == 0 && i + 3 < argc)
+        {
+            g_BuildWorldSource = argv[++i];
+            g_BuildWorldCellSize = static_cast<float>(atof(argv[++i]));
+            g_BuildWorldTarget = argv[++i];
+        }
+        else if (strcmp(argv[i], "--software-render") == 0 && i + 1 < argc)
+        {
+            g_SoftwareImageFilename = argv[++i];
+        }
+        else if (strcmp(argv[i], "--no-simd") == 0)
+        {
+            g_bUseRasterSimd = false;
+        }
+        else if (strcmp(argv[i], "--benchmark-software-raster") == 0)
+        {
+            g_bRunRasterBenchmark = true;
+        }
+        else if (strcmp(argv[i], "--compare-software-render") == 0)
+        {
+            g_bCompareSoftwareRender = true;
+        }
+        else if (strcmp(argv[i], "--capture-gl") == 0 && i + 2 < argc)
+        {
+            g_CaptureFilename = argv[++i];
+            g_CaptureFrames = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--replay-gl") == 0 && i + 2 < argc)
+        {
+            g_ReplayFilename = argv[++i];
+            g_ReplayRuns = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--export-png") == 0 && i + 1 < argc)
+        {
+            g_ExportTarget = argv[++i];
+            g_ExportFormat = EXPORT_PNG_SEQUENCE;
+        }
+        else if (strcmp(argv[i], "--export-raw") == 0 && i + 1 < argc)
+        {
+            g_ExportTarget = argv[++i];
+            g_ExportFormat = EXPORT_RAW_STREAM;
+        }
+        else if (strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+        {
+            g_DynamicResolutionBudget = static_cast<float>(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--min-resolution-scale") == 0 && i + 1 < argc)
+        {
+            g_DynamicResolutionMinScale = static_cast<float>(atof(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--upscale") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "bilinear") == 0)
+            {
+                g_UpscaleFilter = UPSCALE_BILINEAR;
+            }
+            else if (strcmp(argv[i], "sharpen") == 0)
+            {
+                g_UpscaleFilter = UPSCALE_SHARPEN;
+            }
+            else
+            {
+                std::cerr << "WARNING: Unknown upscale filter ignored: " << argv[i] << std::endl;
+            }
+        }
+        else if (strcmp(argv[i], "--multi-view") == 0 && i + 2 < argc)
+        {
+            g_MultiViewCount = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+            g_MultiViewPrefix = argv[++i];
+        }
+        else if (strcmp(argv[i], "--multi-view-tiles") == 0)
+        {
+            g_MultiViewTarget = MULTI_VIEW_TILES;
+        }
+        else if (strcmp(argv[i], "--track-allocations") == 0)
+        {
+            g_bTrackAllocations = true;
+        }
+        else if (strcmp(argv[i], "--assert-no-allocations") == 0 && i + 1 < argc)
+        {
+            g_bTrackAllocations = true;
+            g_AllocationWarmupFrames = static_cast<unsigned>(std::max(1, atoi(argv[++i])));
+        }
+        else if (strcmp(argv[i], "--views") == 0 && i + 1 < argc)
+        {
+            g_ViewCount = std::min(MAX_VIEW_COUNT, static_cast<unsigned>(std::max(1, atoi(argv[++i]))));
+        }
+        else
+        {
+            std::cerr << "WARNING: Unknown option ignored: " << argv[i] << std::endl;
+        }
+    }
+}
+
+/***********************************************************
+ *  RenderSoftwareImage()
+ *
+ *  This function is used to draw one frame of the scene
+ *  from the default camera with the software rasterizer
+ *  and save it as an image. No window or OpenGL context
+ *  is created.
+ ***********************************************************/
+int RenderSoftwareImage(const char* filename)
+{
+    JobSystem jobSystem(g_JobThreadCount);
+    SoftwareRasterizer rasterizer(&jobSystem);
+    rasterizer.SetUseSimd(g_bUseRasterSimd);
+
+    ViewManager viewManager(nullptr);
+    SceneManager sceneManager(nullptr);
+    sceneManager.SetJobSystem(&jobSystem);
+    sceneManager.SetSoftwareRasterizer(&rasterizer);
+    sceneManager.SetMeshOptimization(g_MeshOptimization);
+    sceneManager.PrepareScene(g_SceneFilename);
+    if (g_bOcclusionCulling)
+    {
+        sceneManager.EnableOcclusionCulling(g_bUseRasterSimd);
+    }
+
+    FRAME_PACKET packet;
+    packet.frameIndex = 1;
+    viewManager.UpdateSceneView();
+    viewManager.CaptureSceneView(packet);
+    sceneManager.BuildFramePacket(packet);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    sceneManager.SubmitFramePacket(packet);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::cout << "INFO: Software rasterizer drew " << packet.drawCommands.size() << " objects, "
+              << rasterizer.GetTriangleCount() << " triangles at "
+              << rasterizer.GetWidth() << "x" << rasterizer.GetHeight() << " in "
+              << std::chrono::duration<double, std::milli>(stop - start).count() << " ms on "
+              << jobSystem.GetThreadCount() << " threads ("
+              << (rasterizer.GetUseSimd() ? "AVX2" : "scalar") << ")" << std::endl;
+    if (g_bOcclusionCulling)
+    {
+        PrintOcclusionStats(sceneManager);
+    }
+
+    return rasterizer.WriteImage(filename) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/***********************************************************
+ *  CompareSoftwareRender()
+ *
+ *  This function is used to check the software rasterizer
+ *  against OpenGL. Both draw one frame of the scene from
+ *  the default camera, OpenGL with the glUniform shaders
+ *  into an offscreen target of a hidden window, and their
+ *  pixels are compared. It fails when more pixels than the
+ *  allowed share differ by more than the tolerance.
+ ***********************************************************/
+int CompareSoftwareRender()
+{
+    if (!InitializeGLFW())
+    {
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* pWindow = glfwCreateWindow(64, 64, WINDOW_TITLE, NULL, NULL);
+    if (pWindow == NULL)
+    {
+        std::cerr << "ERROR: Failed to create GLFW window." << std::endl;
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(pWindow);
+
+    int result = EXIT_FAILURE;
+    if (InitializeGLEW())
+    {
+        JobSystem jobSystem(g_JobThreadCount);
+        ShaderManager shaderManager;
+        shaderManager.LoadShaders("shaders/vertexShader.glsl", "shaders/fragmentShader.glsl");
+        shaderManager.use();
+        ViewManager viewManager(&shaderManager);
+        viewManager.BindFrameDataBlock();
+
+        SceneManager glScene(&shaderManager);
+        glScene.SetJobSystem(&jobSystem);
+        glScene.SetMeshOptimization(g_MeshOptimization);
+        glScene.SetVertexFormat(g_VertexFormat);
+        glScene.PrepareScene(g_SceneFilename);
+
+        SoftwareRasterizer rasterizer(&jobSystem);
+        rasterizer.SetUseSimd(g_bUseRasterSimd);
+        SceneManager softwareScene(nullptr);
+        softwareScene.SetJobSystem(&jobSystem);
+        softwareScene.SetSoftwareRasterizer(&rasterizer);
+        softwareScene.SetMeshOptimization(g_MeshOptimization);
+        softwareScene.PrepareScene(g_SceneFilename);
+
+        // both draw lists are built for the same camera
+        FRAME_PACKET glPacket;
+        FRAME_PACKET softwarePacket;
+        glPacket.frameIndex = 1;
+        softwarePacket.frameIndex = 1;
+        viewManager.UpdateSceneView();
+        viewManager.CaptureSceneView(glPacket);
+        viewManager.CaptureSceneView(softwarePacket);
+        glScene.BuildFramePacket(glPacket);
+        softwareScene.BuildFramePacket(softwarePacket);
+
+        softwareScene.SubmitFramePacket(softwarePacket);
+        std::vector<uint8_t> softwarePixels;
+        rasterizer.ReadPixels(softwarePixels);
+        const int width = rasterizer.GetWidth();
+        const int height = rasterizer.GetHeight();
+
+        GLuint renderbuffers[2];
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        GLuint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+
+        glViewport(0, 0, width, height);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        viewManager.ApplyFrameView(glPacket);
+        glScene.SubmitFramePacket(glPacket);
+
+        std::vector<uint8_t> glPixels(softwarePixels.size());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, glPixels.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(2, renderbuffers);
+
+        // only the color channels are compared, the alpha of the
+        // frame is never shown
+        const size_t pixelCount = static_cast<size_t>(width) * height;
+        size_t differentCount = 0;
+        int largestDifference = 0;
+        double differenceSum = 0.0;
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            int difference = 0;
+            for (size_t channel = 0; channel < 3; ++channel)
+            {
+                const size_t index = i * 4 + channel;
+                difference = std::max(difference, std::abs(glPixels[index] - softwarePixels[index]));
+            }
+            if (difference > SOFTWARE_COMPARE_TOLERANCE)
+            {
+                ++differentCount;
+            }
+            largestDifference = std::max(largestDifference, difference);
+            differenceSum += difference;
+        }
+
+        const double differentShare = static_cast<double>(differentCount) / static_cast<double>(pixelCount);
+        std::cout << "INFO: Compared " << softwarePacket.drawCommands.size() << " objects at "
+                  << width << "x" << height << ": " << differentCount << " pixels ("
+                  << differentShare * 100.0 << "%) differ by more than " << SOFTWARE_COMPARE_TOLERANCE
+                  << " levels, the largest difference is " << largestDifference << " and the mean "
+                  << differenceSum / static_cast<double>(pixelCount) << std::endl;
+        if (differentShare <= SOFTWARE_COMPARE_MAX_DIFFERENT)
+        {
+            std::cout << "INFO: The software rasterizer matches OpenGL" << std::endl;
+            result = EXIT_SUCCESS;
+        }
+        else
+        {
+            std::cerr << "ERROR: The software rasterizer differs from OpenGL in more than "
+                      << SOFTWARE_COMPARE_MAX_DIFFERENT * 100.0 << "% of the pixels" << std::endl;
+        }
+    }
+
+    glfwDestroyWindow(pWindow);
+    glfwTerminate();
+    return result;
+}
+
+/***********************************************************
+ *  ReplayGLCapture()
+ *
+ *  This function is used to time the frames of a capture
+ *  file. The scene is not loaded; a hidden window only
+ *  provides the OpenGL context.
+ ***********************************************************/
+int ReplayGLCapture(const char* filename, unsigned runs)
+{
+    if (!InitializeGLFW())
+    {
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* pWindow = glfwCreateWindow(64, 64, WINDOW_TITLE, NULL, NULL);
+    if (pWindow == NULL)
+    {
+        std::cerr << "ERROR: Failed to create GLFW window." << std::endl;
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(pWindow);
+
+    int result = EXIT_FAILURE;
+    if (InitializeGLEW())
+    {
+        result = RunGLReplay(filename, runs);
+    }
+
+    glfwDestroyWindow(pWindow);
+    glfwTerminate();
+    return result;
+}
+
+/***********************************************************
+ *  RenderMultiView()
+ *
+ *  This function is used to draw the scene from cameras
+ *  circling it, all in one multi-view pass, and to write
+ *  the views out as PNG images. A hidden window only
+ *  provides the OpenGL context.
+ ***********************************************************/
+int RenderMultiView(unsigned viewCount, const char* prefix)
+{
+    if (viewCount > MAX_SHADER_VIEWS)
+    {
+        std::cout << "INFO: Drawing the first " << MAX_SHADER_VIEWS << " of "
+                  << viewCount << " views" << std::endl;
+        viewCount = MAX_SHADER_VIEWS;
+    }
+
+    if (!InitializeGLFW())
+    {
+        return EXIT_FAILURE;
+    }
+
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* pWindow = glfwCreateWindow(64, 64, WINDOW_TITLE, NULL, NULL);
+    if (pWindow == NULL)
+    {
+        std::cerr << "ERROR: Failed to create GLFW window." << std::endl;
+        glfwTerminate();
+        return EXIT_FAILURE;
+    }
+    glfwMakeContextCurrent(pWindow);
+
+    int result = EXIT_FAILURE;
+    if (InitializeGLEW())
+    {
+        JobSystem jobSystem(g_JobThreadCount);
+        ShaderManager shaderManager;
+        shaderManager.LoadShaders("shaders/multiViewVertexShader.glsl", "shaders/multiViewFragmentShader.glsl");
+        shaderManager.use();
+
+        SceneManager sceneManager(&shaderManager);
+        sceneManager.SetJobSystem(&jobSystem);
+        sceneManager.SetMeshOptimization(g_MeshOptimization);
+        sceneManager.SetVertexFormat(g_VertexFormat);
+        sceneManager.PrepareScene(g_SceneFilename);
+
+        // the cameras circle the point the default camera looks
+        // at, at its distance and height
+        const glm::vec3 target(0.0f, 2.0f, 0.0f);
+        const float radius = 12.0f;
+        const float height = 5.0f;
+        const glm::mat4 projection = glm::perspective(glm::radians(80.0f),
+            static_cast<float>(MULTI_VIEW_WIDTH) / static_cast<float>(MULTI_VIEW_HEIGHT), 0.1f, 100.0f);
+
+        std::vector<MULTI_VIEW_CAMERA> cameras(viewCount);
+        for (unsigned i = 0; i < viewCount; ++i)
+        {
+            const float angle = glm::radians(360.0f * static_cast<float>(i) / static_cast<float>(viewCount));
+            cameras[i].viewPosition = glm::vec3(radius * std::sin(angle), height, radius * std::cos(angle));
+            cameras[i].view = glm::lookAt(cameras[i].viewPosition, target, glm::vec3(0.0f, 1.0f, 0.0f));
+            cameras[i].projection = projection;
+        }
+
+        MultiViewRenderer renderer;
+        if (renderer.Create(MULTI_VIEW_WIDTH, MULTI_VIEW_HEIGHT, static_cast<int>(viewCount), g_MultiViewTarget))
+        {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            renderer.Render(&sceneManager, cameras.data(), static_cast<int>(viewCount));
+            glFinish();
+            auto stop = std::chrono::high_resolution_clock::now();
+
+            std::cout << "INFO: Drew " << viewCount << " views with "
+                      << renderer.GetDrawCallCount() << " draw calls in "
+                      << std::chrono::duration<double, std::milli>(stop - start).count() << " ms ("
+                      << (renderer.IsSinglePass() ? "single pass" : "one pass per view") << ")" << std::endl;
+
+            FrameExporter exporter;
+            if (exporter.Open(prefix, EXPORT_PNG_SEQUENCE))
+            {
+                for (int image = 0; image < renderer.GetImageCount(); ++image)
+                {
+                    renderer.BindImageForReading(image);
+                    exporter.CaptureFrame(renderer.GetImageWidth(), renderer.GetImageHeight());
+                }
+                exporter.Close();
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+                result = EXIT_SUCCESS;
+            }
+        }
+    }
+
+    glfwDestroyWindow(pWindow);
+    glfwTerminate();
+    return result;
+}
+
+/***********************************************************
+ *  OpenSharedViews()
+ *
+ *  This function is used to open the windows of the other
+ *  views, as in the layout of a scene editor. Their contexts
+ *  share the objects of the main window, so the textures,
+ *  meshes and shaders exist once however many views are
+ *  open. The main window context is current again afterwards.
+ ***********************************************************/
+void OpenSharedViews(unsigned viewCount)
+{
+    // front, top and side cameras
+    const glm::vec3 positions[] =
+    {
+        glm::vec3(0.0f, 3.0f, 16.0f),
+        glm::vec3(0.0f, 20.0f, 2.0f),
+        glm::vec3(16.0f, 3.0f, 0.0f)
+    };
+    const glm::vec3 fronts[] =
+    {
+        glm::vec3(0.0f, -0.1f, -1.0f),
+        glm::vec3(0.0f, -1.0f, -0.1f),
+        glm::vec3(-1.0f, -0.1f, 0.0f)
+    };
+
+    for (unsigned i = 1; i < viewCount; ++i)
+    {
+        ViewManager* pViewManager = new ViewManager(g_ShaderManager);
+        const std::string title = std::string(WINDOW_TITLE) + " - View " + std::to_string(i + 1);
+        if (pViewManager->CreateDisplayWindow(title.c_str(), g_Window) == NULL)
+        {
+            delete pViewManager;
+            break;
+        }
+        pViewManager->SetCameraView(positions[i - 1], fronts[i - 1]);
+
+        SHARED_VIEW view;
+        view.pViewManager = pViewManager;
+        view.packet.frameIndex = 0;
+        g_SharedViews.push_back(view);
+    }
+
+    g_ViewManager->MakeContextCurrent();
+    std::cout << "INFO: Opened " << g_SharedViews.size()
+              << " more views sharing the objects of the main window" << std::endl;
+}
+
+/***********************************************************
+ *  DrawSharedViews()
+ *
+ *  This function is used to draw the scene into the windows
+ *  of the other views. Every view culls the scene to its
+ *  own camera. The program in use and the texture and
+ *  buffer bindings are state of each context, so they are
+ *  set in every window before its draw list is submitted.
+ ***********************************************************/
+void DrawSharedViews()
+{
+    for (auto& view : g_SharedViews)
+    {
+        view.pViewManager->MakeContextCurrent();
+
+        // build the culled draw list for the camera of this view
+        view.packet.frameIndex = g_FramePacket.frameIndex;
+        view.pViewManager->CaptureSceneView(view.packet);
+        g_SceneManager->BuildFramePacket(view.packet);
+
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        g_ShaderManager->use();
+        g_SceneManager->BindSharedResources();
+        view.pViewManager->ApplyFrameView(view.packet);
+        g_SceneManager->SubmitFramePacket(view.packet);
+
+        glfwSwapBuffers(view.pViewManager->GetWindow());
+    }
+
+    if (!g_SharedViews.empty())
+    {
+        g_ViewManager->MakeContextCurrent();
+    }
+}
+
+/***********************************************************
+ *  CloseSharedView()
+ *
+ *  This function is used to close the window of one of the
+ *  other views. The main window context must be current.
+ ***********************************************************/
+void CloseSharedView(size_t index)
+{
+    GLFWwindow* pWindow = g_SharedViews[index].pViewManager->GetWindow();
+    delete g_SharedViews[index].pViewManager;
+    glfwDestroyWindow(pWindow);
+    g_SharedViews.erase(g_SharedViews.begin() + index);
+}
+
+/***********************************************************
+ *  CheckFrameAllocations()
+ *
+ *  This function is used to close the allocation counting
+ *  of a drawn frame. Once the warm-up frames are over, the
+ *  scene has settled and the buffers of the frame have
+ *  reached their size, so any allocation is reported with
+ *  the subsystems it came from and ends the run.
+ ***********************************************************/
+void CheckFrameAllocations()
+{
+    FRAME_ALLOCATIONS frame;
+    EndAllocationFrame(frame);
+
+    const uint64_t frameNumber = GetAllocationFrameStats().frames;
+    if (g_AllocationWarmupFrames == 0 || frameNumber <= g_AllocationWarmupFrames || frame.allocations == 0)
+    {
+        return;
+    }
+
+    std::cerr << "ERROR: Frame " << frameNumber << " allocated " << frame.allocations
+              << " times, " << frame.bytesAllocated << " bytes:";
+    for (int tag = 0; tag < ALLOCATION_TAG_COUNT; ++tag)
+    {
+        if (frame.tags[tag].allocations > 0)
+        {
+            std::cerr << " " << GetAllocationTagName(static_cast<ALLOCATION_TAG>(tag)) << " "
+                      << frame.tags[tag].allocations << " (" << frame.tags[tag].bytesAllocated << " bytes)";
+        }
+    }
+    std::cerr << std::endl;
+
+    g_bFrameAllocated = true;
+    glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+    assert(!"a frame allocated after the warm-up");
+}
+
+/***********************************************************
+ *  PrintOcclusionStats()
+ *
+ *  This function is used to report how many draws the
+ *  occlusion culling dropped and what the stage cost, per
+ *  frame.
+ ***********************************************************/
+void PrintOcclusionStats(const SceneManager& sceneManager)
+{
+    const OcclusionCuller::STATS stats = sceneManager.GetOcclusionStats();
+    const double frames = static_cast<double>(std::max<uint64_t>(1, stats.frames));
+    std::cout << "INFO: Occlusion culling dropped " << stats.culledDraws << " of " << stats.testedDraws
+              << " draws over " << stats.frames << " frames; per frame " << stats.occluders / frames
+              << " occluders of " << stats.occluderTriangles / frames << " triangles rasterized in "
+              << stats.rasterizeTime / frames << " ms, " << stats.testedDraws / frames << " draws tested in "
+              << stats.testTime / frames << " ms" << std::endl;
+}
+
+/***********************************************************
+ *  LoadSceneShaders()
+ *
+ *  This function is used to load and activate the shaders.
+ *  All shader pairs read the camera values from the shared
+ *  FrameData block; the buffered shaders also read the
+ *  object and material values from uniform blocks, and the
+ *  GPU-driven ones read the object of each draw from the
+ *  table of the GPU culling.
+ ***********************************************************/
+void LoadSceneShaders(SCENE_SHADERS shaders)
+{
+    AllocationScope scope(ALLOCATION_SHADER_MANAGER);
+
+    const char* vertexFilename = "shaders/vertexShader.glsl";
+    const char* fragmentFilename = "shaders/fragmentShader.glsl";
+    if (shaders == SCENE_SHADERS_BUFFERED)
+    {
+        vertexFilename = "shaders/bufferedVertexShader.glsl";
+        fragmentFilename = "shaders/bufferedFragmentShader.glsl";
+    }
+    else if (shaders == SCENE_SHADERS_GPU_DRIVEN)
+    {
+        vertexFilename = "shaders/gpuDrivenVertexShader.glsl";
+        fragmentFilename = "shaders/gpuDrivenFragmentShader.glsl";
+    }
+    g_ShaderManager->LoadShaders(vertexFilename, fragmentFilename);
+    g_ShaderManager->use();
+
+    // a capture embeds the sources if the program drops its shaders
+    SetGLCaptureShaderFiles(g_ShaderManager->m_programID, vertexFilename, fragmentFilename);
+
+    // the camera values come from the shared FrameData block
+    g_ViewManager->BindFrameDataBlock();
+}
+
 /***********************************************************
  *  InitializeGLFW()
  *
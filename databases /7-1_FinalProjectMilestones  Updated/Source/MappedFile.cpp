@@ -0,0 +1,168 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.cpp
+// ============
+// read-only memory mapping of a whole file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/***********************************************************
+ *  MappedFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MappedFile::MappedFile()
+    : m_pData(nullptr),
+      m_size(0)
+#ifdef _WIN32
+      , m_hFile(INVALID_HANDLE_VALUE),
+      m_hMapping(NULL)
+#else
+      , m_fileDescriptor(-1)
+#endif
+{
+}
+
+/***********************************************************
+ *  ~MappedFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used to map the whole file read-only.
+ *  Empty files cannot be mapped and are reported as errors.
+ ***********************************************************/
+bool MappedFile::Open(const char* filename)
+{
+    Close();
+
+#ifdef _WIN32
+    m_hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart == 0 ||
+        static_cast<unsigned long long>(fileSize.QuadPart) > static_cast<size_t>(-1))
+    {
+        Close();
+        return false;
+    }
+
+    m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_hMapping == NULL)
+    {
+        Close();
+        return false;
+    }
+
+    m_pData = static_cast<const unsigned char*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    m_fileDescriptor = open(filename, O_RDONLY);
+    if (m_fileDescriptor < 0)
+    {
+        return false;
+    }
+
+    struct stat fileInfo;
+    if (fstat(m_fileDescriptor, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* pData = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+    if (pData != MAP_FAILED)
+    {
+        m_pData = static_cast<const unsigned char*>(pData);
+        m_size = static_cast<size_t>(fileInfo.st_size);
+    }
+#endif
+
+    if (m_pData == nullptr)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used to unmap the file and to release the
+ *  file handles.
+ ***********************************************************/
+void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (m_pData != nullptr)
+    {
+        UnmapViewOfFile(m_pData);
+    }
+    if (m_hMapping != NULL)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+    if (m_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hFile);
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_pData != nullptr)
+    {
+        munmap(const_cast<unsigned char*>(m_pData), m_size);
+    }
+    if (m_fileDescriptor >= 0)
+    {
+        close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+    }
+#endif
+
+    m_pData = nullptr;
+    m_size = 0;
+}
+
+/***********************************************************
+ *  Prefetch()
+ *
+ *  This method is used to read one byte of every page of the
+ *  mapping, which makes the operating system load the whole
+ *  file into memory on the calling thread.
+ ***********************************************************/
+void MappedFile::Prefetch() const
+{
+    const size_t PAGE_SIZE = 4096;
+
+    volatile unsigned char sink = 0;
+    for (size_t offset = 0; offset < m_size; offset += PAGE_SIZE)
+    {
+        sink ^= m_pData[offset];
+    }
+    (void)sink;
+}
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// read-only memory mapping of a whole file
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a file into the address space so its
+ *  contents can be used in place. Pages are only read from
+ *  disk when they are first touched.
+ ***********************************************************/
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // map the whole file read-only; false if it cannot be opened
+    bool Open(const char* filename);
+    // unmap the file
+    void Close();
+    // touch every page so it is read from disk now rather than
+    // by the first thread that uses the data
+    void Prefetch() const;
+
+    const unsigned char* GetData() const { return m_pData; }
+    size_t GetSize() const { return m_size; }
+    bool IsOpen() const { return m_pData != nullptr; }
+
+private:
+    // copying would unmap the file twice
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+    const unsigned char* m_pData;
+    size_t m_size;
+#ifdef _WIN32
+    void* m_hFile;
+    void* m_hMapping;
+#else
+    int m_fileDescriptor;
+#endif
+};
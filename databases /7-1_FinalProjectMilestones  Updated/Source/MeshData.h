@@ -0,0 +1,28 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshdata.h
+// ============
+// indexed triangle meshes in CPU memory, before they are uploaded
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// interleaved vertex layout read by the scene shaders at
+// locations 0 (position), 1 (normal) and 2 (texture coordinate)
+struct MESH_VERTEX
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 uv;
+};
+
+// an indexed triangle list
+struct MESH_DATA
+{
+    std::vector<MESH_VERTEX> vertices;
+    // three indices per counter-clockwise triangle
+    std::vector<uint32_t> indices;
+};
@@ -0,0 +1,400 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder mesh triangles and vertices for the GPU vertex cache, vertex
+// fetch and overdraw
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// declare the global variables
+namespace
+{
+    // scoring constants of Forsyth's "Linear-Speed Vertex Cache
+    // Optimisation" (2006); the cache size only has to be roughly
+    // right, the order works well for smaller hardware caches too
+    const int FORSYTH_CACHE_SIZE = 32;
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    const size_t NO_TRIANGLE = std::numeric_limits<size_t>::max();
+
+    /***********************************************************
+     *  ScoreVertex()
+     *
+     *  Score of a vertex by its position in the simulated LRU
+     *  cache and by the number of triangles still using it;
+     *  vertices with few remaining triangles are boosted so
+     *  they get finished instead of left behind.
+     ***********************************************************/
+    float ScoreVertex(int cachePosition, unsigned activeTriangles)
+    {
+        if (activeTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+            {
+                // used by the last triangle; a fixed score so the
+                // order does not just strip along one edge
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else
+            {
+                const float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+            }
+        }
+
+        score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(activeTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    // a run of triangles that is moved as a whole by the overdraw pass
+    struct TRIANGLE_CLUSTER
+    {
+        size_t firstIndex;
+        size_t indexCount;
+        float sortKey;
+    };
+}
+
+/***********************************************************
+ *  AnalyzeVertexCache()
+ *
+ *  This function is used to count the vertex shader runs of
+ *  an index list on a FIFO post-transform cache, which is
+ *  how most GPUs reuse transformed vertices.
+ ***********************************************************/
+VERTEX_CACHE_STATS AnalyzeVertexCache(
+    const uint32_t* pIndices,
+    size_t indexCount,
+    size_t vertexCount,
+    unsigned cacheSize)
+{
+    const size_t NOT_CACHED = std::numeric_limits<size_t>::max();
+
+    // a vertex is cached while fewer than cacheSize misses have
+    // happened since it was transformed
+    std::vector<size_t> transformedAt(vertexCount, NOT_CACHED);
+    size_t misses = 0;
+    size_t uniqueVertices = 0;
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const uint32_t vertex = pIndices[i];
+        if (transformedAt[vertex] == NOT_CACHED)
+        {
+            ++uniqueVertices;
+        }
+        if (transformedAt[vertex] == NOT_CACHED || misses - transformedAt[vertex] >= cacheSize)
+        {
+            transformedAt[vertex] = misses;
+            ++misses;
+        }
+    }
+
+    VERTEX_CACHE_STATS stats;
+    stats.acmr = (indexCount >= 3) ? static_cast<float>(misses) / (indexCount / 3) : 0.0f;
+    stats.atvr = (uniqueVertices > 0) ? static_cast<float>(misses) / uniqueVertices : 0.0f;
+    return stats;
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This function is used to reorder the triangles greedily:
+ *  every step emits the triangle whose vertices score best
+ *  in a simulated LRU cache. Only the triangles of vertices
+ *  in the cache are rescored, which keeps the pass linear in
+ *  the triangle count.
+ ***********************************************************/
+void OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount)
+{
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // triangles using each vertex; the first activeTriangles[v]
+    // entries of a vertex are the ones not emitted yet
+    std::vector<unsigned> activeTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++activeTriangles[pIndices[i]];
+    }
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + activeTriangles[v];
+    }
+    std::vector<size_t> adjacency(triangleCount * 3);
+    {
+        std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+        {
+            adjacency[fill[pIndices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScore[v] = ScoreVertex(-1, activeTriangles[v]);
+    }
+
+    std::vector<unsigned char> bEmitted(triangleCount, 0);
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t bestTriangle = NO_TRIANGLE;
+    size_t nextInputTriangle = 0;
+
+    for (size_t emitted = 0; emitted < triangleCount; ++emitted)
+    {
+        if (bestTriangle == NO_TRIANGLE)
+        {
+            // nothing in the cache is connected to the rest; carry
+            // on with the next triangle in input order
+            while (bEmitted[nextInputTriangle])
+            {
+                ++nextInputTriangle;
+            }
+            bestTriangle = nextInputTriangle;
+        }
+
+        const uint32_t* pTriangle = pIndices + bestTriangle * 3;
+        bEmitted[bestTriangle] = 1;
+        output.insert(output.end(), pTriangle, pTriangle + 3);
+
+        // the triangle is no longer active for its vertices
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t vertex = pTriangle[k];
+            size_t* pList = &adjacency[adjacencyOffsets[vertex]];
+            unsigned& count = activeTriangles[vertex];
+            for (unsigned i = 0; i < count; ++i)
+            {
+                if (pList[i] == bestTriangle)
+                {
+                    std::swap(pList[i], pList[count - 1]);
+                    --count;
+                    break;
+                }
+            }
+        }
+
+        // move the triangle's vertices to the front of the cache
+        uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (std::find(newCache, newCache + newCount, pTriangle[k]) == newCache + newCount)
+            {
+                newCache[newCount++] = pTriangle[k];
+            }
+        }
+        for (int i = 0; i < cacheCount; ++i)
+        {
+            if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+            {
+                newCache[newCount++] = cache[i];
+            }
+        }
+        for (int i = 0; i < newCount; ++i)
+        {
+            cachePosition[newCache[i]] = (i < FORSYTH_CACHE_SIZE) ? i : -1;
+            vertexScore[newCache[i]] = ScoreVertex(cachePosition[newCache[i]], activeTriangles[newCache[i]]);
+        }
+        cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+        std::copy(newCache, newCache + cacheCount, cache);
+
+        // the next triangle is the best one touching the cache
+        bestTriangle = NO_TRIANGLE;
+        float bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; ++i)
+        {
+            const uint32_t vertex = cache[i];
+            const size_t* pList = &adjacency[adjacencyOffsets[vertex]];
+            for (unsigned j = 0; j < activeTriangles[vertex]; ++j)
+            {
+                const uint32_t* pCandidate = pIndices + pList[j] * 3;
+                const float score = vertexScore[pCandidate[0]] + vertexScore[pCandidate[1]] + vertexScore[pCandidate[2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = pList[j];
+                }
+            }
+        }
+    }
+
+    std::copy(output.begin(), output.end(), pIndices);
+}
+
+/***********************************************************
+ *  OptimizeOverdraw()
+ *
+ *  This function is used to reorder clusters of triangles so
+ *  that surfaces likely to occlude the rest of the mesh are
+ *  drawn first, in the spirit of Sander et al., "Fast
+ *  Triangle Reordering for Vertex Locality and Reduced
+ *  Overdraw" (2007). A cluster starts at a triangle whose
+ *  three vertices all miss the simulated cache, so moving
+ *  the clusters costs little cache efficiency. Clusters are
+ *  ranked by how far their centroid lies out along their
+ *  average normal from the mesh centroid.
+ ***********************************************************/
+void OptimizeOverdraw(
+    uint32_t* pIndices,
+    size_t indexCount,
+    const MESH_VERTEX* pVertices,
+    size_t vertexCount,
+    unsigned cacheSize)
+{
+    const size_t NOT_CACHED = std::numeric_limits<size_t>::max();
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+    {
+        return;
+    }
+
+    // cluster boundaries, from the FIFO cache simulation
+    std::vector<TRIANGLE_CLUSTER> clusters;
+    std::vector<size_t> transformedAt(vertexCount, NOT_CACHED);
+    size_t misses = 0;
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        int triangleMisses = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t vertex = pIndices[t * 3 + k];
+            if (transformedAt[vertex] == NOT_CACHED || misses - transformedAt[vertex] >= cacheSize)
+            {
+                transformedAt[vertex] = misses;
+                ++misses;
+                ++triangleMisses;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+        {
+            TRIANGLE_CLUSTER cluster = { t * 3, 0, 0.0f };
+            clusters.push_back(cluster);
+        }
+        clusters.back().indexCount += 3;
+    }
+    if (clusters.size() < 2)
+    {
+        return;
+    }
+
+    // area-weighted centroid and normal of every cluster
+    std::vector<glm::vec3> centroids(clusters.size());
+    std::vector<glm::vec3> normals(clusters.size());
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t i = clusters[c].firstIndex; i < clusters[c].firstIndex + clusters[c].indexCount; i += 3)
+        {
+            const glm::vec3& p0 = pVertices[pIndices[i]].position;
+            const glm::vec3& p1 = pVertices[pIndices[i + 1]].position;
+            const glm::vec3& p2 = pVertices[pIndices[i + 2]].position;
+            const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+            const float triangleArea = glm::length(areaNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += areaNormal;
+            area += triangleArea;
+        }
+        centroids[c] = (area > 0.0f) ? centroid / area : pVertices[pIndices[clusters[c].firstIndex]].position;
+        const float normalLength = glm::length(normal);
+        normals[c] = (normalLength > 0.0f) ? normal / normalLength : glm::vec3(0.0f);
+        meshCentroid += centroid;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        clusters[c].sortKey = glm::dot(centroids[c] - meshCentroid, normals[c]);
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(),
+        [](const TRIANGLE_CLUSTER& a, const TRIANGLE_CLUSTER& b) { return a.sortKey > b.sortKey; });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (const auto& cluster : clusters)
+    {
+        output.insert(output.end(), pIndices + cluster.firstIndex, pIndices + cluster.firstIndex + cluster.indexCount);
+    }
+    std::copy(output.begin(), output.end(), pIndices);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This function is used to store the vertices in the order
+ *  the index list first references them. Vertices that are
+ *  never referenced are removed.
+ ***********************************************************/
+void OptimizeVertexFetch(MESH_DATA& mesh)
+{
+    const uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+
+    std::vector<uint32_t> remap(mesh.vertices.size(), UNUSED);
+    std::vector<MESH_VERTEX> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for (auto& index : mesh.indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = static_cast<uint32_t>(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+/***********************************************************
+ *  OptimizeMesh()
+ *
+ *  This function is used to run the passes of the requested
+ *  optimization level on a mesh: triangle order, optionally
+ *  cluster order, then vertex order, which has to come last
+ *  since it follows the final triangle order.
+ ***********************************************************/
+void OptimizeMesh(MESH_DATA& mesh, MESH_OPTIMIZATION optimization)
+{
+    if (optimization == MESH_OPTIMIZE_NONE || mesh.indices.empty())
+    {
+        return;
+    }
+
+    OptimizeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    if (optimization == MESH_OPTIMIZE_OVERDRAW)
+    {
+        OptimizeOverdraw(mesh.indices.data(), mesh.indices.size(),
+                         mesh.vertices.data(), mesh.vertices.size());
+    }
+    OptimizeVertexFetch(mesh);
+}
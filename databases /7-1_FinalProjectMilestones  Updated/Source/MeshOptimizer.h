@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder mesh triangles and vertices for the GPU vertex cache, vertex
+// fetch and overdraw
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshData.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// how far a mesh is reordered before it is uploaded
+enum MESH_OPTIMIZATION
+{
+    MESH_OPTIMIZE_NONE = 0,
+    // triangle order for the post-transform cache, vertex order
+    // for fetch locality
+    MESH_OPTIMIZE_VERTEX_CACHE,
+    // as above, then clusters of triangles sorted outside-in so
+    // near surfaces tend to be drawn first
+    MESH_OPTIMIZE_OVERDRAW
+};
+
+// post-transform cache efficiency of an index order
+struct VERTEX_CACHE_STATS
+{
+    // transformed vertices per triangle; 0.5 is the ideal for a
+    // large regular grid, 3 means nothing is reused
+    float acmr;
+    // transformed vertices per unique vertex; 1 is the ideal
+    float atvr;
+};
+
+// default size of the simulated FIFO cache for the statistics
+const unsigned VERTEX_CACHE_SIZE = 16;
+
+// simulate a FIFO post-transform cache over an index list
+VERTEX_CACHE_STATS AnalyzeVertexCache(
+    const uint32_t* pIndices,
+    size_t indexCount,
+    size_t vertexCount,
+    unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// reorder the triangles for the post-transform cache, with the
+// linear-speed algorithm of Tom Forsyth
+void OptimizeVertexCache(uint32_t* pIndices, size_t indexCount, size_t vertexCount);
+
+// split a cache-optimized triangle list into clusters at the points
+// where the cache restarts anyway, and sort the clusters so the ones
+// facing away from the mesh center come first
+void OptimizeOverdraw(
+    uint32_t* pIndices,
+    size_t indexCount,
+    const MESH_VERTEX* pVertices,
+    size_t vertexCount,
+    unsigned cacheSize = VERTEX_CACHE_SIZE);
+
+// renumber the vertices in the order the triangles first use them
+// and drop unused ones, so the vertex fetch walks memory forward
+void OptimizeVertexFetch(MESH_DATA& mesh);
+
+// apply the passes of an optimization level to a mesh
+void OptimizeMesh(MESH_DATA& mesh, MESH_OPTIMIZATION optimization);
@@ -0,0 +1,356 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshletbuilder.cpp
+// ============
+// split meshes into small clusters of triangles with a bounding sphere and
+// a normal cone, so whole clusters can be culled before they are drawn
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshletBuilder.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// declare the global variables
+namespace
+{
+    const size_t NO_TRIANGLE = std::numeric_limits<size_t>::max();
+
+    // vertices closer than this part of the size of the mesh are
+    // at the same position; the generated shapes close their
+    // seams with sines and cosines that are off in the last bits
+    const float WELD_TOLERANCE = 1.0e-4f;
+
+    // new vertices a triangle may cost the cluster to face along
+    // with it rather than across it
+    const float CONE_WEIGHT = 2.0f;
+
+    // a vertex position snapped to the weld grid, and the vertex
+    struct WELD_KEY
+    {
+        int64_t x;
+        int64_t y;
+        int64_t z;
+        uint32_t vertex;
+    };
+
+    /***********************************************************
+     *  WeldPositions()
+     *
+     *  Number the vertices of a mesh by their position on a
+     *  grid, so the copies made for different normals or
+     *  texture coordinates get the number of the first one.
+     ***********************************************************/
+    std::vector<uint32_t> WeldPositions(const MESH_DATA& mesh)
+    {
+        glm::vec3 minPosition(std::numeric_limits<float>::max());
+        glm::vec3 maxPosition(-std::numeric_limits<float>::max());
+        for (const auto& vertex : mesh.vertices)
+        {
+            minPosition = glm::min(minPosition, vertex.position);
+            maxPosition = glm::max(maxPosition, vertex.position);
+        }
+        const glm::vec3 extent = maxPosition - minPosition;
+        const float step = std::max(std::max(extent.x, std::max(extent.y, extent.z)) * WELD_TOLERANCE,
+                                    std::numeric_limits<float>::min());
+
+        std::vector<WELD_KEY> keys(mesh.vertices.size());
+        for (size_t v = 0; v < keys.size(); ++v)
+        {
+            const glm::vec3 cell = (mesh.vertices[v].position - minPosition) / step;
+            keys[v].x = static_cast<int64_t>(std::floor(cell.x + 0.5f));
+            keys[v].y = static_cast<int64_t>(std::floor(cell.y + 0.5f));
+            keys[v].z = static_cast<int64_t>(std::floor(cell.z + 0.5f));
+            keys[v].vertex = static_cast<uint32_t>(v);
+        }
+        const auto isSamePosition = [](const WELD_KEY& a, const WELD_KEY& b)
+        {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        };
+        std::sort(keys.begin(), keys.end(), [](const WELD_KEY& a, const WELD_KEY& b)
+        {
+            if (a.x != b.x)
+            {
+                return a.x < b.x;
+            }
+            if (a.y != b.y)
+            {
+                return a.y < b.y;
+            }
+            if (a.z != b.z)
+            {
+                return a.z < b.z;
+            }
+            return a.vertex < b.vertex;
+        });
+
+        std::vector<uint32_t> welded(mesh.vertices.size());
+        uint32_t first = 0;
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            if (i == 0 || !isSamePosition(keys[i - 1], keys[i]))
+            {
+                first = keys[i].vertex;
+            }
+            welded[keys[i].vertex] = first;
+        }
+        return welded;
+    }
+
+    /***********************************************************
+     *  IsClosed()
+     *
+     *  Check the edges of a mesh between welded vertices.
+     ***********************************************************/
+    bool IsClosed(const MESH_DATA& mesh, const std::vector<uint32_t>& welded)
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(mesh.indices.size());
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const uint64_t from = welded[mesh.indices[i + k]];
+                const uint64_t to = welded[mesh.indices[i + (k + 1) % 3]];
+                if (from != to)
+                {
+                    edges.push_back((from << 32) | to);
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (const uint64_t edge : edges)
+        {
+            const uint64_t reversed = (edge << 32) | (edge >> 32);
+            if (!std::binary_search(edges.begin(), edges.end(), reversed))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+/***********************************************************
+ *  IsClosedMesh()
+ *
+ *  This function is used to check a mesh for holes. Every
+ *  edge of a closed, consistently wound mesh is walked once
+ *  in each direction by the two triangles sharing it. Edges
+ *  collapsed to a point, like the ones at the poles of a
+ *  sphere, are ignored.
+ ***********************************************************/
+bool IsClosedMesh(const MESH_DATA& mesh)
+{
+    return IsClosed(mesh, WeldPositions(mesh));
+}
+
+/***********************************************************
+ *  BuildMeshlets()
+ *
+ *  This function is used to grow the clusters greedily. A
+ *  cluster starts at the first free triangle of the current
+ *  order and takes, one at a time, the free neighbor that
+ *  adds the fewest new vertices and turns least away from
+ *  the normals it already has, until it is full or no
+ *  neighbor fits. Neighbors are found by position, so a
+ *  cluster grows over the seams of the normals and texture
+ *  coordinates; a shape that fits in one cluster stays
+ *  whole. Compact clusters keep the bounding spheres
+ *  small, and similar normals keep the cones narrow, which
+ *  is what lets the culling drop them.
+ ***********************************************************/
+void BuildMeshlets(
+    MESH_DATA& mesh,
+    std::vector<MESHLET>& meshlets,
+    unsigned maxVertices,
+    unsigned maxTriangles)
+{
+    meshlets.clear();
+
+    const size_t triangleCount = mesh.indices.size() / 3;
+    const size_t vertexCount = mesh.vertices.size();
+    if (triangleCount == 0)
+    {
+        return;
+    }
+    maxVertices = std::max(maxVertices, 3u);
+    maxTriangles = std::max(maxTriangles, 1u);
+
+    // the back of the triangles of an open mesh may be seen
+    // through its holes, so its clusters get no cones
+    const std::vector<uint32_t> welded = WeldPositions(mesh);
+    const bool bClosed = IsClosed(mesh, welded);
+
+    // triangles using each welded vertex
+    std::vector<size_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; ++i)
+    {
+        ++adjacencyOffsets[welded[mesh.indices[i]] + 1];
+    }
+    for (size_t v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+    std::vector<size_t> adjacency(triangleCount * 3);
+    {
+        std::vector<size_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+        {
+            adjacency[fill[welded[mesh.indices[i]]]++] = i / 3;
+        }
+    }
+
+    // unit normal of each triangle, zero when it has no area
+    std::vector<glm::vec3> normals(triangleCount);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const glm::vec3& p0 = mesh.vertices[mesh.indices[t * 3]].position;
+        const glm::vec3& p1 = mesh.vertices[mesh.indices[t * 3 + 1]].position;
+        const glm::vec3& p2 = mesh.vertices[mesh.indices[t * 3 + 2]].position;
+        const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+        const float length = glm::length(areaNormal);
+        normals[t] = (length > 0.0f) ? areaNormal / length : glm::vec3(0.0f);
+    }
+
+    std::vector<unsigned char> bUsed(triangleCount, 0);
+    // 1 + the cluster a vertex was last added to
+    std::vector<uint32_t> vertexCluster(vertexCount, 0);
+    std::vector<size_t> triangles;
+    std::vector<size_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    size_t nextSeed = 0;
+
+    for (;;)
+    {
+        while (nextSeed < triangleCount && bUsed[nextSeed])
+        {
+            ++nextSeed;
+        }
+        if (nextSeed == triangleCount)
+        {
+            break;
+        }
+
+        const uint32_t cluster = static_cast<uint32_t>(meshlets.size()) + 1;
+        unsigned clusterVertices = 0;
+        glm::vec3 normalSum(0.0f);
+        triangles.clear();
+        candidates.clear();
+
+        size_t next = nextSeed;
+        while (next != NO_TRIANGLE)
+        {
+            bUsed[next] = 1;
+            triangles.push_back(next);
+            normalSum += normals[next];
+            for (int k = 0; k < 3; ++k)
+            {
+                const uint32_t vertex = mesh.indices[next * 3 + k];
+                if (vertexCluster[vertex] != cluster)
+                {
+                    vertexCluster[vertex] = cluster;
+                    ++clusterVertices;
+                    candidates.insert(candidates.end(),
+                                      adjacency.begin() + adjacencyOffsets[welded[vertex]],
+                                      adjacency.begin() + adjacencyOffsets[welded[vertex] + 1]);
+                }
+            }
+            if (triangles.size() == maxTriangles)
+            {
+                break;
+            }
+
+            // the used triangles are dropped from the candidates
+            // on the way
+            next = NO_TRIANGLE;
+            float bestCost = std::numeric_limits<float>::max();
+            const float normalLength = glm::length(normalSum);
+            const glm::vec3 axis = (normalLength > 0.0f) ? normalSum / normalLength : glm::vec3(0.0f);
+            size_t keptCount = 0;
+            for (const size_t candidate : candidates)
+            {
+                if (bUsed[candidate])
+                {
+                    continue;
+                }
+                candidates[keptCount++] = candidate;
+
+                unsigned newVertices = 0;
+                for (int k = 0; k < 3; ++k)
+                {
+                    newVertices += (vertexCluster[mesh.indices[candidate * 3 + k]] != cluster) ? 1 : 0;
+                }
+                if (clusterVertices + newVertices > maxVertices)
+                {
+                    continue;
+                }
+                const float cost = newVertices + CONE_WEIGHT * (1.0f - glm::dot(normals[candidate], axis));
+                if (cost < bestCost)
+                {
+                    next = candidate;
+                    bestCost = cost;
+                }
+            }
+            candidates.resize(keptCount);
+        }
+
+        MESHLET meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(output.size());
+        meshlet.indexCount = static_cast<uint32_t>(triangles.size() * 3);
+        meshlet.vertexCount = clusterVertices;
+        for (const size_t triangle : triangles)
+        {
+            output.insert(output.end(), &mesh.indices[triangle * 3], &mesh.indices[triangle * 3] + 3);
+        }
+        OptimizeVertexCache(&output[meshlet.firstIndex], meshlet.indexCount, vertexCount);
+
+        // the sphere around the box of the vertices
+        glm::vec3 minPosition(std::numeric_limits<float>::max());
+        glm::vec3 maxPosition(-std::numeric_limits<float>::max());
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+        {
+            minPosition = glm::min(minPosition, mesh.vertices[output[i]].position);
+            maxPosition = glm::max(maxPosition, mesh.vertices[output[i]].position);
+        }
+        const glm::vec3 center = (minPosition + maxPosition) * 0.5f;
+        float radius = 0.0f;
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; ++i)
+        {
+            radius = std::max(radius, glm::length(mesh.vertices[output[i]].position - center));
+        }
+        meshlet.bounds = glm::vec4(center, radius);
+
+        // the cone around the normals; triangles without area
+        // face nowhere and do not widen it
+        meshlet.coneAxis = glm::vec3(0.0f);
+        meshlet.coneCutoff = 0.0f;
+        const float normalLength = glm::length(normalSum);
+        if (bClosed && normalLength > 0.0f)
+        {
+            const glm::vec3 axis = normalSum / normalLength;
+            float cutoff = 1.0f;
+            for (const size_t triangle : triangles)
+            {
+                if (normals[triangle] != glm::vec3(0.0f))
+                {
+                    cutoff = std::min(cutoff, glm::dot(axis, normals[triangle]));
+                }
+            }
+            // at 90 degrees or more some view sees the front of a
+            // triangle from anywhere
+            if (cutoff > 0.0f)
+            {
+                meshlet.coneAxis = axis;
+                meshlet.coneCutoff = cutoff;
+            }
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    mesh.indices.swap(output);
+    OptimizeVertexFetch(mesh);
+}
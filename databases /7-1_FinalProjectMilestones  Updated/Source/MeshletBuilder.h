@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshletbuilder.h
+// ============
+// split meshes into small clusters of triangles with a bounding sphere and
+// a normal cone, so whole clusters can be culled before they are drawn
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshData.h"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// default cluster limits, the sizes that fit the output of one
+// mesh shader work group on most hardware
+const unsigned MESHLET_MAX_VERTICES = 64;
+const unsigned MESHLET_MAX_TRIANGLES = 124;
+
+// a cluster of triangles, stored as a run of the index list of
+// the mesh it was built from
+struct MESHLET
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // different vertices used by the triangles
+    uint32_t vertexCount;
+    // model space bounding sphere, center and radius
+    glm::vec4 bounds;
+    // normalized average of the triangle normals, and the cosine
+    // of the widest angle between it and any of them. A zero axis
+    // means the cluster cannot be culled by the direction it
+    // faces: its normals spread over more than a hemisphere, or
+    // the back of its triangles can be seen through an open mesh
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+// whether every edge of a mesh is shared with a triangle wound the
+// other way, comparing vertices by position so the seams of the
+// normals and texture coordinates do not count as holes
+bool IsClosedMesh(const MESH_DATA& mesh);
+
+// group the triangles of a mesh into clusters of connected
+// triangles that face the same way, and store the index list
+// cluster by cluster, each one ordered for the vertex cache. The
+// vertices are renumbered in the order the new list uses them
+void BuildMeshlets(
+    MESH_DATA& mesh,
+    std::vector<MESHLET>& meshlets,
+    unsigned maxVertices = MESHLET_MAX_VERTICES,
+    unsigned maxTriangles = MESHLET_MAX_TRIANGLES);
@@ -0,0 +1,428 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiviewrenderer.cpp
+// ============
+// draw the scene from many cameras at once into the layers of an array
+// texture or the tiles of one texture
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MultiViewRenderer.h"
+#include "SceneManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declare the global variables
+namespace
+{
+    // uniform of the multi-view vertex shader holding the view
+    // of instance 0
+    const char* const g_FirstViewName = "firstView";
+}
+
+/***********************************************************
+ *  MultiViewRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MultiViewRenderer::MultiViewRenderer()
+    : m_target(MULTI_VIEW_LAYERS),
+      m_bSinglePass(false),
+      m_bCreated(false),
+      m_framebuffer(0),
+      m_readFramebuffer(0),
+      m_colorTexture(0),
+      m_depthTexture(0),
+      m_depthBuffer(0),
+      m_cameraBuffer(0),
+      m_viewWidth(0),
+      m_viewHeight(0),
+      m_viewCount(0),
+      m_tileColumns(1),
+      m_tileRows(1),
+      m_program(0),
+      m_firstViewLocation(-1),
+      m_drawCallCount(0)
+{
+    m_packet.frameIndex = 0;
+}
+
+/***********************************************************
+ *  ~MultiViewRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MultiViewRenderer::~MultiViewRenderer()
+{
+    Destroy();
+}
+
+/***********************************************************
+ *  IsSinglePassSupported()
+ *
+ *  This method is used to check if the vertex shader can
+ *  select the layer and viewport of each instance.
+ ***********************************************************/
+bool MultiViewRenderer::IsSinglePassSupported()
+{
+    return GLEW_VERSION_4_1 && GLEW_ARB_shader_viewport_layer_array;
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used to create the target for a number of
+ *  views. Layered attachments are only used in a single
+ *  pass; otherwise one layer is attached at a time.
+ ***********************************************************/
+bool MultiViewRenderer::Create(int viewWidth, int viewHeight, int viewCount, MULTI_VIEW_TARGET target)
+{
+    Destroy();
+
+    if (viewWidth <= 0 || viewHeight <= 0 || viewCount <= 0)
+    {
+        return false;
+    }
+
+    m_target = target;
+    m_bSinglePass = IsSinglePassSupported();
+    m_viewWidth = viewWidth;
+    m_viewHeight = viewHeight;
+    m_viewCount = std::min(viewCount, static_cast<int>(MAX_SHADER_VIEWS));
+    m_tileColumns = 1;
+    m_tileRows = 1;
+    if (MULTI_VIEW_TILES == m_target)
+    {
+        // as square a sheet as the view count allows
+        m_tileColumns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(m_viewCount))));
+        m_tileRows = (m_viewCount + m_tileColumns - 1) / m_tileColumns;
+    }
+    m_bCreated = true;
+
+    // the scene keeps its textures bound across frames, so the
+    // bindings of the active unit are put back afterwards
+    GLint texture = 0;
+    GLint arrayTexture = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &texture);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &arrayTexture);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glGenFramebuffers(1, &m_readFramebuffer);
+    glGenBuffers(1, &m_cameraBuffer);
+    glGenTextures(1, &m_colorTexture);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+
+    if (MULTI_VIEW_LAYERS == m_target)
+    {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_colorTexture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, m_viewWidth, m_viewHeight, m_viewCount,
+                     0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // a layered framebuffer needs layered depth as well
+        glGenTextures(1, &m_depthTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_depthTexture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, m_viewWidth, m_viewHeight, m_viewCount,
+                     0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        if (m_bSinglePass)
+        {
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0);
+        }
+        else
+        {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0, 0);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, 0);
+        }
+    }
+    else
+    {
+        const int sheetWidth = m_viewWidth * m_tileColumns;
+        const int sheetHeight = m_viewHeight * m_tileRows;
+
+        glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, sheetWidth, sheetHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glGenRenderbuffers(1, &m_depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, sheetWidth, sheetHeight);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+    }
+
+    const bool bComplete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(texture));
+    glBindTexture(GL_TEXTURE_2D_ARRAY, static_cast<GLuint>(arrayTexture));
+
+    if (!bComplete)
+    {
+        std::cout << "ERROR: Could not create the multi-view target" << std::endl;
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used to delete all OpenGL objects.
+ ***********************************************************/
+void MultiViewRenderer::Destroy()
+{
+    if (!m_bCreated)
+    {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &m_framebuffer);
+    glDeleteFramebuffers(1, &m_readFramebuffer);
+    glDeleteTextures(1, &m_colorTexture);
+    glDeleteTextures(1, &m_depthTexture);
+    glDeleteRenderbuffers(1, &m_depthBuffer);
+    glDeleteBuffers(1, &m_cameraBuffer);
+
+    m_framebuffer = 0;
+    m_readFramebuffer = 0;
+    m_colorTexture = 0;
+    m_depthTexture = 0;
+    m_depthBuffer = 0;
+    m_cameraBuffer = 0;
+    m_viewCount = 0;
+    m_program = 0;
+    m_firstViewLocation = -1;
+    m_bCreated = false;
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used to draw the scene for each camera.
+ *  The draw list is built once for all of them; in a single
+ *  pass it is also submitted once, with one instance per
+ *  view, otherwise once per view.
+ ***********************************************************/
+void MultiViewRenderer::Render(SceneManager* pSceneManager, const MULTI_VIEW_CAMERA* pCameras, int cameraCount)
+{
+    m_drawCallCount = 0;
+
+    const int viewCount = std::min(cameraCount, m_viewCount);
+    if (!m_bCreated || pSceneManager == nullptr || viewCount <= 0)
+    {
+        return;
+    }
+
+    m_viewProjections.resize(viewCount);
+    m_viewPositions.resize(viewCount);
+    for (int i = 0; i < viewCount; ++i)
+    {
+        m_viewProjections[i] = pCameras[i].projection * pCameras[i].view;
+        m_viewPositions[i] = pCameras[i].viewPosition;
+    }
+
+    ++m_packet.frameIndex;
+    m_packet.view = pCameras[0].view;
+    m_packet.projection = pCameras[0].projection;
+    m_packet.viewPosition = pCameras[0].viewPosition;
+    m_packet.viewportSize = glm::vec2(static_cast<float>(m_viewWidth), static_cast<float>(m_viewHeight));
+    pSceneManager->BuildMultiViewPacket(m_packet, m_viewProjections.data(), m_viewPositions.data(), viewCount);
+
+    UploadCameras(pCameras, viewCount);
+    BindShaderBlock();
+
+    GLint viewport[4] = {};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glEnable(GL_DEPTH_TEST);
+
+    if (m_bSinglePass)
+    {
+        for (int view = 0; view < viewCount; ++view)
+        {
+            int x = 0;
+            int y = 0;
+            GetTileOrigin(view, x, y);
+            glViewportIndexedf(static_cast<GLuint>(view),
+                static_cast<float>(x), static_cast<float>(y),
+                static_cast<float>(m_viewWidth), static_cast<float>(m_viewHeight));
+        }
+
+        // clears every layer of a layered target
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glUniform1i(m_firstViewLocation, 0);
+        pSceneManager->SubmitFramePacket(m_packet, viewCount);
+        m_drawCallCount = m_packet.drawCommands.size();
+    }
+    else
+    {
+        if (MULTI_VIEW_TILES == m_target)
+        {
+            glViewport(0, 0, m_viewWidth * m_tileColumns, m_viewHeight * m_tileRows);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+
+        for (int view = 0; view < viewCount; ++view)
+        {
+            if (MULTI_VIEW_LAYERS == m_target)
+            {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0, view);
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, view);
+                glViewport(0, 0, m_viewWidth, m_viewHeight);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            }
+            else
+            {
+                int x = 0;
+                int y = 0;
+                GetTileOrigin(view, x, y);
+                glViewport(x, y, m_viewWidth, m_viewHeight);
+            }
+
+            glUniform1i(m_firstViewLocation, view);
+            pSceneManager->SubmitFramePacket(m_packet);
+            m_drawCallCount += m_packet.drawCommands.size();
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // sets every viewport back to the one of the caller
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+/***********************************************************
+ *  GetImageCount()
+ *  GetImageWidth()
+ *  GetImageHeight()
+ *
+ *  These methods are used to get the images holding the
+ *  views: the layers, or the sheet of tiles.
+ ***********************************************************/
+int MultiViewRenderer::GetImageCount() const
+{
+    if (!m_bCreated)
+    {
+        return 0;
+    }
+    return MULTI_VIEW_LAYERS == m_target ? m_viewCount : 1;
+}
+
+int MultiViewRenderer::GetImageWidth() const
+{
+    return MULTI_VIEW_LAYERS == m_target ? m_viewWidth : m_viewWidth * m_tileColumns;
+}
+
+int MultiViewRenderer::GetImageHeight() const
+{
+    return MULTI_VIEW_LAYERS == m_target ? m_viewHeight : m_viewHeight * m_tileRows;
+}
+
+/***********************************************************
+ *  BindImageForReading()
+ *
+ *  This method is used to bind a layer, or the sheet of
+ *  tiles, as the read framebuffer.
+ ***********************************************************/
+void MultiViewRenderer::BindImageForReading(int image)
+{
+    if (!m_bCreated || image < 0 || image >= GetImageCount())
+    {
+        return;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_readFramebuffer);
+    if (MULTI_VIEW_LAYERS == m_target)
+    {
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_colorTexture, 0, image);
+    }
+    else
+    {
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+}
+
+/***********************************************************
+ *  UploadCameras()
+ *
+ *  This method is used to write the cameras into the buffer
+ *  behind the MultiViewData block.
+ ***********************************************************/
+void MultiViewRenderer::UploadCameras(const MULTI_VIEW_CAMERA* pCameras, int viewCount)
+{
+    MULTI_VIEW_DATA_BLOCK cameraData = {};
+    for (int i = 0; i < viewCount; ++i)
+    {
+        cameraData.viewProjection[i] = m_viewProjections[i];
+        cameraData.viewPosition[i] = glm::vec4(pCameras[i].viewPosition, 1.0f);
+    }
+
+    // respecify the whole store so the driver can hand out fresh
+    // memory instead of waiting for the previous pass
+    glBindBuffer(GL_UNIFORM_BUFFER, m_cameraBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(cameraData), &cameraData, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MULTI_VIEW_DATA_BINDING, m_cameraBuffer);
+}
+
+/***********************************************************
+ *  BindShaderBlock()
+ *
+ *  This method is used to connect the MultiViewData block of
+ *  the program in use to its binding point, and to look up
+ *  the first view uniform, once per program.
+ ***********************************************************/
+void MultiViewRenderer::BindShaderBlock()
+{
+    GLint program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+    if (static_cast<GLuint>(program) == m_program)
+    {
+        return;
+    }
+
+    m_program = static_cast<GLuint>(program);
+    m_firstViewLocation = glGetUniformLocation(m_program, g_FirstViewName);
+
+    GLuint blockIndex = glGetUniformBlockIndex(m_program, MULTI_VIEW_DATA_BLOCK_NAME);
+    if (GL_INVALID_INDEX == blockIndex)
+    {
+        std::cout << "Shader program has no " << MULTI_VIEW_DATA_BLOCK_NAME << " block" << std::endl;
+        return;
+    }
+    glUniformBlockBinding(m_program, blockIndex, MULTI_VIEW_DATA_BINDING);
+}
+
+/***********************************************************
+ *  GetTileOrigin()
+ *
+ *  This method is used to get the lower left corner of the
+ *  tile of a view; the tiles are filled row by row from the
+ *  top left, like reading a contact sheet. Layers all start
+ *  at the origin.
+ ***********************************************************/
+void MultiViewRenderer::GetTileOrigin(int view, int& x, int& y) const
+{
+    if (MULTI_VIEW_LAYERS == m_target)
+    {
+        x = 0;
+        y = 0;
+        return;
+    }
+
+    x = (view % m_tileColumns) * m_viewWidth;
+    y = (m_tileRows - 1 - view / m_tileColumns) * m_viewHeight;
+}
@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiviewrenderer.h
+// ============
+// draw the scene from many cameras at once into the layers of an array
+// texture or the tiles of one texture
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FramePacket.h"
+#include "ShaderBlocks.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+class SceneManager;
+
+// where the views of a multi-view pass are drawn to
+enum MULTI_VIEW_TARGET
+{
+    // one layer of a 2D array texture per view
+    MULTI_VIEW_LAYERS = 0,
+    // one viewport per view, tiled over a single 2D texture
+    MULTI_VIEW_TILES
+};
+
+// one camera of a multi-view pass
+struct MULTI_VIEW_CAMERA
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 viewPosition;
+};
+
+/***********************************************************
+ *  MultiViewRenderer
+ *
+ *  This class draws the scene from up to MAX_SHADER_VIEWS
+ *  cameras, such as a set of thumbnails, without repeating
+ *  the frame work per camera. One draw list is culled to
+ *  the union of the frusta and submitted once; every draw
+ *  call has one instance per view, and the multi-view
+ *  vertex shader sends each instance to the layer and
+ *  viewport of its view with gl_Layer and gl_ViewportIndex.
+ *
+ *  Writing those from the vertex shader needs
+ *  ARB_shader_viewport_layer_array. Without it the same
+ *  shaders still work, but the draw list is submitted once
+ *  per view.
+ *
+ *  The multi-view shaders must be in use while Render() is
+ *  called, on the thread that owns the OpenGL context.
+ ***********************************************************/
+class MultiViewRenderer
+{
+public:
+    // constructor
+    MultiViewRenderer();
+    // destructor
+    ~MultiViewRenderer();
+
+    // true when all views can be drawn in a single pass
+    static bool IsSinglePassSupported();
+
+    // create the target for a number of views of one size
+    bool Create(int viewWidth, int viewHeight, int viewCount, MULTI_VIEW_TARGET target);
+    // delete the target and the camera buffer
+    void Destroy();
+
+    // cull, build and draw the scene for each camera into the
+    // view of the same index; the default framebuffer is bound
+    // again afterwards
+    void Render(SceneManager* pSceneManager, const MULTI_VIEW_CAMERA* pCameras, int cameraCount);
+
+    // images holding the views: one per layer, or the single
+    // texture all tiles are on
+    int GetImageCount() const;
+    int GetImageWidth() const;
+    int GetImageHeight() const;
+    // bind an image as the read framebuffer, for glReadPixels
+    void BindImageForReading(int image);
+
+    GLuint GetColorTexture() const { return m_colorTexture; }
+    int GetViewCount() const { return m_viewCount; }
+    bool IsSinglePass() const { return m_bSinglePass; }
+    // draw calls of the last Render()
+    size_t GetDrawCallCount() const { return m_drawCallCount; }
+
+private:
+    // write the cameras into the MultiViewData block
+    void UploadCameras(const MULTI_VIEW_CAMERA* pCameras, int viewCount);
+    // connect the multi-view block of the program in use
+    void BindShaderBlock();
+    // lower left corner of the tile of a view
+    void GetTileOrigin(int view, int& x, int& y) const;
+
+    MULTI_VIEW_TARGET m_target;
+    bool m_bSinglePass;
+    bool m_bCreated;
+
+    GLuint m_framebuffer;
+    GLuint m_readFramebuffer;
+    GLuint m_colorTexture;
+    // depth array texture for layers, renderbuffer for tiles
+    GLuint m_depthTexture;
+    GLuint m_depthBuffer;
+    GLuint m_cameraBuffer;
+
+    int m_viewWidth;
+    int m_viewHeight;
+    int m_viewCount;
+    int m_tileColumns;
+    int m_tileRows;
+
+    // program the block binding and location belong to
+    GLuint m_program;
+    GLint m_firstViewLocation;
+
+    // draw list shared by all views
+    FRAME_PACKET m_packet;
+    std::vector<glm::mat4> m_viewProjections;
+    std::vector<glm::vec3> m_viewPositions;
+    size_t m_drawCallCount;
+};
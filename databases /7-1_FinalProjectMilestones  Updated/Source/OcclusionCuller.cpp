@@ -0,0 +1,517 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.cpp
+// ============
+// hide the draws behind large occluders, tested against a small depth buffer
+// the occluders are rasterized into on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OcclusionCuller.h"
+#include "PrimitiveMeshes.h"
+#include "SoftwareRasterizer.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define OCCLUSION_HAS_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+// MSVC compiles AVX2 intrinsics without changing the target
+#define OCCLUSION_AVX2_FUNCTION
+#else
+#define OCCLUSION_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+// declare the global variables
+namespace
+{
+    // depth of a pixel no occluder covers
+    const float CLEAR_DEPTH = 1.0f;
+    // most vertices of a triangle clipped by the near plane
+    const int MAX_CLIPPED_VERTICES = 4;
+
+    // a span of pixels of one row of a triangle: the edge
+    // functions and the depth at its first pixel center and
+    // their steps to the next pixel
+    struct SPAN
+    {
+        float edge[3];
+        float edgeStep[3];
+        float depth;
+        float depthStep;
+    };
+
+    /***********************************************************
+     *  RasterizeSpanScalar()
+     *
+     *  Keep the nearer depth in the pixels of a span that are
+     *  inside all three edges.
+     ***********************************************************/
+    void RasterizeSpanScalar(const SPAN& span, int count, float* pDepthRow)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const float offset = static_cast<float>(i);
+            if (span.edge[0] + span.edgeStep[0] * offset > 0.0f &&
+                span.edge[1] + span.edgeStep[1] * offset > 0.0f &&
+                span.edge[2] + span.edgeStep[2] * offset > 0.0f)
+            {
+                const float depth = span.depth + span.depthStep * offset;
+                pDepthRow[i] = std::min(pDepthRow[i], depth);
+            }
+        }
+    }
+
+#ifdef OCCLUSION_HAS_AVX2
+    /***********************************************************
+     *  RasterizeSpanAvx2()
+     *
+     *  Same as RasterizeSpanScalar(), eight pixels at a time;
+     *  the values of each pixel are calculated the same way,
+     *  so both paths write the same depths.
+     ***********************************************************/
+    OCCLUSION_AVX2_FUNCTION
+    void RasterizeSpanAvx2(const SPAN& span, int count, float* pDepthRow)
+    {
+        const __m256 laneOffset = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 edge[3];
+        __m256 edgeStep[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            edge[k] = _mm256_set1_ps(span.edge[k]);
+            edgeStep[k] = _mm256_set1_ps(span.edgeStep[k]);
+        }
+        const __m256 depth = _mm256_set1_ps(span.depth);
+        const __m256 depthStep = _mm256_set1_ps(span.depthStep);
+
+        for (int i = 0; i < count; i += 8)
+        {
+            const __m256 offset = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), laneOffset);
+            __m256 inside = _mm256_cmp_ps(offset, _mm256_set1_ps(static_cast<float>(count)), _CMP_LT_OQ);
+            for (int k = 0; k < 3; ++k)
+            {
+                const __m256 value = _mm256_add_ps(edge[k], _mm256_mul_ps(edgeStep[k], offset));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(value, zero, _CMP_GT_OQ));
+            }
+            if (_mm256_movemask_ps(inside) == 0)
+            {
+                continue;
+            }
+
+            // the row is padded to a multiple of eight pixels, so
+            // the lanes past the span stay inside the buffer
+            const __m256 stored = _mm256_loadu_ps(pDepthRow + i);
+            const __m256 nearer = _mm256_min_ps(stored, _mm256_add_ps(depth, _mm256_mul_ps(depthStep, offset)));
+            _mm256_storeu_ps(pDepthRow + i, _mm256_blendv_ps(stored, nearer, inside));
+        }
+    }
+#endif
+}
+
+/***********************************************************
+ *  OcclusionCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OcclusionCuller::OcclusionCuller()
+    : m_bUseSimd(SoftwareRasterizer::IsSimdSupported()),
+      m_viewProjection(1.0f),
+      m_levelCount(0),
+      m_stats()
+{
+    AllocationScope scope(ALLOCATION_MESHES);
+
+    size_t maxVertexCount = 0;
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        PrimitiveMeshes::GenerateMesh(static_cast<MESH_TYPE>(mesh), m_shapes[mesh]);
+        maxVertexCount = std::max(maxVertexCount, m_shapes[mesh].vertices.size());
+    }
+    m_clipVertices.resize(maxVertexCount);
+
+    m_depthBuffer.assign(static_cast<size_t>(DEPTH_WIDTH) * DEPTH_HEIGHT, CLEAR_DEPTH);
+
+    // levels 1 and up halve the level above them until a single
+    // texel is left
+    m_levelOffsets.assign(1, 0);
+    m_levelWidths.assign(1, static_cast<int>(DEPTH_WIDTH));
+    m_levelHeights.assign(1, static_cast<int>(DEPTH_HEIGHT));
+    size_t texelCount = 0;
+    while (m_levelWidths.back() > 1 || m_levelHeights.back() > 1)
+    {
+        const int width = std::max(m_levelWidths.back() / 2, 1);
+        const int height = std::max(m_levelHeights.back() / 2, 1);
+        m_levelOffsets.push_back(texelCount);
+        m_levelWidths.push_back(width);
+        m_levelHeights.push_back(height);
+        texelCount += static_cast<size_t>(width) * height;
+    }
+    m_levelCount = static_cast<int>(m_levelWidths.size());
+    m_nearestDepth.assign(texelCount, CLEAR_DEPTH);
+    m_farthestDepth.assign(texelCount, CLEAR_DEPTH);
+}
+
+/***********************************************************
+ *  SetUseSimd()
+ *
+ *  Use the AVX2 path when the processor supports it.
+ ***********************************************************/
+void OcclusionCuller::SetUseSimd(bool bUseSimd)
+{
+    m_bUseSimd = bUseSimd && SoftwareRasterizer::IsSimdSupported();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used to clear the depth buffer and to
+ *  start timing the occluders of a frame.
+ ***********************************************************/
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+    m_frameStart = std::chrono::high_resolution_clock::now();
+    m_viewProjection = viewProjection;
+    std::fill(m_depthBuffer.begin(), m_depthBuffer.end(), CLEAR_DEPTH);
+}
+
+/***********************************************************
+ *  RasterizeOccluder()
+ *
+ *  This method is used to transform the vertices of a shape
+ *  to clip space and draw each of its triangles.
+ ***********************************************************/
+void OcclusionCuller::RasterizeOccluder(MESH_TYPE mesh, const glm::mat4& model)
+{
+    const MESH_DATA& shape = m_shapes[mesh];
+    const glm::mat4 modelViewProjection = m_viewProjection * model;
+    for (size_t i = 0; i < shape.vertices.size(); ++i)
+    {
+        m_clipVertices[i] = modelViewProjection * glm::vec4(shape.vertices[i].position, 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < shape.indices.size(); i += 3)
+    {
+        ClipTriangle(m_clipVertices[shape.indices[i]],
+                     m_clipVertices[shape.indices[i + 1]],
+                     m_clipVertices[shape.indices[i + 2]]);
+    }
+
+    ++m_stats.occluders;
+    m_stats.occluderTriangles += shape.indices.size() / 3;
+}
+
+/***********************************************************
+ *  ClipTriangle()
+ *
+ *  This method is used to cut a clip space triangle at the
+ *  near plane and draw the polygon that is in front of it
+ *  as a fan. The sides are left to the pixel bounds, since
+ *  every vertex in front of the near plane has a positive w.
+ ***********************************************************/
+void OcclusionCuller::ClipTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2)
+{
+    const glm::vec4 input[3] = { v0, v1, v2 };
+    glm::vec4 clipped[MAX_CLIPPED_VERTICES];
+    int clippedCount = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const glm::vec4& a = input[i];
+        const glm::vec4& b = input[(i + 1) % 3];
+        // distances to the near plane, z = -w
+        const float distanceA = a.z + a.w;
+        const float distanceB = b.z + b.w;
+        if (distanceA >= 0.0f)
+        {
+            clipped[clippedCount++] = a;
+        }
+        if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+        {
+            clipped[clippedCount++] = a + (b - a) * (distanceA / (distanceA - distanceB));
+        }
+    }
+    if (clippedCount < 3)
+    {
+        return;
+    }
+
+    SCREEN_VERTEX screen[MAX_CLIPPED_VERTICES];
+    for (int i = 0; i < clippedCount; ++i)
+    {
+        const float invW = 1.0f / clipped[i].w;
+        screen[i].x = (clipped[i].x * invW * 0.5f + 0.5f) * DEPTH_WIDTH;
+        screen[i].y = (clipped[i].y * invW * 0.5f + 0.5f) * DEPTH_HEIGHT;
+        screen[i].z = clipped[i].z * invW * 0.5f + 0.5f;
+    }
+    for (int i = 1; i + 1 < clippedCount; ++i)
+    {
+        RasterizeTriangle(screen[0], screen[i], screen[i + 1]);
+    }
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used to keep the nearer depth in every
+ *  pixel whose center is strictly inside a front facing
+ *  triangle. The back faces of the closed shapes are behind
+ *  their front faces, so they are skipped.
+ ***********************************************************/
+void OcclusionCuller::RasterizeTriangle(const SCREEN_VERTEX& v0, const SCREEN_VERTEX& v1, const SCREEN_VERTEX& v2)
+{
+    const float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (!(area > 0.0f))
+    {
+        return;
+    }
+
+    // pixels whose centers may be inside the triangle
+    const int minX = std::max(static_cast<int>(std::ceil(std::min(v0.x, std::min(v1.x, v2.x)) - 0.5f)), 0);
+    const int maxX = std::min(static_cast<int>(std::floor(std::max(v0.x, std::max(v1.x, v2.x)) - 0.5f)), DEPTH_WIDTH - 1);
+    const int minY = std::max(static_cast<int>(std::ceil(std::min(v0.y, std::min(v1.y, v2.y)) - 0.5f)), 0);
+    const int maxY = std::min(static_cast<int>(std::floor(std::max(v0.y, std::max(v1.y, v2.y)) - 0.5f)), DEPTH_HEIGHT - 1);
+    if (minX > maxX || minY > maxY)
+    {
+        return;
+    }
+
+    // edge k is opposite vertex k and positive inside:
+    // value = a * x + b * y + c
+    const SCREEN_VERTEX* pVertices[3] = { &v0, &v1, &v2 };
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    for (int k = 0; k < 3; ++k)
+    {
+        const SCREEN_VERTEX& from = *pVertices[(k + 1) % 3];
+        const SCREEN_VERTEX& to = *pVertices[(k + 2) % 3];
+        edgeA[k] = from.y - to.y;
+        edgeB[k] = to.x - from.x;
+        edgeC[k] = -(edgeA[k] * from.x + edgeB[k] * from.y);
+    }
+
+    // the window depth is linear on the screen; each edge value
+    // over the area is the weight of its opposite vertex
+    const float invArea = 1.0f / area;
+    const float depthA = (edgeA[0] * v0.z + edgeA[1] * v1.z + edgeA[2] * v2.z) * invArea;
+    const float depthB = (edgeB[0] * v0.z + edgeB[1] * v1.z + edgeB[2] * v2.z) * invArea;
+    const float depthC = (edgeC[0] * v0.z + edgeC[1] * v1.z + edgeC[2] * v2.z) * invArea;
+
+    // the spans start on a multiple of eight pixels, so the
+    // loads of the AVX2 path stay inside the row and both paths
+    // step from the same pixel centers
+    const int spanX = minX & ~7;
+    const float centerX = static_cast<float>(spanX) + 0.5f;
+    const int count = maxX - spanX + 1;
+
+    SPAN span;
+    for (int k = 0; k < 3; ++k)
+    {
+        span.edgeStep[k] = edgeA[k];
+    }
+    span.depthStep = depthA;
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        const float centerY = static_cast<float>(y) + 0.5f;
+        for (int k = 0; k < 3; ++k)
+        {
+            span.edge[k] = edgeA[k] * centerX + edgeB[k] * centerY + edgeC[k];
+        }
+        span.depth = depthA * centerX + depthB * centerY + depthC;
+
+        float* pDepthRow = &m_depthBuffer[static_cast<size_t>(y) * DEPTH_WIDTH + spanX];
+#ifdef OCCLUSION_HAS_AVX2
+        if (m_bUseSimd)
+        {
+            RasterizeSpanAvx2(span, count, pDepthRow);
+            continue;
+        }
+#endif
+        RasterizeSpanScalar(span, count, pDepthRow);
+    }
+}
+
+/***********************************************************
+ *  FinishOccluders()
+ *
+ *  This method is used to build each level of the depth
+ *  hierarchy from the nearest and farthest depth of the
+ *  2x2 texels below it, and to start timing the occludee
+ *  tests.
+ ***********************************************************/
+void OcclusionCuller::FinishOccluders()
+{
+    for (int level = 1; level < m_levelCount; ++level)
+    {
+        const int width = m_levelWidths[level];
+        const int height = m_levelHeights[level];
+        const int lastX = m_levelWidths[level - 1] - 1;
+        const int lastY = m_levelHeights[level - 1] - 1;
+        float* pNearest = &m_nearestDepth[m_levelOffsets[level]];
+        float* pFarthest = &m_farthestDepth[m_levelOffsets[level]];
+
+        for (int y = 0; y < height; ++y)
+        {
+            const int y0 = 2 * y;
+            const int y1 = std::min(2 * y + 1, lastY);
+            for (int x = 0; x < width; ++x)
+            {
+                const int x0 = 2 * x;
+                const int x1 = std::min(2 * x + 1, lastX);
+                pNearest[y * width + x] = std::min(
+                    std::min(GetNearestDepth(level - 1, x0, y0), GetNearestDepth(level - 1, x1, y0)),
+                    std::min(GetNearestDepth(level - 1, x0, y1), GetNearestDepth(level - 1, x1, y1)));
+                pFarthest[y * width + x] = std::max(
+                    std::max(GetFarthestDepth(level - 1, x0, y0), GetFarthestDepth(level - 1, x1, y0)),
+                    std::max(GetFarthestDepth(level - 1, x0, y1), GetFarthestDepth(level - 1, x1, y1)));
+            }
+        }
+    }
+
+    m_testStart = std::chrono::high_resolution_clock::now();
+    m_stats.rasterizeTime += std::chrono::duration<double, std::milli>(m_testStart - m_frameStart).count();
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used to test the box around a bounding
+ *  sphere against the depth hierarchy. The test starts on
+ *  the level where its screen rectangle spans at most 2x2
+ *  texels. A box that reaches behind the camera is never
+ *  hidden.
+ ***********************************************************/
+bool OcclusionCuller::IsOccluded(const glm::vec4& sphere)
+{
+    ++m_stats.testedDraws;
+
+    glm::vec2 minPosition(1.0f);
+    glm::vec2 maxPosition(0.0f);
+    float nearestDepth = 1.0f;
+    for (int i = 0; i < 8; ++i)
+    {
+        const glm::vec3 corner = glm::vec3(sphere) + sphere.w * glm::vec3(
+            (i & 1) ? 1.0f : -1.0f,
+            (i & 2) ? 1.0f : -1.0f,
+            (i & 4) ? 1.0f : -1.0f);
+        const glm::vec4 clip = m_viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w <= 0.0f)
+        {
+            return false;
+        }
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        const glm::vec2 position = glm::vec2(ndc) * 0.5f + 0.5f;
+        minPosition = glm::min(minPosition, position);
+        maxPosition = glm::max(maxPosition, position);
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+
+    // pixels the rectangle touches: min x, min y, max x, max y
+    const int rect[4] =
+    {
+        glm::clamp(static_cast<int>(std::floor(minPosition.x * DEPTH_WIDTH)), 0, DEPTH_WIDTH - 1),
+        glm::clamp(static_cast<int>(std::floor(minPosition.y * DEPTH_HEIGHT)), 0, DEPTH_HEIGHT - 1),
+        glm::clamp(static_cast<int>(std::floor(maxPosition.x * DEPTH_WIDTH)), 0, DEPTH_WIDTH - 1),
+        glm::clamp(static_cast<int>(std::floor(maxPosition.y * DEPTH_HEIGHT)), 0, DEPTH_HEIGHT - 1)
+    };
+
+    const int extent = std::max(rect[2] - rect[0], rect[3] - rect[1]) + 1;
+    int level = 0;
+    while ((1 << level) < extent && level + 1 < m_levelCount)
+    {
+        ++level;
+    }
+
+    for (int y = rect[1] >> level; y <= std::min(rect[3] >> level, m_levelHeights[level] - 1); ++y)
+    {
+        for (int x = rect[0] >> level; x <= std::min(rect[2] >> level, m_levelWidths[level] - 1); ++x)
+        {
+            if (!IsRegionOccluded(level, x, y, rect, nearestDepth))
+            {
+                return false;
+            }
+        }
+    }
+
+    ++m_stats.culledDraws;
+    return true;
+}
+
+/***********************************************************
+ *  IsRegionOccluded()
+ *
+ *  This method is used to decide a texel of the hierarchy:
+ *  hidden when all of it is nearer than the object, shown
+ *  when all of it is farther, and otherwise hidden only when
+ *  the texels below it that the rectangle touches are.
+ ***********************************************************/
+bool OcclusionCuller::IsRegionOccluded(int level, int texelX, int texelY,
+                                       const int* pRect, float nearestDepth) const
+{
+    if (nearestDepth > GetFarthestDepth(level, texelX, texelY))
+    {
+        return true;
+    }
+    if (level == 0 || nearestDepth <= GetNearestDepth(level, texelX, texelY))
+    {
+        return false;
+    }
+
+    const int below = level - 1;
+    const int minX = std::max(2 * texelX, pRect[0] >> below);
+    const int minY = std::max(2 * texelY, pRect[1] >> below);
+    const int maxX = std::min(std::min(2 * texelX + 1, pRect[2] >> below), m_levelWidths[below] - 1);
+    const int maxY = std::min(std::min(2 * texelY + 1, pRect[3] >> below), m_levelHeights[below] - 1);
+    for (int y = minY; y <= maxY; ++y)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            if (!IsRegionOccluded(below, x, y, pRect, nearestDepth))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used to add the time of the occludee
+ *  tests to the totals and count the frame.
+ ***********************************************************/
+void OcclusionCuller::EndFrame()
+{
+    const auto now = std::chrono::high_resolution_clock::now();
+    m_stats.testTime += std::chrono::duration<double, std::milli>(now - m_testStart).count();
+    ++m_stats.frames;
+}
+
+/***********************************************************
+ *  GetNearestDepth()
+ *  GetFarthestDepth()
+ *
+ *  Depth range of a texel of a level of the hierarchy.
+ ***********************************************************/
+float OcclusionCuller::GetNearestDepth(int level, int x, int y) const
+{
+    if (level == 0)
+    {
+        return m_depthBuffer[static_cast<size_t>(y) * DEPTH_WIDTH + x];
+    }
+    return m_nearestDepth[m_levelOffsets[level] + static_cast<size_t>(y) * m_levelWidths[level] + x];
+}
+
+float OcclusionCuller::GetFarthestDepth(int level, int x, int y) const
+{
+    if (level == 0)
+    {
+        return m_depthBuffer[static_cast<size_t>(y) * DEPTH_WIDTH + x];
+    }
+    return m_farthestDepth[m_levelOffsets[level] + static_cast<size_t>(y) * m_levelWidths[level] + x];
+}
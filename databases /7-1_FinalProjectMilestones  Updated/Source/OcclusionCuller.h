@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// occlusionculler.h
+// ============
+// hide the draws behind large occluders, tested against a small depth buffer
+// the occluders are rasterized into on the CPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FramePacket.h"
+#include "MeshData.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  OcclusionCuller
+ *
+ *  This class draws the triangles of a few large occluders
+ *  into a low resolution depth buffer, eight pixels at once
+ *  with AVX2 when the processor supports it, and builds a
+ *  hierarchy of the nearest and farthest depth of each 2x2
+ *  block above it. An occludee is tested with the screen
+ *  rectangle and nearest depth of the box around its
+ *  bounding sphere: a texel whose farthest depth is nearer
+ *  hides its part of the rectangle, a texel whose nearest
+ *  depth is farther shows the object, and anything between
+ *  is decided by the texels below it.
+ *
+ *  The depth is sampled at the pixel centers, so an edge of
+ *  an occluder may hide a little more than it covers at the
+ *  full resolution. The culler runs on the thread that
+ *  builds the frames and makes no OpenGL calls.
+ ***********************************************************/
+class OcclusionCuller
+{
+public:
+    // size of the depth buffer
+    static const int DEPTH_WIDTH = 256;
+    static const int DEPTH_HEIGHT = 128;
+
+    // totals since the culler was created
+    struct STATS
+    {
+        uint64_t frames;
+        uint64_t occluders;
+        uint64_t occluderTriangles;
+        // occludees tested and the ones found hidden
+        uint64_t testedDraws;
+        uint64_t culledDraws;
+        // milliseconds spent rasterizing the occluders and
+        // building the hierarchy, and testing the occludees
+        double rasterizeTime;
+        double testTime;
+    };
+
+    OcclusionCuller();
+
+    // use the AVX2 path when supported, on by default
+    void SetUseSimd(bool bUseSimd);
+    bool GetUseSimd() const { return m_bUseSimd; }
+
+    // clear the depth buffer for the camera of a frame
+    void BeginFrame(const glm::mat4& viewProjection);
+    // draw the front faces of a shape into the depth buffer
+    void RasterizeOccluder(MESH_TYPE mesh, const glm::mat4& model);
+    // build the depth hierarchy once the occluders are drawn
+    void FinishOccluders();
+    // whether a world bounding sphere is hidden behind the occluders
+    bool IsOccluded(const glm::vec4& sphere);
+    // add the counts and times of the frame to the totals
+    void EndFrame();
+
+    const STATS& GetStats() const { return m_stats; }
+
+private:
+    // a vertex projected to depth buffer pixels and window depth
+    struct SCREEN_VERTEX
+    {
+        float x;
+        float y;
+        float z;
+    };
+
+    // clip a triangle to the near plane and draw what is left
+    void ClipTriangle(const glm::vec4& v0, const glm::vec4& v1, const glm::vec4& v2);
+    // draw a projected, counter-clockwise triangle
+    void RasterizeTriangle(const SCREEN_VERTEX& v0, const SCREEN_VERTEX& v1, const SCREEN_VERTEX& v2);
+    // whether the part of a pixel rectangle under a texel of a
+    // level is hidden behind its depth
+    bool IsRegionOccluded(int level, int texelX, int texelY,
+                          const int* pRect, float nearestDepth) const;
+
+    // nearest and farthest depth of a texel of a level; level 0
+    // is the depth buffer itself
+    float GetNearestDepth(int level, int x, int y) const;
+    float GetFarthestDepth(int level, int x, int y) const;
+
+    bool m_bUseSimd;
+
+    // the shapes in model space, generated by the constructor
+    MESH_DATA m_shapes[MESH_COUNT];
+    // clip space vertices of the occluder being drawn
+    std::vector<glm::vec4> m_clipVertices;
+
+    glm::mat4 m_viewProjection;
+    // window depth of each pixel, bottom row first
+    std::vector<float> m_depthBuffer;
+    // levels 1 and up of the hierarchy, one after the other, and
+    // the offset and width of each level in them
+    std::vector<float> m_nearestDepth;
+    std::vector<float> m_farthestDepth;
+    std::vector<size_t> m_levelOffsets;
+    std::vector<int> m_levelWidths;
+    std::vector<int> m_levelHeights;
+    int m_levelCount;
+
+    // the frame being culled
+    std::chrono::high_resolution_clock::time_point m_frameStart;
+    std::chrono::high_resolution_clock::time_point m_testStart;
+    STATS m_stats;
+};
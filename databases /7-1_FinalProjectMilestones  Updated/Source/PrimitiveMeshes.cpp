@@ -0,0 +1,873 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.cpp
+// ============
+// generate, optimize and draw the basic shape meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PrimitiveMeshes.h"
+#include "AllocationTracker.h"
+
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+
+// redirects the OpenGL calls below to the capture layer
+#include "GLCaptureCalls.h"
+
+// declare the global variables
+namespace
+{
+    const float PI = 3.14159265358979f;
+
+    // tessellation of the round shapes
+    const int ROUND_SEGMENTS = 36;
+    const int SPHERE_STACKS = 18;
+    const int TORUS_TUBE_SEGMENTS = 18;
+
+    // generic attributes holding the decode values of the current
+    // mesh, see DrawUploadedRange(); no vertex array enables them
+    const GLuint DECODE_SCALE_LOCATION = 3;
+    const GLuint DECODE_OFFSET_LOCATION = 4;
+
+    // torus radii, around the hole and around the tube
+    const float TORUS_MAIN_RADIUS = 1.0f;
+    const float TORUS_TUBE_RADIUS = 0.2f;
+
+    // shape names for the optimization report, indexed by MESH_TYPE
+    const char* const g_MeshNames[MESH_COUNT] =
+    {
+        "box", "plane", "cylinder", "cone", "prism",
+        "pyramid4", "sphere", "tapered cylinder", "torus",
+    };
+
+    /***********************************************************
+     *  AddVertex()
+     *
+     *  Append a vertex and return its index.
+     ***********************************************************/
+    uint32_t AddVertex(MESH_DATA& data, const glm::vec3& position, const glm::vec3& normal, const glm::vec2& uv)
+    {
+        MESH_VERTEX vertex;
+        vertex.position = position;
+        vertex.normal = normal;
+        vertex.uv = uv;
+        data.vertices.push_back(vertex);
+        return static_cast<uint32_t>(data.vertices.size() - 1);
+    }
+
+    /***********************************************************
+     *  AddTriangle()
+     *
+     *  Append a triangle, wound counter-clockwise as seen from
+     *  the side its vertex normals point to. Triangles without
+     *  area, such as the ones at the poles of a sphere, are
+     *  dropped.
+     ***********************************************************/
+    void AddTriangle(MESH_DATA& data, uint32_t a, uint32_t b, uint32_t c)
+    {
+        const MESH_VERTEX& va = data.vertices[a];
+        const MESH_VERTEX& vb = data.vertices[b];
+        const MESH_VERTEX& vc = data.vertices[c];
+        const glm::vec3 faceNormal = glm::cross(vb.position - va.position, vc.position - va.position);
+        if (glm::dot(faceNormal, faceNormal) < 1e-12f)
+        {
+            return;
+        }
+
+        data.indices.push_back(a);
+        if (glm::dot(faceNormal, va.normal + vb.normal + vc.normal) >= 0.0f)
+        {
+            data.indices.push_back(b);
+            data.indices.push_back(c);
+        }
+        else
+        {
+            data.indices.push_back(c);
+            data.indices.push_back(b);
+        }
+    }
+
+    /***********************************************************
+     *  AddQuad()
+     *
+     *  Append two triangles covering the corners a, b, c, d,
+     *  given in order around the quad.
+     ***********************************************************/
+    void AddQuad(MESH_DATA& data, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+    {
+        AddTriangle(data, a, b, c);
+        AddTriangle(data, a, c, d);
+    }
+
+    /***********************************************************
+     *  AddFlatQuad()
+     *
+     *  Append a quad with its own four vertices and one normal.
+     ***********************************************************/
+    void AddFlatQuad(MESH_DATA& data, const glm::vec3& normal,
+                     const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3)
+    {
+        AddQuad(data,
+                AddVertex(data, p0, normal, glm::vec2(0.0f, 0.0f)),
+                AddVertex(data, p1, normal, glm::vec2(1.0f, 0.0f)),
+                AddVertex(data, p2, normal, glm::vec2(1.0f, 1.0f)),
+                AddVertex(data, p3, normal, glm::vec2(0.0f, 1.0f)));
+    }
+
+    /***********************************************************
+     *  AddRevolvedSide()
+     *
+     *  Append the side of a cylinder, cone or tapered cylinder:
+     *  the surface swept by the line from (bottomRadius,
+     *  bottomY) to (topRadius, topY) around the Y axis.
+     ***********************************************************/
+    void AddRevolvedSide(MESH_DATA& data, float bottomRadius, float bottomY, float topRadius, float topY)
+    {
+        // the normal is perpendicular to the swept line
+        const float normalRadial = topY - bottomY;
+        const float normalY = bottomRadius - topRadius;
+        const float normalLength = std::sqrt(normalRadial * normalRadial + normalY * normalY);
+
+        const uint32_t first = static_cast<uint32_t>(data.vertices.size());
+        for (int i = 0; i <= ROUND_SEGMENTS; ++i)
+        {
+            const float u = static_cast<float>(i) / ROUND_SEGMENTS;
+            const float angle = u * 2.0f * PI;
+            const glm::vec3 radial(std::cos(angle), 0.0f, std::sin(angle));
+            const glm::vec3 normal = (radial * normalRadial + glm::vec3(0.0f, normalY, 0.0f)) / normalLength;
+            AddVertex(data, radial * bottomRadius + glm::vec3(0.0f, bottomY, 0.0f), normal, glm::vec2(u, 0.0f));
+            AddVertex(data, radial * topRadius + glm::vec3(0.0f, topY, 0.0f), normal, glm::vec2(u, 1.0f));
+        }
+        for (int i = 0; i < ROUND_SEGMENTS; ++i)
+        {
+            const uint32_t bottom = first + 2 * i;
+            AddQuad(data, bottom, bottom + 2, bottom + 3, bottom + 1);
+        }
+    }
+
+    /***********************************************************
+     *  AddDisk()
+     *
+     *  Append a flat disk around the Y axis, facing up or down.
+     ***********************************************************/
+    void AddDisk(MESH_DATA& data, float radius, float y, bool bFacingUp)
+    {
+        const glm::vec3 normal(0.0f, bFacingUp ? 1.0f : -1.0f, 0.0f);
+        const uint32_t center = AddVertex(data, glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+        for (int i = 0; i <= ROUND_SEGMENTS; ++i)
+        {
+            const float angle = 2.0f * PI * i / ROUND_SEGMENTS;
+            const float x = std::cos(angle);
+            const float z = std::sin(angle);
+            AddVertex(data, glm::vec3(x * radius, y, z * radius), normal,
+                      glm::vec2(0.5f + 0.5f * x, 0.5f + 0.5f * z));
+        }
+        for (int i = 0; i < ROUND_SEGMENTS; ++i)
+        {
+            AddTriangle(data, center, center + 1 + i, center + 2 + i);
+        }
+    }
+
+    /***********************************************************
+     *  GenerateBox()
+     *
+     *  A unit cube centered on the origin, one quad per face.
+     ***********************************************************/
+    void GenerateBox(MESH_DATA& data)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            for (int side = -1; side <= 1; side += 2)
+            {
+                glm::vec3 normal(0.0f);
+                normal[axis] = static_cast<float>(side);
+                glm::vec3 u(0.0f);
+                u[(axis + 1) % 3] = 0.5f;
+                glm::vec3 v(0.0f);
+                v[(axis + 2) % 3] = 0.5f;
+                const glm::vec3 center = normal * 0.5f;
+                AddFlatQuad(data, normal, center - u - v, center + u - v, center + u + v, center - u + v);
+            }
+        }
+    }
+
+    /***********************************************************
+     *  GeneratePlane()
+     *
+     *  A 2 by 2 square in the XZ plane, facing up.
+     ***********************************************************/
+    void GeneratePlane(MESH_DATA& data)
+    {
+        AddFlatQuad(data, glm::vec3(0.0f, 1.0f, 0.0f),
+                    glm::vec3(-1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f),
+                    glm::vec3(1.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, -1.0f));
+    }
+
+    /***********************************************************
+     *  GeneratePrism()
+     *
+     *  A triangular prism in the unit cube: the triangle lies in
+     *  the XY plane and is extruded along Z.
+     ***********************************************************/
+    void GeneratePrism(MESH_DATA& data)
+    {
+        const glm::vec3 corners[3] =
+        {
+            glm::vec3(-0.5f, -0.5f, 0.0f), glm::vec3(0.5f, -0.5f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f),
+        };
+        const glm::vec3 front(0.0f, 0.0f, 0.5f);
+
+        for (int side = -1; side <= 1; side += 2)
+        {
+            const glm::vec3 normal(0.0f, 0.0f, static_cast<float>(side));
+            AddTriangle(data,
+                        AddVertex(data, corners[0] + front * static_cast<float>(side), normal, glm::vec2(0.0f, 0.0f)),
+                        AddVertex(data, corners[1] + front * static_cast<float>(side), normal, glm::vec2(1.0f, 0.0f)),
+                        AddVertex(data, corners[2] + front * static_cast<float>(side), normal, glm::vec2(0.5f, 1.0f)));
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            const glm::vec3& a = corners[i];
+            const glm::vec3& b = corners[(i + 1) % 3];
+            const glm::vec3 edge = b - a;
+            const glm::vec3 normal = glm::normalize(glm::vec3(edge.y, -edge.x, 0.0f));
+            AddFlatQuad(data, normal, a - front, b - front, b + front, a + front);
+        }
+    }
+
+    /***********************************************************
+     *  GeneratePyramid4()
+     *
+     *  A square pyramid in the unit cube with its apex up.
+     ***********************************************************/
+    void GeneratePyramid4(MESH_DATA& data)
+    {
+        const glm::vec3 apex(0.0f, 0.5f, 0.0f);
+        const glm::vec3 base[4] =
+        {
+            glm::vec3(-0.5f, -0.5f, 0.5f), glm::vec3(0.5f, -0.5f, 0.5f),
+            glm::vec3(0.5f, -0.5f, -0.5f), glm::vec3(-0.5f, -0.5f, -0.5f),
+        };
+
+        AddFlatQuad(data, glm::vec3(0.0f, -1.0f, 0.0f), base[0], base[3], base[2], base[1]);
+        for (int i = 0; i < 4; ++i)
+        {
+            const glm::vec3& a = base[i];
+            const glm::vec3& b = base[(i + 1) % 4];
+            const glm::vec3 normal = glm::normalize(glm::cross(b - a, apex - a));
+            AddTriangle(data,
+                        AddVertex(data, a, normal, glm::vec2(0.0f, 0.0f)),
+                        AddVertex(data, b, normal, glm::vec2(1.0f, 0.0f)),
+                        AddVertex(data, apex, normal, glm::vec2(0.5f, 1.0f)));
+        }
+    }
+
+    /***********************************************************
+     *  GenerateSphere()
+     *
+     *  A unit sphere of stacks and segments around the Y axis.
+     ***********************************************************/
+    void GenerateSphere(MESH_DATA& data)
+    {
+        for (int stack = 0; stack <= SPHERE_STACKS; ++stack)
+        {
+            const float v = static_cast<float>(stack) / SPHERE_STACKS;
+            const float polar = v * PI;
+            for (int i = 0; i <= ROUND_SEGMENTS; ++i)
+            {
+                const float u = static_cast<float>(i) / ROUND_SEGMENTS;
+                const float angle = u * 2.0f * PI;
+                const glm::vec3 position(std::sin(polar) * std::cos(angle), std::cos(polar), std::sin(polar) * std::sin(angle));
+                AddVertex(data, position, position, glm::vec2(u, 1.0f - v));
+            }
+        }
+
+        const uint32_t rowSize = ROUND_SEGMENTS + 1;
+        for (int stack = 0; stack < SPHERE_STACKS; ++stack)
+        {
+            for (int i = 0; i < ROUND_SEGMENTS; ++i)
+            {
+                const uint32_t top = stack * rowSize + i;
+                const uint32_t bottom = top + rowSize;
+                AddQuad(data, top, bottom, bottom + 1, top + 1);
+            }
+        }
+    }
+
+    /***********************************************************
+     *  GenerateTorus()
+     *
+     *  A torus lying in the XZ plane around the Y axis.
+     ***********************************************************/
+    void GenerateTorus(MESH_DATA& data)
+    {
+        for (int i = 0; i <= ROUND_SEGMENTS; ++i)
+        {
+            const float u = static_cast<float>(i) / ROUND_SEGMENTS;
+            const float mainAngle = u * 2.0f * PI;
+            const glm::vec3 radial(std::cos(mainAngle), 0.0f, std::sin(mainAngle));
+            for (int j = 0; j <= TORUS_TUBE_SEGMENTS; ++j)
+            {
+                const float v = static_cast<float>(j) / TORUS_TUBE_SEGMENTS;
+                const float tubeAngle = v * 2.0f * PI;
+                const glm::vec3 normal = radial * std::cos(tubeAngle) + glm::vec3(0.0f, std::sin(tubeAngle), 0.0f);
+                AddVertex(data, radial * TORUS_MAIN_RADIUS + normal * TORUS_TUBE_RADIUS, normal, glm::vec2(u, v));
+            }
+        }
+
+        const uint32_t rowSize = TORUS_TUBE_SEGMENTS + 1;
+        for (int i = 0; i < ROUND_SEGMENTS; ++i)
+        {
+            for (int j = 0; j < TORUS_TUBE_SEGMENTS; ++j)
+            {
+                const uint32_t a = i * rowSize + j;
+                const uint32_t b = a + rowSize;
+                AddQuad(data, a, b, b + 1, a + 1);
+            }
+        }
+    }
+}
+
+/***********************************************************
+ *  PrimitiveMeshes()
+ *
+ *  The constructor for the class. No OpenGL calls are made
+ *  until a mesh is loaded.
+ ***********************************************************/
+PrimitiveMeshes::PrimitiveMeshes()
+    : m_optimization(MESH_OPTIMIZE_OVERDRAW),
+      m_vertexFormat(VERTEX_FORMAT_FLOAT),
+      m_currentContext(0)
+{
+    for (auto& gpuMesh : m_meshes)
+    {
+        gpuMesh.vertexArray = 0;
+        gpuMesh.vertexBuffer = 0;
+        gpuMesh.indexBuffer = 0;
+        gpuMesh.indexCount = 0;
+        gpuMesh.bufferBytes = 0;
+    }
+    for (auto& count : m_referenceCounts)
+    {
+        count.store(0);
+    }
+    for (int context = 0; context < MAX_SHARED_CONTEXTS; ++context)
+    {
+        for (auto& vertexArray : m_vertexArrays[context])
+        {
+            vertexArray = 0;
+        }
+        m_bContextInUse[context] = context == 0;
+    }
+}
+
+/***********************************************************
+ *  ~PrimitiveMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PrimitiveMeshes::~PrimitiveMeshes()
+{
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        ReleaseMesh(static_cast<MESH_TYPE>(mesh));
+    }
+}
+
+/***********************************************************
+ *  GetShared()
+ *
+ *  This method is used to get the mesh registry that all
+ *  scene managers draw from, so every shape is uploaded
+ *  once no matter how many scenes use it.
+ ***********************************************************/
+PrimitiveMeshes& PrimitiveMeshes::GetShared()
+{
+    static PrimitiveMeshes sharedMeshes;
+    return sharedMeshes;
+}
+
+/***********************************************************
+ *  AddReference()
+ *
+ *  This method is used to count a user of a shape. Nothing
+ *  is loaded here, since the caller may not own the OpenGL
+ *  context; the shape is loaded when it is first drawn.
+ ***********************************************************/
+void PrimitiveMeshes::AddReference(MESH_TYPE mesh)
+{
+    if (mesh >= 0 && mesh < MESH_COUNT)
+    {
+        m_referenceCounts[mesh].fetch_add(1);
+    }
+}
+
+/***********************************************************
+ *  ReleaseReference()
+ *
+ *  This method is used to drop a user of a shape. The last
+ *  release leaves the shape loaded until the next call of
+ *  UnloadUnreferenced(), so a scene that is replaced by one
+ *  with the same shapes does not upload them again.
+ ***********************************************************/
+void PrimitiveMeshes::ReleaseReference(MESH_TYPE mesh)
+{
+    if (mesh >= 0 && mesh < MESH_COUNT)
+    {
+        m_referenceCounts[mesh].fetch_sub(1);
+    }
+}
+
+/***********************************************************
+ *  GetReferenceCount()
+ *
+ *  This method is used to get the number of users of a
+ *  shape.
+ ***********************************************************/
+int PrimitiveMeshes::GetReferenceCount(MESH_TYPE mesh) const
+{
+    if (mesh < 0 || mesh >= MESH_COUNT)
+    {
+        return 0;
+    }
+    return m_referenceCounts[mesh].load();
+}
+
+/***********************************************************
+ *  RegisterContext()
+ *
+ *  This method is used to reserve the vertex arrays of a
+ *  context created to share the objects of the first one.
+ ***********************************************************/
+int PrimitiveMeshes::RegisterContext()
+{
+    for (int context = 1; context < MAX_SHARED_CONTEXTS; ++context)
+    {
+        if (!m_bContextInUse[context])
+        {
+            m_bContextInUse[context] = true;
+            return context;
+        }
+    }
+    return -1;
+}
+
+/***********************************************************
+ *  ReleaseContext()
+ *
+ *  This method is used to free the slot of a context that
+ *  is destroyed. Its vertex arrays go away with it, so the
+ *  names are only forgotten.
+ ***********************************************************/
+void PrimitiveMeshes::ReleaseContext(int context)
+{
+    if (context <= 0 || context >= MAX_SHARED_CONTEXTS)
+    {
+        return;
+    }
+
+    for (auto& vertexArray : m_vertexArrays[context])
+    {
+        vertexArray = 0;
+    }
+    m_staleVertexArrays[context].clear();
+    m_bContextInUse[context] = false;
+    if (m_currentContext == context)
+    {
+        m_currentContext = 0;
+    }
+}
+
+/***********************************************************
+ *  SetCurrentContext()
+ *
+ *  This method is used to select the vertex arrays used by
+ *  the following draws, after making another context of the
+ *  share group current.
+ ***********************************************************/
+void PrimitiveMeshes::SetCurrentContext(int context)
+{
+    if (context >= 0 && context < MAX_SHARED_CONTEXTS && m_bContextInUse[context])
+    {
+        m_currentContext = context;
+    }
+}
+
+/***********************************************************
+ *  UnloadUnreferenced()
+ *
+ *  This method is used to delete the buffers of the loaded
+ *  shapes that have no users left. A shape that is drawn
+ *  again afterwards, for example from a frame packet built
+ *  before its last user was released, is simply reloaded.
+ ***********************************************************/
+void PrimitiveMeshes::UnloadUnreferenced()
+{
+    AllocationScope scope(ALLOCATION_MESHES);
+
+    DeleteStaleVertexArrays();
+
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        if (m_meshes[mesh].vertexBuffer != 0 && m_referenceCounts[mesh].load() <= 0)
+        {
+            ReleaseMesh(static_cast<MESH_TYPE>(mesh));
+            std::cout << "INFO: Unloaded " << g_MeshNames[mesh] << " mesh" << std::endl;
+        }
+    }
+}
+
+/***********************************************************
+ *  GetLoadedBytes()
+ *
+ *  This method is used to get the video memory used by the
+ *  vertex and index buffers of the loaded shapes.
+ ***********************************************************/
+size_t PrimitiveMeshes::GetLoadedBytes() const
+{
+    size_t bytes = 0;
+    for (const auto& gpuMesh : m_meshes)
+    {
+        bytes += gpuMesh.bufferBytes;
+    }
+    return bytes;
+}
+
+/***********************************************************
+ *  GenerateMesh()
+ *
+ *  This method is used to build the triangle list of one of
+ *  the basic shapes, in the order the generator emits it.
+ ***********************************************************/
+void PrimitiveMeshes::GenerateMesh(MESH_TYPE mesh, MESH_DATA& data)
+{
+    data.vertices.clear();
+    data.indices.clear();
+
+    switch (mesh)
+    {
+    case MESH_BOX:              GenerateBox(data); break;
+    case MESH_PLANE:            GeneratePlane(data); break;
+    case MESH_CYLINDER:
+        AddRevolvedSide(data, 1.0f, 0.0f, 1.0f, 1.0f);
+        AddDisk(data, 1.0f, 1.0f, true);
+        AddDisk(data, 1.0f, 0.0f, false);
+        break;
+    case MESH_CONE:
+        AddRevolvedSide(data, 1.0f, 0.0f, 0.0f, 1.0f);
+        AddDisk(data, 1.0f, 0.0f, false);
+        break;
+    case MESH_PRISM:            GeneratePrism(data); break;
+    case MESH_PYRAMID4:         GeneratePyramid4(data); break;
+    case MESH_SPHERE:           GenerateSphere(data); break;
+    case MESH_TAPERED_CYLINDER:
+        AddRevolvedSide(data, 1.0f, 0.0f, 0.5f, 1.0f);
+        AddDisk(data, 0.5f, 1.0f, true);
+        AddDisk(data, 1.0f, 0.0f, false);
+        break;
+    case MESH_TORUS:            GenerateTorus(data); break;
+    default: break;
+    }
+}
+
+/***********************************************************
+ *  LoadMesh()
+ *
+ *  This method is used to generate a basic shape, reorder it
+ *  for the vertex cache, vertex fetch and overdraw, report
+ *  the cache efficiency before and after, and upload it in
+ *  the selected vertex layout.
+ ***********************************************************/
+bool PrimitiveMeshes::LoadMesh(MESH_TYPE mesh)
+{
+    AllocationScope scope(ALLOCATION_MESHES);
+
+    if (mesh < 0 || mesh >= MESH_COUNT)
+    {
+        return false;
+    }
+    if (m_meshes[mesh].vertexBuffer != 0)
+    {
+        return true;
+    }
+
+    MESH_DATA data;
+    GenerateMesh(mesh, data);
+
+    const VERTEX_CACHE_STATS before = AnalyzeVertexCache(
+        data.indices.data(), data.indices.size(), data.vertices.size());
+    OptimizeMesh(data, m_optimization);
+    const VERTEX_CACHE_STATS after = AnalyzeVertexCache(
+        data.indices.data(), data.indices.size(), data.vertices.size());
+
+    UploadMesh(data, m_vertexFormat, m_meshes[mesh]);
+    m_vertexArrays[m_currentContext][mesh] = m_meshes[mesh].vertexArray;
+
+    std::cout << "INFO: Loaded " << g_MeshNames[mesh] << " mesh, "
+              << data.indices.size() / 3 << " triangles, ACMR "
+              << std::fixed << std::setprecision(3) << before.acmr << " -> " << after.acmr
+              << ", ATVR " << before.atvr << " -> " << after.atvr
+              << std::defaultfloat << ", " << m_meshes[mesh].bufferBytes << " bytes"
+              << (m_vertexFormat == VERTEX_FORMAT_PACKED ? " packed" : "") << std::endl;
+    return true;
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used to draw a basic shape, generating and
+ *  uploading it the first time it is drawn.
+ ***********************************************************/
+void PrimitiveMeshes::DrawMesh(MESH_TYPE mesh, GLsizei instanceCount)
+{
+    if (!LoadMesh(mesh))
+    {
+        return;
+    }
+
+    GPU_MESH gpuMesh = m_meshes[mesh];
+    gpuMesh.vertexArray = GetVertexArray(mesh);
+    DrawUploadedMesh(gpuMesh, instanceCount);
+}
+
+/***********************************************************
+ *  GetVertexArray()
+ *
+ *  This method is used to get the vertex array of a loaded
+ *  shape in the current context. A context that has not
+ *  drawn the shape before gets a new one over the shared
+ *  buffers.
+ ***********************************************************/
+GLuint PrimitiveMeshes::GetVertexArray(MESH_TYPE mesh)
+{
+    DeleteStaleVertexArrays();
+
+    GLuint& vertexArray = m_vertexArrays[m_currentContext][mesh];
+    if (vertexArray == 0)
+    {
+        glGenVertexArrays(1, &vertexArray);
+        glBindVertexArray(vertexArray);
+        SetVertexLayout(m_meshes[mesh]);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    return vertexArray;
+}
+
+/***********************************************************
+ *  ReleaseMesh()
+ *
+ *  This method is used to delete the buffers of a shape. The
+ *  vertex arrays of the other contexts can only be deleted
+ *  while those are current, so they are kept until then.
+ ***********************************************************/
+void PrimitiveMeshes::ReleaseMesh(MESH_TYPE mesh)
+{
+    for (int context = 0; context < MAX_SHARED_CONTEXTS; ++context)
+    {
+        GLuint& vertexArray = m_vertexArrays[context][mesh];
+        if (vertexArray == 0)
+        {
+            continue;
+        }
+        if (context == m_currentContext)
+        {
+            glDeleteVertexArrays(1, &vertexArray);
+        }
+        else
+        {
+            m_staleVertexArrays[context].push_back(vertexArray);
+        }
+        vertexArray = 0;
+    }
+
+    // the vertex array the shape was uploaded with is one of the
+    // above, in the context that loaded it
+    m_meshes[mesh].vertexArray = 0;
+    DeleteUploadedMesh(m_meshes[mesh]);
+}
+
+/***********************************************************
+ *  DeleteStaleVertexArrays()
+ *
+ *  This method is used to delete the vertex arrays of the
+ *  current context whose buffers are gone.
+ ***********************************************************/
+void PrimitiveMeshes::DeleteStaleVertexArrays()
+{
+    std::vector<GLuint>& staleVertexArrays = m_staleVertexArrays[m_currentContext];
+    if (!staleVertexArrays.empty())
+    {
+        glDeleteVertexArrays(static_cast<GLsizei>(staleVertexArrays.size()), staleVertexArrays.data());
+        staleVertexArrays.clear();
+    }
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used to create the vertex array and the
+ *  buffers of a mesh, with the interleaved attributes at the
+ *  locations the scene shaders read them from. The packed
+ *  layout uses normalized integer and half float attributes,
+ *  so the shaders only have to apply the position bounds and
+ *  unfold the normals.
+ ***********************************************************/
+void PrimitiveMeshes::UploadMesh(const MESH_DATA& data, VERTEX_FORMAT format, GPU_MESH& gpuMesh)
+{
+    glGenVertexArrays(1, &gpuMesh.vertexArray);
+    glBindVertexArray(gpuMesh.vertexArray);
+    glGenBuffers(1, &gpuMesh.vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vertexBuffer);
+    glGenBuffers(1, &gpuMesh.indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.indexBuffer);
+
+    gpuMesh.format = format;
+    gpuMesh.indexCount = static_cast<GLsizei>(data.indices.size());
+
+    if (format == VERTEX_FORMAT_PACKED)
+    {
+        PACKED_MESH_DATA packed;
+        PackMesh(data, packed);
+
+        const size_t vertexBytes = packed.vertices.size() * sizeof(PACKED_VERTEX);
+        size_t indexBytes = 0;
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, packed.vertices.data(), GL_STATIC_DRAW);
+        if (!packed.indices16.empty())
+        {
+            indexBytes = packed.indices16.size() * sizeof(uint16_t);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, packed.indices16.data(), GL_STATIC_DRAW);
+            gpuMesh.indexType = GL_UNSIGNED_SHORT;
+        }
+        else
+        {
+            indexBytes = packed.indices32.size() * sizeof(uint32_t);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, packed.indices32.data(), GL_STATIC_DRAW);
+            gpuMesh.indexType = GL_UNSIGNED_INT;
+        }
+        gpuMesh.bufferBytes = vertexBytes + indexBytes;
+        gpuMesh.positionOffset = packed.positionOffset;
+        gpuMesh.positionScale = packed.positionScale;
+    }
+    else
+    {
+        const size_t vertexBytes = data.vertices.size() * sizeof(MESH_VERTEX);
+        const size_t indexBytes = data.indices.size() * sizeof(uint32_t);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, data.vertices.data(), GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, data.indices.data(), GL_STATIC_DRAW);
+        gpuMesh.indexType = GL_UNSIGNED_INT;
+        gpuMesh.bufferBytes = vertexBytes + indexBytes;
+        gpuMesh.positionOffset = glm::vec3(0.0f, 0.0f, 0.0f);
+        gpuMesh.positionScale = glm::vec3(1.0f, 1.0f, 1.0f);
+    }
+
+    SetVertexLayout(gpuMesh);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetVertexLayout()
+ *
+ *  This method is used to bind the buffers of an uploaded
+ *  mesh to the vertex array that is bound, with the
+ *  attributes of its layout.
+ ***********************************************************/
+void PrimitiveMeshes::SetVertexLayout(const GPU_MESH& gpuMesh)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, gpuMesh.vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gpuMesh.indexBuffer);
+
+    if (gpuMesh.format == VERTEX_FORMAT_PACKED)
+    {
+        const GLsizei stride = sizeof(PACKED_VERTEX);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(PACKED_VERTEX, position)));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<const void*>(offsetof(PACKED_VERTEX, normal)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(PACKED_VERTEX, uv)));
+        glEnableVertexAttribArray(2);
+    }
+    else
+    {
+        const GLsizei stride = sizeof(MESH_VERTEX);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(MESH_VERTEX, position)));
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(MESH_VERTEX, normal)));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<const void*>(offsetof(MESH_VERTEX, uv)));
+        glEnableVertexAttribArray(2);
+    }
+}
+
+/***********************************************************
+ *  DrawUploadedMesh()
+ *
+ *  This method is used to draw all indices of an uploaded
+ *  mesh.
+ ***********************************************************/
+void PrimitiveMeshes::DrawUploadedMesh(const GPU_MESH& gpuMesh, GLsizei instanceCount)
+{
+    DrawUploadedRange(gpuMesh, 0, gpuMesh.indexCount, instanceCount);
+}
+
+/***********************************************************
+ *  DrawUploadedRange()
+ *
+ *  This method is used to draw part of the indices of an
+ *  uploaded mesh, such as one batch of merged geometry. The
+ *  decode values are passed as the current values of two
+ *  generic attributes rather than as uniforms, so every scene
+ *  program receives them without knowing which mesh is
+ *  drawn; the w of the scale tells the shaders the normals
+ *  are octahedral.
+ ***********************************************************/
+void PrimitiveMeshes::DrawUploadedRange(const GPU_MESH& gpuMesh, GLsizei firstIndex, GLsizei indexCount,
+                                        GLsizei instanceCount)
+{
+    const float packedNormals = gpuMesh.format == VERTEX_FORMAT_PACKED ? 1.0f : 0.0f;
+    glVertexAttrib4f(DECODE_SCALE_LOCATION,
+                     gpuMesh.positionScale.x, gpuMesh.positionScale.y, gpuMesh.positionScale.z,
+                     packedNormals);
+    glVertexAttrib3f(DECODE_OFFSET_LOCATION,
+                     gpuMesh.positionOffset.x, gpuMesh.positionOffset.y, gpuMesh.positionOffset.z);
+
+    const size_t indexSize = (gpuMesh.indexType == GL_UNSIGNED_SHORT) ? sizeof(uint16_t) : sizeof(uint32_t);
+    const void* pIndices = reinterpret_cast<const void*>(static_cast<size_t>(firstIndex) * indexSize);
+
+    glBindVertexArray(gpuMesh.vertexArray);
+    if (instanceCount > 1)
+    {
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, gpuMesh.indexType, pIndices, instanceCount);
+    }
+    else
+    {
+        glDrawElements(GL_TRIANGLES, indexCount, gpuMesh.indexType, pIndices);
+    }
+    glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  DeleteUploadedMesh()
+ *
+ *  This method is used to delete the buffers of an uploaded
+ *  mesh, if it has any.
+ ***********************************************************/
+void PrimitiveMeshes::DeleteUploadedMesh(GPU_MESH& gpuMesh)
+{
+    if (gpuMesh.vertexArray != 0)
+    {
+        glDeleteVertexArrays(1, &gpuMesh.vertexArray);
+        gpuMesh.vertexArray = 0;
+    }
+    if (gpuMesh.vertexBuffer != 0)
+    {
+        glDeleteBuffers(1, &gpuMesh.vertexBuffer);
+        glDeleteBuffers(1, &gpuMesh.indexBuffer);
+        gpuMesh.vertexBuffer = 0;
+        gpuMesh.indexBuffer = 0;
+        gpuMesh.bufferBytes = 0;
+    }
+}
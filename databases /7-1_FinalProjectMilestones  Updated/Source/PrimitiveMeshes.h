@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.h
+// ============
+// generate, optimize and draw the basic shape meshes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FramePacket.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "VertexFormat.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <vector>
+
+/***********************************************************
+ *  PrimitiveMeshes
+ *
+ *  This class generates the basic shapes drawn by the scene
+ *  in CPU memory, runs them through the mesh optimizer and
+ *  keeps one vertex array per shape on the GPU. The shapes
+ *  have the same sizes and orientations as the ShapeMeshes
+ *  utility they replace.
+ *
+ *  One shared instance serves as the mesh registry of all
+ *  scene managers. A shape is only generated and uploaded
+ *  when it is first drawn, and its buffers are deleted once
+ *  nobody references it anymore, so the startup time and
+ *  the video memory follow the shapes a scene really uses.
+ *  References may be counted on any thread; loading and
+ *  unloading happen on the thread that owns the context.
+ *
+ *  Windows whose contexts share their objects draw from the
+ *  same buffers. Vertex arrays are not shared, so each
+ *  registered context gets vertex arrays of its own over
+ *  those buffers, created when it first draws a shape.
+ ***********************************************************/
+class PrimitiveMeshes
+{
+public:
+    // buffers and decode values of one uploaded mesh
+    struct GPU_MESH
+    {
+        GLuint vertexArray;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+        GLsizei indexCount;
+        // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+        GLenum indexType;
+        VERTEX_FORMAT format;
+        // bytes of vertex and index data on the GPU
+        size_t bufferBytes;
+        // dequantization of packed positions
+        glm::vec3 positionOffset;
+        glm::vec3 positionScale;
+    };
+
+    // contexts of one share group that may draw the shapes
+    static const int MAX_SHARED_CONTEXTS = 8;
+
+    PrimitiveMeshes();
+    ~PrimitiveMeshes();
+
+    // optimization applied by LoadMesh(), MESH_OPTIMIZE_OVERDRAW
+    // unless changed
+    void SetOptimization(MESH_OPTIMIZATION optimization) { m_optimization = optimization; }
+    MESH_OPTIMIZATION GetOptimization() const { return m_optimization; }
+
+    // vertex layout used by LoadMesh(), VERTEX_FORMAT_FLOAT unless
+    // changed; shapes that are already loaded keep their layout
+    void SetVertexFormat(VERTEX_FORMAT format) { m_vertexFormat = format; }
+    VERTEX_FORMAT GetVertexFormat() const { return m_vertexFormat; }
+
+    // registry shared by all scene managers of the process
+    static PrimitiveMeshes& GetShared();
+
+    // count a user of a shape; shapes without users are deleted
+    // by the next UnloadUnreferenced()
+    void AddReference(MESH_TYPE mesh);
+    void ReleaseReference(MESH_TYPE mesh);
+    int GetReferenceCount(MESH_TYPE mesh) const;
+
+    // reserve a slot for another context that shares the objects
+    // of the first one, which always has slot 0; -1 when all
+    // slots are taken
+    int RegisterContext();
+    // forget the vertex arrays of a context that is destroyed
+    void ReleaseContext(int context);
+    // slot of the context the following calls are made in
+    void SetCurrentContext(int context);
+    int GetCurrentContext() const { return m_currentContext; }
+
+    // generate, optimize and upload a shape; does nothing when
+    // the shape is already loaded
+    bool LoadMesh(MESH_TYPE mesh);
+    // issue the draw call of a shape, loading it on first use;
+    // more than one instance draws it once per view of a
+    // multi-view pass
+    void DrawMesh(MESH_TYPE mesh, GLsizei instanceCount = 1);
+    // delete the buffers of the loaded shapes without users
+    void UnloadUnreferenced();
+    // bytes of vertex and index data of the loaded shapes
+    size_t GetLoadedBytes() const;
+
+    // build the unoptimized triangle list of a shape
+    static void GenerateMesh(MESH_TYPE mesh, MESH_DATA& data);
+
+    // create the vertex array and buffers of a mesh in the given
+    // layout, with the attributes at the scene shader locations
+    static void UploadMesh(const MESH_DATA& data, VERTEX_FORMAT format, GPU_MESH& gpuMesh);
+    // set the decode values of the mesh and issue its draw call
+    static void DrawUploadedMesh(const GPU_MESH& gpuMesh, GLsizei instanceCount = 1);
+    // same, for a range of its indices
+    static void DrawUploadedRange(const GPU_MESH& gpuMesh, GLsizei firstIndex, GLsizei indexCount,
+                                  GLsizei instanceCount = 1);
+    // point the bound vertex array at the buffers of a mesh
+    static void SetVertexLayout(const GPU_MESH& gpuMesh);
+    // delete the buffers of an uploaded mesh
+    static void DeleteUploadedMesh(GPU_MESH& gpuMesh);
+
+private:
+    // vertex array of a loaded shape in the current context
+    GLuint GetVertexArray(MESH_TYPE mesh);
+    // delete the buffers of a shape and the vertex arrays of
+    // the current context pointing at them
+    void ReleaseMesh(MESH_TYPE mesh);
+    // delete the vertex arrays of the current context whose
+    // buffers were deleted while another context was current
+    void DeleteStaleVertexArrays();
+
+    GPU_MESH m_meshes[MESH_COUNT];
+    std::atomic<int> m_referenceCounts[MESH_COUNT];
+    // vertex arrays of each context slot, 0 until first drawn
+    GLuint m_vertexArrays[MAX_SHARED_CONTEXTS][MESH_COUNT];
+    std::vector<GLuint> m_staleVertexArrays[MAX_SHARED_CONTEXTS];
+    bool m_bContextInUse[MAX_SHARED_CONTEXTS];
+    MESH_OPTIMIZATION m_optimization;
+    VERTEX_FORMAT m_vertexFormat;
+    int m_currentContext;
+};
@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderscheduler.cpp
+// ============
+// decide when the main loop needs to draw a new frame and block on the
+// GLFW event queue while the displayed image is still up to date
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderScheduler.h"
+
+#include "GLFW/glfw3.h"     // GLFW library
+
+#include <algorithm>
+
+// declare the global variables
+namespace
+{
+    // longest time the loop sleeps without any event arriving; the
+    // wake-up is cheap and keeps the loop responsive to state that
+    // changes outside of GLFW callbacks
+    const double MAX_IDLE_WAIT_SECONDS = 0.5;
+}
+
+/***********************************************************
+ *  RenderScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderScheduler::RenderScheduler()
+    : m_bOnDemand(false),
+      m_bFrameRequested(true),
+      m_bLastFrameChanged(true),
+      m_animateUntil(0.0),
+      m_renderedFrames(0),
+      m_skippedFrames(0)
+{
+    // the first frame is always drawn
+}
+
+/***********************************************************
+ *  SetOnDemand()
+ *
+ *  This method is used to switch between continuous and
+ *  render-on-demand modes.
+ ***********************************************************/
+void RenderScheduler::SetOnDemand(bool bOnDemand)
+{
+    m_bOnDemand = bOnDemand;
+    m_bFrameRequested = true;
+}
+
+/***********************************************************
+ *  RequestFrame()
+ *
+ *  This method is used to request that one more frame is
+ *  drawn even though the view has not changed.
+ ***********************************************************/
+void RenderScheduler::RequestFrame()
+{
+    m_bFrameRequested = true;
+}
+
+/***********************************************************
+ *  RequestFramesFor()
+ *
+ *  This method is used by animations to keep the loop
+ *  drawing frames for the passed-in number of seconds.
+ ***********************************************************/
+void RenderScheduler::RequestFramesFor(double seconds)
+{
+    m_animateUntil = std::max(m_animateUntil, glfwGetTime() + seconds);
+    m_bFrameRequested = true;
+}
+
+/***********************************************************
+ *  WaitForEvents()
+ *
+ *  This method is used to process the pending window events.
+ *  In continuous mode, or while frames are still expected,
+ *  the events are only polled; otherwise the thread sleeps
+ *  until an event arrives or the idle timeout expires.
+ ***********************************************************/
+void RenderScheduler::WaitForEvents()
+{
+    double now = glfwGetTime();
+
+    if (!m_bOnDemand ||
+        m_bFrameRequested ||
+        m_bLastFrameChanged ||
+        now < m_animateUntil)
+    {
+        glfwPollEvents();
+        return;
+    }
+
+    glfwWaitEventsTimeout(MAX_IDLE_WAIT_SECONDS);
+}
+
+/***********************************************************
+ *  ShouldRenderFrame()
+ *
+ *  This method is used to decide whether the current loop
+ *  iteration draws a frame. Any pending request is consumed.
+ ***********************************************************/
+bool RenderScheduler::ShouldRenderFrame(bool bViewChanged)
+{
+    bool bRender = true;
+
+    if (m_bOnDemand)
+    {
+        bRender = bViewChanged ||
+                  m_bFrameRequested ||
+                  glfwGetTime() < m_animateUntil;
+    }
+
+    m_bFrameRequested = false;
+    m_bLastFrameChanged = bViewChanged;
+
+    if (bRender)
+    {
+        ++m_renderedFrames;
+    }
+    else
+    {
+        ++m_skippedFrames;
+    }
+
+    return bRender;
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderscheduler.h
+// ============
+// decide when the main loop needs to draw a new frame and block on the
+// GLFW event queue while the displayed image is still up to date
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  RenderScheduler
+ *
+ *  This class is used by the main render loop to support a
+ *  render-on-demand mode. A frame is only drawn when the
+ *  view, the scene or the window has changed, or while an
+ *  animation has requested frames. Otherwise the loop sleeps
+ *  in glfwWaitEventsTimeout() instead of busy-polling.
+ ***********************************************************/
+class RenderScheduler
+{
+public:
+    // constructor
+    RenderScheduler();
+
+    // enable or disable render-on-demand (continuous when off)
+    void SetOnDemand(bool bOnDemand);
+    bool IsOnDemand() const { return m_bOnDemand; }
+
+    // request a single redraw at the next loop iteration
+    void RequestFrame();
+    // request continuous redraws for the passed-in duration
+    void RequestFramesFor(double seconds);
+
+    // process pending window events, blocking while idle
+    void WaitForEvents();
+
+    // decide whether a frame must be drawn this iteration
+    bool ShouldRenderFrame(bool bViewChanged);
+
+    // number of frames drawn and skipped since startup
+    unsigned long GetRenderedFrameCount() const { return m_renderedFrames; }
+    unsigned long GetSkippedFrameCount() const { return m_skippedFrames; }
+
+private:
+    // true when frames are only drawn on demand
+    bool m_bOnDemand;
+    // a single redraw has been requested
+    bool m_bFrameRequested;
+    // the last iteration drew a frame because something changed,
+    // so keep polling until the view settles
+    bool m_bLastFrameChanged;
+    // glfwGetTime() value until which animation frames are drawn
+    double m_animateUntil;
+
+    unsigned long m_renderedFrames;
+    unsigned long m_skippedFrames;
+};
@@ -0,0 +1,227 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderthread.cpp
+// ============
+// own the OpenGL context on a dedicated thread that draws the frame
+// packets produced by the main thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include <GL/glew.h>        // GLEW library
+
+#include "RenderThread.h"
+#include "DynamicResolution.h"
+#include "FrameExporter.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <chrono>
+
+// redirects the OpenGL calls below to the capture layer
+#include "GLCaptureCalls.h"
+
+// declare the global variables
+namespace
+{
+    // longest time a waiting thread sleeps before checking its
+    // queue again, in case a wake-up was missed
+    const std::chrono::milliseconds WAKE_TIMEOUT(2);
+}
+
+/***********************************************************
+ *  RenderThread()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderThread::RenderThread(
+    GLFWwindow* pWindow,
+    ViewManager* pViewManager,
+    SceneManager* pSceneManager)
+    : m_pWindow(pWindow),
+      m_pViewManager(pViewManager),
+      m_pSceneManager(pSceneManager),
+      m_pFrameExporter(nullptr),
+      m_pDynamicResolution(nullptr),
+      m_bRunning(false),
+      m_nextFrameIndex(0)
+{
+    // all packets start out unused
+    for (auto& packet : m_packets)
+    {
+        m_freeQueue.TryPush(&packet);
+    }
+}
+
+/***********************************************************
+ *  ~RenderThread()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used to hand the OpenGL context over to
+ *  the render thread. The calling thread must not make any
+ *  OpenGL calls until Stop() has returned.
+ ***********************************************************/
+void RenderThread::Start()
+{
+    if (m_bRunning)
+    {
+        return;
+    }
+
+    // a context can only be current on one thread at a time
+    glfwMakeContextCurrent(NULL);
+
+    m_bRunning = true;
+    m_thread = std::thread(&RenderThread::Run, this);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used to finish drawing the queued frames,
+ *  join the render thread and take the OpenGL context back.
+ ***********************************************************/
+void RenderThread::Stop()
+{
+    if (!m_bRunning)
+    {
+        return;
+    }
+
+    m_bRunning = false;
+    m_submitSignal.notify_one();
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+
+    glfwMakeContextCurrent(m_pWindow);
+}
+
+/***********************************************************
+ *  AcquireFramePacket()
+ *
+ *  This method is used by the main thread to get a frame
+ *  packet to fill. It blocks while MAX_FRAMES_IN_FLIGHT
+ *  frames are still queued or drawing.
+ ***********************************************************/
+FRAME_PACKET* RenderThread::AcquireFramePacket()
+{
+    FRAME_PACKET* pPacket = nullptr;
+
+    while (!m_freeQueue.TryPop(pPacket))
+    {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_freeSignal.wait_for(lock, WAKE_TIMEOUT);
+    }
+
+    pPacket->frameIndex = m_nextFrameIndex++;
+    return pPacket;
+}
+
+/***********************************************************
+ *  SubmitFramePacket()
+ *
+ *  This method is used by the main thread to queue a frame
+ *  packet for drawing on the render thread.
+ ***********************************************************/
+void RenderThread::SubmitFramePacket(FRAME_PACKET* pPacket)
+{
+    // the queue holds every packet, so it can never be full
+    m_submitQueue.TryPush(pPacket);
+    m_submitSignal.notify_one();
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is the render thread entry point. It draws
+ *  the queued packets in order until Stop() is called and
+ *  the queue has been drained.
+ ***********************************************************/
+void RenderThread::Run()
+{
+    glfwMakeContextCurrent(m_pWindow);
+
+    for (;;)
+    {
+        FRAME_PACKET* pPacket = nullptr;
+        if (m_submitQueue.TryPop(pPacket))
+        {
+            DrawFrame(*pPacket);
+
+            m_freeQueue.TryPush(pPacket);
+            m_freeSignal.notify_one();
+            continue;
+        }
+
+        if (!m_bRunning)
+        {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_submitSignal.wait_for(lock, WAKE_TIMEOUT);
+    }
+
+    glFinish();
+    glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *  DrawFrame()
+ *
+ *  This method is used to issue the OpenGL calls for one
+ *  frame packet and present the result.
+ ***********************************************************/
+void RenderThread::DrawFrame(const FRAME_PACKET& packet)
+{
+    // redirect the scene into the scaled offscreen target
+    float resolutionScale = 1.0f;
+    if (m_pDynamicResolution != nullptr)
+    {
+        resolutionScale = m_pDynamicResolution->BeginFrame(
+            static_cast<int>(packet.viewportSize.x),
+            static_cast<int>(packet.viewportSize.y));
+    }
+
+    BeginGLCaptureFrame();
+
+    // Enable z-depth
+    glEnable(GL_DEPTH_TEST);
+
+    // Clear the frame and z buffers
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // convert from 3D object space to 2D view
+    m_pViewManager->ApplyFrameView(packet, resolutionScale);
+
+    // draw the 3D scene
+    m_pSceneManager->SubmitFramePacket(packet);
+
+    EndGLCaptureFrame();
+
+    // stretch the scaled frame over the window
+    if (m_pDynamicResolution != nullptr)
+    {
+        m_pDynamicResolution->EndFrame();
+    }
+
+    // queue the readback of the frame before it is presented
+    if (m_pFrameExporter != nullptr)
+    {
+        m_pFrameExporter->CaptureFrame(
+            static_cast<int>(packet.viewportSize.x),
+            static_cast<int>(packet.viewportSize.y));
+    }
+
+    // Swap buffers
+    glfwSwapBuffers(m_pWindow);
+}
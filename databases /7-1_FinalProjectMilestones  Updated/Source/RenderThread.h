@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderthread.h
+// ============
+// own the OpenGL context on a dedicated thread that draws the frame
+// packets produced by the main thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FramePacket.h"
+#include "SpscQueue.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "GLFW/glfw3.h"     // GLFW library
+
+class DynamicResolution;
+class FrameExporter;
+class SceneManager;
+class ViewManager;
+
+/***********************************************************
+ *  RenderThread
+ *
+ *  This class moves the OpenGL submission and buffer swaps
+ *  off the main thread. The main thread keeps handling the
+ *  GLFW events, camera updates and scene logic, and hands
+ *  each finished frame packet over through a lock-free
+ *  single-producer/single-consumer queue. Used packets are
+ *  returned through a second queue, so the number of frames
+ *  in flight is bounded and no packet is ever reallocated.
+ ***********************************************************/
+class RenderThread
+{
+public:
+    // frames that may be queued or drawing while the main
+    // thread builds the next one
+    static const size_t MAX_FRAMES_IN_FLIGHT = 2;
+
+    // constructor
+    RenderThread(
+        GLFWwindow* pWindow,
+        ViewManager* pViewManager,
+        SceneManager* pSceneManager);
+    // destructor
+    ~RenderThread();
+
+    // release the OpenGL context on the calling thread and
+    // start drawing on the render thread
+    void Start();
+    // draw the queued frames, stop the render thread and make
+    // the OpenGL context current on the calling thread again
+    void Stop();
+
+    // get an unused frame packet, blocking while the maximum
+    // number of frames is in flight
+    FRAME_PACKET* AcquireFramePacket();
+    // queue a filled frame packet for drawing
+    void SubmitFramePacket(FRAME_PACKET* pPacket);
+
+    // read every drawn frame back for export; set before Start()
+    void SetFrameExporter(FrameExporter* pExporter) { m_pFrameExporter = pExporter; }
+    // draw the scene at a dynamic resolution; set before Start()
+    void SetDynamicResolution(DynamicResolution* pDynamicResolution) { m_pDynamicResolution = pDynamicResolution; }
+
+private:
+    // render thread entry point
+    void Run();
+    // draw one frame packet and present it
+    void DrawFrame(const FRAME_PACKET& packet);
+
+    GLFWwindow* m_pWindow;
+    ViewManager* m_pViewManager;
+    SceneManager* m_pSceneManager;
+    FrameExporter* m_pFrameExporter;
+    DynamicResolution* m_pDynamicResolution;
+
+    // packets being built, queued or drawn
+    FRAME_PACKET m_packets[MAX_FRAMES_IN_FLIGHT + 1];
+    // main thread -> render thread
+    SpscQueue<FRAME_PACKET*, 4> m_submitQueue;
+    // render thread -> main thread
+    SpscQueue<FRAME_PACKET*, 4> m_freeQueue;
+
+    std::thread m_thread;
+    std::atomic<bool> m_bRunning;
+    unsigned long m_nextFrameIndex;
+
+    // used only to sleep while a queue is empty; the queues
+    // themselves never take a lock
+    std::mutex m_wakeMutex;
+    std::condition_variable m_submitSignal;
+    std::condition_variable m_freeSignal;
+};
@@ -0,0 +1,411 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneconverter.cpp
+// ============
+// convert human-readable scene descriptions into binary scene files
+//
+// A scene description has one statement per line; '#' starts a
+// comment. Values follow their keyword, and keywords may appear in
+// any order:
+//
+//   texture <tag> <filename>
+//   material <tag> ambient r g b strength s diffuse r g b
+//            specular r g b shininess s
+//   light position x y z diffuse r g b specular r g b
+//         focal f intensity i
+//   object <mesh> scale x y z rotation x y z position x y z
+//          material <tag> texture <tag> color r g b a
+//
+// Objects without a material keep the material of the previous
+// object; objects without a texture are drawn with their color.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneConverter.h"
+#include "SceneFile.h"
+#include "FramePacket.h"
+#include "WorldStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+
+// declare the global variables
+namespace
+{
+    // mesh names used in scene descriptions, indexed by MESH_TYPE
+    const char* const g_MeshNames[MESH_COUNT] =
+    {
+        "box", "plane", "cylinder", "cone", "prism",
+        "pyramid4", "sphere", "tapered_cylinder", "torus",
+    };
+
+    /***********************************************************
+     *  ReadFloats()
+     *
+     *  Read count floating point values from a statement.
+     ***********************************************************/
+    bool ReadFloats(std::istringstream& stream, float* pValues, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            if (!(stream >> pValues[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // name of the table file in a world directory
+    const char* const WORLD_TABLES_FILENAME = "world.scnb";
+
+    // objects of one world cell and the extent they cover
+    struct WORLD_CELL
+    {
+        SceneFileWriter writer;
+        float minY;
+        float maxY;
+        uint32_t textureMask;
+    };
+
+    /***********************************************************
+     *  FindMeshType()
+     *
+     *  Get the mesh type with the passed in name.
+     ***********************************************************/
+    bool FindMeshType(const std::string& name, MESH_TYPE& mesh)
+    {
+        for (int i = 0; i < MESH_COUNT; ++i)
+        {
+            if (name == g_MeshNames[i])
+            {
+                mesh = static_cast<MESH_TYPE>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+/***********************************************************
+ *  ParseSceneText()
+ *
+ *  This function is used to parse a scene description into
+ *  the tables and object arrays of a scene file writer.
+ ***********************************************************/
+bool ParseSceneText(const char* textFilename, SceneFileWriter& writer)
+{
+    std::ifstream file(textFilename);
+    if (!file)
+    {
+        std::cout << "Could not open scene description: " << textFilename << std::endl;
+        return false;
+    }
+
+    int previousMaterial = -1;
+    int lineNumber = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+
+        size_t comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+
+        std::istringstream stream(line);
+        std::string statement;
+        if (!(stream >> statement))
+        {
+            continue;
+        }
+
+        std::string error;
+        if (statement == "texture")
+        {
+            std::string tag, filename;
+            if (!(stream >> tag >> filename))
+            {
+                error = "expected: texture <tag> <filename>";
+            }
+            else
+            {
+                writer.AddTexture(tag, filename);
+            }
+        }
+        else if (statement == "material")
+        {
+            std::string tag, keyword;
+            float ambient[3] = { 0.0f, 0.0f, 0.0f };
+            float diffuse[3] = { 0.0f, 0.0f, 0.0f };
+            float specular[3] = { 0.0f, 0.0f, 0.0f };
+            float strength = 0.0f;
+            float shininess = 1.0f;
+
+            if (!(stream >> tag))
+            {
+                error = "expected: material <tag>";
+            }
+            while (error.empty() && stream >> keyword)
+            {
+                bool bValid =
+                    (keyword == "ambient")   ? ReadFloats(stream, ambient, 3) :
+                    (keyword == "strength")  ? ReadFloats(stream, &strength, 1) :
+                    (keyword == "diffuse")   ? ReadFloats(stream, diffuse, 3) :
+                    (keyword == "specular")  ? ReadFloats(stream, specular, 3) :
+                    (keyword == "shininess") ? ReadFloats(stream, &shininess, 1) :
+                    false;
+                if (!bValid)
+                {
+                    error = "bad material value: " + keyword;
+                }
+            }
+            if (error.empty())
+            {
+                writer.AddMaterial(tag, ambient, strength, diffuse, specular, shininess);
+            }
+        }
+        else if (statement == "light")
+        {
+            SCENE_FILE_LIGHT light;
+            memset(&light, 0, sizeof(light));
+            std::string keyword;
+            while (error.empty() && stream >> keyword)
+            {
+                bool bValid =
+                    (keyword == "position")  ? ReadFloats(stream, light.position, 3) :
+                    (keyword == "diffuse")   ? ReadFloats(stream, light.diffuseColor, 3) :
+                    (keyword == "specular")  ? ReadFloats(stream, light.specularColor, 3) :
+                    (keyword == "focal")     ? ReadFloats(stream, &light.focalStrength, 1) :
+                    (keyword == "intensity") ? ReadFloats(stream, &light.specularIntensity, 1) :
+                    false;
+                if (!bValid)
+                {
+                    error = "bad light value: " + keyword;
+                }
+            }
+            if (error.empty())
+            {
+                writer.AddLight(light);
+            }
+        }
+        else if (statement == "object")
+        {
+            std::string meshName, keyword;
+            MESH_TYPE mesh = MESH_BOX;
+            float scale[3] = { 1.0f, 1.0f, 1.0f };
+            float rotation[3] = { 0.0f, 0.0f, 0.0f };
+            float position[3] = { 0.0f, 0.0f, 0.0f };
+            float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+            int material = previousMaterial;
+            int texture = -1;
+
+            if (!(stream >> meshName) || !FindMeshType(meshName, mesh))
+            {
+                error = "unknown mesh: " + meshName;
+            }
+            while (error.empty() && stream >> keyword)
+            {
+                std::string tag;
+                bool bValid = true;
+                if (keyword == "scale")         bValid = ReadFloats(stream, scale, 3);
+                else if (keyword == "rotation") bValid = ReadFloats(stream, rotation, 3);
+                else if (keyword == "position") bValid = ReadFloats(stream, position, 3);
+                else if (keyword == "color")    bValid = ReadFloats(stream, color, 4);
+                else if (keyword == "material")
+                {
+                    bValid = (stream >> tag) && (material = writer.FindMaterial(tag)) >= 0;
+                }
+                else if (keyword == "texture")
+                {
+                    bValid = (stream >> tag) && (texture = writer.FindTexture(tag)) >= 0;
+                }
+                else
+                {
+                    bValid = false;
+                }
+
+                if (!bValid)
+                {
+                    error = tag.empty() ? "bad object value: " + keyword : "undefined " + keyword + ": " + tag;
+                }
+            }
+            if (error.empty() &&
+                !writer.AddObject(static_cast<uint8_t>(mesh), scale, rotation, position, color, material, texture))
+            {
+                error = "material or texture index out of range";
+            }
+            if (error.empty())
+            {
+                previousMaterial = material;
+            }
+        }
+        else
+        {
+            error = "unknown statement: " + statement;
+        }
+
+        if (!error.empty())
+        {
+            std::cout << textFilename << "(" << lineNumber << "): " << error << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/***********************************************************
+ *  ConvertSceneText()
+ *
+ *  This function is used to convert a scene description
+ *  into a binary scene file.
+ ***********************************************************/
+bool ConvertSceneText(const char* textFilename, const char* sceneFilename)
+{
+    SceneFileWriter writer;
+    if (!ParseSceneText(textFilename, writer) || !writer.Write(sceneFilename))
+    {
+        return false;
+    }
+
+    std::cout << "INFO: Converted " << textFilename << " to " << sceneFilename
+              << " (" << writer.GetObjectCount() << " objects)" << std::endl;
+    return true;
+}
+
+/***********************************************************
+ *  BuildWorldCells()
+ *
+ *  This function is used to split a scene file into a world
+ *  that WorldStreamer can stream. Every object goes to the
+ *  cell that holds its position; objects without a material
+ *  get the material they would have inherited in the source
+ *  order, since the cells are loaded in any order.
+ ***********************************************************/
+bool BuildWorldCells(const char* sceneFilename, float cellSize, const char* worldDirectory)
+{
+    SceneFile scene;
+    if (cellSize <= 0.0f || !scene.Open(sceneFilename))
+    {
+        return false;
+    }
+    const std::string directory(worldDirectory);
+
+    // the tables, without objects
+    SceneFileWriter tables;
+    const SCENE_FILE_MATERIAL* pMaterials = scene.GetSection<SCENE_FILE_MATERIAL>(SCENE_SECTION_MATERIALS);
+    for (uint32_t i = 0; i < scene.GetMaterialCount(); ++i)
+    {
+        const SCENE_FILE_MATERIAL& material = pMaterials[i];
+        tables.AddMaterial(scene.GetString(material.tag), material.ambientColor, material.ambientStrength,
+                           material.diffuseColor, material.specularColor, material.shininess);
+    }
+    const SCENE_FILE_TEXTURE* pTextures = scene.GetSection<SCENE_FILE_TEXTURE>(SCENE_SECTION_TEXTURES);
+    for (uint32_t i = 0; i < scene.GetTextureCount(); ++i)
+    {
+        tables.AddTexture(scene.GetString(pTextures[i].tag), scene.GetString(pTextures[i].filename));
+    }
+    const SCENE_FILE_LIGHT* pLights = scene.GetSection<SCENE_FILE_LIGHT>(SCENE_SECTION_LIGHTS);
+    for (uint32_t i = 0; i < scene.GetLightCount(); ++i)
+    {
+        tables.AddLight(pLights[i]);
+    }
+    const std::string tablesPath = directory + "/" + WORLD_TABLES_FILENAME;
+    if (!tables.Write(tablesPath.c_str()))
+    {
+        return false;
+    }
+
+    // objects, bucketed by cell
+    const size_t objectCount = scene.GetObjectCount();
+    const float* pScales = scene.GetSection<float>(SCENE_SECTION_SCALE);
+    const float* pRotations = scene.GetSection<float>(SCENE_SECTION_ROTATION);
+    const float* pPositions = scene.GetSection<float>(SCENE_SECTION_POSITION);
+    const float* pColors = scene.GetSection<float>(SCENE_SECTION_COLOR);
+    const uint8_t* pMeshes = scene.GetSection<uint8_t>(SCENE_SECTION_MESH);
+    const int16_t* pMaterialIndices = scene.GetSection<int16_t>(SCENE_SECTION_MATERIAL_INDEX);
+    const int16_t* pTextureIndices = scene.GetSection<int16_t>(SCENE_SECTION_TEXTURE_INDEX);
+
+    std::map<std::pair<int, int>, WORLD_CELL> cells;
+    int materialIndex = -1;
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        const float* pPosition = pPositions + 3 * i;
+        const float* pScale = pScales + 3 * i;
+        const std::pair<int, int> key(
+            static_cast<int>(std::floor(pPosition[0] / cellSize)),
+            static_cast<int>(std::floor(pPosition[2] / cellSize)));
+
+        WORLD_CELL& cell = cells[key];
+        // a bounding sphere of the basic meshes is at most 1.5 units
+        const float extent = 1.5f * std::max(std::fabs(pScale[0]), std::max(std::fabs(pScale[1]), std::fabs(pScale[2])));
+        if (cell.writer.GetObjectCount() == 0)
+        {
+            cell.minY = pPosition[1] - extent;
+            cell.maxY = pPosition[1] + extent;
+            cell.textureMask = 0;
+        }
+        cell.minY = std::min(cell.minY, pPosition[1] - extent);
+        cell.maxY = std::max(cell.maxY, pPosition[1] + extent);
+
+        if (pMaterialIndices[i] >= 0)
+        {
+            materialIndex = pMaterialIndices[i];
+        }
+        const int textureIndex = pTextureIndices[i];
+        if (textureIndex >= 0 && textureIndex < 32)
+        {
+            cell.textureMask |= 1u << textureIndex;
+        }
+
+        if (!cell.writer.AddObject(pMeshes[i], pScale, pRotations + 3 * i, pPosition, pColors + 4 * i,
+                                   materialIndex, textureIndex))
+        {
+            std::cout << "ERROR::WORLD: object " << i << " has a material or texture index out of range" << std::endl;
+            return false;
+        }
+    }
+
+    // cell files and the index
+    const std::string indexPath = directory + "/" + WORLD_INDEX_FILENAME;
+    std::ofstream index(indexPath);
+    if (!index)
+    {
+        std::cout << "ERROR::WORLD: cannot write " << indexPath << std::endl;
+        return false;
+    }
+    index << "# world index written from " << sceneFilename << "\n";
+    index << "world " << WORLD_INDEX_VERSION << " " << cellSize << " " << WORLD_TABLES_FILENAME << "\n";
+    for (const auto& entry : cells)
+    {
+        const std::string filename = "cell_" + std::to_string(entry.first.first) + "_" +
+                                     std::to_string(entry.first.second) + ".scnb";
+        const std::string path = directory + "/" + filename;
+        if (!entry.second.writer.Write(path.c_str()))
+        {
+            return false;
+        }
+        std::ifstream written(path, std::ios::binary | std::ios::ate);
+        index << "cell " << entry.first.first << " " << entry.first.second << " " << filename
+              << " " << static_cast<long long>(written.tellg())
+              << " " << entry.second.minY << " " << entry.second.maxY
+              << " " << entry.second.textureMask << "\n";
+    }
+    if (!index)
+    {
+        std::cout << "ERROR::WORLD: cannot write " << indexPath << std::endl;
+        return false;
+    }
+
+    std::cout << "INFO: Built world " << directory << " from " << sceneFilename
+              << " (" << objectCount << " objects in " << cells.size() << " cells)" << std::endl;
+    return true;
+}
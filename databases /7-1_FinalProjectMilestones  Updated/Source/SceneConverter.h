@@ -0,0 +1,21 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneconverter.h
+// ============
+// convert human-readable scene descriptions into binary scene files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+class SceneFileWriter;
+
+// parse a scene description into a scene file writer; errors are
+// printed with their line number
+bool ParseSceneText(const char* textFilename, SceneFileWriter& writer);
+
+// parse a scene description and write it as a binary scene file
+bool ConvertSceneText(const char* textFilename, const char* sceneFilename);
+
+// split a binary scene file into the cells of a streamed world:
+// a table file, one scene file per square cell of the XZ plane and
+// the world index (see WorldStreamer). The directory must exist.
+bool BuildWorldCells(const char* sceneFilename, float cellSize, const char* worldDirectory);
@@ -0,0 +1,367 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// binary scene format that is memory mapped and used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+// declare the global variables
+namespace
+{
+    // element size of every section, 0 for the string section
+    const size_t g_SectionElementSize[SCENE_SECTION_COUNT] =
+    {
+        3 * sizeof(float),              // scale
+        3 * sizeof(float),              // rotation
+        3 * sizeof(float),              // position
+        4 * sizeof(float),              // color
+        sizeof(uint8_t),                // mesh
+        sizeof(int16_t),                // material index
+        sizeof(int16_t),                // texture index
+        sizeof(SCENE_FILE_MATERIAL),    // materials
+        sizeof(SCENE_FILE_TEXTURE),     // textures
+        sizeof(SCENE_FILE_LIGHT),       // lights
+        0,                              // strings
+    };
+
+    /***********************************************************
+     *  AlignOffset()
+     *
+     *  Round an offset up to the section alignment.
+     ***********************************************************/
+    uint64_t AlignOffset(uint64_t offset)
+    {
+        return (offset + SCENE_FILE_ALIGNMENT - 1) & ~static_cast<uint64_t>(SCENE_FILE_ALIGNMENT - 1);
+    }
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+    : m_pHeader(nullptr)
+{
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used to map a scene file and to check its
+ *  header. Every section must be aligned, lie inside the
+ *  file and hold exactly the number of elements given in
+ *  the header, so the arrays can be used without further
+ *  checks.
+ ***********************************************************/
+bool SceneFile::Open(const char* filename)
+{
+    Close();
+
+    if (!m_file.Open(filename))
+    {
+        std::cout << "Could not open scene file: " << filename << std::endl;
+        return false;
+    }
+
+    const SCENE_FILE_HEADER* pHeader = reinterpret_cast<const SCENE_FILE_HEADER*>(m_file.GetData());
+    if (m_file.GetSize() < sizeof(SCENE_FILE_HEADER) ||
+        pHeader->magic != SCENE_FILE_MAGIC)
+    {
+        std::cout << "Not a scene file: " << filename << std::endl;
+        Close();
+        return false;
+    }
+    if (pHeader->version != SCENE_FILE_VERSION ||
+        pHeader->headerSize != sizeof(SCENE_FILE_HEADER) ||
+        pHeader->sectionCount != SCENE_SECTION_COUNT)
+    {
+        std::cout << "Unsupported scene file version " << pHeader->version
+                  << " (expected " << SCENE_FILE_VERSION << "): " << filename << std::endl;
+        Close();
+        return false;
+    }
+    if (pHeader->fileSize != m_file.GetSize())
+    {
+        std::cout << "Truncated scene file: " << filename << std::endl;
+        Close();
+        return false;
+    }
+
+    const uint64_t elementCounts[SCENE_SECTION_COUNT] =
+    {
+        pHeader->objectCount, pHeader->objectCount, pHeader->objectCount, pHeader->objectCount,
+        pHeader->objectCount, pHeader->objectCount, pHeader->objectCount,
+        pHeader->materialCount, pHeader->textureCount, pHeader->lightCount,
+        0,
+    };
+
+    for (int i = 0; i < SCENE_SECTION_COUNT; ++i)
+    {
+        const SCENE_FILE_SECTION& section = pHeader->sections[i];
+        bool bValid = (section.offset % SCENE_FILE_ALIGNMENT) == 0 &&
+                      section.offset <= pHeader->fileSize &&
+                      section.size <= pHeader->fileSize - section.offset;
+        if (g_SectionElementSize[i] != 0)
+        {
+            bValid = bValid && section.size == elementCounts[i] * g_SectionElementSize[i];
+        }
+        else if (section.size > 0)
+        {
+            // the last string must be terminated
+            bValid = bValid && m_file.GetData()[section.offset + section.size - 1] == '\0';
+        }
+
+        if (!bValid)
+        {
+            std::cout << "Corrupt section " << i << " in scene file: " << filename << std::endl;
+            Close();
+            return false;
+        }
+    }
+
+    m_pHeader = pHeader;
+    return true;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used to unmap the scene file. Pointers
+ *  returned by GetSection() are invalid afterwards.
+ ***********************************************************/
+void SceneFile::Close()
+{
+    m_pHeader = nullptr;
+    m_file.Close();
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used to get a string of the string
+ *  section; invalid offsets return an empty string.
+ ***********************************************************/
+const char* SceneFile::GetString(uint32_t offset) const
+{
+    if (offset >= m_pHeader->sections[SCENE_SECTION_STRINGS].size)
+    {
+        return "";
+    }
+    return GetSection<char>(SCENE_SECTION_STRINGS) + offset;
+}
+
+/***********************************************************
+ *  AddString()
+ *
+ *  This method is used to append a string to the string
+ *  section and to get its offset.
+ ***********************************************************/
+uint32_t SceneFileWriter::AddString(const std::string& text)
+{
+    uint32_t offset = static_cast<uint32_t>(m_strings.size());
+    m_strings.insert(m_strings.end(), text.begin(), text.end());
+    m_strings.push_back('\0');
+    return offset;
+}
+
+/***********************************************************
+ *  AddMaterial()
+ *
+ *  This method is used to add an entry to the material
+ *  table.
+ ***********************************************************/
+int SceneFileWriter::AddMaterial(
+    const std::string& tag,
+    const float ambientColor[3],
+    float ambientStrength,
+    const float diffuseColor[3],
+    const float specularColor[3],
+    float shininess)
+{
+    SCENE_FILE_MATERIAL material;
+    memcpy(material.ambientColor, ambientColor, sizeof(material.ambientColor));
+    material.ambientStrength = ambientStrength;
+    memcpy(material.diffuseColor, diffuseColor, sizeof(material.diffuseColor));
+    material.shininess = shininess;
+    memcpy(material.specularColor, specularColor, sizeof(material.specularColor));
+    material.tag = AddString(tag);
+
+    m_materials.push_back(material);
+    m_materialTags.push_back(tag);
+    return static_cast<int>(m_materials.size()) - 1;
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used to add an entry to the texture
+ *  table. Textures are loaded into slots in table order.
+ ***********************************************************/
+int SceneFileWriter::AddTexture(const std::string& tag, const std::string& filename)
+{
+    SCENE_FILE_TEXTURE texture;
+    texture.filename = AddString(filename);
+    texture.tag = AddString(tag);
+
+    m_textures.push_back(texture);
+    m_textureTags.push_back(tag);
+    return static_cast<int>(m_textures.size()) - 1;
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used to add an entry to the light table.
+ ***********************************************************/
+void SceneFileWriter::AddLight(const SCENE_FILE_LIGHT& light)
+{
+    m_lights.push_back(light);
+}
+
+/***********************************************************
+ *  AddObject()
+ *
+ *  This method is used to append one object to each of the
+ *  object arrays. The indices are stored as int16_t, so an
+ *  object whose index does not fit is rejected.
+ ***********************************************************/
+bool SceneFileWriter::AddObject(
+    uint8_t mesh,
+    const float scaleXYZ[3],
+    const float rotationDegrees[3],
+    const float positionXYZ[3],
+    const float color[4],
+    int materialIndex,
+    int textureIndex)
+{
+    const int maxIndex = std::numeric_limits<int16_t>::max();
+    if (materialIndex < -1 || materialIndex > maxIndex ||
+        textureIndex < -1 || textureIndex > maxIndex)
+    {
+        return false;
+    }
+
+    m_scales.insert(m_scales.end(), scaleXYZ, scaleXYZ + 3);
+    m_rotations.insert(m_rotations.end(), rotationDegrees, rotationDegrees + 3);
+    m_positions.insert(m_positions.end(), positionXYZ, positionXYZ + 3);
+    m_colors.insert(m_colors.end(), color, color + 4);
+    m_meshes.push_back(mesh);
+    m_materialIndices.push_back(static_cast<int16_t>(materialIndex));
+    m_textureIndices.push_back(static_cast<int16_t>(textureIndex));
+    return true;
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *  FindTexture()
+ *
+ *  These methods are used to get the table index of the
+ *  entry with the passed in tag.
+ ***********************************************************/
+int SceneFileWriter::FindMaterial(const std::string& tag) const
+{
+    for (size_t i = 0; i < m_materialTags.size(); ++i)
+    {
+        if (m_materialTags[i] == tag)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int SceneFileWriter::FindTexture(const std::string& tag) const
+{
+    for (size_t i = 0; i < m_textureTags.size(); ++i)
+    {
+        if (m_textureTags[i] == tag)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used to lay the sections out behind the
+ *  header, each starting on an aligned offset, and to write
+ *  them to a file.
+ ***********************************************************/
+bool SceneFileWriter::Write(const char* filename) const
+{
+    const void* sectionData[SCENE_SECTION_COUNT] =
+    {
+        m_scales.data(), m_rotations.data(), m_positions.data(), m_colors.data(),
+        m_meshes.data(), m_materialIndices.data(), m_textureIndices.data(),
+        m_materials.data(), m_textures.data(), m_lights.data(), m_strings.data(),
+    };
+    const size_t sectionBytes[SCENE_SECTION_COUNT] =
+    {
+        m_scales.size() * sizeof(float),
+        m_rotations.size() * sizeof(float),
+        m_positions.size() * sizeof(float),
+        m_colors.size() * sizeof(float),
+        m_meshes.size() * sizeof(uint8_t),
+        m_materialIndices.size() * sizeof(int16_t),
+        m_textureIndices.size() * sizeof(int16_t),
+        m_materials.size() * sizeof(SCENE_FILE_MATERIAL),
+        m_textures.size() * sizeof(SCENE_FILE_TEXTURE),
+        m_lights.size() * sizeof(SCENE_FILE_LIGHT),
+        m_strings.size(),
+    };
+
+    SCENE_FILE_HEADER header;
+    memset(&header, 0, sizeof(header));
+    header.magic         = SCENE_FILE_MAGIC;
+    header.version       = SCENE_FILE_VERSION;
+    header.headerSize    = sizeof(SCENE_FILE_HEADER);
+    header.sectionCount  = SCENE_SECTION_COUNT;
+    header.objectCount   = static_cast<uint32_t>(m_meshes.size());
+    header.materialCount = static_cast<uint32_t>(m_materials.size());
+    header.textureCount  = static_cast<uint32_t>(m_textures.size());
+    header.lightCount    = static_cast<uint32_t>(m_lights.size());
+
+    uint64_t offset = AlignOffset(sizeof(SCENE_FILE_HEADER));
+    for (int i = 0; i < SCENE_SECTION_COUNT; ++i)
+    {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sectionBytes[i];
+        offset = AlignOffset(offset + sectionBytes[i]);
+    }
+    header.fileSize = offset;
+
+    std::ofstream file(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "Could not write scene file: " << filename << std::endl;
+        return false;
+    }
+
+    const char padding[SCENE_FILE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (int i = 0; i < SCENE_SECTION_COUNT; ++i)
+    {
+        file.write(padding, static_cast<std::streamsize>(header.sections[i].offset - written));
+        file.write(static_cast<const char*>(sectionData[i]), static_cast<std::streamsize>(sectionBytes[i]));
+        written = header.sections[i].offset + sectionBytes[i];
+    }
+    file.write(padding, static_cast<std::streamsize>(header.fileSize - written));
+    file.close();
+
+    if (!file)
+    {
+        std::cout << "Could not write scene file: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,183 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// binary scene format that is memory mapped and used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// "SCNB" read as a little-endian 32-bit value
+const uint32_t SCENE_FILE_MAGIC = 0x424E4353;
+// bumped whenever the layout below changes
+const uint32_t SCENE_FILE_VERSION = 1;
+// every section starts at a multiple of this
+const uint32_t SCENE_FILE_ALIGNMENT = 64;
+
+// the sections of a scene file; the object sections are arrays
+// of objectCount elements, one array per object property
+enum SCENE_FILE_SECTION_ID
+{
+    SCENE_SECTION_SCALE = 0,        // float[3] per object
+    SCENE_SECTION_ROTATION,         // float[3] per object, degrees
+    SCENE_SECTION_POSITION,         // float[3] per object
+    SCENE_SECTION_COLOR,            // float[4] per object
+    SCENE_SECTION_MESH,             // uint8_t MESH_TYPE per object
+    SCENE_SECTION_MATERIAL_INDEX,   // int16_t per object, -1 for none
+    SCENE_SECTION_TEXTURE_INDEX,    // int16_t per object, -1 for none
+    SCENE_SECTION_MATERIALS,        // SCENE_FILE_MATERIAL table
+    SCENE_SECTION_TEXTURES,         // SCENE_FILE_TEXTURE table
+    SCENE_SECTION_LIGHTS,           // SCENE_FILE_LIGHT table
+    SCENE_SECTION_STRINGS,          // zero-terminated strings
+    SCENE_SECTION_COUNT
+};
+
+// location of a section, relative to the start of the file
+struct SCENE_FILE_SECTION
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+// first bytes of every scene file
+struct SCENE_FILE_HEADER
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t sectionCount;
+    uint64_t fileSize;
+    uint32_t objectCount;
+    uint32_t materialCount;
+    uint32_t textureCount;
+    uint32_t lightCount;
+    SCENE_FILE_SECTION sections[SCENE_SECTION_COUNT];
+};
+
+// strings are stored as byte offsets into the string section
+struct SCENE_FILE_MATERIAL
+{
+    float ambientColor[3];
+    float ambientStrength;
+    float diffuseColor[3];
+    float shininess;
+    float specularColor[3];
+    uint32_t tag;
+};
+
+struct SCENE_FILE_TEXTURE
+{
+    uint32_t filename;
+    uint32_t tag;
+};
+
+struct SCENE_FILE_LIGHT
+{
+    float position[3];
+    float focalStrength;
+    float diffuseColor[3];
+    float specularIntensity;
+    float specularColor[3];
+    uint32_t reserved;
+};
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  A scene file mapped into memory. Open() only checks the
+ *  header and the section bounds; the object arrays are
+ *  returned as pointers into the mapping, so the cost of
+ *  opening does not depend on the number of objects.
+ ***********************************************************/
+class SceneFile
+{
+public:
+    SceneFile();
+
+    // map and validate a scene file; errors are printed
+    bool Open(const char* filename);
+    void Close();
+    bool IsOpen() const { return m_pHeader != nullptr; }
+    // read the whole file into memory now
+    void Prefetch() const { m_file.Prefetch(); }
+
+    uint32_t GetObjectCount() const { return m_pHeader->objectCount; }
+    uint32_t GetMaterialCount() const { return m_pHeader->materialCount; }
+    uint32_t GetTextureCount() const { return m_pHeader->textureCount; }
+    uint32_t GetLightCount() const { return m_pHeader->lightCount; }
+
+    // typed pointer to the start of a section
+    template <typename T>
+    const T* GetSection(SCENE_FILE_SECTION_ID section) const
+    {
+        return reinterpret_cast<const T*>(m_file.GetData() + m_pHeader->sections[section].offset);
+    }
+
+    // string stored at an offset in the string section
+    const char* GetString(uint32_t offset) const;
+
+private:
+    MappedFile m_file;
+    const SCENE_FILE_HEADER* m_pHeader;
+};
+
+/***********************************************************
+ *  SceneFileWriter
+ *
+ *  Collects a scene in memory and writes it in the layout
+ *  expected by SceneFile.
+ ***********************************************************/
+class SceneFileWriter
+{
+public:
+    // add table entries; the returned index is referenced by
+    // the objects
+    int AddMaterial(const std::string& tag, const float ambientColor[3], float ambientStrength,
+                    const float diffuseColor[3], const float specularColor[3], float shininess);
+    int AddTexture(const std::string& tag, const std::string& filename);
+    void AddLight(const SCENE_FILE_LIGHT& light);
+
+    // append an object to the object arrays; false if an index
+    // does not fit the 16-bit index sections
+    bool AddObject(
+        uint8_t mesh,
+        const float scaleXYZ[3],
+        const float rotationDegrees[3],
+        const float positionXYZ[3],
+        const float color[4],
+        int materialIndex,
+        int textureIndex);
+
+    // index of a table entry by tag, -1 if it was not added
+    int FindMaterial(const std::string& tag) const;
+    int FindTexture(const std::string& tag) const;
+
+    size_t GetObjectCount() const { return m_meshes.size(); }
+
+    // write the collected scene; false if the file cannot be written
+    bool Write(const char* filename) const;
+
+private:
+    uint32_t AddString(const std::string& text);
+
+    std::vector<float> m_scales;
+    std::vector<float> m_rotations;
+    std::vector<float> m_positions;
+    std::vector<float> m_colors;
+    std::vector<uint8_t> m_meshes;
+    std::vector<int16_t> m_materialIndices;
+    std::vector<int16_t> m_textureIndices;
+
+    std::vector<SCENE_FILE_MATERIAL> m_materials;
+    std::vector<std::string> m_materialTags;
+    std::vector<SCENE_FILE_TEXTURE> m_textures;
+    std::vector<std::string> m_textureTags;
+    std::vector<SCENE_FILE_LIGHT> m_lights;
+    std::vector<char> m_strings;
+};
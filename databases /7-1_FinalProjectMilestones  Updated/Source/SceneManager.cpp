@@ -8,6 +8,10 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "ShaderBlocks.h"
+#include "WorldStreamer.h"
+#include "SoftwareRasterizer.h"
+#include "AllocationTracker.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -15,7 +19,14 @@
 #endif
 
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <string>
+
+// redirects the OpenGL calls below to the capture layer
+#include "GLCaptureCalls.h"
 
 // declare the global variables
 namespace
@@ -25,6 +36,40 @@ namespace
     const char* g_TextureValueName = "objectTexture";
     const char* g_UseTextureName   = "bUseTexture";
     const char* g_UseLightingName  = "bUseLighting";
+
+    // scene objects handled by one frame preparation job
+    const size_t FRAME_JOB_GRAIN_SIZE = 256;
+
+    // versions of the GPU object tables built so far, over all
+    // scene managers
+    std::atomic<uint64_t> g_GpuObjectSetVersion(0);
+
+    // most objects rasterized as occluders per frame, and the
+    // smallest ratio of bounding radius to view distance of one
+    const size_t MAX_OCCLUDERS = 16;
+    const float OCCLUDER_MIN_SIZE = 0.1f;
+
+    // a draw command that may be rasterized as an occluder
+    struct OCCLUDER_CANDIDATE
+    {
+        float size;
+        size_t command;
+    };
+
+    // conservative model-space bounding spheres (center, radius)
+    // of the basic shape meshes, indexed by MESH_TYPE
+    const glm::vec4 g_MeshBounds[MESH_COUNT] =
+    {
+        glm::vec4(0.0f, 0.0f, 0.0f, 0.87f),    // box
+        glm::vec4(0.0f, 0.0f, 0.0f, 1.42f),    // plane
+        glm::vec4(0.0f, 0.5f, 0.0f, 1.12f),    // cylinder
+        glm::vec4(0.0f, 0.5f, 0.0f, 1.12f),    // cone
+        glm::vec4(0.0f, 0.0f, 0.0f, 1.5f),     // prism
+        glm::vec4(0.0f, 0.0f, 0.0f, 1.5f),     // pyramid4
+        glm::vec4(0.0f, 0.0f, 0.0f, 1.0f),     // sphere
+        glm::vec4(0.0f, 0.5f, 0.0f, 1.12f),    // tapered cylinder
+        glm::vec4(0.0f, 0.0f, 0.0f, 1.5f),     // torus
+    };
 }
 
 /***********************************************************
@@ -34,9 +79,107 @@ namespace
  ***********************************************************/
 SceneManager::SceneManager(ShaderManager* pShaderManager)
     : m_pShaderManager(pShaderManager),
-      m_basicMeshes(new ShapeMeshes())
+      m_pJobSystem(nullptr),
+      m_pWorldStreamer(nullptr),
+      m_pSoftwareRasterizer(nullptr),
+      m_basicMeshes(&PrimitiveMeshes::GetShared()),
+      m_pObjectChunks(nullptr),
+      m_objectChunkCount(0),
+      m_pChunkOffsets(nullptr),
+      m_pObjectTransforms(nullptr),
+      m_pObjectBounds(nullptr),
+      m_pObjectVisible(nullptr),
+      m_bCullToFrustum(false),
+      m_cullViewPosition(0.0f),
+      m_cullViewProjection(1.0f),
+      m_pBuildPacket(nullptr),
+      m_pRingBuffer(nullptr),
+      m_materialBuffer(0),
+      m_uniformAlignment(256),
+      m_bStaticBatching(false),
+      m_bStaticBatchesDirty(false),
+      m_pStaticBatchBuffers(nullptr),
+      m_bGpuCulling(false),
+      m_bGpuObjectsDirty(false),
+      m_pGpuCuller(nullptr),
+      m_pOcclusionCuller(nullptr)
 {
+    for (bool& bReferenced : m_meshReferenced)
+    {
+        bReferenced = false;
+    }
+    // no program yet; -1 locations are ignored by glUniform and
+    // the real ones are looked up once a program is in use
+    m_uniforms.program = 0;
+    m_uniforms.model = m_uniforms.objectColor = m_uniforms.objectTexture = -1;
+    m_uniforms.useTexture = m_uniforms.ambientColor = m_uniforms.ambientStrength = -1;
+    m_uniforms.diffuseColor = m_uniforms.specularColor = m_uniforms.shininess = -1;
+
     // start with empty containers; textures & materials will be filled later
+    UseObjectStorage();
+}
+
+/***********************************************************
+ *  SetJobSystem()
+ *
+ *  Set the job system used for decoding textures and for
+ *  preparing the frames. Pass nullptr to run everything on
+ *  the calling thread.
+ ***********************************************************/
+void SceneManager::SetJobSystem(JobSystem* pJobSystem)
+{
+    m_pJobSystem = pJobSystem;
+}
+
+/***********************************************************
+ *  SetSoftwareRasterizer()
+ *
+ *  This method is used for drawing the frame packets with a
+ *  software rasterizer. The scene then makes no OpenGL
+ *  calls and runs without a context; its textures, lights
+ *  and materials are handed to the rasterizer instead.
+ ***********************************************************/
+void SceneManager::SetSoftwareRasterizer(SoftwareRasterizer* pRasterizer)
+{
+    m_pSoftwareRasterizer = pRasterizer;
+}
+
+/***********************************************************
+ *  SetWorldStreamer()
+ *
+ *  Set the world streamer that is updated for the camera of
+ *  every built frame packet. Pass nullptr to stop streaming.
+ ***********************************************************/
+void SceneManager::SetWorldStreamer(WorldStreamer* pWorldStreamer)
+{
+    m_pWorldStreamer = pWorldStreamer;
+    if (pWorldStreamer == nullptr)
+    {
+        m_streamedObjects.clear();
+        UpdateMeshReferences();
+    }
+}
+
+/***********************************************************
+ *  SetMeshOptimization()
+ *
+ *  Set how the basic shapes are reordered for the vertex
+ *  cache and overdraw when the shared registry loads them.
+ ***********************************************************/
+void SceneManager::SetMeshOptimization(MESH_OPTIMIZATION optimization)
+{
+    m_basicMeshes->SetOptimization(optimization);
+}
+
+/***********************************************************
+ *  SetVertexFormat()
+ *
+ *  Set whether the shared registry uploads the basic shapes
+ *  with float or packed vertices.
+ ***********************************************************/
+void SceneManager::SetVertexFormat(VERTEX_FORMAT format)
+{
+    m_basicMeshes->SetVertexFormat(format);
 }
 
 /***********************************************************
@@ -49,7 +192,37 @@ SceneManager::~SceneManager()
     // destroy the created OpenGL textures
     DestroyGLTextures();
 
-    delete m_basicMeshes;
+    // release the buffers of the buffered shader path
+    delete m_pRingBuffer;
+    m_pRingBuffer = nullptr;
+    if (m_materialBuffer != 0)
+    {
+        glDeleteBuffers(1, &m_materialBuffer);
+        m_materialBuffer = 0;
+    }
+
+    // release the merged geometry of the static batches
+    delete m_pStaticBatchBuffers;
+    m_pStaticBatchBuffers = nullptr;
+
+    // release the buffers and programs of the GPU culling
+    delete m_pGpuCuller;
+    m_pGpuCuller = nullptr;
+
+    delete m_pOcclusionCuller;
+    m_pOcclusionCuller = nullptr;
+
+    // the shapes only this scene used are deleted right away;
+    // no OpenGL calls are made when none of them was drawn
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        if (m_meshReferenced[mesh])
+        {
+            m_basicMeshes->ReleaseReference(static_cast<MESH_TYPE>(mesh));
+            m_meshReferenced[mesh] = false;
+        }
+    }
+    m_basicMeshes->UnloadUnreferenced();
     m_basicMeshes = nullptr;
 
     m_pShaderManager = nullptr;
@@ -65,29 +238,128 @@ SceneManager::~SceneManager()
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
 {
-    int width = 0;
-    int height = 0;
-    int colorChannels = 0;
-    GLuint textureID = 0;
-
     // indicate to always flip images vertically when loaded
     stbi_set_flip_vertically_on_load(true);
 
+    DECODED_IMAGE image;
+    DecodeTextureImage(filename, image);
+
+    return UploadGLTexture(image, tag);
+}
+
+/***********************************************************
+ *  DecodeTextureImage()
+ *
+ *  This method is used for parsing the pixels of an image
+ *  file into memory. It makes no OpenGL calls, so several
+ *  images can be decoded at once on the job system.
+ ***********************************************************/
+void SceneManager::DecodeTextureImage(const char* filename, DECODED_IMAGE& image)
+{
+    image.filename = filename;
+    image.width = 0;
+    image.height = 0;
+    image.colorChannels = 0;
+
     // try to parse the image data from the specified image file
-    unsigned char* image = stbi_load(
+    image.pixels = stbi_load(
         filename,
-        &width,
-        &height,
-        &colorChannels,
+        &image.width,
+        &image.height,
+        &image.colorChannels,
         0);
+}
 
-    if (!image)
+/***********************************************************
+ *  FreeDecodedImage()
+ *
+ *  This method is used for freeing the pixels of a decoded
+ *  image that will not be uploaded.
+ ***********************************************************/
+void SceneManager::FreeDecodedImage(DECODED_IMAGE& image)
+{
+    if (image.pixels != nullptr)
+    {
+        stbi_image_free(image.pixels);
+        image.pixels = nullptr;
+    }
+}
+
+/***********************************************************
+ *  UploadGLTexture()
+ *
+ *  This method is used for creating an OpenGL texture from
+ *  decoded image pixels, configuring the texture mapping
+ *  parameters, generating the mipmaps, and loading the
+ *  texture into the next available texture slot in memory.
+ *  The decoded pixels are freed.
+ ***********************************************************/
+bool SceneManager::UploadGLTexture(DECODED_IMAGE& image, const std::string& tag)
+{
+    const int colorChannels = image.colorChannels;
+    GLuint textureID = 0;
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        // the rasterizer keeps its own copy in the same slot
+        if (m_textures.size() >= 16 ||
+            !m_pSoftwareRasterizer->SetTexture(static_cast<int>(m_textures.size()), image))
+        {
+            std::cout << "Could not load image: " << image.filename << std::endl;
+            FreeDecodedImage(image);
+            return false;
+        }
+    }
+    else
+    {
+        textureID = CreateTextureObject(image);
+        if (textureID == 0)
+        {
+            return false;
+        }
+    }
+
+    // Enhancement: store texture info in dynamic container + map
+    TEXTURE_INFO texInfo;
+    texInfo.ID  = textureID;
+    texInfo.bHasAlpha = (colorChannels == 4);
+
+    int slotIndex = static_cast<int>(m_textures.size());
+    if (slotIndex >= 16)
     {
-        std::cout << "Could not load image: " << filename << std::endl;
+        std::cout << "WARNING: Maximum texture slots (16) reached. Ignoring texture: "
+                  << tag << std::endl;
+        glDeleteTextures(1, &textureID);
         return false;
     }
 
-    std::cout << "Successfully loaded image: " << filename
+    m_textures.push_back(texInfo);
+    m_textureTags.Add(tag);
+
+    return true;
+}
+
+/***********************************************************
+ *  CreateTextureObject()
+ *
+ *  This method is used for creating an OpenGL texture from
+ *  decoded image pixels with the texture mapping parameters
+ *  and mipmaps. The decoded pixels are freed. Returns 0 when
+ *  the image could not be used.
+ ***********************************************************/
+GLuint SceneManager::CreateTextureObject(DECODED_IMAGE& image)
+{
+    const int width = image.width;
+    const int height = image.height;
+    const int colorChannels = image.colorChannels;
+    GLuint textureID = 0;
+
+    if (!image.pixels)
+    {
+        std::cout << "Could not load image: " << image.filename << std::endl;
+        return 0;
+    }
+
+    std::cout << "Successfully loaded image: " << image.filename
               << ", width: " << width
               << ", height: " << height
               << ", channels: " << colorChannels << std::endl;
@@ -106,49 +378,96 @@ bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
     if (colorChannels == 3)
     {
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0,
-                     GL_RGB, GL_UNSIGNED_BYTE, image);
+                     GL_RGB, GL_UNSIGNED_BYTE, image.pixels);
     }
     else if (colorChannels == 4)
     {
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
-                     GL_RGBA, GL_UNSIGNED_BYTE, image);
+                     GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
     }
     else
     {
         std::cout << "Not implemented to handle image with "
                   << colorChannels << " channels" << std::endl;
-        stbi_image_free(image);
+        stbi_image_free(image.pixels);
+        image.pixels = nullptr;
         glBindTexture(GL_TEXTURE_2D, 0);
-        return false;
+        glDeleteTextures(1, &textureID);
+        return 0;
     }
 
     // generate the texture mipmaps
     glGenerateMipmap(GL_TEXTURE_2D);
 
     // free the image data from local memory
-    stbi_image_free(image);
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
     glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
 
-    // Enhancement: store texture info in dynamic container + map
-    TEXTURE_INFO texInfo;
-    texInfo.ID  = textureID;
-    texInfo.tag = tag;
+    return textureID;
+}
 
-    int slotIndex = static_cast<int>(m_textures.size());
-    if (slotIndex >= 16)
+/***********************************************************
+ *  SetStreamedTexture()
+ *
+ *  This method is used for creating the texture of a slot
+ *  reserved by LoadSceneFile() and binding it to its texture
+ *  unit. The decoded pixels are freed.
+ ***********************************************************/
+bool SceneManager::SetStreamedTexture(int slot, DECODED_IMAGE& image)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    if (slot < 0 || slot >= static_cast<int>(m_textures.size()))
     {
-        std::cout << "WARNING: Maximum texture slots (16) reached. Ignoring texture: "
-                  << tag << std::endl;
-        glDeleteTextures(1, &textureID);
+        FreeDecodedImage(image);
         return false;
     }
 
-    m_textures.push_back(texInfo);
-    m_textureSlotLookup[tag] = slotIndex;
+    const bool bHasAlpha = (image.colorChannels == 4);
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        m_textures[slot].bHasAlpha = bHasAlpha;
+        return m_pSoftwareRasterizer->SetTexture(slot, image);
+    }
+
+    GLuint textureID = CreateTextureObject(image);
+    if (textureID == 0)
+    {
+        return false;
+    }
 
+    ReleaseStreamedTexture(slot);
+    m_textures[slot].ID = textureID;
+    m_textures[slot].bHasAlpha = bHasAlpha;
+
+    glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(slot));
+    glBindTexture(GL_TEXTURE_2D, textureID);
     return true;
 }
 
+/***********************************************************
+ *  ReleaseStreamedTexture()
+ *
+ *  This method is used for deleting the texture of a slot
+ *  reserved by LoadSceneFile(). The slot stays reserved.
+ ***********************************************************/
+void SceneManager::ReleaseStreamedTexture(int slot)
+{
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        m_pSoftwareRasterizer->ReleaseTexture(slot);
+    }
+    if (slot < 0 || slot >= static_cast<int>(m_textures.size()) || m_textures[slot].ID == 0)
+    {
+        return;
+    }
+
+    GLuint textureID = m_textures[slot].ID;
+    glDeleteTextures(1, &textureID);
+    m_textures[slot].ID = 0;
+}
+
 /***********************************************************
  *  BindGLTextures()
  *
@@ -157,6 +476,11 @@ bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        return;
+    }
+
     for (size_t i = 0; i < m_textures.size(); ++i)
     {
         glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
@@ -164,6 +488,24 @@ void SceneManager::BindGLTextures()
     }
 }
 
+/***********************************************************
+ *  BindSharedResources()
+ *
+ *  This method is used for binding the textures and the
+ *  material table in a context that shares the objects of
+ *  the one they were created in. Bindings are not shared,
+ *  and streamed textures may have been replaced since the
+ *  last frame, so it is meant to be called every frame.
+ ***********************************************************/
+void SceneManager::BindSharedResources()
+{
+    BindGLTextures();
+    if (m_materialBuffer != 0)
+    {
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_DATA_BINDING, m_materialBuffer);
+    }
+}
+
 /***********************************************************
  *  DestroyGLTextures()
  *
@@ -181,7 +523,11 @@ void SceneManager::DestroyGLTextures()
         }
     }
     m_textures.clear();
-    m_textureSlotLookup.clear();
+    m_textureTags.Clear();
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        m_pSoftwareRasterizer->ClearTextures();
+    }
 }
 
 /***********************************************************
@@ -190,14 +536,9 @@ void SceneManager::DestroyGLTextures()
  *  Get an ID for the previously loaded texture bitmap
  *  associated with the passed-in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(const std::string& tag)
+int SceneManager::FindTextureID(TAG_ID tag) const
 {
-    auto it = m_textureSlotLookup.find(tag);
-    if (it == m_textureSlotLookup.end())
-    {
-        return -1;
-    }
-    int slot = it->second;
+    int slot = m_textureTags.Find(tag);
     if (slot < 0 || slot >= static_cast<int>(m_textures.size()))
     {
         return -1;
@@ -206,19 +547,25 @@ int SceneManager::FindTextureID(const std::string& tag)
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  CalculateModelMatrix()
  *
- *  Get a slot index for the previously loaded texture bitmap
- *  associated with the passed-in tag.
+ *  This method is used for calculating the model matrix
+ *  from the passed in transformation values.
  ***********************************************************/
-int SceneManager::FindTextureSlot(const std::string& tag)
+glm::mat4 SceneManager::CalculateModelMatrix(
+    glm::vec3 scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    glm::vec3 positionXYZ)
 {
-    auto it = m_textureSlotLookup.find(tag);
-    if (it == m_textureSlotLookup.end())
-    {
-        return -1;
-    }
-    return it->second;
+    glm::mat4 scale      = glm::scale(scaleXYZ);
+    glm::mat4 rotationX  = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+    glm::mat4 rotationY  = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 rotationZ  = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::mat4 translation = glm::translate(positionXYZ);
+
+    return translation * rotationX * rotationY * rotationZ * scale;
 }
 
 /***********************************************************
@@ -234,18 +581,12 @@ void SceneManager::SetTransformations(
     float ZrotationDegrees,
     glm::vec3 positionXYZ)
 {
-    glm::mat4 modelView(1.0f);
-    glm::mat4 scale      = glm::scale(scaleXYZ);
-    glm::mat4 rotationX  = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-    glm::mat4 rotationY  = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-    glm::mat4 rotationZ  = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-    glm::mat4 translation = glm::translate(positionXYZ);
-
-    modelView = translation * rotationX * rotationY * rotationZ * scale;
+    glm::mat4 modelView = CalculateModelMatrix(
+        scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
 
     if (m_pShaderManager != nullptr)
     {
-        m_pShaderManager->setMat4Value(g_ModelName, modelView);
+        glUniformMatrix4fv(GetShaderUniforms().model, 1, GL_FALSE, glm::value_ptr(modelView));
     }
 }
 
@@ -265,8 +606,9 @@ void SceneManager::SetShaderColor(
 
     if (m_pShaderManager != nullptr)
     {
-        m_pShaderManager->setIntValue(g_UseTextureName, false);
-        m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+        const SHADER_UNIFORMS& uniforms = GetShaderUniforms();
+        glUniform1i(uniforms.useTexture, false);
+        glUniform4fv(uniforms.objectColor, 1, glm::value_ptr(currentColor));
     }
 }
 
@@ -274,22 +616,22 @@ void SceneManager::SetShaderColor(
  *  SetShaderTexture()
  *
  *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  of the passed in texture slot into the shader.
  ***********************************************************/
-void SceneManager::SetShaderTexture(const std::string& textureTag)
+void SceneManager::SetShaderTexture(int textureSlot)
 {
     if (m_pShaderManager != nullptr)
     {
-        int textureSlot = FindTextureSlot(textureTag);
+        const SHADER_UNIFORMS& uniforms = GetShaderUniforms();
         if (textureSlot >= 0)
         {
-            m_pShaderManager->setIntValue(g_UseTextureName, true);
-            m_pShaderManager->setSampler2DValue(g_TextureValueName, textureSlot);
+            glUniform1i(uniforms.useTexture, true);
+            glUniform1i(uniforms.objectTexture, textureSlot);
         }
         else
         {
             // fallback to color-only if texture is missing
-            m_pShaderManager->setIntValue(g_UseTextureName, false);
+            glUniform1i(uniforms.useTexture, false);
         }
     }
 }
@@ -302,6 +644,12 @@ void SceneManager::SetShaderTexture(const std::string& textureTag)
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
+    AllocationScope scope(ALLOCATION_SHADER_MANAGER);
+
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        m_pSoftwareRasterizer->SetUVScale(glm::vec2(u, v));
+    }
     if (m_pShaderManager != nullptr)
     {
         m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
@@ -309,56 +657,74 @@ void SceneManager::SetTextureUVScale(float u, float v)
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  AddObjectMaterial()
  *
- *  Look up material by tag using map; fall back to linear
- *  search if needed (during initial population).
+ *  Append a material to the material list and add its tag
+ *  to the material tags, so the tag handle is the index.
  ***********************************************************/
-bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
+void SceneManager::AddObjectMaterial(const std::string& tag, const OBJECT_MATERIAL& material)
 {
-    // Fast path: use map lookup
-    auto it = m_materialLookup.find(tag);
-    if (it != m_materialLookup.end())
-    {
-        material = it->second;
-        return true;
-    }
-
-    // Fallback: linear search (in case map not populated yet)
-    for (const auto& mat : m_objectMaterials)
-    {
-        if (mat.tag == tag)
-        {
-            material = mat;
-            return true;
-        }
-    }
-
-    return false;
+    m_objectMaterials.push_back(material);
+    m_materialTags.Add(tag);
 }
 
 /***********************************************************
  *  SetShaderMaterial()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for passing the values of the
+ *  material at the passed in index into the shader.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(const std::string& materialTag)
+void SceneManager::SetShaderMaterial(int materialIndex)
 {
-    if (m_objectMaterials.empty() || m_pShaderManager == nullptr)
+    if (m_pShaderManager == nullptr ||
+        materialIndex < 0 || materialIndex >= static_cast<int>(m_objectMaterials.size()))
     {
         return;
     }
 
-    OBJECT_MATERIAL material;
-    if (FindMaterial(materialTag, material))
+    ApplyMaterial(m_objectMaterials[materialIndex]);
+}
+
+/***********************************************************
+ *  ApplyMaterial()
+ *
+ *  This method is used for passing the values of the passed
+ *  in material into the shader.
+ ***********************************************************/
+void SceneManager::ApplyMaterial(const OBJECT_MATERIAL& material)
+{
+    const SHADER_UNIFORMS& uniforms = GetShaderUniforms();
+    glUniform3fv(uniforms.ambientColor, 1, glm::value_ptr(material.ambientColor));
+    glUniform1f(uniforms.ambientStrength, material.ambientStrength);
+    glUniform3fv(uniforms.diffuseColor, 1, glm::value_ptr(material.diffuseColor));
+    glUniform3fv(uniforms.specularColor, 1, glm::value_ptr(material.specularColor));
+    glUniform1f(uniforms.shininess, material.shininess);
+}
+
+/***********************************************************
+ *  GetShaderUniforms()
+ *
+ *  Get the locations of the per-draw shader values in the
+ *  program in use. They are looked up by name once per
+ *  program, so the draw path makes no string lookups.
+ ***********************************************************/
+const SceneManager::SHADER_UNIFORMS& SceneManager::GetShaderUniforms()
+{
+    const GLuint program = m_pShaderManager->m_programID;
+    if (m_uniforms.program != program)
     {
-        m_pShaderManager->setVec3Value("material.ambientColor",  material.ambientColor);
-        m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-        m_pShaderManager->setVec3Value("material.diffuseColor",  material.diffuseColor);
-        m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-        m_pShaderManager->setFloatValue("material.shininess",    material.shininess);
+        m_uniforms.program         = program;
+        m_uniforms.model           = glGetUniformLocation(program, g_ModelName);
+        m_uniforms.objectColor     = glGetUniformLocation(program, g_ColorValueName);
+        m_uniforms.objectTexture   = glGetUniformLocation(program, g_TextureValueName);
+        m_uniforms.useTexture      = glGetUniformLocation(program, g_UseTextureName);
+        m_uniforms.ambientColor    = glGetUniformLocation(program, "material.ambientColor");
+        m_uniforms.ambientStrength = glGetUniformLocation(program, "material.ambientStrength");
+        m_uniforms.diffuseColor    = glGetUniformLocation(program, "material.diffuseColor");
+        m_uniforms.specularColor   = glGetUniformLocation(program, "material.specularColor");
+        m_uniforms.shininess       = glGetUniformLocation(program, "material.shininess");
     }
+    return m_uniforms;
 }
 
 /***********************************************************
@@ -370,7 +736,7 @@ void SceneManager::SetShaderMaterial(const std::string& materialTag)
 void SceneManager::DefineObjectMaterials()
 {
     m_objectMaterials.clear();
-    m_materialLookup.clear();
+    m_materialTags.Clear();
 
     OBJECT_MATERIAL goldMaterial;
     goldMaterial.ambientColor    = glm::vec3(0.2f, 0.2f, 0.1f);
@@ -378,8 +744,7 @@ void SceneManager::DefineObjectMaterials()
     goldMaterial.diffuseColor    = glm::vec3(0.3f, 0.3f, 0.2f);
     goldMaterial.specularColor   = glm::vec3(0.6f, 0.5f, 0.4f);
     goldMaterial.shininess       = 22.0f;
-    goldMaterial.tag             = "gold";
-    m_objectMaterials.push_back(goldMaterial);
+    AddObjectMaterial("gold", goldMaterial);
 
     OBJECT_MATERIAL cementMaterial;
     cementMaterial.ambientColor    = glm::vec3(0.2f, 0.2f, 0.2f);
@@ -387,8 +752,7 @@ void SceneManager::DefineObjectMaterials()
     cementMaterial.diffuseColor    = glm::vec3(0.5f, 0.5f, 0.5f);
     cementMaterial.specularColor   = glm::vec3(0.4f, 0.4f, 0.4f);
     cementMaterial.shininess       = 0.5f;
-    cementMaterial.tag             = "cement";
-    m_objectMaterials.push_back(cementMaterial);
+    AddObjectMaterial("cement", cementMaterial);
 
     OBJECT_MATERIAL woodMaterial;
     woodMaterial.ambientColor    = glm::vec3(0.4f, 0.3f, 0.1f);
@@ -396,8 +760,7 @@ void SceneManager::DefineObjectMaterials()
     woodMaterial.diffuseColor    = glm::vec3(0.3f, 0.2f, 0.1f);
     woodMaterial.specularColor   = glm::vec3(0.1f, 0.1f, 0.1f);
     woodMaterial.shininess       = 0.3f;
-    woodMaterial.tag             = "wood";
-    m_objectMaterials.push_back(woodMaterial);
+    AddObjectMaterial("wood", woodMaterial);
 
     OBJECT_MATERIAL tileMaterial;
     tileMaterial.ambientColor    = glm::vec3(0.2f, 0.3f, 0.4f);
@@ -405,8 +768,7 @@ void SceneManager::DefineObjectMaterials()
     tileMaterial.diffuseColor    = glm::vec3(0.3f, 0.2f, 0.1f);
     tileMaterial.specularColor   = glm::vec3(0.4f, 0.5f, 0.6f);
     tileMaterial.shininess       = 25.0f;
-    tileMaterial.tag             = "tile";
-    m_objectMaterials.push_back(tileMaterial);
+    AddObjectMaterial("tile", tileMaterial);
 
     OBJECT_MATERIAL glassMaterial;
     glassMaterial.ambientColor    = glm::vec3(0.4f, 0.4f, 0.4f);
@@ -414,8 +776,7 @@ void SceneManager::DefineObjectMaterials()
     glassMaterial.diffuseColor    = glm::vec3(0.3f, 0.3f, 0.3f);
     glassMaterial.specularColor   = glm::vec3(0.6f, 0.6f, 0.6f);
     glassMaterial.shininess       = 85.0f;
-    glassMaterial.tag             = "glass";
-    m_objectMaterials.push_back(glassMaterial);
+    AddObjectMaterial("glass", glassMaterial);
 
     OBJECT_MATERIAL clayMaterial;
     clayMaterial.ambientColor    = glm::vec3(0.2f, 0.2f, 0.3f);
@@ -423,8 +784,7 @@ void SceneManager::DefineObjectMaterials()
     clayMaterial.diffuseColor    = glm::vec3(0.4f, 0.4f, 0.5f);
     clayMaterial.specularColor   = glm::vec3(0.2f, 0.2f, 0.4f);
     clayMaterial.shininess       = 0.5f;
-    clayMaterial.tag             = "clay";
-    m_objectMaterials.push_back(clayMaterial);
+    AddObjectMaterial("clay", clayMaterial);
 
     // Enhancement: add a "ceramic" material actually used in RenderScene
     OBJECT_MATERIAL ceramicMaterial;
@@ -433,39 +793,65 @@ void SceneManager::DefineObjectMaterials()
     ceramicMaterial.diffuseColor    = glm::vec3(0.7f, 0.7f, 0.8f);
     ceramicMaterial.specularColor   = glm::vec3(0.9f, 0.9f, 1.0f);
     ceramicMaterial.shininess       = 32.0f;
-    ceramicMaterial.tag             = "ceramic";
-    m_objectMaterials.push_back(ceramicMaterial);
+    AddObjectMaterial("ceramic", ceramicMaterial);
+}
 
-    // Build hash map for O(1) material lookup
-    for (const auto& mat : m_objectMaterials)
-    {
-        m_materialLookup[mat.tag] = mat;
-    }
+/***********************************************************
+ *  DefineSceneLights()
+ *
+ *  Configure the light sources of the built-in 3D scene.
+ ***********************************************************/
+void SceneManager::DefineSceneLights()
+{
+    m_lightSources.clear();
+
+    // First light - Warmer light focused on the wood
+    LIGHT_SOURCE warmLight;
+    warmLight.position          = glm::vec3(0.0f, 1.5f, 0.0f);
+    warmLight.diffuseColor      = glm::vec3(0.4f, 0.3f, 0.2f);
+    warmLight.specularColor     = glm::vec3(0.0f, 0.0f, 0.0f);
+    warmLight.focalStrength     = 64.0f;
+    warmLight.specularIntensity = 0.1f;
+    m_lightSources.push_back(warmLight);
+
+    // Second light - Soft fill light coming from the camera side
+    LIGHT_SOURCE fillLight;
+    fillLight.position          = glm::vec3(0.0f, 1.2f, 2.0f);
+    fillLight.diffuseColor      = glm::vec3(0.3f, 0.3f, 0.3f);
+    fillLight.specularColor     = glm::vec3(0.0f, 0.0f, 0.0f);
+    fillLight.focalStrength     = 90.0f;
+    fillLight.specularIntensity = 0.05f;
+    m_lightSources.push_back(fillLight);
 }
 
 /***********************************************************
  *  SetupSceneLights()
+ *
+ *  Send the defined light sources into the shader.
  ***********************************************************/
 void SceneManager::SetupSceneLights()
 {
+    AllocationScope scope(ALLOCATION_SHADER_MANAGER);
+
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        m_pSoftwareRasterizer->SetLights(m_lightSources);
+    }
     if (m_pShaderManager == nullptr)
     {
         return;
     }
 
-    // First light - Warmer light focused on the wood
-    m_pShaderManager->setVec3Value("lightSources[0].position",       0.0f, 1.5f, 0.0f);
-    m_pShaderManager->setVec3Value("lightSources[0].diffuseColor",   0.4f, 0.3f, 0.2f);
-    m_pShaderManager->setVec3Value("lightSources[0].specularColor",  0.0f, 0.0f, 0.0f);
-    m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 64.0f);
-    m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.1f);
-
-    // Second light - Soft fill light coming from the camera side
-    m_pShaderManager->setVec3Value("lightSources[1].position",       0.0f, 1.2f, 2.0f);
-    m_pShaderManager->setVec3Value("lightSources[1].diffuseColor",   0.3f, 0.3f, 0.3f);
-    m_pShaderManager->setVec3Value("lightSources[1].specularColor",  0.0f, 0.0f, 0.0f);
-    m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 90.0f);
-    m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.05f);
+    for (size_t i = 0; i < m_lightSources.size(); ++i)
+    {
+        const LIGHT_SOURCE& light = m_lightSources[i];
+        const std::string prefix = "lightSources[" + std::to_string(i) + "].";
+        m_pShaderManager->setVec3Value(prefix + "position",       light.position);
+        m_pShaderManager->setVec3Value(prefix + "diffuseColor",   light.diffuseColor);
+        m_pShaderManager->setVec3Value(prefix + "specularColor",  light.specularColor);
+        m_pShaderManager->setFloatValue(prefix + "focalStrength", light.focalStrength);
+        m_pShaderManager->setFloatValue(prefix + "specularIntensity", light.specularIntensity);
+    }
 
     // Enable lighting
     m_pShaderManager->setBoolValue(g_UseLightingName, true);
@@ -478,27 +864,16 @@ void SceneManager::SetupSceneLights()
  ***********************************************************/
 void SceneManager::LoadSceneTextures()
 {
-    bool bReturn = false;
-
-    bReturn = CreateGLTexture(
-        "../../Utilities/textures/wood.jpg",
-        "wood");
-
-    bReturn = CreateGLTexture(
-        "../../Utilities/textures/greencup.png",
-        "Mug");
-
-    bReturn = CreateGLTexture(
-        "../../Utilities/textures/light.jpg",
-        "light");
-
-    bReturn = CreateGLTexture(
-        "../../Utilities/textures/stainedglass.jpg",
-        "glass");
+    const TEXTURE_FILE textureFiles[] =
+    {
+        { "../../Utilities/textures/wood.jpg",                  "wood"  },
+        { "../../Utilities/textures/greencup.png",              "Mug"   },
+        { "../../Utilities/textures/light.jpg",                 "light" },
+        { "../../Utilities/textures/stainedglass.jpg",          "glass" },
+        { "../../Utilities/textures/gold-seamless-texture.jpg", "gold"  },
+    };
 
-    bReturn = CreateGLTexture(
-        "../../Utilities/textures/gold-seamless-texture.jpg",
-        "gold");
+    LoadGLTextures(textureFiles, sizeof(textureFiles) / sizeof(textureFiles[0]));
 
     // after the texture image data is loaded into memory,
     // bind loaded textures to slots (up to 16)
@@ -506,106 +881,1635 @@ void SceneManager::LoadSceneTextures()
 }
 
 /***********************************************************
- *  PrepareScene()
+ *  LoadGLTextures()
  *
- *  Prepare the 3D scene by loading shapes, textures, and
- *  materials into memory.
+ *  Load a list of texture files. The image files are decoded
+ *  in parallel on the job system when one is available; the
+ *  OpenGL textures are then created in list order, so every
+ *  texture keeps the same slot as with sequential loading.
  ***********************************************************/
-void SceneManager::PrepareScene()
+void SceneManager::LoadGLTextures(const TEXTURE_FILE* pFiles, size_t fileCount)
 {
-    // load the textures for the 3D scene
-    LoadSceneTextures();
+    // indicate to always flip images vertically when loaded; set
+    // once up front since the flag is shared by all decode jobs
+    stbi_set_flip_vertically_on_load(true);
 
-    // define materials and lights
-    DefineObjectMaterials();
-    SetupSceneLights();
+    std::vector<DECODED_IMAGE> images(fileCount);
+    auto decodeImages = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            DecodeTextureImage(pFiles[i].filename, images[i]);
+        }
+    };
+
+    if (m_pJobSystem != nullptr)
+    {
+        m_pJobSystem->ParallelFor(fileCount, 1, decodeImages);
+    }
+    else
+    {
+        decodeImages(0, fileCount);
+    }
 
-    // only one instance of a particular mesh needs to be loaded
-    // in memory no matter how many times it is drawn
-    m_basicMeshes->LoadBoxMesh();
-    m_basicMeshes->LoadPlaneMesh();
-    m_basicMeshes->LoadCylinderMesh();
-    m_basicMeshes->LoadConeMesh();
-    m_basicMeshes->LoadPrismMesh();
-    m_basicMeshes->LoadPyramid4Mesh();
-    m_basicMeshes->LoadSphereMesh();
-    m_basicMeshes->LoadTaperedCylinderMesh();
-    m_basicMeshes->LoadTorusMesh();
+    for (size_t i = 0; i < fileCount; ++i)
+    {
+        UploadGLTexture(images[i], pFiles[i].tag);
+    }
 }
 
 /***********************************************************
- *  RenderScene()
+ *  PrepareScene()
  *
- *  Render the 3D scene by transforming and drawing shapes.
+ *  Prepare the 3D scene by loading shapes, textures, and
+ *  materials into memory. When a scene file is passed in
+ *  and can be loaded, it replaces the built-in scene.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::PrepareScene(const char* sceneFilename)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    if (sceneFilename == nullptr || !LoadSceneFile(sceneFilename))
+    {
+        // load the textures for the 3D scene
+        LoadSceneTextures();
+
+        // define materials, lights and the objects in the scene
+        DefineObjectMaterials();
+        DefineSceneLights();
+        DefineSceneObjects();
+    }
+    SetupSceneLights();
+    // textures are mapped once across each mesh
+    SetTextureUVScale(1.0f, 1.0f);
+
+    // the meshes are not loaded here: the shared registry loads
+    // the ones the objects reference when they are first drawn
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object with the passed
+ *  in mesh, transformation and shader settings to the scene.
+ ***********************************************************/
+ENTITY_HANDLE SceneManager::AddSceneObject(
+    MESH_TYPE mesh,
+    glm::vec3 scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    glm::vec3 positionXYZ,
+    TAG_ID materialTag,
+    TAG_ID textureTag,
+    glm::vec4 color)
+{
+    DetachSceneFile();
+
+    int materialIndex = materialTag.IsEmpty() ? -1 : FindMaterialIndex(materialTag);
+    if (materialTag.IsEmpty() && m_entities.GetCount() > 0)
+    {
+        // the shader keeps the material of the previous draw
+        materialIndex = m_entities.GetMaterialIndices()[m_entities.GetCount() - 1];
+    }
+    int textureSlot = textureTag.IsEmpty() ? -1 : FindTextureSlot(textureTag);
+
+    ENTITY_COMPONENTS components;
+    components.scaleXYZ        = scaleXYZ;
+    components.rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+    components.positionXYZ     = positionXYZ;
+    components.color           = color;
+    components.mesh            = static_cast<uint8_t>(mesh);
+    components.materialIndex   = static_cast<int16_t>(materialIndex);
+    components.textureSlot     = static_cast<int16_t>(textureSlot);
+    ENTITY_HANDLE object = m_entities.Create(components);
+    UseObjectStorage();
+    ReferenceMesh(mesh);
+    // the new object may join a static batch
+    m_bStaticBatchesDirty = true;
+    m_bGpuObjectsDirty = true;
+    return object;
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object whose material
+ *  and texture tags are only known at run time.
+ ***********************************************************/
+ENTITY_HANDLE SceneManager::AddSceneObject(
+    MESH_TYPE mesh,
+    glm::vec3 scaleXYZ,
+    float XrotationDegrees,
+    float YrotationDegrees,
+    float ZrotationDegrees,
+    glm::vec3 positionXYZ,
+    const std::string& materialTag,
+    const std::string& textureTag,
+    glm::vec4 color)
+{
+    return AddSceneObject(mesh, scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees,
+                   positionXYZ, MakeTag(materialTag), MakeTag(textureTag), color);
+}
+
+/***********************************************************
+ *  RemoveSceneObject()
+ *
+ *  This method is used for removing an object from the
+ *  scene. The last object takes its place in the object
+ *  arrays.
+ ***********************************************************/
+void SceneManager::RemoveSceneObject(ENTITY_HANDLE object)
+{
+    const int slot = m_entities.GetSlot(object);
+    if (slot >= 0 && (m_entities.GetFlags()[slot] & ENTITY_FLAG_BATCHED))
+    {
+        m_bStaticBatchesDirty = true;
+    }
+    m_bGpuObjectsDirty = true;
+
+    m_entities.Destroy(object);
+    UseObjectStorage();
+}
+
+/***********************************************************
+ *  SetSceneObjectTransform()
+ *
+ *  This method is used for moving an object; its model
+ *  matrix and bounds are updated when the next frame is
+ *  built. An object that moves leaves its static batch and
+ *  is drawn on its own from then on, so the batch is not
+ *  rebuilt every time it moves.
+ ***********************************************************/
+void SceneManager::SetSceneObjectTransform(
+    ENTITY_HANDLE object,
+    glm::vec3 scaleXYZ,
+    glm::vec3 rotationDegrees,
+    glm::vec3 positionXYZ)
+{
+    const int slot = m_entities.GetSlot(object);
+    if (slot >= 0 && (m_entities.GetFlags()[slot] & ENTITY_FLAG_BATCHED))
+    {
+        m_bStaticBatchesDirty = true;
+    }
+    m_bGpuObjectsDirty = true;
+
+    m_entities.SetTransform(object, scaleXYZ, rotationDegrees, positionXYZ);
+}
+
+/***********************************************************
+ *  SetSceneObjectVisible()
+ *
+ *  This method is used for hiding an object without
+ *  removing it, or showing it again.
+ ***********************************************************/
+void SceneManager::SetSceneObjectVisible(ENTITY_HANDLE object, bool bVisible)
+{
+    const int slot = m_entities.GetSlot(object);
+    if (slot >= 0 && ((m_entities.GetFlags()[slot] & ENTITY_FLAG_HIDDEN) != 0) == bVisible)
+    {
+        // a hidden object leaves its batch, a shown one may join one
+        m_bStaticBatchesDirty = true;
+        m_bGpuObjectsDirty = true;
+    }
+
+    m_entities.SetHidden(object, !bVisible);
+}
+
+/***********************************************************
+ *  UseObjectStorage()
+ *
+ *  Point the object arrays at the entity components. Called
+ *  whenever they may have been reallocated.
+ ***********************************************************/
+void SceneManager::UseObjectStorage()
+{
+    m_objects.count           = m_entities.GetCount();
+    m_objects.scaleXYZ        = m_entities.GetScales();
+    m_objects.rotationDegrees = m_entities.GetRotations();
+    m_objects.positionXYZ     = m_entities.GetPositions();
+    m_objects.color           = m_entities.GetColors();
+    m_objects.mesh            = m_entities.GetMeshes();
+    m_objects.materialIndex   = m_entities.GetMaterialIndices();
+    m_objects.textureSlot     = m_entities.GetTextureSlots();
+    m_objects.model           = m_entities.GetModelMatrices();
+    m_objects.worldBounds     = m_entities.GetWorldBounds();
+    m_objects.flags           = m_entities.GetFlags();
+}
+
+/***********************************************************
+ *  UpdateEntityTransforms()
+ *
+ *  The transform system: calculate the model matrix and the
+ *  world bounding sphere of every entity flagged as moved,
+ *  walking the packed component arrays. The scene file and
+ *  streamed objects have no cached transforms and are still
+ *  transformed by the frame preparation jobs.
+ ***********************************************************/
+void SceneManager::UpdateEntityTransforms()
+{
+    const size_t dirtyCount = m_entities.GetDirtyCount();
+    if (dirtyCount == 0)
+    {
+        return;
+    }
+
+    const glm::vec3* pScales = m_entities.GetScales();
+    const glm::vec3* pRotations = m_entities.GetRotations();
+    const glm::vec3* pPositions = m_entities.GetPositions();
+    const uint8_t* pMeshes = m_entities.GetMeshes();
+    glm::mat4* pModels = m_entities.GetModelMatrices();
+    glm::vec4* pBounds = m_entities.GetWorldBounds();
+    uint8_t* pFlags = m_entities.GetFlags();
+
+    auto updateTransforms = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (!(pFlags[i] & ENTITY_FLAG_TRANSFORM_DIRTY))
+            {
+                continue;
+            }
+            pModels[i] = CalculateModelMatrix(
+                pScales[i], pRotations[i].x, pRotations[i].y, pRotations[i].z, pPositions[i]);
+            pBounds[i] = TransformBoundingSphere(pModels[i], g_MeshBounds[pMeshes[i]]);
+            pFlags[i] = static_cast<uint8_t>(pFlags[i] & ~ENTITY_FLAG_TRANSFORM_DIRTY);
+        }
+    };
+
+    if (m_pJobSystem != nullptr && dirtyCount > FRAME_JOB_GRAIN_SIZE)
+    {
+        m_pJobSystem->ParallelFor(m_entities.GetCount(), FRAME_JOB_GRAIN_SIZE, updateTransforms);
+    }
+    else
+    {
+        updateTransforms(0, m_entities.GetCount());
+    }
+    m_entities.ClearDirtyCount();
+}
+
+/***********************************************************
+ *  UpdateStaticBatches()
+ *
+ *  Regroup the static batches after an object joined or
+ *  left them. Visible opaque entities that never moved are
+ *  batchable; the batcher only transforms the groups whose
+ *  objects changed. The members are flagged, so the frame
+ *  preparation skips them.
+ ***********************************************************/
+void SceneManager::UpdateStaticBatches()
+{
+    if (!m_bStaticBatching || !m_bStaticBatchesDirty)
+    {
+        return;
+    }
+    m_bStaticBatchesDirty = false;
+
+    const size_t count = m_entities.GetCount();
+    const int16_t* pTextures = m_entities.GetTextureSlots();
+    const glm::vec4* pColors = m_entities.GetColors();
+    uint8_t* pFlags = m_entities.GetFlags();
+
+    uint8_t* pBatchable = GetFrameArena().AllocateArray<uint8_t>(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        pBatchable[i] = (!(pFlags[i] & (ENTITY_FLAG_HIDDEN | ENTITY_FLAG_MOVED)) &&
+                         !IsTranslucent(pTextures[i], pColors[i])) ? 1 : 0;
+        pFlags[i] = static_cast<uint8_t>(pFlags[i] & ~ENTITY_FLAG_BATCHED);
+    }
+
+    m_staticBatcher.Build(m_entities, pBatchable, m_basicMeshes->GetOptimization());
+    for (const ENTITY_HANDLE& object : m_staticBatcher.GetBatches()->objects)
+    {
+        pFlags[m_entities.GetSlot(object)] |= ENTITY_FLAG_BATCHED;
+    }
+}
+
+/***********************************************************
+ *  UpdateGpuObjects()
+ *
+ *  Build a new object table for the GPU culling after an
+ *  object was added, removed, moved, hidden or shown, or the
+ *  streamed cells changed. The objects of the scene file and
+ *  the cells get their transforms calculated here, so a
+ *  frame that changed nothing does no work per object. A
+ *  material index of -1 is resolved to the material of the
+ *  object before it. Hidden objects stay in the table,
+ *  flagged to be skipped.
+ ***********************************************************/
+void SceneManager::UpdateGpuObjects()
+{
+    if (!m_bGpuCulling || !m_bGpuObjectsDirty)
+    {
+        return;
+    }
+    m_bGpuObjectsDirty = false;
+
+    std::shared_ptr<GPU_OBJECT_SET> pSet = std::make_shared<GPU_OBJECT_SET>();
+    size_t objectCount = m_objects.count;
+    for (const SCENE_OBJECT_ARRAYS& cell : m_streamedObjects)
+    {
+        objectCount += cell.count;
+    }
+    pSet->objects.reserve(objectCount);
+
+    int currentMaterial = 0;
+    auto appendObjects = [&](const SCENE_OBJECT_ARRAYS& objects)
+    {
+        for (size_t j = 0; j < objects.count; ++j)
+        {
+            const MESH_TYPE mesh = static_cast<MESH_TYPE>(objects.mesh[j]);
+
+            GPU_OBJECT_ENTRY entry;
+            if (objects.model != nullptr)
+            {
+                entry.model = objects.model[j];
+                entry.bounds = objects.worldBounds[j];
+            }
+            else
+            {
+                const glm::vec3& rotation = objects.rotationDegrees[j];
+                entry.model = CalculateModelMatrix(
+                    objects.scaleXYZ[j], rotation.x, rotation.y, rotation.z, objects.positionXYZ[j]);
+                entry.bounds = TransformBoundingSphere(entry.model, g_MeshBounds[mesh]);
+            }
+
+            const int materialIndex = objects.materialIndex[j];
+            if (materialIndex >= 0 && materialIndex < static_cast<int>(MAX_SHADER_MATERIALS))
+            {
+                currentMaterial = materialIndex;
+            }
+            const int textureSlot = objects.textureSlot[j];
+
+            entry.color = objects.color[j];
+            entry.mesh = mesh;
+            entry.materialIndex = currentMaterial;
+            entry.textureSlot = (textureSlot < static_cast<int>(MAX_SHADER_TEXTURES)) ? std::max(textureSlot, -1) : -1;
+            entry.flags = 0;
+
+            const bool bHidden = objects.flags != nullptr && (objects.flags[j] & ENTITY_FLAG_HIDDEN) != 0;
+            const bool bTranslucent = IsTranslucent(textureSlot, entry.color);
+            if (bHidden || bTranslucent)
+            {
+                entry.flags |= GPU_OBJECT_SKIP_CULLING;
+            }
+            if (bTranslucent && !bHidden)
+            {
+                pSet->translucentObjects.push_back(static_cast<uint32_t>(pSet->objects.size()));
+            }
+            pSet->objects.push_back(entry);
+        }
+    };
+
+    appendObjects(m_objects);
+    for (const SCENE_OBJECT_ARRAYS& cell : m_streamedObjects)
+    {
+        appendObjects(cell);
+    }
+
+    pSet->version = ++g_GpuObjectSetVersion;
+    m_pGpuObjects = pSet;
+}
+
+/***********************************************************
+ *  IsTranslucent()
+ *
+ *  A textured draw is blended when its texture has an alpha
+ *  channel, a solid one when its color is not opaque.
+ ***********************************************************/
+bool SceneManager::IsTranslucent(int textureSlot, const glm::vec4& color) const
+{
+    return (textureSlot >= 0 && textureSlot < static_cast<int>(m_textures.size()))
+        ? m_textures[textureSlot].bHasAlpha
+        : (color.w < 1.0f);
+}
+
+/***********************************************************
+ *  DetachSceneFile()
+ *
+ *  Copy the objects that are used in place from the mapped
+ *  scene file into entities and close the file. Nothing
+ *  happens when no scene file is open.
+ ***********************************************************/
+void SceneManager::DetachSceneFile()
+{
+    if (!m_sceneFile.IsOpen())
+    {
+        return;
+    }
+
+    const size_t count = m_objects.count;
+    m_entities.Clear();
+    m_entities.Reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        ENTITY_COMPONENTS components;
+        components.scaleXYZ        = m_objects.scaleXYZ[i];
+        components.rotationDegrees = m_objects.rotationDegrees[i];
+        components.positionXYZ     = m_objects.positionXYZ[i];
+        components.color           = m_objects.color[i];
+        components.mesh            = m_objects.mesh[i];
+        components.materialIndex   = m_objects.materialIndex[i];
+        components.textureSlot     = m_objects.textureSlot[i];
+        m_entities.Create(components);
+    }
+
+    m_fileTextureSlots = std::vector<int16_t>();
+    m_sceneFile.Close();
+    UseObjectStorage();
+    m_bStaticBatchesDirty = true;
+    m_bGpuObjectsDirty = true;
+}
+
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  Map a binary scene file and use its object arrays in
+ *  place. Only the small tables are copied: the textures
+ *  are loaded in table order, so a texture index in the
+ *  file is also its texture slot, and the materials keep
+ *  their table order as well. The object arrays are checked
+ *  once so the frame preparation can index with them.
+ *  Streamed textures only get their slots reserved here.
+ *  A scene with more materials or textures than the shader
+ *  tables hold is still loaded, it can only be drawn with
+ *  the glUniform path.
+ ***********************************************************/
+bool SceneManager::LoadSceneFile(const char* filename, bool bStreamTextures)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    SceneFile& file = m_sceneFile;
+    DetachSceneFile();
+    if (!file.Open(filename))
+    {
+        return false;
+    }
+
+    const size_t objectCount = file.GetObjectCount();
+    const uint8_t* pMeshes = file.GetSection<uint8_t>(SCENE_SECTION_MESH);
+    const int16_t* pMaterials = file.GetSection<int16_t>(SCENE_SECTION_MATERIAL_INDEX);
+    const int16_t* pTextures = file.GetSection<int16_t>(SCENE_SECTION_TEXTURE_INDEX);
+    const int materialCount = static_cast<int>(file.GetMaterialCount());
+    const int textureCount = static_cast<int>(file.GetTextureCount());
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        if (pMeshes[i] >= MESH_COUNT ||
+            pMaterials[i] < -1 || pMaterials[i] >= materialCount ||
+            pTextures[i] < -1 || pTextures[i] >= textureCount)
+        {
+            std::cout << "Invalid object " << i << " in scene file: " << filename << std::endl;
+            file.Close();
+            return false;
+        }
+    }
+
+    // textures, in table order
+    const SCENE_FILE_TEXTURE* pTextureTable = file.GetSection<SCENE_FILE_TEXTURE>(SCENE_SECTION_TEXTURES);
+    DestroyGLTextures();
+    if (bStreamTextures)
+    {
+        // the streamed images are decoded later, flipped like the others
+        stbi_set_flip_vertically_on_load(true);
+        for (int i = 0; i < textureCount; ++i)
+        {
+            TEXTURE_INFO texInfo;
+            texInfo.ID = 0;
+            texInfo.bHasAlpha = false;
+            m_textures.push_back(texInfo);
+            m_textureTags.Add(file.GetString(pTextureTable[i].tag));
+        }
+    }
+    else if ((m_pShaderManager != nullptr || m_pSoftwareRasterizer != nullptr) && textureCount > 0)
+    {
+        std::vector<TEXTURE_FILE> textureFiles(textureCount);
+        for (int i = 0; i < textureCount; ++i)
+        {
+            textureFiles[i].filename = file.GetString(pTextureTable[i].filename);
+            textureFiles[i].tag = file.GetString(pTextureTable[i].tag);
+        }
+        LoadGLTextures(textureFiles.data(), textureFiles.size());
+        BindGLTextures();
+    }
+
+    // materials
+    m_objectMaterials.clear();
+    m_materialTags.Clear();
+    const SCENE_FILE_MATERIAL* pMaterialTable = file.GetSection<SCENE_FILE_MATERIAL>(SCENE_SECTION_MATERIALS);
+    for (int i = 0; i < materialCount; ++i)
+    {
+        const SCENE_FILE_MATERIAL& entry = pMaterialTable[i];
+        OBJECT_MATERIAL material;
+        material.ambientColor    = glm::vec3(entry.ambientColor[0], entry.ambientColor[1], entry.ambientColor[2]);
+        material.ambientStrength = entry.ambientStrength;
+        material.diffuseColor    = glm::vec3(entry.diffuseColor[0], entry.diffuseColor[1], entry.diffuseColor[2]);
+        material.specularColor   = glm::vec3(entry.specularColor[0], entry.specularColor[1], entry.specularColor[2]);
+        material.shininess       = entry.shininess;
+        AddObjectMaterial(file.GetString(entry.tag), material);
+    }
+    if (materialCount > static_cast<int>(MAX_SHADER_MATERIALS) ||
+        textureCount > static_cast<int>(MAX_SHADER_TEXTURES))
+    {
+        std::cout << "WARNING: Scene file " << filename << " has " << materialCount << " materials and "
+                  << textureCount << " textures, more than the " << MAX_SHADER_MATERIALS << " and "
+                  << MAX_SHADER_TEXTURES << " of the ring buffer and GPU culling, it will be drawn with glUniform"
+                  << std::endl;
+    }
+
+    // lights
+    m_lightSources.clear();
+    const SCENE_FILE_LIGHT* pLightTable = file.GetSection<SCENE_FILE_LIGHT>(SCENE_SECTION_LIGHTS);
+    for (uint32_t i = 0; i < file.GetLightCount(); ++i)
+    {
+        const SCENE_FILE_LIGHT& entry = pLightTable[i];
+        LIGHT_SOURCE light;
+        light.position          = glm::vec3(entry.position[0], entry.position[1], entry.position[2]);
+        light.diffuseColor      = glm::vec3(entry.diffuseColor[0], entry.diffuseColor[1], entry.diffuseColor[2]);
+        light.specularColor     = glm::vec3(entry.specularColor[0], entry.specularColor[1], entry.specularColor[2]);
+        light.focalStrength     = entry.focalStrength;
+        light.specularIntensity = entry.specularIntensity;
+        m_lightSources.push_back(light);
+    }
+
+    // objects, used in place
+    m_entities.Clear();
+    m_bStaticBatchesDirty = true;
+    m_bGpuObjectsDirty = true;
+    m_fileTextureSlots.clear();
+    m_objects.count           = objectCount;
+    m_objects.scaleXYZ        = file.GetSection<glm::vec3>(SCENE_SECTION_SCALE);
+    m_objects.rotationDegrees = file.GetSection<glm::vec3>(SCENE_SECTION_ROTATION);
+    m_objects.positionXYZ     = file.GetSection<glm::vec3>(SCENE_SECTION_POSITION);
+    m_objects.color           = file.GetSection<glm::vec4>(SCENE_SECTION_COLOR);
+    m_objects.mesh            = pMeshes;
+    m_objects.materialIndex   = pMaterials;
+    m_objects.textureSlot     = pTextures;
+    m_objects.model           = nullptr;
+    m_objects.worldBounds     = nullptr;
+    m_objects.flags           = nullptr;
+
+    // a texture that failed to load shifts the slots of the ones
+    // after it; only then are the texture indices remapped
+    bool bSlotsMatch = true;
+    for (int i = 0; i < textureCount && bSlotsMatch; ++i)
+    {
+        bSlotsMatch = FindTextureSlot(TAG_ID(HashTag(file.GetString(pTextureTable[i].tag)))) == i;
+    }
+    if (!bSlotsMatch)
+    {
+        std::vector<int16_t> slots(textureCount);
+        for (int i = 0; i < textureCount; ++i)
+        {
+            slots[i] = static_cast<int16_t>(FindTextureSlot(TAG_ID(HashTag(file.GetString(pTextureTable[i].tag)))));
+        }
+        m_fileTextureSlots.resize(objectCount);
+        for (size_t i = 0; i < objectCount; ++i)
+        {
+            m_fileTextureSlots[i] = (pTextures[i] >= 0) ? slots[pTextures[i]] : -1;
+        }
+        m_objects.textureSlot = m_fileTextureSlots.data();
+    }
+
+    UpdateMeshReferences();
+
+    std::cout << "INFO: Loaded scene file " << filename << " (" << objectCount << " objects)" << std::endl;
+    return true;
+}
+
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  Configure the transformations, meshes and shader settings
+ *  of all the objects in the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
 {
-    glm::vec3 scaleXYZ;
-    float XrotationDegrees = 0.0f;
-    float YrotationDegrees = 0.0f;
-    float ZrotationDegrees = 0.0f;
-    glm::vec3 positionXYZ;
+    // start from an empty scene; the shapes of the previous one
+    // stay loaded until the next frame is submitted
+    m_sceneFile.Close();
+    m_entities.Clear();
+    m_bStaticBatchesDirty = true;
+    m_bGpuObjectsDirty = true;
+    m_fileTextureSlots = std::vector<int16_t>();
+    UseObjectStorage();
+    UpdateMeshReferences();
 
     /*** Render the Table ***/
-    scaleXYZ    = glm::vec3(12.0f, 0.3f, 12.0f);
-    positionXYZ = glm::vec3(0.0f, -3.0f, 0.0f);
-    XrotationDegrees = YrotationDegrees = ZrotationDegrees = 0.0f;
-    SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-    SetShaderMaterial("wood");
-    SetShaderTexture("wood");
-    m_basicMeshes->DrawCylinderMesh();
+    AddSceneObject(MESH_CYLINDER,
+        glm::vec3(12.0f, 0.3f, 12.0f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -3.0f, 0.0f),
+        TAG("wood"), TAG("wood"));
 
     /*** Render the Lamp Base ***/
-    scaleXYZ    = glm::vec3(0.8f, 1.5f, 0.8f);
-    positionXYZ = glm::vec3(0.0f, -1.95f, -1.0f);
-    XrotationDegrees = YrotationDegrees = ZrotationDegrees = 0.0f;
-    SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-    SetShaderMaterial("gold");
-    SetShaderTexture("gold");
-    m_basicMeshes->DrawCylinderMesh();
+    AddSceneObject(MESH_CYLINDER,
+        glm::vec3(0.8f, 1.5f, 0.8f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -1.95f, -1.0f),
+        TAG("gold"), TAG("gold"));
 
     /*** Render the Lamp Shade ***/
-    scaleXYZ    = glm::vec3(1.2f, 1.2f, 1.2f);
-    positionXYZ = glm::vec3(0.0f, -0.25f, -1.0f);
-    XrotationDegrees = YrotationDegrees = ZrotationDegrees = 0.0f;
-    SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-    SetShaderMaterial("glass");
-    SetShaderTexture("light"); // fixed: tag matches LoadSceneTextures
-    m_basicMeshes->DrawConeMesh();
+    AddSceneObject(MESH_CONE,
+        glm::vec3(1.2f, 1.2f, 1.2f), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, -0.25f, -1.0f),
+        TAG("glass"), TAG("light")); // fixed: tag matches LoadSceneTextures
 
     /*** Render the Coffee Mug ***/
-    scaleXYZ    = glm::vec3(0.6f, 0.7f, 0.6f);
-    positionXYZ = glm::vec3(1.5f, -2.85f, -1.2f);
-    XrotationDegrees = 0.0f;
-    YrotationDegrees = 30.0f;
-    ZrotationDegrees = 0.0f;
-    SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-    SetShaderMaterial("ceramic"); // now defined in materials
-    SetShaderTexture("Mug");
-    m_basicMeshes->DrawCylinderMesh();
+    AddSceneObject(MESH_CYLINDER,
+        glm::vec3(0.6f, 0.7f, 0.6f), 0.0f, 30.0f, 0.0f, glm::vec3(1.5f, -2.85f, -1.2f),
+        TAG("ceramic"), TAG("Mug")); // now defined in materials
 
     /*** Render the Book ***/
-    scaleXYZ    = glm::vec3(1.5f, 0.2f, 1.0f);
-    positionXYZ = glm::vec3(-1.2f, -2.7f, -1.5f);
-    XrotationDegrees = YrotationDegrees = ZrotationDegrees = 0.0f;
-    SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-    SetShaderColor(0.5f, 0.2f, 0.1f, 1.0f);
-    m_basicMeshes->DrawBoxMesh();
+    AddSceneObject(MESH_BOX,
+        glm::vec3(1.5f, 0.2f, 1.0f), 0.0f, 0.0f, 0.0f, glm::vec3(-1.2f, -2.7f, -1.5f),
+        TAG_ID(), TAG_ID(), glm::vec4(0.5f, 0.2f, 0.1f, 1.0f));
 
     /*** Render the Laptop Base ***/
-    scaleXYZ    = glm::vec3(2.5f, 0.2f, 1.8f);
-    positionXYZ = glm::vec3(-0.5f, -2.7f, 0.5f);
-    XrotationDegrees = YrotationDegrees = ZrotationDegrees = 0.0f;
-    SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-    SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);
-    m_basicMeshes->DrawBoxMesh();
+    AddSceneObject(MESH_BOX,
+        glm::vec3(2.5f, 0.2f, 1.8f), 0.0f, 0.0f, 0.0f, glm::vec3(-0.5f, -2.7f, 0.5f),
+        TAG_ID(), TAG_ID(), glm::vec4(0.2f, 0.2f, 0.2f, 1.0f));
 
     /*** Render the Laptop Screen ***/
-    scaleXYZ    = glm::vec3(2.5f, 1.5f, 0.2f);
-    positionXYZ = glm::vec3(-0.5f, -1.3f, 1.0f);
-    XrotationDegrees = -60.0f;
-    YrotationDegrees = ZrotationDegrees = 0.0f;
-    SetTransformations(scaleXYZ, XrotationDegrees, YrotationDegrees, ZrotationDegrees, positionXYZ);
-    SetShaderColor(0.3f, 0.3f, 0.3f, 1.0f);
-    m_basicMeshes->DrawPlaneMesh();
-}
\ No newline at end of file
+    AddSceneObject(MESH_PLANE,
+        glm::vec3(2.5f, 1.5f, 0.2f), -60.0f, 0.0f, 0.0f, glm::vec3(-0.5f, -1.3f, 1.0f),
+        TAG_ID(), TAG_ID(), glm::vec4(0.3f, 0.3f, 0.3f, 1.0f));
+}
+
+/***********************************************************
+ *  SetStreamedObjects()
+ *
+ *  Replace the object arrays of the streamed world cells.
+ *  They are drawn after the scene objects, starting with
+ *  the next frame that is built.
+ ***********************************************************/
+void SceneManager::SetStreamedObjects(const std::vector<SCENE_OBJECT_ARRAYS>& objects)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    m_streamedObjects = objects;
+    m_bGpuObjectsDirty = true;
+    UpdateMeshReferences();
+}
+
+/***********************************************************
+ *  BuildFramePacket()
+ *
+ *  Build the draw list for the next frame from the scene
+ *  objects, culled to the view stored in the packet. No
+ *  OpenGL calls are made here, so this can run on the main
+ *  thread while the render thread is still submitting the
+ *  previous frame.
+ ***********************************************************/
+void SceneManager::BuildFramePacket(FRAME_PACKET& packet)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    m_cullViewProjection = packet.projection * packet.view;
+    m_cullFrusta.assign(1, ExtractFrustum(m_cullViewProjection));
+    m_bCullToFrustum = true;
+    m_cullViewPosition = packet.viewPosition;
+
+    if (m_pWorldStreamer != nullptr)
+    {
+        // the camera looks down the negative z axis of the view
+        const glm::vec3 viewDirection(-packet.view[0][2], -packet.view[1][2], -packet.view[2][2]);
+        m_pWorldStreamer->Update(packet.viewPosition, viewDirection, packet.frameIndex);
+    }
+
+    BuildDrawList(packet);
+}
+
+/***********************************************************
+ *  BuildMultiViewPacket()
+ *
+ *  Build the draw list of a multi-view pass. An object is
+ *  kept when any camera can see it, so the list is built
+ *  and submitted once for all of them. Translucent draws
+ *  are sorted from the middle of the cameras, as no single
+ *  back to front order suits every view.
+ ***********************************************************/
+void SceneManager::BuildMultiViewPacket(
+    FRAME_PACKET& packet,
+    const glm::mat4* pViewProjections,
+    const glm::vec3* pViewPositions,
+    size_t viewCount)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    m_cullFrusta.resize(viewCount);
+    glm::vec3 viewCenter(0.0f);
+    for (size_t i = 0; i < viewCount; ++i)
+    {
+        m_cullFrusta[i] = ExtractFrustum(pViewProjections[i]);
+        viewCenter += pViewPositions[i];
+    }
+    m_bCullToFrustum = viewCount > 0;
+    m_cullViewPosition = viewCount > 0 ? viewCenter / static_cast<float>(viewCount) : viewCenter;
+    m_cullViewProjection = viewCount > 0 ? pViewProjections[0] : glm::mat4(1.0f);
+
+    BuildDrawList(packet);
+}
+
+/***********************************************************
+ *  BuildDrawList()
+ *
+ *  Update the object transforms, cull them and build their
+ *  draw commands. With a job system, each chunk of objects
+ *  is prepared by one job that appends to the draw list of
+ *  the thread it runs on, and the merge into the packet is a
+ *  job that depends on all of them. The scene objects and
+ *  the streamed cells are numbered as one list.
+ *
+ *  The temporary arrays come from the frame arenas and are
+ *  dropped, not freed, when the frame ends.
+ ***********************************************************/
+void SceneManager::BuildDrawList(FRAME_PACKET& packet)
+{
+    UpdateEntityTransforms();
+
+    // the GPU culls the opaque objects itself
+    if (m_bGpuCulling)
+    {
+        UpdateGpuObjects();
+        PrepareGpuTranslucents(packet);
+        return;
+    }
+
+    UpdateStaticBatches();
+
+    FrameArena& arena = GetFrameArena();
+
+    m_objectChunkCount = 1 + m_streamedObjects.size();
+    m_pObjectChunks = arena.AllocateArray<SCENE_OBJECT_ARRAYS>(m_objectChunkCount);
+    m_pObjectChunks[0] = m_objects;
+    std::copy(m_streamedObjects.begin(), m_streamedObjects.end(), m_pObjectChunks + 1);
+    m_pChunkOffsets = arena.AllocateArray<size_t>(m_objectChunkCount + 1);
+    m_pChunkOffsets[0] = 0;
+    for (size_t i = 0; i < m_objectChunkCount; ++i)
+    {
+        m_pChunkOffsets[i + 1] = m_pChunkOffsets[i] + m_pObjectChunks[i].count;
+    }
+
+    const size_t objectCount = m_pChunkOffsets[m_objectChunkCount];
+    const size_t threadCount = (m_pJobSystem != nullptr) ? m_pJobSystem->GetThreadCount() : 1;
+
+    m_pObjectTransforms = arena.AllocateArray<glm::mat4>(objectCount);
+    m_pObjectBounds = arena.AllocateArray<glm::vec4>(objectCount);
+    m_pObjectVisible = arena.AllocateArray<unsigned char>(objectCount);
+    // each list is bound to the arena of its thread by the first
+    // PrepareObjects() call there
+    m_threadDrawLists.resize(threadCount);
+    for (auto& drawList : m_threadDrawLists)
+    {
+        drawList.commands = FrameVector<DRAW_COMMAND>();
+    }
+    m_pBuildPacket = &packet;
+    PrepareStaticBatches(packet, objectCount);
+
+    if (m_pJobSystem != nullptr && objectCount > FRAME_JOB_GRAIN_SIZE)
+    {
+        JobCounter objectsPrepared(0);
+        JobCounter drawListBuilt(0);
+
+        m_pJobSystem->ParallelFor(objectCount, FRAME_JOB_GRAIN_SIZE,
+            &SceneManager::PrepareObjectsJob, this, &objectsPrepared);
+        m_pJobSystem->Run(&SceneManager::MergeDrawListsJob, this,
+            &drawListBuilt, 0, 1, &objectsPrepared);
+        m_pJobSystem->Wait(&drawListBuilt);
+    }
+    else
+    {
+        PrepareObjects(0, objectCount);
+        MergeDrawLists();
+    }
+
+    // an occluder hides different objects from each camera, so
+    // only the lists of a single view are culled
+    if (m_pOcclusionCuller != nullptr && m_bCullToFrustum && m_cullFrusta.size() == 1)
+    {
+        CullOccludedDraws(packet);
+    }
+
+    m_pBuildPacket = nullptr;
+}
+
+/***********************************************************
+ *  PrepareObjects()
+ *
+ *  Calculate the model matrices and world bounds of a range
+ *  of scene objects, test them against the view frustum and
+ *  append the draw commands of the visible ones to the draw
+ *  list of the calling thread.
+ ***********************************************************/
+void SceneManager::PrepareObjects(size_t begin, size_t end)
+{
+    int workerIndex = JobSystem::GetCurrentWorkerIndex();
+    if (workerIndex < 0 || workerIndex >= static_cast<int>(m_threadDrawLists.size()))
+    {
+        workerIndex = 0;
+    }
+    FrameVector<DRAW_COMMAND>& drawCommands = m_threadDrawLists[workerIndex].commands;
+    if (drawCommands.get_allocator().GetArena() == nullptr)
+    {
+        drawCommands = FrameVector<DRAW_COMMAND>(FrameAllocator<DRAW_COMMAND>(&GetFrameArena()));
+        drawCommands.reserve(end - begin);
+    }
+
+    // object arrays that hold the first object of the range
+    size_t chunk = std::upper_bound(m_pChunkOffsets, m_pChunkOffsets + m_objectChunkCount + 1, begin)
+        - m_pChunkOffsets - 1;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        while (i >= m_pChunkOffsets[chunk + 1])
+        {
+            ++chunk;
+        }
+        const SCENE_OBJECT_ARRAYS& objects = m_pObjectChunks[chunk];
+        const size_t j = i - m_pChunkOffsets[chunk];
+
+        const MESH_TYPE mesh = static_cast<MESH_TYPE>(objects.mesh[j]);
+
+        // transform update, unless the entity transform system
+        // already did it
+        if (objects.model != nullptr)
+        {
+            if (objects.flags[j] & (ENTITY_FLAG_HIDDEN | ENTITY_FLAG_BATCHED))
+            {
+                m_pObjectVisible[i] = 0;
+                continue;
+            }
+            m_pObjectTransforms[i] = objects.model[j];
+            m_pObjectBounds[i] = objects.worldBounds[j];
+        }
+        else
+        {
+            const glm::vec3& rotation = objects.rotationDegrees[j];
+            m_pObjectTransforms[i] = CalculateModelMatrix(
+                objects.scaleXYZ[j],
+                rotation.x,
+                rotation.y,
+                rotation.z,
+                objects.positionXYZ[j]);
+            m_pObjectBounds[i] = TransformBoundingSphere(
+                m_pObjectTransforms[i], g_MeshBounds[mesh]);
+        }
+        const glm::vec3 center(m_pObjectBounds[i].x, m_pObjectBounds[i].y, m_pObjectBounds[i].z);
+
+        // frustum culling
+        bool bVisible = !m_bCullToFrustum;
+        for (size_t view = 0; !bVisible && view < m_cullFrusta.size(); ++view)
+        {
+            bVisible = IsSphereInFrustum(m_cullFrusta[view], center, m_pObjectBounds[i].w);
+        }
+        m_pObjectVisible[i] = bVisible ? 1 : 0;
+        if (!bVisible)
+        {
+            continue;
+        }
+
+        // draw command
+        DRAW_COMMAND command;
+        command.objectIndex   = static_cast<uint32_t>(i);
+        command.model         = m_pObjectTransforms[i];
+        command.color         = objects.color[j];
+        command.mesh          = mesh;
+        command.materialIndex = objects.materialIndex[j];
+        command.textureSlot   = objects.textureSlot[j];
+        command.staticBatch   = -1;
+
+        bool bTranslucent = IsTranslucent(command.textureSlot, command.color);
+        float viewDistance = m_bCullToFrustum ? glm::length(center - m_cullViewPosition) : 0.0f;
+        command.sortKey = MakeDrawSortKey(
+            command.mesh, command.materialIndex, command.textureSlot, bTranslucent, viewDistance);
+
+        drawCommands.push_back(command);
+    }
+}
+
+/***********************************************************
+ *  PrepareStaticBatches()
+ *
+ *  Hand the current static batches to the packet and build
+ *  a draw command for each one that is in view. A batch is
+ *  culled with the sphere around all of its objects and
+ *  numbered after the scene objects.
+ ***********************************************************/
+void SceneManager::PrepareStaticBatches(FRAME_PACKET& packet, size_t objectCount)
+{
+    m_batchDrawCommands = FrameVector<DRAW_COMMAND>(FrameAllocator<DRAW_COMMAND>(&GetFrameArena()));
+    if (!m_bStaticBatching)
+    {
+        packet.staticBatches.reset();
+        return;
+    }
+
+    packet.staticBatches = m_staticBatcher.GetBatches();
+    const std::vector<STATIC_BATCH>& batches = packet.staticBatches->batches;
+    m_batchDrawCommands.reserve(batches.size());
+
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        const STATIC_BATCH& batch = batches[i];
+        const glm::vec3 center(batch.bounds.x, batch.bounds.y, batch.bounds.z);
+
+        bool bVisible = !m_bCullToFrustum;
+        for (size_t view = 0; !bVisible && view < m_cullFrusta.size(); ++view)
+        {
+            bVisible = IsSphereInFrustum(m_cullFrusta[view], center, batch.bounds.w);
+        }
+        if (!bVisible)
+        {
+            continue;
+        }
+
+        // the vertices are in world space already
+        DRAW_COMMAND command;
+        command.objectIndex   = static_cast<uint32_t>(objectCount + i);
+        command.model         = glm::mat4(1.0f);
+        command.color         = batch.color;
+        command.mesh          = MESH_COUNT;
+        command.materialIndex = batch.materialIndex;
+        command.textureSlot   = batch.textureSlot;
+        command.staticBatch   = static_cast<int>(i);
+
+        float viewDistance = m_bCullToFrustum ? glm::length(center - m_cullViewPosition) : 0.0f;
+        command.sortKey = MakeDrawSortKey(
+            command.mesh, command.materialIndex, command.textureSlot, false, viewDistance);
+
+        m_batchDrawCommands.push_back(command);
+    }
+}
+
+/***********************************************************
+ *  PrepareGpuTranslucents()
+ *
+ *  Hand the GPU object table to the packet and build the
+ *  draw commands of its translucent objects that are in
+ *  view. These are few, and must be drawn back to front, so
+ *  they are culled and sorted here rather than on the GPU.
+ ***********************************************************/
+void SceneManager::PrepareGpuTranslucents(FRAME_PACKET& packet)
+{
+    packet.gpuObjects = m_pGpuObjects;
+    packet.staticBatches.reset();
+    packet.drawCommands.clear();
+    if (!m_pGpuObjects)
+    {
+        return;
+    }
+
+    const GPU_OBJECT_SET& objects = *m_pGpuObjects;
+    for (uint32_t objectIndex : objects.translucentObjects)
+    {
+        const GPU_OBJECT_ENTRY& object = objects.objects[objectIndex];
+        const glm::vec3 center(object.bounds.x, object.bounds.y, object.bounds.z);
+
+        bool bVisible = !m_bCullToFrustum;
+        for (size_t view = 0; !bVisible && view < m_cullFrusta.size(); ++view)
+        {
+            bVisible = IsSphereInFrustum(m_cullFrusta[view], center, object.bounds.w);
+        }
+        if (!bVisible)
+        {
+            continue;
+        }
+
+        // the index is the base instance the object is drawn with
+        DRAW_COMMAND command;
+        command.objectIndex   = objectIndex;
+        command.model         = object.model;
+        command.color         = object.color;
+        command.mesh          = static_cast<MESH_TYPE>(object.mesh);
+        command.materialIndex = object.materialIndex;
+        command.textureSlot   = object.textureSlot;
+        command.staticBatch   = -1;
+
+        float viewDistance = m_bCullToFrustum ? glm::length(center - m_cullViewPosition) : 0.0f;
+        command.sortKey = MakeDrawSortKey(
+            command.mesh, command.materialIndex, command.textureSlot, true, viewDistance);
+
+        packet.drawCommands.push_back(command);
+    }
+    std::sort(packet.drawCommands.begin(), packet.drawCommands.end(), &DrawCommandLess);
+}
+
+/***********************************************************
+ *  MergeDrawLists()
+ *
+ *  Concatenate the draw lists of all threads and the static
+ *  batch commands into the packet being built and sort them
+ *  into submission order. With a job system, the copies and
+ *  the sort run in parallel.
+ ***********************************************************/
+void SceneManager::MergeDrawLists()
+{
+    std::vector<DRAW_COMMAND>& drawCommands = m_pBuildPacket->drawCommands;
+
+    // the thread lists, then the batch commands
+    const size_t listCount = m_threadDrawLists.size() + 1;
+    auto getDrawList = [&](size_t i) -> const FrameVector<DRAW_COMMAND>&
+    {
+        return (i < m_threadDrawLists.size()) ? m_threadDrawLists[i].commands : m_batchDrawCommands;
+    };
+
+    // kept between frames, so a settled frame does not allocate
+    std::vector<size_t>& offsets = m_drawListOffsets;
+    offsets.assign(listCount + 1, 0);
+    for (size_t i = 0; i < listCount; ++i)
+    {
+        offsets[i + 1] = offsets[i] + getDrawList(i).size();
+    }
+    drawCommands.resize(offsets.back());
+
+    auto copyDrawLists = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const FrameVector<DRAW_COMMAND>& commands = getDrawList(i);
+            std::copy(commands.begin(), commands.end(), drawCommands.begin() + offsets[i]);
+        }
+    };
+
+    if (m_pJobSystem != nullptr)
+    {
+        m_pJobSystem->ParallelFor(listCount, 1, copyDrawLists);
+        m_pJobSystem->ParallelSort(drawCommands, m_sortScratch, &DrawCommandLess);
+    }
+    else
+    {
+        copyDrawLists(0, listCount);
+        std::sort(drawCommands.begin(), drawCommands.end(), &DrawCommandLess);
+    }
+}
+
+/***********************************************************
+ *  CullOccludedDraws()
+ *
+ *  Rasterize the opaque objects of the merged draw list that
+ *  look the largest from the camera into the depth buffer of
+ *  the occlusion culler, then test the bounds of every draw
+ *  against it, the occluders included, and drop the hidden
+ *  ones. The submission order of the rest is kept.
+ ***********************************************************/
+void SceneManager::CullOccludedDraws(FRAME_PACKET& packet)
+{
+    std::vector<DRAW_COMMAND>& drawCommands = packet.drawCommands;
+    auto getBounds = [&](const DRAW_COMMAND& command) -> const glm::vec4&
+    {
+        return (command.staticBatch >= 0) ? packet.staticBatches->batches[command.staticBatch].bounds
+                                          : m_pObjectBounds[command.objectIndex];
+    };
+
+    m_pOcclusionCuller->BeginFrame(m_cullViewProjection);
+
+    FrameVector<OCCLUDER_CANDIDATE> candidates{FrameAllocator<OCCLUDER_CANDIDATE>(&GetFrameArena())};
+    for (size_t i = 0; i < drawCommands.size(); ++i)
+    {
+        const DRAW_COMMAND& command = drawCommands[i];
+        if (command.staticBatch >= 0 || IsTranslucent(command.textureSlot, command.color))
+        {
+            continue;
+        }
+        const glm::vec4& bounds = getBounds(command);
+        const float distance = glm::length(glm::vec3(bounds) - m_cullViewPosition);
+        const float size = (distance > bounds.w) ? bounds.w / distance : 1.0f;
+        if (size >= OCCLUDER_MIN_SIZE)
+        {
+            OCCLUDER_CANDIDATE candidate = { size, i };
+            candidates.push_back(candidate);
+        }
+    }
+
+    const size_t occluderCount = std::min(candidates.size(), MAX_OCCLUDERS);
+    std::partial_sort(candidates.begin(), candidates.begin() + occluderCount, candidates.end(),
+        [](const OCCLUDER_CANDIDATE& a, const OCCLUDER_CANDIDATE& b)
+        {
+            return a.size > b.size || (a.size == b.size && a.command < b.command);
+        });
+    for (size_t i = 0; i < occluderCount; ++i)
+    {
+        const DRAW_COMMAND& command = drawCommands[candidates[i].command];
+        m_pOcclusionCuller->RasterizeOccluder(command.mesh, command.model);
+    }
+    m_pOcclusionCuller->FinishOccluders();
+
+    if (occluderCount > 0)
+    {
+        drawCommands.erase(
+            std::remove_if(drawCommands.begin(), drawCommands.end(),
+                [&](const DRAW_COMMAND& command)
+                {
+                    return m_pOcclusionCuller->IsOccluded(getBounds(command));
+                }),
+            drawCommands.end());
+    }
+    m_pOcclusionCuller->EndFrame();
+}
+
+/***********************************************************
+ *  PrepareObjectsJob()
+ *  MergeDrawListsJob()
+ *
+ *  Job system entry points for the frame preparation.
+ ***********************************************************/
+void SceneManager::PrepareObjectsJob(void* pData, size_t begin, size_t end)
+{
+    static_cast<SceneManager*>(pData)->PrepareObjects(begin, end);
+}
+
+void SceneManager::MergeDrawListsJob(void* pData, size_t /*begin*/, size_t /*end*/)
+{
+    static_cast<SceneManager*>(pData)->MergeDrawLists();
+}
+
+/***********************************************************
+ *  SubmitFramePacket()
+ *
+ *  Issue the shader settings and draw calls for a frame
+ *  that was built by BuildFramePacket(), or draw it with
+ *  the software rasterizer when one is set.
+ ***********************************************************/
+void SceneManager::SubmitFramePacket(const FRAME_PACKET& packet, GLsizei viewCount)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    if (m_pShaderManager == nullptr && m_pSoftwareRasterizer == nullptr)
+    {
+        return;
+    }
+
+    if (m_pWorldStreamer != nullptr)
+    {
+        // texture uploads of the streamed cells, time-sliced
+        m_pWorldStreamer->ProcessGpuWork(packet.frameIndex);
+    }
+
+    if (m_pSoftwareRasterizer != nullptr)
+    {
+        m_pSoftwareRasterizer->SetMaterials(m_objectMaterials);
+        m_pSoftwareRasterizer->DrawFramePacket(packet);
+        return;
+    }
+
+    // shapes no scene uses anymore; the ones of this packet are
+    // still referenced or get reloaded when drawn
+    m_basicMeshes->UnloadUnreferenced();
+
+    if (m_pGpuCuller != nullptr && packet.gpuObjects)
+    {
+        SubmitFramePacketGpuCulled(packet);
+        return;
+    }
+
+    if (m_pRingBuffer != nullptr)
+    {
+        SubmitFramePacketBuffered(packet, viewCount);
+        return;
+    }
+
+    // the list is sorted by state, so only send what changed
+    const SHADER_UNIFORMS& uniforms = GetShaderUniforms();
+    int currentMaterial = -1;
+    int currentTexture = -2;
+
+    for (const auto& command : packet.drawCommands)
+    {
+        glUniformMatrix4fv(uniforms.model, 1, GL_FALSE, glm::value_ptr(command.model));
+
+        if (command.materialIndex >= 0 && command.materialIndex != currentMaterial)
+        {
+            ApplyMaterial(m_objectMaterials[command.materialIndex]);
+            currentMaterial = command.materialIndex;
+        }
+
+        if (command.textureSlot >= 0)
+        {
+            if (command.textureSlot != currentTexture)
+            {
+                glUniform1i(uniforms.useTexture, true);
+                glUniform1i(uniforms.objectTexture, command.textureSlot);
+                currentTexture = command.textureSlot;
+            }
+        }
+        else
+        {
+            if (currentTexture != -1)
+            {
+                glUniform1i(uniforms.useTexture, false);
+                currentTexture = -1;
+            }
+            glUniform4fv(uniforms.objectColor, 1, glm::value_ptr(command.color));
+        }
+
+        if (command.staticBatch >= 0)
+        {
+            DrawStaticBatch(packet, command.staticBatch, viewCount);
+        }
+        else
+        {
+            DrawMesh(command.mesh, viewCount);
+        }
+    }
+}
+
+/***********************************************************
+ *  EnableGpuRingBuffer()
+ *
+ *  Create the ring buffer that the per-frame shader data is
+ *  streamed through, sized for the passed in number of draws
+ *  per frame, and the material table. The texture slots are
+ *  assigned to the sampler array of the buffered shaders.
+ ***********************************************************/
+bool SceneManager::EnableGpuRingBuffer(size_t maxDrawsPerFrame)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    if (m_pShaderManager == nullptr || !GpuRingBuffer::IsSupported() || !FitsShaderTables("ring buffer"))
+    {
+        return false;
+    }
+
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_uniformAlignment = static_cast<size_t>(std::max(alignment, 16));
+
+    const size_t objectSize = (sizeof(OBJECT_DATA_BLOCK) + m_uniformAlignment - 1) & ~(m_uniformAlignment - 1);
+
+    GpuRingBuffer* pRingBuffer = new GpuRingBuffer();
+    if (!pRingBuffer->Create(objectSize * maxDrawsPerFrame))
+    {
+        delete pRingBuffer;
+        return false;
+    }
+    m_pRingBuffer = pRingBuffer;
+
+    UploadMaterialTable();
+
+    for (unsigned i = 0; i < MAX_SHADER_TEXTURES; ++i)
+    {
+        m_pShaderManager->setSampler2DValue(
+            "objectTextures[" + std::to_string(i) + "]", static_cast<int>(i));
+    }
+
+    return true;
+}
+
+/***********************************************************
+ *  EnableStaticBatching()
+ *
+ *  Start drawing the static objects through merged batches
+ *  and group them right away. The scene objects of a mapped
+ *  scene file are not entities and stay individual draws,
+ *  as do objects that are translucent, hidden or moved.
+ ***********************************************************/
+bool SceneManager::EnableStaticBatching()
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    if (m_pShaderManager == nullptr || m_pSoftwareRasterizer != nullptr || m_bGpuCulling)
+    {
+        return false;
+    }
+
+    if (m_pStaticBatchBuffers == nullptr)
+    {
+        m_pStaticBatchBuffers = new StaticBatchBuffers();
+    }
+    m_bStaticBatching = true;
+    m_bStaticBatchesDirty = true;
+
+    UpdateEntityTransforms();
+    UpdateStaticBatches();
+
+    const StaticBatcher::STATS& stats = m_staticBatcher.GetStats();
+    std::cout << "INFO: Static batching merged " << stats.objectCount << " of "
+              << m_entities.GetCount() << " objects into " << stats.batchCount
+              << " draws, " << stats.vertexCount << " vertices" << std::endl;
+    return true;
+}
+
+/***********************************************************
+ *  EnableGpuCulling()
+ *
+ *  Create the culler and build the first object table. The
+ *  GPU-driven shaders read the materials from the material
+ *  table and the textures through the same sampler array
+ *  as the buffered shaders. Static batches are not needed
+ *  anymore, since the culler draws every opaque object with
+ *  one call anyway.
+ ***********************************************************/
+bool SceneManager::EnableGpuCulling(bool bOcclusion, bool bMeshlets)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    if (m_pShaderManager == nullptr || m_pSoftwareRasterizer != nullptr ||
+        !GpuCuller::IsSupported() || !FitsShaderTables("GPU culling"))
+    {
+        return false;
+    }
+
+    GpuCuller* pGpuCuller = new GpuCuller();
+    if (!pGpuCuller->Create(m_basicMeshes->GetOptimization(), bOcclusion, bMeshlets))
+    {
+        delete pGpuCuller;
+        return false;
+    }
+    delete m_pGpuCuller;
+    m_pGpuCuller = pGpuCuller;
+
+    UploadMaterialTable();
+
+    for (unsigned i = 0; i < MAX_SHADER_TEXTURES; ++i)
+    {
+        m_pShaderManager->setSampler2DValue(
+            "objectTextures[" + std::to_string(i) + "]", static_cast<int>(i));
+    }
+
+    m_bStaticBatching = false;
+    m_bGpuCulling = true;
+    m_bGpuObjectsDirty = true;
+
+    UpdateEntityTransforms();
+    UpdateGpuObjects();
+
+    const size_t translucentCount = m_pGpuObjects->translucentObjects.size();
+    std::cout << "INFO: GPU culling of " << m_pGpuObjects->objects.size() - translucentCount
+              << " objects" << (bOcclusion ? " with occlusion culling" : "") << ", "
+              << translucentCount << " translucent ones sorted on the CPU" << std::endl;
+    if (bMeshlets)
+    {
+        std::cout << "INFO: Split the shapes into " << m_pGpuCuller->GetMeshletCount()
+                  << " meshlets of " << m_pGpuCuller->GetAverageMeshletTriangles() << " triangles and "
+                  << m_pGpuCuller->GetAverageMeshletVertices() << " vertices on average" << std::endl;
+    }
+    return true;
+}
+
+/***********************************************************
+ *  EnableOcclusionCulling()
+ *
+ *  Create the occlusion culler. It only works on the draw
+ *  lists built on the CPU, so it is of no use when the
+ *  objects are culled on the GPU.
+ ***********************************************************/
+bool SceneManager::EnableOcclusionCulling(bool bUseSimd)
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    if (m_bGpuCulling)
+    {
+        return false;
+    }
+
+    if (m_pOcclusionCuller == nullptr)
+    {
+        m_pOcclusionCuller = new OcclusionCuller();
+    }
+    m_pOcclusionCuller->SetUseSimd(bUseSimd);
+    return true;
+}
+
+/***********************************************************
+ *  GetOcclusionStats()
+ *
+ *  Get the totals of the occlusion culler.
+ ***********************************************************/
+OcclusionCuller::STATS SceneManager::GetOcclusionStats() const
+{
+    if (m_pOcclusionCuller == nullptr)
+    {
+        OcclusionCuller::STATS stats = {};
+        return stats;
+    }
+    return m_pOcclusionCuller->GetStats();
+}
+
+/***********************************************************
+ *  FitsShaderTables()
+ *
+ *  Check that every material and texture of the scene has
+ *  an entry in the fixed size material table and sampler
+ *  array, so the passed in draw path is not enabled for a
+ *  scene it would draw with the wrong materials.
+ ***********************************************************/
+bool SceneManager::FitsShaderTables(const char* pathName) const
+{
+    if (m_objectMaterials.size() <= MAX_SHADER_MATERIALS && m_textures.size() <= MAX_SHADER_TEXTURES)
+    {
+        return true;
+    }
+
+    std::cout << "INFO: The " << pathName << " holds " << MAX_SHADER_MATERIALS << " materials and "
+              << MAX_SHADER_TEXTURES << " textures, the scene has " << m_objectMaterials.size()
+              << " and " << m_textures.size() << std::endl;
+    return false;
+}
+
+/***********************************************************
+ *  UploadMaterialTable()
+ *
+ *  Write the defined materials into an immutable uniform
+ *  buffer that stays bound for the lifetime of the scene.
+ ***********************************************************/
+void SceneManager::UploadMaterialTable()
+{
+    MATERIAL_DATA_ENTRY table[MAX_SHADER_MATERIALS] = {};
+    const size_t materialCount = std::min<size_t>(m_objectMaterials.size(), MAX_SHADER_MATERIALS);
+    for (size_t i = 0; i < materialCount; ++i)
+    {
+        const OBJECT_MATERIAL& material = m_objectMaterials[i];
+        table[i].ambientColorStrength   = glm::vec4(material.ambientColor, material.ambientStrength);
+        table[i].diffuseColor           = glm::vec4(material.diffuseColor, 1.0f);
+        table[i].specularColorShininess = glm::vec4(material.specularColor, material.shininess);
+    }
+
+    if (m_materialBuffer != 0)
+    {
+        glDeleteBuffers(1, &m_materialBuffer);
+    }
+    glGenBuffers(1, &m_materialBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_materialBuffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, sizeof(table), table, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_DATA_BINDING, m_materialBuffer);
+}
+
+/***********************************************************
+ *  SubmitFramePacketBuffered()
+ *
+ *  Write one object block per draw straight into the mapped
+ *  ring buffer and bind each block with glBindBufferRange()
+ *  before its draw call. The view values come from the
+ *  shared FrameData block. A frame
+ *  with more draws than the region holds skips the rest and
+ *  the region grows before the next frame.
+ ***********************************************************/
+void SceneManager::SubmitFramePacketBuffered(const FRAME_PACKET& packet, GLsizei viewCount)
+{
+    m_pRingBuffer->BeginFrame();
+    const GLuint buffer = m_pRingBuffer->GetBuffer();
+
+    GLintptr offset = 0;
+
+    // a material index of -1 keeps the material of the previous draw
+    int currentMaterial = 0;
+
+    for (const auto& command : packet.drawCommands)
+    {
+        OBJECT_DATA_BLOCK* pObjectData = static_cast<OBJECT_DATA_BLOCK*>(
+            m_pRingBuffer->Allocate(sizeof(OBJECT_DATA_BLOCK), m_uniformAlignment, offset));
+        if (pObjectData == nullptr)
+        {
+            break;
+        }
+
+        if (command.materialIndex >= 0 && command.materialIndex < static_cast<int>(MAX_SHADER_MATERIALS))
+        {
+            currentMaterial = command.materialIndex;
+        }
+
+        // build the block locally so the mapped, write-combined
+        // memory is written once, front to back
+        OBJECT_DATA_BLOCK objectData;
+        objectData.model         = command.model;
+        objectData.objectColor   = command.color;
+        objectData.uvScale       = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+        objectData.materialIndex = currentMaterial;
+        objectData.textureSlot   = std::max(command.textureSlot, 0);
+        objectData.bUseTexture   = (command.textureSlot >= 0) ? 1 : 0;
+        objectData.bUseLighting  = 1;
+        *pObjectData = objectData;
+
+        glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_DATA_BINDING, buffer, offset, sizeof(OBJECT_DATA_BLOCK));
+        if (command.staticBatch >= 0)
+        {
+            DrawStaticBatch(packet, command.staticBatch, viewCount);
+        }
+        else
+        {
+            DrawMesh(command.mesh, viewCount);
+        }
+    }
+
+    m_pRingBuffer->EndFrame();
+}
+
+/***********************************************************
+ *  SubmitFramePacketGpuCulled()
+ *
+ *  Cull the object table of the packet on the GPU and draw
+ *  the opaque survivors with one indirect call, whatever
+ *  the number of objects. The depth pyramid for the next
+ *  frame is taken before the translucent objects are drawn,
+ *  as they hide nothing behind them. Those are drawn one by
+ *  one, back to front, from the same merged shapes.
+ ***********************************************************/
+void SceneManager::SubmitFramePacketGpuCulled(const FRAME_PACKET& packet)
+{
+    const GPU_OBJECT_SET& objects = *packet.gpuObjects;
+
+    m_pGpuCuller->Cull(objects, packet.projection * packet.view, packet.viewPosition);
+    m_pGpuCuller->DrawVisible();
+    m_pGpuCuller->UpdateDepthPyramid();
+
+    for (const auto& command : packet.drawCommands)
+    {
+        m_pGpuCuller->DrawObject(objects, command.objectIndex);
+    }
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  Draw one of the basic shape meshes; the shared registry
+ *  loads it on the first draw.
+ ***********************************************************/
+void SceneManager::DrawMesh(MESH_TYPE mesh, GLsizei viewCount)
+{
+    m_basicMeshes->DrawMesh(mesh, viewCount);
+}
+
+/***********************************************************
+ *  DrawStaticBatch()
+ *
+ *  Draw one static batch of a packet from the merged
+ *  buffers, which take the packet's set the first time.
+ ***********************************************************/
+void SceneManager::DrawStaticBatch(const FRAME_PACKET& packet, int batchIndex, GLsizei viewCount)
+{
+    if (m_pStaticBatchBuffers != nullptr && packet.staticBatches)
+    {
+        m_pStaticBatchBuffers->Draw(*packet.staticBatches, static_cast<size_t>(batchIndex), viewCount);
+    }
+}
+
+/***********************************************************
+ *  ReferenceMesh()
+ *
+ *  Take a registry reference on a shape the first time an
+ *  object of this scene uses it.
+ ***********************************************************/
+void SceneManager::ReferenceMesh(MESH_TYPE mesh)
+{
+    if (mesh >= 0 && mesh < MESH_COUNT && !m_meshReferenced[mesh])
+    {
+        m_basicMeshes->AddReference(mesh);
+        m_meshReferenced[mesh] = true;
+    }
+}
+
+/***********************************************************
+ *  UpdateMeshReferences()
+ *
+ *  Find the shapes used by the scene objects and the
+ *  streamed cells, then take the missing registry references
+ *  and release the ones of shapes no object uses anymore.
+ ***********************************************************/
+void SceneManager::UpdateMeshReferences()
+{
+    bool bUsed[MESH_COUNT] = {};
+    int usedCount = 0;
+
+    std::vector<const SCENE_OBJECT_ARRAYS*> objectLists;
+    objectLists.push_back(&m_objects);
+    for (const auto& cell : m_streamedObjects)
+    {
+        objectLists.push_back(&cell);
+    }
+    for (const SCENE_OBJECT_ARRAYS* pObjects : objectLists)
+    {
+        for (size_t i = 0; i < pObjects->count && usedCount < MESH_COUNT; ++i)
+        {
+            const uint8_t mesh = pObjects->mesh[i];
+            if (mesh < MESH_COUNT && !bUsed[mesh])
+            {
+                bUsed[mesh] = true;
+                ++usedCount;
+            }
+        }
+    }
+
+    for (int mesh = 0; mesh < MESH_COUNT; ++mesh)
+    {
+        if (bUsed[mesh])
+        {
+            ReferenceMesh(static_cast<MESH_TYPE>(mesh));
+        }
+        else if (m_meshReferenced[mesh])
+        {
+            m_basicMeshes->ReleaseReference(static_cast<MESH_TYPE>(mesh));
+            m_meshReferenced[mesh] = false;
+        }
+    }
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  Render the 3D scene by transforming and drawing shapes.
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+    AllocationScope scope(ALLOCATION_SCENE_MANAGER);
+
+    // the camera is unknown here, so nothing is culled
+    m_bCullToFrustum = false;
+
+    BuildDrawList(m_framePacket);
+    SubmitFramePacket(m_framePacket);
+}
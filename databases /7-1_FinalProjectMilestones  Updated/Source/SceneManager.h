@@ -10,13 +10,26 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "PrimitiveMeshes.h"
+#include "FramePacket.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "GpuRingBuffer.h"
+#include "FrameArena.h"
+#include "EntityStore.h"
+#include "StaticBatcher.h"
+#include "GpuCuller.h"
+#include "OcclusionCuller.h"
+#include "SceneFile.h"
+#include "TagTable.h"
 
 #include <string>
 #include <vector>
-#include <unordered_map>    // Enhancement: fast lookup structures
 #include <glm/glm.hpp>
 
+class WorldStreamer;
+class SoftwareRasterizer;
+
 /***********************************************************
  *  SceneManager
  *
@@ -31,11 +44,25 @@ public:
     // destructor
     ~SceneManager();
 
+    // run texture decoding and frame preparation on a job system
+    void SetJobSystem(JobSystem* pJobSystem);
+    // stream world cells around the camera while building frames
+    void SetWorldStreamer(WorldStreamer* pWorldStreamer);
+    // reordering of the basic shapes; call before PrepareScene()
+    void SetMeshOptimization(MESH_OPTIMIZATION optimization);
+    // vertex layout of the basic shapes; call before PrepareScene()
+    void SetVertexFormat(VERTEX_FORMAT format);
+    // draw the frame packets on the CPU instead of with OpenGL;
+    // the textures are then decoded into the rasterizer, so call
+    // before PrepareScene()
+    void SetSoftwareRasterizer(SoftwareRasterizer* pRasterizer);
+
     // properties for loaded texture access
     struct TEXTURE_INFO
     {
-        std::string tag;
         uint32_t ID;
+        // the texture has an alpha channel and is drawn blended
+        bool bHasAlpha;
     };
 
     // properties for object materials
@@ -46,30 +73,206 @@ public:
         glm::vec3 diffuseColor;
         glm::vec3 specularColor;
         float shininess;
-        std::string tag;
     };
 
+    // properties for a light source
+    struct LIGHT_SOURCE
+    {
+        glm::vec3 position;
+        glm::vec3 diffuseColor;
+        glm::vec3 specularColor;
+        float focalStrength;
+        float specularIntensity;
+    };
+
+    // image file to load into a texture slot
+    struct TEXTURE_FILE
+    {
+        const char* filename;
+        const char* tag;
+    };
+
+    // pixels of an image file decoded into memory
+    struct DECODED_IMAGE
+    {
+        const char* filename;
+        unsigned char* pixels;
+        int width;
+        int height;
+        int colorChannels;
+    };
+
+    // objects placed in the 3D scene, one array per property, with
+    // the material and texture tags already resolved to indices
+    struct SCENE_OBJECT_ARRAYS
+    {
+        size_t count;
+        const glm::vec3* scaleXYZ;
+        const glm::vec3* rotationDegrees;
+        const glm::vec3* positionXYZ;
+        const glm::vec4* color;
+        const uint8_t* mesh;
+        // -1 keeps the material of the previous draw
+        const int16_t* materialIndex;
+        // -1 draws with the solid color
+        const int16_t* textureSlot;
+        // transforms and world bounds kept up to date by the owner,
+        // and the ENTITY_FLAGS; nullptr when they are calculated
+        // per frame
+        const glm::mat4* model;
+        const glm::vec4* worldBounds;
+        const uint8_t* flags;
+    };
+
+    // decode an image file into memory; makes no OpenGL calls
+    // and may run on any thread
+    static void DecodeTextureImage(const char* filename, DECODED_IMAGE& image);
+    // free the pixels of a decoded image that is not uploaded
+    static void FreeDecodedImage(DECODED_IMAGE& image);
+
 private:
     // pointer to shader manager object
     ShaderManager* m_pShaderManager;
-    // pointer to basic shapes object
-    ShapeMeshes* m_basicMeshes;
+    // optional job system for spreading the frame work over threads
+    JobSystem* m_pJobSystem;
+    // optional streamer of the world cells around the camera
+    WorldStreamer* m_pWorldStreamer;
+    // optional CPU renderer replacing the OpenGL submission
+    SoftwareRasterizer* m_pSoftwareRasterizer;
+    // pointer to the basic shapes registry shared by all scenes
+    PrimitiveMeshes* m_basicMeshes;
+    // shapes this scene holds a registry reference on
+    bool m_meshReferenced[MESH_COUNT];
 
     // Enhancement: use dynamic containers & hash maps for faster lookups
     std::vector<TEXTURE_INFO> m_textures;
-    std::unordered_map<std::string, int> m_textureSlotLookup; // tag -> texture slot
+    TagTable m_textureTags;       // tag -> texture slot
 
     std::vector<OBJECT_MATERIAL> m_objectMaterials;
-    std::unordered_map<std::string, OBJECT_MATERIAL> m_materialLookup; // tag -> material
+    TagTable m_materialTags;      // tag -> material index
+
+    // uniform locations of the shader values set per draw
+    struct SHADER_UNIFORMS
+    {
+        // program the locations belong to
+        GLuint program;
+        GLint model;
+        GLint objectColor;
+        GLint objectTexture;
+        GLint useTexture;
+        GLint ambientColor;
+        GLint ambientStrength;
+        GLint diffuseColor;
+        GLint specularColor;
+        GLint shininess;
+    };
+    SHADER_UNIFORMS m_uniforms;
+
+    // the arrays point into the components of m_entities, or into
+    // m_sceneFile when the scene was loaded from a binary scene file
+    SCENE_OBJECT_ARRAYS m_objects;
+    EntityStore m_entities;
+    SceneFile m_sceneFile;
+    // texture slots of the scene file objects, used instead of the
+    // texture indices of the file when a texture failed to load
+    std::vector<int16_t> m_fileTextureSlots;
+    // object arrays of the streamed world cells, drawn after m_objects
+    std::vector<SCENE_OBJECT_ARRAYS> m_streamedObjects;
+
+    // light sources sent to the shader by SetupSceneLights()
+    std::vector<LIGHT_SOURCE> m_lightSources;
+    // frame packet reused by the single-threaded RenderScene()
+    FRAME_PACKET m_framePacket;
+
+    // draw commands built by one job system thread; padded so
+    // threads appending to neighbouring lists do not share a line;
+    // the commands live in the frame arena of that thread
+    struct THREAD_DRAW_LIST
+    {
+        FrameVector<DRAW_COMMAND> commands;
+        char padding[64];
+    };
+
+    // object arrays of the frame being prepared and the index of
+    // the first object of each, followed by the total count; this
+    // and the per-object results of the frame preparation jobs
+    // are allocated from the frame arena of the building thread
+    SCENE_OBJECT_ARRAYS* m_pObjectChunks;
+    size_t m_objectChunkCount;
+    size_t* m_pChunkOffsets;
+    glm::mat4* m_pObjectTransforms;
+    glm::vec4* m_pObjectBounds;
+    unsigned char* m_pObjectVisible;
+    // visible draw commands, one list per job system thread
+    std::vector<THREAD_DRAW_LIST> m_threadDrawLists;
+    // offset of each thread's commands in the merged list
+    std::vector<size_t> m_drawListOffsets;
+    // merge buffer of the draw command sort
+    std::vector<DRAW_COMMAND> m_sortScratch;
+    // culling settings and output of the frame being prepared; an
+    // object is drawn when it is inside any of the frusta
+    std::vector<FRUSTUM> m_cullFrusta;
+    bool m_bCullToFrustum;
+    glm::vec3 m_cullViewPosition;
+    // camera of the first frustum, for the occlusion culling
+    glm::mat4 m_cullViewProjection;
+    FRAME_PACKET* m_pBuildPacket;
+
+    // per-frame shader data streamed through persistently mapped
+    // memory; nullptr sets the shader values with glUniform
+    GpuRingBuffer* m_pRingBuffer;
+    // material table read by the buffered shaders
+    GLuint m_materialBuffer;
+    // required offset alignment of bound uniform buffer ranges
+    size_t m_uniformAlignment;
+
+    // static batching of the entities, see EnableStaticBatching();
+    // the batches are regrouped by the building thread when an
+    // object joins or leaves them and drawn from the buffers on
+    // the OpenGL thread
+    bool m_bStaticBatching;
+    bool m_bStaticBatchesDirty;
+    StaticBatcher m_staticBatcher;
+    StaticBatchBuffers* m_pStaticBatchBuffers;
+    // draw commands of the visible batches of the frame being
+    // prepared, in the frame arena of the building thread
+    FrameVector<DRAW_COMMAND> m_batchDrawCommands;
+
+    // GPU culling of the opaque objects, see EnableGpuCulling();
+    // the object table is rebuilt by the building thread when an
+    // object changed, and culled and drawn by the culler on the
+    // OpenGL thread
+    bool m_bGpuCulling;
+    bool m_bGpuObjectsDirty;
+    std::shared_ptr<const GPU_OBJECT_SET> m_pGpuObjects;
+    GpuCuller* m_pGpuCuller;
+
+    // CPU occlusion culling of the draw lists built for a single
+    // camera, see EnableOcclusionCulling(); nullptr when disabled
+    OcclusionCuller* m_pOcclusionCuller;
 
     // methods for managing OpenGL textures
     bool CreateGLTexture(const char* filename, const std::string& tag);
+    void LoadGLTextures(const TEXTURE_FILE* pFiles, size_t fileCount);
+    bool UploadGLTexture(DECODED_IMAGE& image, const std::string& tag);
+    GLuint CreateTextureObject(DECODED_IMAGE& image);
     void BindGLTextures();
     void DestroyGLTextures();
-    int FindTextureID(const std::string& tag);
-    int FindTextureSlot(const std::string& tag);
+    int FindTextureID(TAG_ID tag) const;
+
+    // add a material to the material list under a tag
+    void AddObjectMaterial(const std::string& tag, const OBJECT_MATERIAL& material);
+    // uniform locations of the program in use, looked up again
+    // only when the shader manager switched programs
+    const SHADER_UNIFORMS& GetShaderUniforms();
 
-    bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+    // calculate the model matrix from the transformation values
+    glm::mat4 CalculateModelMatrix(
+        glm::vec3 scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        glm::vec3 positionXYZ);
 
     // set the transformation values into the transform buffer
     void SetTransformations(
@@ -88,7 +291,7 @@ private:
 
     // set the texture data into the shader
     void SetShaderTexture(
-        const std::string& textureTag);
+        int textureSlot);
 
     // set the texture UV scale into the shader
     void SetTextureUVScale(
@@ -96,16 +299,187 @@ private:
 
     // set the object material into the shader
     void SetShaderMaterial(
-        const std::string& materialTag);
+        int materialIndex);
+    void ApplyMaterial(
+        const OBJECT_MATERIAL& material);
+
+    // point the object arrays at the entity components
+    void UseObjectStorage();
+    // copy the objects of the mapped scene file into entities so
+    // more objects can be added
+    void DetachSceneFile();
+    // transform system: recalculate the model matrices and world
+    // bounds of the entities that were moved
+    void UpdateEntityTransforms();
+    // regroup the static batches when an object joined or left them
+    void UpdateStaticBatches();
+    // rebuild the GPU object table when an object changed
+    void UpdateGpuObjects();
+    // whether a draw with these settings is blended
+    bool IsTranslucent(int textureSlot, const glm::vec4& color) const;
+
+    // draw one of the basic shape meshes, once per view
+    void DrawMesh(MESH_TYPE mesh, GLsizei viewCount = 1);
+    // hold a registry reference on a shape used by an object
+    void ReferenceMesh(MESH_TYPE mesh);
+    // reference exactly the shapes of the scene and streamed
+    // objects, releasing the ones no longer used
+    void UpdateMeshReferences();
+
+    // build the draw list, culled to m_cullFrusta when enabled
+    void BuildDrawList(FRAME_PACKET& packet);
+    // transform, cull and build the draw commands of a range
+    // of scene objects
+    void PrepareObjects(size_t begin, size_t end);
+    // cull the static batches and build their draw commands
+    void PrepareStaticBatches(FRAME_PACKET& packet, size_t objectCount);
+    // cull the translucent objects of the GPU object table on
+    // the CPU and sort them into the packet
+    void PrepareGpuTranslucents(FRAME_PACKET& packet);
+    // merge the per-thread draw lists into the packet and sort
+    // them into submission order
+    void MergeDrawLists();
+    // drop the draws of a merged list that are hidden behind its
+    // largest opaque objects
+    void CullOccludedDraws(FRAME_PACKET& packet);
+    // draw one static batch of a packet, once per view
+    void DrawStaticBatch(const FRAME_PACKET& packet, int batchIndex, GLsizei viewCount);
+
+    // whether the materials and textures fit the material table
+    // and the sampler array of the buffered and GPU-driven shaders
+    bool FitsShaderTables(const char* pathName) const;
+    // write the material list into the material table buffer
+    void UploadMaterialTable();
+    // issue a frame through the GPU ring buffer
+    void SubmitFramePacketBuffered(const FRAME_PACKET& packet, GLsizei viewCount);
+    // issue a frame through the GPU culling
+    void SubmitFramePacketGpuCulled(const FRAME_PACKET& packet);
+
+    // job entry points for the frame preparation
+    static void PrepareObjectsJob(void* pData, size_t begin, size_t end);
+    static void MergeDrawListsJob(void* pData, size_t begin, size_t end);
 
 public:
 
     /*** The following methods are for the students to ***/
     /*** customize for their own 3D scene              ***/
-    void PrepareScene();
+    // an optional binary scene file replaces the built-in scene
+    void PrepareScene(const char* sceneFilename = nullptr);
     void RenderScene();
 
+    // map a binary scene file and use its objects in place; its
+    // textures, materials and lights replace the current ones.
+    // With bStreamTextures, the texture slots are only reserved
+    // and filled later by SetStreamedTexture().
+    bool LoadSceneFile(const char* filename, bool bStreamTextures = false);
+
+    // replace the object arrays of the streamed world cells; the
+    // arrays must stay valid until they are replaced again
+    void SetStreamedObjects(const std::vector<SCENE_OBJECT_ARRAYS>& objects);
+    // create the texture of a reserved slot from decoded pixels,
+    // which are freed; OpenGL thread only
+    bool SetStreamedTexture(int slot, DECODED_IMAGE& image);
+    // delete the texture of a reserved slot; OpenGL thread only
+    void ReleaseStreamedTexture(int slot);
+
+    // build the draw list for the next frame; this does not make
+    // any OpenGL calls and may run on a different thread than
+    // SubmitFramePacket()
+    void BuildFramePacket(FRAME_PACKET& packet);
+    // build one draw list for several cameras, culled to the union
+    // of their frusta, to be drawn by a multi-view pass
+    void BuildMultiViewPacket(
+        FRAME_PACKET& packet,
+        const glm::mat4* pViewProjections,
+        const glm::vec3* pViewPositions,
+        size_t viewCount);
+    // issue the OpenGL calls for a previously built frame; must
+    // run on the thread that owns the OpenGL context. With more
+    // than one view, every draw call is instanced once per view
+    // for the multi-view shaders.
+    void SubmitFramePacket(const FRAME_PACKET& packet, GLsizei viewCount = 1);
+    // bind the textures and the material table to the units and
+    // binding points of the current context; another context that
+    // shares the objects of the one the scene was loaded in must
+    // call this before submitting, since it starts with nothing
+    // bound
+    void BindSharedResources();
+
+    // stream the object and material values through a
+    // persistently mapped ring buffer instead of glUniform calls;
+    // call after PrepareScene() with the buffered shaders in use.
+    // Returns false when the context does not support it.
+    bool EnableGpuRingBuffer(size_t maxDrawsPerFrame);
+    // draw the static objects added by AddSceneObject() that share
+    // a material, texture and color as merged, pre-transformed
+    // geometry with one call per group; call after PrepareScene().
+    // Returns false when the frames are not drawn with OpenGL.
+    bool EnableStaticBatching();
+    // cull the opaque objects in a compute shader, against the
+    // depth of the previous frame as well with bOcclusion, and
+    // draw them with one indirect call; call after PrepareScene()
+    // with the GPU-driven shaders in use. With bMeshlets the
+    // shapes are culled cluster by cluster, dropping the ones out
+    // of view or facing away. Frames are drawn for a single view.
+    // Returns false when the context does not support it.
+    bool EnableGpuCulling(bool bOcclusion, bool bMeshlets);
+    // rasterize the largest opaque objects in view into a small
+    // CPU depth buffer while building a frame for one camera, and
+    // drop the draws hidden behind them. Returns false when the
+    // objects are culled on the GPU.
+    bool EnableOcclusionCulling(bool bUseSimd);
+    // counts and times of the occlusion culling so far, all zero
+    // when it is not enabled
+    OcclusionCuller::STATS GetOcclusionStats() const;
+
+    void DefineSceneObjects();
+
+    // add an object to the list of scene objects; an empty
+    // material tag keeps the material of the previous object.
+    // Materials and textures must be defined before their objects.
+    ENTITY_HANDLE AddSceneObject(
+        MESH_TYPE mesh,
+        glm::vec3 scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        glm::vec3 positionXYZ,
+        TAG_ID materialTag,
+        TAG_ID textureTag,
+        glm::vec4 color = glm::vec4(1.0f));
+    // same, with tags known only at run time
+    ENTITY_HANDLE AddSceneObject(
+        MESH_TYPE mesh,
+        glm::vec3 scaleXYZ,
+        float XrotationDegrees,
+        float YrotationDegrees,
+        float ZrotationDegrees,
+        glm::vec3 positionXYZ,
+        const std::string& materialTag,
+        const std::string& textureTag,
+        glm::vec4 color = glm::vec4(1.0f));
+    // remove an object added by AddSceneObject(); its shape stays
+    // referenced until the scene is defined or loaded again
+    void RemoveSceneObject(ENTITY_HANDLE object);
+    // move an object, or take it out of the draw lists; not while
+    // a frame packet is being built
+    void SetSceneObjectTransform(
+        ENTITY_HANDLE object,
+        glm::vec3 scaleXYZ,
+        glm::vec3 rotationDegrees,
+        glm::vec3 positionXYZ);
+    void SetSceneObjectVisible(ENTITY_HANDLE object, bool bVisible);
+
+    // resolve a tag to the handle stored in the object arrays,
+    // -1 when it is unknown; resolve tags once, not per frame
+    int FindTextureSlot(TAG_ID tag) const { return m_textureTags.Find(tag); }
+    int FindMaterialIndex(TAG_ID tag) const { return m_materialTags.Find(tag); }
+    // tag of a handle, for log and debug output
+    const std::string& GetTextureName(int textureSlot) const { return m_textureTags.GetName(textureSlot); }
+    const std::string& GetMaterialName(int materialIndex) const { return m_materialTags.GetName(materialIndex); }
+
     void DefineObjectMaterials();
+    void DefineSceneLights();
     void SetupSceneLights();
 
     // loads textures from image files
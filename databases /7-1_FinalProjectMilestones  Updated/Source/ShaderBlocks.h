@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderblocks.h
+// ============
+// std140 layouts of the uniform blocks read by the buffered shaders, and
+// std430 layouts of the storage buffers of the GPU culling
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// uniform block binding points; the buffered shaders declare them
+// with layout qualifiers, the default shaders are assigned the
+// FrameData binding when they are loaded
+const unsigned FRAME_DATA_BINDING = 0;
+const unsigned OBJECT_DATA_BINDING = 1;
+const unsigned MATERIAL_DATA_BINDING = 2;
+// assigned to the multi-view shaders when they are drawn with
+const unsigned MULTI_VIEW_DATA_BINDING = 3;
+
+// shader storage binding points of the GPU culling and GPU-driven
+// shaders; a namespace of their own, apart from the uniform blocks
+const unsigned GPU_OBJECT_TABLE_BINDING = 0;
+const unsigned GPU_MESH_TABLE_BINDING = 1;
+const unsigned GPU_DRAW_COMMANDS_BINDING = 2;
+const unsigned GPU_DRAW_COUNT_BINDING = 3;
+const unsigned GPU_MESHLET_TABLE_BINDING = 4;
+
+// size of the material table and of the sampler array
+const unsigned MAX_SHADER_MATERIALS = 16;
+const unsigned MAX_SHADER_TEXTURES = 16;
+// views of one multi-view pass, the viewport count OpenGL 4.1
+// guarantees
+const unsigned MAX_SHADER_VIEWS = 16;
+
+// name of the per-frame block in every shader program
+const char* const FRAME_DATA_BLOCK_NAME = "FrameData";
+// name of the camera block of the multi-view shaders
+const char* const MULTI_VIEW_DATA_BLOCK_NAME = "MultiViewData";
+
+// the camera and timing values of one frame, shared by all
+// shader programs
+struct FRAME_DATA_BLOCK
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProjection;
+    glm::vec4 viewPosition;
+    // x seconds since start, y seconds since the last frame,
+    // z frame index
+    glm::vec4 time;
+    // xy size in pixels, zw reciprocal size
+    glm::vec4 viewportSize;
+};
+
+// the settings of one draw
+struct OBJECT_DATA_BLOCK
+{
+    glm::mat4 model;
+    glm::vec4 objectColor;
+    glm::vec4 uvScale;
+    int32_t materialIndex;
+    int32_t textureSlot;
+    int32_t bUseTexture;
+    int32_t bUseLighting;
+};
+
+// one entry of the material table
+struct MATERIAL_DATA_ENTRY
+{
+    glm::vec4 ambientColorStrength;
+    glm::vec4 diffuseColor;
+    glm::vec4 specularColorShininess;
+};
+
+// the cameras of a multi-view pass, indexed by the view of the
+// instance being drawn
+struct MULTI_VIEW_DATA_BLOCK
+{
+    glm::mat4 viewProjection[MAX_SHADER_VIEWS];
+    glm::vec4 viewPosition[MAX_SHADER_VIEWS];
+};
+
+// bits of GPU_OBJECT_ENTRY::flags
+enum GPU_OBJECT_FLAGS
+{
+    // left out by the culling shader: hidden, or translucent and
+    // drawn from the sorted CPU draw list instead
+    GPU_OBJECT_SKIP_CULLING = 0x01
+};
+
+// one object of the table the culling shader and the GPU-driven
+// shaders read, indexed by the base instance of its draw
+struct GPU_OBJECT_ENTRY
+{
+    glm::mat4 model;
+    glm::vec4 color;
+    // world bounding sphere, center and radius
+    glm::vec4 bounds;
+    int32_t mesh;
+    // resolved, never -1
+    int32_t materialIndex;
+    // -1 draws with the solid color
+    int32_t textureSlot;
+    int32_t flags;
+};
+
+// where a basic shape is in the merged shape geometry, and its
+// range of the meshlet table; no meshlets draws it as a whole
+struct GPU_MESH_ENTRY
+{
+    uint32_t indexCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    uint32_t padding[3];
+};
+
+// one cluster of triangles of a basic shape, culled on its own
+struct GPU_MESHLET_ENTRY
+{
+    // model space bounding sphere, center and radius
+    glm::vec4 bounds;
+    // normal cone axis and the cosine of its angle; a zero axis
+    // is never culled by the direction it faces
+    glm::vec4 cone;
+    // in the merged shape geometry
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t padding[2];
+};
+
+// one command of glMultiDrawElementsIndirect(), as written by the
+// culling shader
+struct DRAW_ELEMENTS_INDIRECT_COMMAND
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+static_assert(sizeof(FRAME_DATA_BLOCK) == 432, "FRAME_DATA_BLOCK must match the std140 layout");
+static_assert(sizeof(OBJECT_DATA_BLOCK) == 112, "OBJECT_DATA_BLOCK must match the std140 layout");
+static_assert(sizeof(MATERIAL_DATA_ENTRY) == 48, "MATERIAL_DATA_ENTRY must match the std140 layout");
+static_assert(sizeof(MULTI_VIEW_DATA_BLOCK) == 1280, "MULTI_VIEW_DATA_BLOCK must match the std140 layout");
+static_assert(sizeof(GPU_OBJECT_ENTRY) == 112, "GPU_OBJECT_ENTRY must match the std430 layout");
+static_assert(sizeof(GPU_MESH_ENTRY) == 32, "GPU_MESH_ENTRY must match the std430 layout");
+static_assert(sizeof(GPU_MESHLET_ENTRY) == 48, "GPU_MESHLET_ENTRY must match the std430 layout");
+static_assert(sizeof(DRAW_ELEMENTS_INDIRECT_COMMAND) == 20, "DRAW_ELEMENTS_INDIRECT_COMMAND must be tightly packed");
@@ -0,0 +1,1103 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.cpp
+// ============
+// multi-threaded tile-based CPU renderer for the frame packets, used in
+// place of OpenGL on machines without a GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+#include "PrimitiveMeshes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RASTER_HAS_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC compiles AVX2 intrinsics without changing the target
+#define RASTER_AVX2_FUNCTION
+#else
+#define RASTER_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+// declare the global variables
+namespace
+{
+    // fractional bits of the fixed point screen positions
+    const int SUBPIXEL_BITS = 4;
+    const int SUBPIXEL_SCALE = 1 << SUBPIXEL_BITS;
+    // pixels the guard band reaches past each edge of the frame;
+    // only triangles crossing it are clipped at the sides. Keeps
+    // the fixed point positions within 17 bits, so the edge
+    // functions of a tile fit 32-bit integers.
+    const float GUARD_BAND_PIXELS = 2048.0f;
+    // most vertices of a triangle clipped by six planes
+    const int MAX_CLIPPED_VERTICES = 9;
+    // draw commands binned by one job, per worker thread
+    const size_t CHUNKS_PER_THREAD = 4;
+
+    // glClearColor(0, 0, 0, 1) and a depth of 1
+    const uint32_t CLEAR_COLOR = 0xFF000000u;
+    const float CLEAR_DEPTH = 1.0f;
+
+    // material of draws made before any material was set,
+    // matching the zeroed shader uniforms
+    const SceneManager::OBJECT_MATERIAL g_NoMaterial =
+    {
+        0.0f, glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), 0.0f
+    };
+
+    // edge function values along a span of pixels; an edge
+    // covers a pixel when value + bias is not negative
+    struct SPAN_EDGES
+    {
+        int32_t value[3];
+        int32_t step[3];
+        int32_t bias[3];
+    };
+
+    /***********************************************************
+     *  RasterizeSpanScalar()
+     *
+     *  Find the pixels of a span that are inside all three
+     *  edges and closer than the depth buffer. Writes their
+     *  offsets and depths and returns how many there are.
+     ***********************************************************/
+    int RasterizeSpanScalar(
+        const SPAN_EDGES& edges,
+        int count,
+        float depth,
+        float depthStep,
+        const float* pDepthRow,
+        int* pCovered,
+        float* pCoveredDepth)
+    {
+        int covered = 0;
+        int32_t e0 = edges.value[0] + edges.bias[0];
+        int32_t e1 = edges.value[1] + edges.bias[1];
+        int32_t e2 = edges.value[2] + edges.bias[2];
+        for (int x = 0; x < count; ++x)
+        {
+            if ((e0 | e1 | e2) >= 0)
+            {
+                const float z = depth + static_cast<float>(x) * depthStep;
+                if (z < pDepthRow[x])
+                {
+                    pCovered[covered] = x;
+                    pCoveredDepth[covered] = z;
+                    ++covered;
+                }
+            }
+            e0 += edges.step[0];
+            e1 += edges.step[1];
+            e2 += edges.step[2];
+        }
+        return covered;
+    }
+
+#ifdef RASTER_HAS_AVX2
+    /***********************************************************
+     *  RasterizeSpanAvx2()
+     *
+     *  RasterizeSpanScalar() on eight pixels at a time. The
+     *  sign bits of the or-ed edge values mark the pixels
+     *  outside the triangle; the depth test runs on the rest.
+     *  Pixels past the span are never read.
+     ***********************************************************/
+    RASTER_AVX2_FUNCTION
+    int RasterizeSpanAvx2(
+        const SPAN_EDGES& edges,
+        int count,
+        float depth,
+        float depthStep,
+        const float* pDepthRow,
+        int* pCovered,
+        float* pCoveredDepth)
+    {
+        const __m256i laneIndex = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        __m256i edge[3];
+        __m256i edgeStep[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            edge[k] = _mm256_add_epi32(
+                _mm256_set1_epi32(edges.value[k] + edges.bias[k]),
+                _mm256_mullo_epi32(laneIndex, _mm256_set1_epi32(edges.step[k])));
+            edgeStep[k] = _mm256_set1_epi32(edges.step[k] * 8);
+        }
+        const __m256 depthStart = _mm256_set1_ps(depth);
+        const __m256 depthStepX = _mm256_set1_ps(depthStep);
+
+        int covered = 0;
+        for (int x = 0; x < count; x += 8)
+        {
+            const __m256i outside = _mm256_or_si256(_mm256_or_si256(edge[0], edge[1]), edge[2]);
+            int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(outside)) & 0xFF;
+            const int remaining = count - x;
+            if (remaining < 8)
+            {
+                mask &= (1 << remaining) - 1;
+            }
+
+            if (mask != 0)
+            {
+                const __m256i pixel = _mm256_add_epi32(_mm256_set1_epi32(x), laneIndex);
+                const __m256 z = _mm256_add_ps(depthStart, _mm256_mul_ps(_mm256_cvtepi32_ps(pixel), depthStepX));
+                const __m256i loadMask = _mm256_cmpgt_epi32(_mm256_set1_epi32(remaining), laneIndex);
+                const __m256 stored = _mm256_maskload_ps(pDepthRow + x, loadMask);
+                mask &= _mm256_movemask_ps(_mm256_cmp_ps(z, stored, _CMP_LT_OQ));
+
+                if (mask != 0)
+                {
+                    float laneDepth[8];
+                    _mm256_storeu_ps(laneDepth, z);
+                    for (int lane = 0; lane < 8; ++lane)
+                    {
+                        if (mask & (1 << lane))
+                        {
+                            pCovered[covered] = x + lane;
+                            pCoveredDepth[covered] = laneDepth[lane];
+                            ++covered;
+                        }
+                    }
+                }
+            }
+
+            for (int k = 0; k < 3; ++k)
+            {
+                edge[k] = _mm256_add_epi32(edge[k], edgeStep[k]);
+            }
+        }
+        return covered;
+    }
+#endif
+
+    /***********************************************************
+     *  ToUnorm8()
+     *
+     *  Convert a color channel to 8 bits like the OpenGL
+     *  framebuffer does.
+     ***********************************************************/
+    inline uint32_t ToUnorm8(float value)
+    {
+        return static_cast<uint32_t>(glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    inline uint32_t PackColor(const glm::vec4& color)
+    {
+        return ToUnorm8(color.x) | (ToUnorm8(color.y) << 8) |
+               (ToUnorm8(color.z) << 16) | (ToUnorm8(color.w) << 24);
+    }
+
+    inline glm::vec4 UnpackColor(uint32_t color)
+    {
+        const float scale = 1.0f / 255.0f;
+        return glm::vec4(
+            static_cast<float>(color & 0xFF) * scale,
+            static_cast<float>((color >> 8) & 0xFF) * scale,
+            static_cast<float>((color >> 16) & 0xFF) * scale,
+            static_cast<float>(color >> 24) * scale);
+    }
+
+    /***********************************************************
+     *  SampleBilinear()
+     *
+     *  Filter the four texels around a texture coordinate of
+     *  one mip level, wrapping at the edges.
+     ***********************************************************/
+    glm::vec4 SampleBilinear(const std::vector<uint32_t>& texels, int width, int height, const glm::vec2& uv)
+    {
+        const float u = uv.x * width - 0.5f;
+        const float v = uv.y * height - 0.5f;
+        const float u0 = std::floor(u);
+        const float v0 = std::floor(v);
+        const float fu = u - u0;
+        const float fv = v - v0;
+
+        int x0 = static_cast<int>(u0) % width;
+        int y0 = static_cast<int>(v0) % height;
+        x0 += (x0 < 0) ? width : 0;
+        y0 += (y0 < 0) ? height : 0;
+        const int x1 = (x0 + 1 == width) ? 0 : x0 + 1;
+        const int y1 = (y0 + 1 == height) ? 0 : y0 + 1;
+
+        const glm::vec4 c00 = UnpackColor(texels[y0 * width + x0]);
+        const glm::vec4 c10 = UnpackColor(texels[y0 * width + x1]);
+        const glm::vec4 c01 = UnpackColor(texels[y1 * width + x0]);
+        const glm::vec4 c11 = UnpackColor(texels[y1 * width + x1]);
+        return (c00 * (1.0f - fu) + c10 * fu) * (1.0f - fv) + (c01 * (1.0f - fu) + c11 * fu) * fv;
+    }
+
+    /***********************************************************
+     *  LerpVertex()
+     *
+     *  Interpolate all values of two clip space vertices.
+     ***********************************************************/
+    template <typename VERTEX>
+    VERTEX LerpVertex(const VERTEX& a, const VERTEX& b, float t)
+    {
+        VERTEX result;
+        result.clip = a.clip + (b.clip - a.clip) * t;
+        result.world = a.world + (b.world - a.world) * t;
+        result.normal = a.normal + (b.normal - a.normal) * t;
+        result.uv = a.uv + (b.uv - a.uv) * t;
+        return result;
+    }
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer(JobSystem* pJobSystem)
+    : m_pJobSystem(pJobSystem),
+      m_bUseSimd(IsSimdSupported()),
+      m_width(0),
+      m_height(0),
+      m_tilesX(0),
+      m_tilesY(0),
+      m_stride(0),
+      m_uvScale(1.0f, 1.0f),
+      m_bUseLighting(false),
+      m_pPacket(nullptr),
+      m_viewProjection(1.0f),
+      m_guardBand(1.0f, 1.0f),
+      m_triangleCount(0)
+{
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+    m_pJobSystem = nullptr;
+}
+
+/***********************************************************
+ *  IsSimdSupported()
+ *
+ *  This method is used for checking whether the processor
+ *  and the operating system support AVX2.
+ ***********************************************************/
+bool SoftwareRasterizer::IsSimdSupported()
+{
+#if !defined(RASTER_HAS_AVX2)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool bOsSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                             (_xgetbv(0) & 6) == 6;
+    if (!bOsSavesAvx)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+/***********************************************************
+ *  SetTexture()
+ *
+ *  This method is used for copying decoded pixels into a
+ *  texture slot as RGBA and building the mip chain by
+ *  averaging 2x2 texels, like glGenerateMipmap().
+ ***********************************************************/
+bool SoftwareRasterizer::SetTexture(int slot, SceneManager::DECODED_IMAGE& image)
+{
+    if (slot < 0 || image.pixels == nullptr ||
+        (image.colorChannels != 3 && image.colorChannels != 4))
+    {
+        SceneManager::FreeDecodedImage(image);
+        return false;
+    }
+
+    if (slot >= static_cast<int>(m_textures.size()))
+    {
+        m_textures.resize(slot + 1);
+    }
+    TEXTURE& texture = m_textures[slot];
+    texture.levels.clear();
+
+    MIP_LEVEL base;
+    base.width = image.width;
+    base.height = image.height;
+    base.texels.resize(static_cast<size_t>(image.width) * image.height);
+    const int channels = image.colorChannels;
+    for (size_t i = 0; i < base.texels.size(); ++i)
+    {
+        const unsigned char* pPixel = image.pixels + i * channels;
+        const uint32_t alpha = (channels == 4) ? pPixel[3] : 0xFF;
+        base.texels[i] = pPixel[0] | (pPixel[1] << 8) | (pPixel[2] << 16) | (alpha << 24);
+    }
+    SceneManager::FreeDecodedImage(image);
+    texture.levels.push_back(base);
+
+    while (texture.levels.back().width > 1 || texture.levels.back().height > 1)
+    {
+        const MIP_LEVEL& source = texture.levels.back();
+        MIP_LEVEL level;
+        level.width = std::max(1, source.width / 2);
+        level.height = std::max(1, source.height / 2);
+        level.texels.resize(static_cast<size_t>(level.width) * level.height);
+        for (int y = 0; y < level.height; ++y)
+        {
+            const int sy0 = std::min(y * 2, source.height - 1);
+            const int sy1 = std::min(y * 2 + 1, source.height - 1);
+            for (int x = 0; x < level.width; ++x)
+            {
+                const int sx0 = std::min(x * 2, source.width - 1);
+                const int sx1 = std::min(x * 2 + 1, source.width - 1);
+                const uint32_t texels[4] =
+                {
+                    source.texels[sy0 * source.width + sx0], source.texels[sy0 * source.width + sx1],
+                    source.texels[sy1 * source.width + sx0], source.texels[sy1 * source.width + sx1]
+                };
+                uint32_t average = 0;
+                for (int shift = 0; shift < 32; shift += 8)
+                {
+                    uint32_t sum = 2;
+                    for (uint32_t texel : texels)
+                    {
+                        sum += (texel >> shift) & 0xFF;
+                    }
+                    average |= (sum / 4) << shift;
+                }
+                level.texels[y * level.width + x] = average;
+            }
+        }
+        texture.levels.push_back(level);
+    }
+    return true;
+}
+
+/***********************************************************
+ *  ReleaseTexture()
+ *
+ *  This method is used for freeing the texels of a slot.
+ ***********************************************************/
+void SoftwareRasterizer::ReleaseTexture(int slot)
+{
+    if (slot >= 0 && slot < static_cast<int>(m_textures.size()))
+    {
+        m_textures[slot].levels.clear();
+    }
+}
+
+/***********************************************************
+ *  ClearTextures()
+ *
+ *  This method is used for freeing the texels of all slots.
+ ***********************************************************/
+void SoftwareRasterizer::ClearTextures()
+{
+    m_textures.clear();
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for setting the light sources; like
+ *  SetupSceneLights() it also turns the lighting on. The
+ *  shaders have four light sources, so only the first four
+ *  are used.
+ ***********************************************************/
+void SoftwareRasterizer::SetLights(const std::vector<SceneManager::LIGHT_SOURCE>& lights)
+{
+    const size_t MAX_LIGHTS = 4;
+    m_lights.assign(lights.begin(), lights.begin() + std::min(lights.size(), MAX_LIGHTS));
+    m_bUseLighting = true;
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for allocating the color and depth
+ *  buffers, rounded up to whole tiles.
+ ***********************************************************/
+void SoftwareRasterizer::Resize(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    m_stride = m_tilesX * TILE_SIZE;
+
+    const size_t pixelCount = static_cast<size_t>(m_stride) * m_tilesY * TILE_SIZE;
+    m_colorBuffer.assign(pixelCount, CLEAR_COLOR);
+    m_depthBuffer.assign(pixelCount, CLEAR_DEPTH);
+
+    // screen x = (ndc x + 1) * width / 2 stays within the band
+    m_guardBand = glm::vec2(1.0f + 2.0f * GUARD_BAND_PIXELS / width,
+                            1.0f + 2.0f * GUARD_BAND_PIXELS / height);
+}
+
+/***********************************************************
+ *  DrawFramePacket()
+ *
+ *  This method is used for drawing a frame packet. The draw
+ *  commands are binned in ordered chunks, then the tiles
+ *  are rasterized, both spread over the job system.
+ ***********************************************************/
+void SoftwareRasterizer::DrawFramePacket(const FRAME_PACKET& packet)
+{
+    const int width = glm::clamp(static_cast<int>(packet.viewportSize.x), 1, MAX_RESOLUTION);
+    const int height = glm::clamp(static_cast<int>(packet.viewportSize.y), 1, MAX_RESOLUTION);
+    if (width != m_width || height != m_height)
+    {
+        Resize(width, height);
+    }
+
+    m_pPacket = &packet;
+    m_viewProjection = packet.projection * packet.view;
+
+    // resolve the shader values of each draw in submission
+    // order; a material index of -1 keeps the previous one
+    const std::vector<DRAW_COMMAND>& commands = packet.drawCommands;
+    m_drawStates.resize(commands.size());
+    const SceneManager::OBJECT_MATERIAL* pMaterial = &g_NoMaterial;
+    for (size_t i = 0; i < commands.size(); ++i)
+    {
+        const DRAW_COMMAND& command = commands[i];
+        if (command.materialIndex >= 0 && command.materialIndex < static_cast<int>(m_materials.size()))
+        {
+            pMaterial = &m_materials[command.materialIndex];
+        }
+
+        DRAW_STATE& state = m_drawStates[i];
+        state.color = command.color;
+        state.pMaterial = pMaterial;
+        state.bUseTexture = command.textureSlot >= 0;
+        state.pTexture = nullptr;
+        if (command.textureSlot >= 0 && command.textureSlot < static_cast<int>(m_textures.size()) &&
+            !m_textures[command.textureSlot].levels.empty())
+        {
+            state.pTexture = &m_textures[command.textureSlot];
+        }
+
+        if (m_meshes[command.mesh].indices.empty())
+        {
+            PrimitiveMeshes::GenerateMesh(command.mesh, m_meshes[command.mesh]);
+        }
+    }
+
+    // ordered chunks of draws for the binning jobs
+    const size_t threadCount = (m_pJobSystem != nullptr) ? m_pJobSystem->GetThreadCount() : 1;
+    const size_t chunkCount = std::max<size_t>(1, std::min(commands.size(), threadCount * CHUNKS_PER_THREAD));
+    const size_t drawsPerChunk = (commands.size() + chunkCount - 1) / chunkCount;
+    const size_t tileCount = static_cast<size_t>(m_tilesX) * m_tilesY;
+    m_chunks.resize(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        BIN_CHUNK& chunk = m_chunks[i];
+        chunk.firstDraw = std::min(commands.size(), i * drawsPerChunk);
+        chunk.endDraw = std::min(commands.size(), chunk.firstDraw + drawsPerChunk);
+        chunk.triangles.clear();
+        chunk.tileBins.resize(tileCount);
+        for (std::vector<uint32_t>& bin : chunk.tileBins)
+        {
+            bin.clear();
+        }
+    }
+
+    if (m_pJobSystem != nullptr)
+    {
+        JobCounter counter(0);
+        m_pJobSystem->ParallelFor(chunkCount, 1, &BinDrawsJob, this, &counter);
+        m_pJobSystem->Wait(&counter);
+
+        // a few tiles per job keeps the queues short on large frames
+        const size_t tilesPerJob = std::max<size_t>(1, tileCount / (threadCount * 64));
+        m_pJobSystem->ParallelFor(tileCount, tilesPerJob, &RasterizeTilesJob, this, &counter);
+        m_pJobSystem->Wait(&counter);
+    }
+    else
+    {
+        BinDrawsJob(this, 0, chunkCount);
+        RasterizeTilesJob(this, 0, tileCount);
+    }
+
+    m_triangleCount = 0;
+    for (const BIN_CHUNK& chunk : m_chunks)
+    {
+        m_triangleCount += chunk.triangles.size();
+    }
+    m_pPacket = nullptr;
+}
+
+/***********************************************************
+ *  BinDrawsJob()
+ *
+ *  Job entry point binning the chunks [begin, end).
+ ***********************************************************/
+void SoftwareRasterizer::BinDrawsJob(void* pData, size_t begin, size_t end)
+{
+    SoftwareRasterizer* pRasterizer = static_cast<SoftwareRasterizer*>(pData);
+    for (size_t i = begin; i < end; ++i)
+    {
+        pRasterizer->BinDraws(pRasterizer->m_chunks[i]);
+    }
+}
+
+/***********************************************************
+ *  RasterizeTilesJob()
+ *
+ *  Job entry point rasterizing the tiles [begin, end).
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTilesJob(void* pData, size_t begin, size_t end)
+{
+    SoftwareRasterizer* pRasterizer = static_cast<SoftwareRasterizer*>(pData);
+    for (size_t i = begin; i < end; ++i)
+    {
+        pRasterizer->RasterizeTile(static_cast<int>(i));
+    }
+}
+
+/***********************************************************
+ *  BinDraws()
+ *
+ *  This method is used for running the vertex stage of the
+ *  default vertex shader over the draws of a chunk and
+ *  binning their triangles.
+ ***********************************************************/
+void SoftwareRasterizer::BinDraws(BIN_CHUNK& chunk)
+{
+    for (size_t drawIndex = chunk.firstDraw; drawIndex < chunk.endDraw; ++drawIndex)
+    {
+        const DRAW_COMMAND& command = m_pPacket->drawCommands[drawIndex];
+        const MESH_DATA& mesh = m_meshes[command.mesh];
+        const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(command.model)));
+
+        chunk.vertices.resize(mesh.vertices.size());
+        for (size_t i = 0; i < mesh.vertices.size(); ++i)
+        {
+            const MESH_VERTEX& source = mesh.vertices[i];
+            const glm::vec4 worldPosition = command.model * glm::vec4(source.position, 1.0f);
+            RASTER_VERTEX& vertex = chunk.vertices[i];
+            vertex.clip = m_viewProjection * worldPosition;
+            vertex.world = glm::vec3(worldPosition);
+            vertex.normal = normalMatrix * source.normal;
+            vertex.uv = source.uv;
+        }
+
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+        {
+            const RASTER_VERTEX triangle[3] =
+            {
+                chunk.vertices[mesh.indices[i]],
+                chunk.vertices[mesh.indices[i + 1]],
+                chunk.vertices[mesh.indices[i + 2]]
+            };
+            ClipTriangle(chunk, triangle, static_cast<uint32_t>(drawIndex));
+        }
+    }
+}
+
+/***********************************************************
+ *  ClipTriangle()
+ *
+ *  This method is used for clipping a triangle in clip space
+ *  to the near and far planes and to the guard band. Most
+ *  triangles are entirely inside and set up directly; the
+ *  ones outside a frustum side are dropped.
+ ***********************************************************/
+void SoftwareRasterizer::ClipTriangle(BIN_CHUNK& chunk, const RASTER_VERTEX* pVertices, uint32_t drawIndex)
+{
+    const int PLANE_COUNT = 6;
+
+    // signed distance of a vertex to the clip planes
+    auto planeDistance = [this](const glm::vec4& clip, int plane) -> float
+    {
+        switch (plane)
+        {
+        case 0: return clip.w + clip.z;                     // near
+        case 1: return clip.w - clip.z;                     // far
+        case 2: return clip.w * m_guardBand.x + clip.x;     // left guard band
+        case 3: return clip.w * m_guardBand.x - clip.x;     // right guard band
+        case 4: return clip.w * m_guardBand.y + clip.y;     // bottom guard band
+        default: return clip.w * m_guardBand.y - clip.y;    // top guard band
+        }
+    };
+
+    // triangles entirely outside a side of the view frustum
+    const glm::vec4& a = pVertices[0].clip;
+    const glm::vec4& b = pVertices[1].clip;
+    const glm::vec4& c = pVertices[2].clip;
+    if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+        (a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w))
+    {
+        return;
+    }
+
+    int clipPlanes = 0;
+    for (int plane = 0; plane < PLANE_COUNT; ++plane)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (planeDistance(pVertices[i].clip, plane) < 0.0f)
+            {
+                clipPlanes |= 1 << plane;
+            }
+        }
+    }
+    if (clipPlanes == 0)
+    {
+        SetupTriangle(chunk, pVertices[0], pVertices[1], pVertices[2], drawIndex);
+        return;
+    }
+
+    // Sutherland-Hodgman against the crossed planes
+    RASTER_VERTEX polygon[2][MAX_CLIPPED_VERTICES];
+    int vertexCount = 3;
+    int current = 0;
+    std::copy(pVertices, pVertices + 3, polygon[0]);
+    for (int plane = 0; plane < PLANE_COUNT && vertexCount >= 3; ++plane)
+    {
+        if ((clipPlanes & (1 << plane)) == 0)
+        {
+            continue;
+        }
+
+        const RASTER_VERTEX* pInput = polygon[current];
+        RASTER_VERTEX* pOutput = polygon[1 - current];
+        int outputCount = 0;
+        for (int i = 0; i < vertexCount; ++i)
+        {
+            const RASTER_VERTEX& from = pInput[i];
+            const RASTER_VERTEX& to = pInput[(i + 1) % vertexCount];
+            const float fromDistance = planeDistance(from.clip, plane);
+            const float toDistance = planeDistance(to.clip, plane);
+            if (fromDistance >= 0.0f)
+            {
+                pOutput[outputCount++] = from;
+            }
+            if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+            {
+                pOutput[outputCount++] = LerpVertex(from, to, fromDistance / (fromDistance - toDistance));
+            }
+        }
+        vertexCount = outputCount;
+        current = 1 - current;
+    }
+
+    for (int i = 1; i + 1 < vertexCount; ++i)
+    {
+        SetupTriangle(chunk, polygon[current][0], polygon[current][i], polygon[current][i + 1], drawIndex);
+    }
+}
+
+/***********************************************************
+ *  SetupTriangle()
+ *
+ *  This method is used for snapping a clipped triangle to
+ *  fixed point pixels, calculating its interpolation planes
+ *  and adding it to the bins of the tiles it overlaps.
+ *  Triangles are drawn from both sides, so clockwise ones
+ *  are turned around.
+ ***********************************************************/
+void SoftwareRasterizer::SetupTriangle(
+    BIN_CHUNK& chunk,
+    const RASTER_VERTEX& v0,
+    const RASTER_VERTEX& v1,
+    const RASTER_VERTEX& v2,
+    uint32_t drawIndex)
+{
+    const RASTER_VERTEX* pVertices[3] = { &v0, &v1, &v2 };
+
+    RASTER_TRIANGLE triangle;
+    float depth[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        const glm::vec4& clip = pVertices[i]->clip;
+        const float invW = 1.0f / clip.w;
+        const float screenX = (clip.x * invW * 0.5f + 0.5f) * m_width;
+        const float screenY = (clip.y * invW * 0.5f + 0.5f) * m_height;
+        triangle.x[i] = static_cast<int32_t>(std::floor(screenX * SUBPIXEL_SCALE + 0.5f));
+        triangle.y[i] = static_cast<int32_t>(std::floor(screenY * SUBPIXEL_SCALE + 0.5f));
+        triangle.invW[i] = invW;
+        depth[i] = clip.z * invW * 0.5f + 0.5f;
+    }
+
+    int64_t area = static_cast<int64_t>(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+                   static_cast<int64_t>(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+    if (area == 0)
+    {
+        return;
+    }
+    if (area < 0)
+    {
+        std::swap(pVertices[1], pVertices[2]);
+        std::swap(triangle.x[1], triangle.x[2]);
+        std::swap(triangle.y[1], triangle.y[2]);
+        std::swap(triangle.invW[1], triangle.invW[2]);
+        std::swap(depth[1], depth[2]);
+        area = -area;
+    }
+
+    // pixels whose centers may be covered, inside the frame
+    triangle.minX = std::max(0, std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2])) >> SUBPIXEL_BITS);
+    triangle.minY = std::max(0, std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2])) >> SUBPIXEL_BITS);
+    triangle.maxX = std::min(m_width - 1, std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2])) >> SUBPIXEL_BITS);
+    triangle.maxY = std::min(m_height - 1, std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2])) >> SUBPIXEL_BITS);
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+    {
+        return;
+    }
+
+    // barycentric weights of vertices 1 and 2 at the pixel
+    // centers, from the edge functions relative to vertex 0
+    const double invArea = 1.0 / static_cast<double>(area);
+    const double halfPixel = SUBPIXEL_SCALE / 2;
+    const double edge1X = (triangle.y[2] - triangle.y[0]) * invArea;
+    const double edge1Y = (triangle.x[0] - triangle.x[2]) * invArea;
+    const double edge2X = (triangle.y[0] - triangle.y[1]) * invArea;
+    const double edge2Y = (triangle.x[1] - triangle.x[0]) * invArea;
+    triangle.weight1Plane = glm::vec3(
+        static_cast<float>(edge1X * (halfPixel - triangle.x[0]) + edge1Y * (halfPixel - triangle.y[0])),
+        static_cast<float>(edge1X * SUBPIXEL_SCALE),
+        static_cast<float>(edge1Y * SUBPIXEL_SCALE));
+    triangle.weight2Plane = glm::vec3(
+        static_cast<float>(edge2X * (halfPixel - triangle.x[0]) + edge2Y * (halfPixel - triangle.y[0])),
+        static_cast<float>(edge2X * SUBPIXEL_SCALE),
+        static_cast<float>(edge2Y * SUBPIXEL_SCALE));
+    triangle.depthPlane = glm::vec3(depth[0], 0.0f, 0.0f) +
+                          triangle.weight1Plane * (depth[1] - depth[0]) +
+                          triangle.weight2Plane * (depth[2] - depth[0]);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        triangle.world[i] = pVertices[i]->world;
+        triangle.normal[i] = pVertices[i]->normal;
+        triangle.uv[i] = pVertices[i]->uv;
+    }
+    triangle.drawIndex = drawIndex;
+
+    const uint32_t triangleIndex = static_cast<uint32_t>(chunk.triangles.size());
+    chunk.triangles.push_back(triangle);
+    for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; ++tileY)
+    {
+        for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; ++tileX)
+        {
+            chunk.tileBins[tileY * m_tilesX + tileX].push_back(triangleIndex);
+        }
+    }
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ *
+ *  This method is used for clearing a tile and drawing the
+ *  triangles binned to it, chunk by chunk in draw order.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTile(int tileIndex)
+{
+    const int tileX = (tileIndex % m_tilesX) * TILE_SIZE;
+    const int tileY = (tileIndex / m_tilesX) * TILE_SIZE;
+    for (int y = tileY; y < tileY + TILE_SIZE; ++y)
+    {
+        const size_t rowStart = static_cast<size_t>(y) * m_stride + tileX;
+        std::fill(m_colorBuffer.begin() + rowStart, m_colorBuffer.begin() + rowStart + TILE_SIZE, CLEAR_COLOR);
+        std::fill(m_depthBuffer.begin() + rowStart, m_depthBuffer.begin() + rowStart + TILE_SIZE, CLEAR_DEPTH);
+    }
+
+    for (const BIN_CHUNK& chunk : m_chunks)
+    {
+        for (uint32_t triangleIndex : chunk.tileBins[tileIndex])
+        {
+            RasterizeTriangle(chunk.triangles[triangleIndex], tileX, tileY);
+        }
+    }
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used for walking the rows of the part of
+ *  a triangle inside a tile. The edge functions are set up
+ *  in 64-bit at the corner of that area; edges that do not
+ *  cross it are dropped, which leaves values small enough
+ *  for 32-bit stepping. Pixel centers exactly on an edge
+ *  belong to the triangle left of or above it.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY)
+{
+    const int x0 = std::max(triangle.minX, tileX);
+    const int y0 = std::max(triangle.minY, tileY);
+    const int x1 = std::min(triangle.maxX, tileX + TILE_SIZE - 1);
+    const int y1 = std::min(triangle.maxY, tileY + TILE_SIZE - 1);
+    if (x0 > x1 || y0 > y1)
+    {
+        return;
+    }
+
+    SPAN_EDGES edges;
+    int32_t rowStep[3];
+    const int64_t sampleX = static_cast<int64_t>(x0) * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+    const int64_t sampleY = static_cast<int64_t>(y0) * SUBPIXEL_SCALE + SUBPIXEL_SCALE / 2;
+    for (int k = 0; k < 3; ++k)
+    {
+        // edge k runs between the two other vertices
+        const int a = (k + 1) % 3;
+        const int b = (k + 2) % 3;
+        const int64_t edgeA = static_cast<int64_t>(triangle.y[a]) - triangle.y[b];
+        const int64_t edgeB = static_cast<int64_t>(triangle.x[b]) - triangle.x[a];
+        const int64_t edgeC = static_cast<int64_t>(triangle.x[a]) * triangle.y[b] -
+                              static_cast<int64_t>(triangle.x[b]) * triangle.y[a];
+        const int64_t value = edgeA * sampleX + edgeB * sampleY + edgeC;
+        const int64_t spanX = edgeA * SUBPIXEL_SCALE * (x1 - x0);
+        const int64_t spanY = edgeB * SUBPIXEL_SCALE * (y1 - y0);
+        const bool bTopLeft = edgeA > 0 || (edgeA == 0 && edgeB < 0);
+        const int64_t bias = bTopLeft ? 0 : -1;
+
+        const int64_t minValue = value + std::min<int64_t>(0, spanX) + std::min<int64_t>(0, spanY) + bias;
+        const int64_t maxValue = value + std::max<int64_t>(0, spanX) + std::max<int64_t>(0, spanY) + bias;
+        if (maxValue < 0)
+        {
+            return;
+        }
+        if (minValue >= 0)
+        {
+            edges.value[k] = 0;
+            edges.step[k] = 0;
+            edges.bias[k] = 0;
+            rowStep[k] = 0;
+        }
+        else
+        {
+            edges.value[k] = static_cast<int32_t>(value);
+            edges.step[k] = static_cast<int32_t>(edgeA * SUBPIXEL_SCALE);
+            edges.bias[k] = static_cast<int32_t>(bias);
+            rowStep[k] = static_cast<int32_t>(edgeB * SUBPIXEL_SCALE);
+        }
+    }
+
+    int covered[TILE_SIZE];
+    float coveredDepth[TILE_SIZE];
+    const int count = x1 - x0 + 1;
+    for (int y = y0; y <= y1; ++y)
+    {
+        const float rowDepth = triangle.depthPlane.x + x0 * triangle.depthPlane.y + y * triangle.depthPlane.z;
+        const float* pDepthRow = &m_depthBuffer[static_cast<size_t>(y) * m_stride + x0];
+
+        int coveredCount;
+#ifdef RASTER_HAS_AVX2
+        if (m_bUseSimd)
+        {
+            coveredCount = RasterizeSpanAvx2(edges, count, rowDepth, triangle.depthPlane.y,
+                                             pDepthRow, covered, coveredDepth);
+        }
+        else
+#endif
+        {
+            coveredCount = RasterizeSpanScalar(edges, count, rowDepth, triangle.depthPlane.y,
+                                               pDepthRow, covered, coveredDepth);
+        }
+
+        for (int i = 0; i < coveredCount; ++i)
+        {
+            ShadePixel(triangle, x0 + covered[i], y, coveredDepth[i]);
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            edges.value[k] += rowStep[k];
+        }
+    }
+}
+
+/***********************************************************
+ *  ShadePixel()
+ *
+ *  This method is used for running the default fragment
+ *  shader on a covered pixel: the perspective correct
+ *  values are interpolated, the texture is sampled and lit
+ *  by the Phong model, and the result is blended with
+ *  GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA.
+ ***********************************************************/
+void SoftwareRasterizer::ShadePixel(const RASTER_TRIANGLE& triangle, int x, int y, float depth)
+{
+    const DRAW_STATE& state = m_drawStates[triangle.drawIndex];
+    const float fx = static_cast<float>(x);
+    const float fy = static_cast<float>(y);
+
+    // perspective correct weights of the three vertices at a
+    // pixel offset, for the value and its screen derivatives
+    auto perspectiveWeights = [&triangle](float px, float py) -> glm::vec3
+    {
+        const float weight1 = triangle.weight1Plane.x + px * triangle.weight1Plane.y + py * triangle.weight1Plane.z;
+        const float weight2 = triangle.weight2Plane.x + px * triangle.weight2Plane.y + py * triangle.weight2Plane.z;
+        const glm::vec3 weights((1.0f - weight1 - weight2) * triangle.invW[0],
+                                weight1 * triangle.invW[1],
+                                weight2 * triangle.invW[2]);
+        return weights / (weights.x + weights.y + weights.z);
+    };
+    auto interpolateUV = [&triangle](const glm::vec3& weights) -> glm::vec2
+    {
+        return triangle.uv[0] * weights.x + triangle.uv[1] * weights.y + triangle.uv[2] * weights.z;
+    };
+
+    const glm::vec3 weights = perspectiveWeights(fx, fy);
+
+    glm::vec4 baseColor = state.color;
+    if (state.bUseTexture)
+    {
+        baseColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        if (state.pTexture != nullptr)
+        {
+            const glm::vec2 uv = interpolateUV(weights) * m_uvScale;
+            const glm::vec2 uvDx = interpolateUV(perspectiveWeights(fx + 1.0f, fy)) * m_uvScale - uv;
+            const glm::vec2 uvDy = interpolateUV(perspectiveWeights(fx, fy + 1.0f)) * m_uvScale - uv;
+            baseColor = SampleTexture(*state.pTexture, uv, uvDx, uvDy);
+        }
+    }
+
+    glm::vec4 color = baseColor;
+    if (m_bUseLighting)
+    {
+        const SceneManager::OBJECT_MATERIAL& material = *state.pMaterial;
+        const glm::vec3 position = triangle.world[0] * weights.x + triangle.world[1] * weights.y +
+                                   triangle.world[2] * weights.z;
+        const glm::vec3 normal = glm::normalize(triangle.normal[0] * weights.x + triangle.normal[1] * weights.y +
+                                                triangle.normal[2] * weights.z);
+        const glm::vec3 viewDirection = glm::normalize(m_pPacket->viewPosition - position);
+
+        glm::vec3 phong = material.ambientStrength * material.ambientColor;
+        for (const SceneManager::LIGHT_SOURCE& light : m_lights)
+        {
+            const glm::vec3 lightDirection = glm::normalize(light.position - position);
+            const float impact = std::max(glm::dot(normal, lightDirection), 0.0f);
+            phong += impact * material.diffuseColor * light.diffuseColor;
+
+            const glm::vec3 reflectDirection = glm::reflect(-lightDirection, normal);
+            const float specular = std::pow(std::max(glm::dot(viewDirection, reflectDirection), 0.0f),
+                                            light.focalStrength);
+            phong += light.specularIntensity * specular * material.specularColor * light.specularColor;
+        }
+        color = glm::vec4(phong * glm::vec3(baseColor), baseColor.w);
+    }
+
+    const size_t pixel = static_cast<size_t>(y) * m_stride + x;
+    const float alpha = glm::clamp(color.w, 0.0f, 1.0f);
+    const glm::vec4 destination = UnpackColor(m_colorBuffer[pixel]);
+    const glm::vec4 source(glm::clamp(glm::vec3(color), 0.0f, 1.0f), alpha);
+    m_colorBuffer[pixel] = PackColor(source * alpha + destination * (1.0f - alpha));
+    m_depthBuffer[pixel] = depth;
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  This method is used for filtering a texture the way
+ *  GL_LINEAR_MIPMAP_LINEAR does: the level of detail comes
+ *  from the texture coordinate change per pixel, and the
+ *  bilinear samples of the two nearest levels are blended.
+ ***********************************************************/
+glm::vec4 SoftwareRasterizer::SampleTexture(
+    const TEXTURE& texture,
+    const glm::vec2& uv,
+    const glm::vec2& uvDx,
+    const glm::vec2& uvDy) const
+{
+    const MIP_LEVEL& base = texture.levels[0];
+    const float dx = glm::length(glm::vec2(uvDx.x * base.width, uvDx.y * base.height));
+    const float dy = glm::length(glm::vec2(uvDy.x * base.width, uvDy.y * base.height));
+    const float rho = std::max(dx, dy);
+    const float lod = (rho > 0.0f) ? std::log2(rho) : 0.0f;
+    if (lod <= 0.0f)
+    {
+        return SampleBilinear(base.texels, base.width, base.height, uv);
+    }
+
+    const float maxLevel = static_cast<float>(texture.levels.size() - 1);
+    const float level = std::min(lod, maxLevel);
+    const int level0 = static_cast<int>(level);
+    const int level1 = std::min(level0 + 1, static_cast<int>(maxLevel));
+    const float blend = level - static_cast<float>(level0);
+
+    const MIP_LEVEL& near0 = texture.levels[level0];
+    const glm::vec4 color0 = SampleBilinear(near0.texels, near0.width, near0.height, uv);
+    if (level1 == level0 || blend <= 0.0f)
+    {
+        return color0;
+    }
+    const MIP_LEVEL& near1 = texture.levels[level1];
+    const glm::vec4 color1 = SampleBilinear(near1.texels, near1.width, near1.height, uv);
+    return color0 * (1.0f - blend) + color1 * blend;
+}
+
+/***********************************************************
+ *  ReadPixels()
+ *
+ *  This method is used for copying the visible part of the
+ *  color buffer as RGBA bytes.
+ ***********************************************************/
+void SoftwareRasterizer::ReadPixels(std::vector<uint8_t>& pixels) const
+{
+    pixels.resize(static_cast<size_t>(m_width) * m_height * 4);
+    for (int y = 0; y < m_height; ++y)
+    {
+        const uint32_t* pRow = &m_colorBuffer[static_cast<size_t>(y) * m_stride];
+        for (int x = 0; x < m_width; ++x)
+        {
+            uint8_t* pPixel = &pixels[(static_cast<size_t>(y) * m_width + x) * 4];
+            pPixel[0] = static_cast<uint8_t>(pRow[x] & 0xFF);
+            pPixel[1] = static_cast<uint8_t>((pRow[x] >> 8) & 0xFF);
+            pPixel[2] = static_cast<uint8_t>((pRow[x] >> 16) & 0xFF);
+            pPixel[3] = static_cast<uint8_t>(pRow[x] >> 24);
+        }
+    }
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This method is used for saving the last frame as a 32-bit
+ *  uncompressed TGA file, which stores the bottom row first
+ *  like the frame itself.
+ ***********************************************************/
+bool SoftwareRasterizer::WriteImage(const char* filename) const
+{
+    if (m_width == 0 || m_height == 0)
+    {
+        return false;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR: Could not write the image " << filename << std::endl;
+        return false;
+    }
+
+    uint8_t header[18];
+    memset(header, 0, sizeof(header));
+    header[2] = 2;                                          // uncompressed true color
+    header[12] = static_cast<uint8_t>(m_width & 0xFF);
+    header[13] = static_cast<uint8_t>(m_width >> 8);
+    header[14] = static_cast<uint8_t>(m_height & 0xFF);
+    header[15] = static_cast<uint8_t>(m_height >> 8);
+    header[16] = 32;                                        // bits per pixel
+    header[17] = 8;                                         // alpha bits, bottom-up rows
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<uint8_t> pixels;
+    ReadPixels(pixels);
+    for (size_t i = 0; i < pixels.size(); i += 4)
+    {
+        std::swap(pixels[i], pixels[i + 2]);                // RGBA to BGRA
+    }
+    file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    return static_cast<bool>(file);
+}
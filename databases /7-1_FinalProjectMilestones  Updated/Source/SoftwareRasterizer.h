@@ -0,0 +1,212 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// multi-threaded tile-based CPU renderer for the frame packets, used in
+// place of OpenGL on machines without a GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "FramePacket.h"
+#include "JobSystem.h"
+#include "MeshData.h"
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  SoftwareRasterizer
+ *
+ *  This class draws the frame packets built by the scene
+ *  manager on the CPU, with the same vertex transform,
+ *  texture filtering and Phong lighting as the default
+ *  shaders. A frame runs in two job system passes:
+ *
+ *  - the draw commands are split into ordered chunks; each
+ *    chunk transforms its meshes, clips the triangles and
+ *    sorts them into per-tile bins
+ *  - each screen tile is rasterized by a single job, which
+ *    walks the bins of all chunks in draw order, so blending
+ *    and depth ties resolve exactly as they are submitted
+ *
+ *  The edge functions and depth test run on eight pixels at
+ *  once with AVX2 when the processor supports it. Since each
+ *  tile belongs to one job, the image does not depend on the
+ *  number of threads or on the SIMD path.
+ ***********************************************************/
+class SoftwareRasterizer
+{
+public:
+    // pixels per side of the tiles the screen is split into
+    static const int TILE_SIZE = 64;
+    // largest supported frame width and height
+    static const int MAX_RESOLUTION = 4096;
+
+    // constructor; without a job system everything runs on the
+    // calling thread
+    explicit SoftwareRasterizer(JobSystem* pJobSystem = nullptr);
+    // destructor
+    ~SoftwareRasterizer();
+
+    // whether the processor and the build support the AVX2 path
+    static bool IsSimdSupported();
+    // use the AVX2 path when supported, on by default
+    void SetUseSimd(bool bUseSimd) { m_bUseSimd = bUseSimd && IsSimdSupported(); }
+    bool GetUseSimd() const { return m_bUseSimd; }
+
+    // copy decoded pixels into a texture slot and build their mip
+    // chain; the decoded pixels are freed
+    bool SetTexture(int slot, SceneManager::DECODED_IMAGE& image);
+    // empty a texture slot; textured draws then sample black
+    void ReleaseTexture(int slot);
+    void ClearTextures();
+
+    // the shader values of the scene
+    void SetMaterials(const std::vector<SceneManager::OBJECT_MATERIAL>& materials) { m_materials = materials; }
+    void SetLights(const std::vector<SceneManager::LIGHT_SOURCE>& lights);
+    void SetUVScale(const glm::vec2& uvScale) { m_uvScale = uvScale; }
+
+    // clear the frame to the packet's viewport size and draw the
+    // commands of the packet into it
+    void DrawFramePacket(const FRAME_PACKET& packet);
+
+    // size of the last frame drawn
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    // triangles sent to the tiles in the last frame, after clipping
+    size_t GetTriangleCount() const { return m_triangleCount; }
+
+    // copy the last frame as RGBA bytes, bottom row first like
+    // glReadPixels()
+    void ReadPixels(std::vector<uint8_t>& pixels) const;
+    // write the last frame to an uncompressed TGA file
+    bool WriteImage(const char* filename) const;
+
+private:
+    // one level of a texture's mip chain, RGBA8 texels
+    struct MIP_LEVEL
+    {
+        int width;
+        int height;
+        std::vector<uint32_t> texels;
+    };
+
+    // a texture slot; empty when nothing is loaded
+    struct TEXTURE
+    {
+        std::vector<MIP_LEVEL> levels;
+    };
+
+    // a transformed vertex with the inputs of the pixel shading
+    struct RASTER_VERTEX
+    {
+        glm::vec4 clip;
+        glm::vec3 world;
+        glm::vec3 normal;
+        glm::vec2 uv;
+    };
+
+    // a clipped, screen space triangle, ready to be rasterized
+    struct RASTER_TRIANGLE
+    {
+        // vertex positions in 28.4 fixed point pixels,
+        // counter-clockwise
+        int32_t x[3];
+        int32_t y[3];
+        // pixel bounds, inclusive and inside the frame
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+        // barycentric weights of vertices 1 and 2 and the window
+        // depth as planes: value = c + x * dx + y * dy at pixel
+        // centers
+        glm::vec3 weight1Plane;
+        glm::vec3 weight2Plane;
+        glm::vec3 depthPlane;
+        // perspective correction and interpolated values
+        float invW[3];
+        glm::vec3 world[3];
+        glm::vec3 normal[3];
+        glm::vec2 uv[3];
+        uint32_t drawIndex;
+    };
+
+    // the shader values of one draw command
+    struct DRAW_STATE
+    {
+        glm::vec4 color;
+        const SceneManager::OBJECT_MATERIAL* pMaterial;
+        bool bUseTexture;
+        // nullptr samples black, like an empty texture unit
+        const TEXTURE* pTexture;
+    };
+
+    // triangles of a range of draw commands, binned per tile;
+    // padded so neighbouring chunks do not share a cache line
+    struct BIN_CHUNK
+    {
+        size_t firstDraw;
+        size_t endDraw;
+        std::vector<RASTER_VERTEX> vertices;
+        std::vector<RASTER_TRIANGLE> triangles;
+        std::vector<std::vector<uint32_t>> tileBins;
+        char padding[64];
+    };
+
+    // allocate the buffers of a frame size
+    void Resize(int width, int height);
+    // transform, clip, set up and bin the triangles of a chunk
+    void BinDraws(BIN_CHUNK& chunk);
+    // clip a triangle to the near and far planes and the guard
+    // band and set up the resulting triangles
+    void ClipTriangle(BIN_CHUNK& chunk, const RASTER_VERTEX* pVertices, uint32_t drawIndex);
+    // project a triangle to the screen and add it to its tiles
+    void SetupTriangle(BIN_CHUNK& chunk, const RASTER_VERTEX& v0, const RASTER_VERTEX& v1,
+                       const RASTER_VERTEX& v2, uint32_t drawIndex);
+    // clear a tile and draw its triangles of every chunk
+    void RasterizeTile(int tileIndex);
+    // draw the pixels of a triangle inside a tile
+    void RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY);
+    // shade a covered pixel and blend it into the frame
+    void ShadePixel(const RASTER_TRIANGLE& triangle, int x, int y, float depth);
+    // trilinear texture lookup with repeat wrapping
+    glm::vec4 SampleTexture(const TEXTURE& texture, const glm::vec2& uv,
+                            const glm::vec2& uvDx, const glm::vec2& uvDy) const;
+
+    // job entry points of the two frame passes
+    static void BinDrawsJob(void* pData, size_t begin, size_t end);
+    static void RasterizeTilesJob(void* pData, size_t begin, size_t end);
+
+    JobSystem* m_pJobSystem;
+    bool m_bUseSimd;
+
+    // frame size, and the buffer size rounded up to whole tiles
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    int m_stride;
+    std::vector<uint32_t> m_colorBuffer;
+    std::vector<float> m_depthBuffer;
+
+    std::vector<TEXTURE> m_textures;
+    std::vector<SceneManager::OBJECT_MATERIAL> m_materials;
+    std::vector<SceneManager::LIGHT_SOURCE> m_lights;
+    glm::vec2 m_uvScale;
+    bool m_bUseLighting;
+
+    // basic shapes, generated when a packet first draws them
+    MESH_DATA m_meshes[MESH_COUNT];
+
+    // state of the frame being drawn
+    const FRAME_PACKET* m_pPacket;
+    glm::mat4 m_viewProjection;
+    std::vector<DRAW_STATE> m_drawStates;
+    std::vector<BIN_CHUNK> m_chunks;
+    // extent of the guard band in normalized device coordinates
+    glm::vec2 m_guardBand;
+    size_t m_triangleCount;
+};
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// spscqueue.h
+// ============
+// bounded lock-free queue for one producer thread and one consumer thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/***********************************************************
+ *  SpscQueue
+ *
+ *  A fixed-capacity ring buffer that is safe to use without
+ *  locks as long as exactly one thread pushes and exactly
+ *  one thread pops. The capacity must be a power of two.
+ ***********************************************************/
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue()
+        : m_head(0),
+          m_tail(0)
+    {
+    }
+
+    // add an item at the tail; returns false when the queue is full
+    bool TryPush(const T& item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        m_items[tail & (Capacity - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // remove the item at the head; returns false when the queue is empty
+    bool TryPop(T& item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = m_items[head & (Capacity - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate number of queued items
+    size_t Size() const
+    {
+        return m_tail.load(std::memory_order_acquire) -
+               m_head.load(std::memory_order_acquire);
+    }
+
+    bool IsEmpty() const { return Size() == 0; }
+
+private:
+    // head and tail are padded onto separate cache lines so the
+    // producer and the consumer do not invalidate each other's
+    // line; padding rather than alignas keeps the queue safe to
+    // allocate with the plain C++14 operator new
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    std::atomic<size_t> m_head;
+    char m_headPadding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_tail;
+    char m_tailPadding[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    T m_items[Capacity];
+};
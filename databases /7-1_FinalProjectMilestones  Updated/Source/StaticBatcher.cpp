@@ -0,0 +1,485 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.cpp
+// ============
+// merge static scene objects that share their draw state into pre-transformed
+// geometry that is drawn with one call per group
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticBatcher.h"
+#include "AllocationTracker.h"
+
+#include <algorithm>
+#include <atomic>
+
+// redirects the OpenGL calls below to the capture layer
+#include "GLCaptureCalls.h"
+
+// declare the global variables
+namespace
+{
+    // fewest objects worth a batch
+    const size_t MIN_BATCH_OBJECTS = 2;
+    // a group with more vertices than this is split, so the
+    // culling can still drop parts of a large group
+    const uint32_t MAX_BATCH_VERTICES = 65536;
+
+    // versions of the sets built so far, over all batchers
+    std::atomic<uint64_t> g_BatchSetVersion(0);
+
+    // the state a batch shares, used to group the objects
+    struct DRAW_STATE
+    {
+        int materialIndex;
+        int textureSlot;
+        // only compared for untextured objects
+        glm::vec4 color;
+    };
+
+    /***********************************************************
+     *  CompareDrawState()
+     *
+     *  Order two draw states; negative, zero or positive like
+     *  strcmp().
+     ***********************************************************/
+    int CompareDrawState(const DRAW_STATE& a, const DRAW_STATE& b)
+    {
+        if (a.materialIndex != b.materialIndex)
+        {
+            return a.materialIndex < b.materialIndex ? -1 : 1;
+        }
+        if (a.textureSlot != b.textureSlot)
+        {
+            return a.textureSlot < b.textureSlot ? -1 : 1;
+        }
+        if (a.textureSlot < 0)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                if (a.color[i] != b.color[i])
+                {
+                    return a.color[i] < b.color[i] ? -1 : 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    /***********************************************************
+     *  MergeBoundingSpheres()
+     *
+     *  Get the smallest sphere around two spheres; a negative
+     *  radius marks an empty sphere.
+     ***********************************************************/
+    glm::vec4 MergeBoundingSpheres(const glm::vec4& a, const glm::vec4& b)
+    {
+        if (a.w < 0.0f)
+        {
+            return b;
+        }
+
+        const glm::vec3 centerA(a);
+        const glm::vec3 centerB(b);
+        const float distance = glm::length(centerB - centerA);
+        if (distance + b.w <= a.w)
+        {
+            return a;
+        }
+        if (distance + a.w <= b.w)
+        {
+            return b;
+        }
+
+        const float radius = 0.5f * (distance + a.w + b.w);
+        const glm::vec3 center = centerA + (centerB - centerA) * ((radius - a.w) / distance);
+        return glm::vec4(center, radius);
+    }
+}
+
+/***********************************************************
+ *  StaticBatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatcher::StaticBatcher()
+    : m_shapeOptimization(MESH_OPTIMIZE_OVERDRAW)
+{
+    for (bool& bGenerated : m_bShapeGenerated)
+    {
+        bGenerated = false;
+    }
+    m_stats.batchCount = 0;
+    m_stats.objectCount = 0;
+    m_stats.vertexCount = 0;
+    m_stats.rebuiltBatches = 0;
+    m_stats.reusedBatches = 0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  Sort the batchable entities by draw state and by entity
+ *  index, so the grouping does not depend on their slots,
+ *  and cut each run of equal states into batches within the
+ *  vertex limit. The objects of a batch are transformed
+ *  into world space with their model matrices; the normals
+ *  get the inverse transpose, as in the vertex shader.
+ ***********************************************************/
+void StaticBatcher::Build(const EntityStore& entities, const uint8_t* pBatchable, MESH_OPTIMIZATION optimization)
+{
+    AllocationScope scope(ALLOCATION_MESHES);
+
+    if (optimization != m_shapeOptimization)
+    {
+        for (bool& bGenerated : m_bShapeGenerated)
+        {
+            bGenerated = false;
+        }
+        m_shapeOptimization = optimization;
+    }
+
+    const int16_t* pMaterials = entities.GetMaterialIndices();
+    const int16_t* pTextures = entities.GetTextureSlots();
+    const glm::vec4* pColors = entities.GetColors();
+    const uint8_t* pMeshes = entities.GetMeshes();
+    const glm::mat4* pModels = entities.GetModelMatrices();
+    const glm::vec4* pBounds = entities.GetWorldBounds();
+
+    auto getDrawState = [&](size_t slot)
+    {
+        DRAW_STATE state;
+        state.materialIndex = pMaterials[slot];
+        state.textureSlot = pTextures[slot];
+        state.color = pColors[slot];
+        return state;
+    };
+
+    std::vector<uint32_t> slots;
+    for (size_t slot = 0; slot < entities.GetCount(); ++slot)
+    {
+        if (pBatchable[slot] && pMeshes[slot] < MESH_COUNT)
+        {
+            slots.push_back(static_cast<uint32_t>(slot));
+        }
+    }
+    std::sort(slots.begin(), slots.end(), [&](uint32_t a, uint32_t b)
+    {
+        const int order = CompareDrawState(getDrawState(a), getDrawState(b));
+        return order != 0 ? order < 0 : entities.GetHandle(a).index < entities.GetHandle(b).index;
+    });
+
+    const STATIC_BATCH_SET* pPrevious = m_pBatches.get();
+    std::shared_ptr<STATIC_BATCH_SET> pSet = std::make_shared<STATIC_BATCH_SET>();
+    pSet->version = ++g_BatchSetVersion;
+    m_stats.rebuiltBatches = 0;
+    m_stats.reusedBatches = 0;
+
+    // find the batch of the previous set with the same objects
+    auto findPrevious = [&](const STATIC_BATCH& batch) -> const STATIC_BATCH*
+    {
+        if (pPrevious == nullptr)
+        {
+            return nullptr;
+        }
+        const ENTITY_HANDLE* pObjects = pSet->objects.data() + batch.firstObject;
+        for (const STATIC_BATCH& previous : pPrevious->batches)
+        {
+            if (previous.objectCount != batch.objectCount)
+            {
+                continue;
+            }
+            const ENTITY_HANDLE* pPreviousObjects = pPrevious->objects.data() + previous.firstObject;
+            bool bSame = true;
+            for (uint32_t i = 0; i < batch.objectCount && bSame; ++i)
+            {
+                bSame = pObjects[i].index == pPreviousObjects[i].index &&
+                        pObjects[i].generation == pPreviousObjects[i].generation;
+            }
+            if (bSame)
+            {
+                return &previous;
+            }
+        }
+        return nullptr;
+    };
+
+    // append the objects of slots[begin, end) as one batch
+    auto addBatch = [&](size_t begin, size_t end)
+    {
+        MESH_DATA& geometry = pSet->geometry;
+
+        const DRAW_STATE state = getDrawState(slots[begin]);
+        STATIC_BATCH batch;
+        batch.materialIndex = state.materialIndex;
+        batch.textureSlot = state.textureSlot;
+        batch.color = state.color;
+        batch.bounds = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+        batch.firstVertex = static_cast<uint32_t>(geometry.vertices.size());
+        batch.firstIndex = static_cast<uint32_t>(geometry.indices.size());
+        batch.firstObject = static_cast<uint32_t>(pSet->objects.size());
+        batch.objectCount = static_cast<uint32_t>(end - begin);
+        for (size_t i = begin; i < end; ++i)
+        {
+            pSet->objects.push_back(entities.GetHandle(slots[i]));
+        }
+
+        const STATIC_BATCH* pReused = findPrevious(batch);
+        if (pReused != nullptr)
+        {
+            // the objects have not moved since, as a moved object
+            // leaves its batch; only the indices are rebased
+            const MESH_DATA& previousGeometry = pPrevious->geometry;
+            geometry.vertices.insert(geometry.vertices.end(),
+                previousGeometry.vertices.begin() + pReused->firstVertex,
+                previousGeometry.vertices.begin() + pReused->firstVertex + pReused->vertexCount);
+            for (uint32_t i = 0; i < pReused->indexCount; ++i)
+            {
+                const uint32_t index = previousGeometry.indices[pReused->firstIndex + i];
+                geometry.indices.push_back(index - pReused->firstVertex + batch.firstVertex);
+            }
+            batch.bounds = pReused->bounds;
+            ++m_stats.reusedBatches;
+        }
+        else
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const uint32_t slot = slots[i];
+                const MESH_DATA& shape = GetShapeMesh(static_cast<MESH_TYPE>(pMeshes[slot]), optimization);
+                const glm::mat4& model = pModels[slot];
+                const glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+
+                const uint32_t baseVertex = static_cast<uint32_t>(geometry.vertices.size());
+                for (const MESH_VERTEX& vertex : shape.vertices)
+                {
+                    MESH_VERTEX world;
+                    world.position = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+                    world.normal = normalMatrix * vertex.normal;
+                    world.uv = vertex.uv;
+                    geometry.vertices.push_back(world);
+                }
+                for (uint32_t index : shape.indices)
+                {
+                    geometry.indices.push_back(baseVertex + index);
+                }
+                batch.bounds = MergeBoundingSpheres(batch.bounds, pBounds[slot]);
+            }
+            ++m_stats.rebuiltBatches;
+        }
+
+        batch.vertexCount = static_cast<uint32_t>(geometry.vertices.size()) - batch.firstVertex;
+        batch.indexCount = static_cast<uint32_t>(geometry.indices.size()) - batch.firstIndex;
+        pSet->batches.push_back(batch);
+    };
+
+    size_t groupBegin = 0;
+    while (groupBegin < slots.size())
+    {
+        const DRAW_STATE state = getDrawState(slots[groupBegin]);
+        size_t groupEnd = groupBegin + 1;
+        while (groupEnd < slots.size() && CompareDrawState(state, getDrawState(slots[groupEnd])) == 0)
+        {
+            ++groupEnd;
+        }
+
+        size_t batchBegin = groupBegin;
+        while (batchBegin < groupEnd)
+        {
+            size_t batchEnd = batchBegin;
+            uint32_t vertexCount = 0;
+            while (batchEnd < groupEnd)
+            {
+                const MESH_TYPE mesh = static_cast<MESH_TYPE>(pMeshes[slots[batchEnd]]);
+                const uint32_t shapeVertices = static_cast<uint32_t>(GetShapeMesh(mesh, optimization).vertices.size());
+                if (batchEnd > batchBegin && vertexCount + shapeVertices > MAX_BATCH_VERTICES)
+                {
+                    break;
+                }
+                vertexCount += shapeVertices;
+                ++batchEnd;
+            }
+            if (batchEnd - batchBegin >= MIN_BATCH_OBJECTS)
+            {
+                addBatch(batchBegin, batchEnd);
+            }
+            batchBegin = batchEnd;
+        }
+        groupBegin = groupEnd;
+    }
+
+    m_stats.batchCount = pSet->batches.size();
+    m_stats.objectCount = pSet->objects.size();
+    m_stats.vertexCount = pSet->geometry.vertices.size();
+    m_pBatches = pSet;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  Drop the current set. The shapes stay generated.
+ ***********************************************************/
+void StaticBatcher::Clear()
+{
+    m_pBatches.reset();
+    m_stats.batchCount = 0;
+    m_stats.objectCount = 0;
+    m_stats.vertexCount = 0;
+}
+
+/***********************************************************
+ *  GetShapeMesh()
+ *
+ *  Get a basic shape as the registry uploads it, generated
+ *  and optimized the first time a batch uses it.
+ ***********************************************************/
+const MESH_DATA& StaticBatcher::GetShapeMesh(MESH_TYPE mesh, MESH_OPTIMIZATION optimization)
+{
+    if (!m_bShapeGenerated[mesh])
+    {
+        m_shapes[mesh] = MESH_DATA();
+        PrimitiveMeshes::GenerateMesh(mesh, m_shapes[mesh]);
+        OptimizeMesh(m_shapes[mesh], optimization);
+        m_bShapeGenerated[mesh] = true;
+    }
+    return m_shapes[mesh];
+}
+
+/***********************************************************
+ *  StaticBatchBuffers()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatchBuffers::StaticBatchBuffers()
+    : m_uploadedVersion(0)
+{
+    m_mesh.vertexArray = 0;
+    m_mesh.vertexBuffer = 0;
+    m_mesh.indexBuffer = 0;
+    m_mesh.indexCount = 0;
+    m_mesh.indexType = GL_UNSIGNED_INT;
+    m_mesh.format = VERTEX_FORMAT_FLOAT;
+    m_mesh.bufferBytes = 0;
+    m_mesh.positionOffset = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_mesh.positionScale = glm::vec3(1.0f, 1.0f, 1.0f);
+    for (GLuint& vertexArray : m_vertexArrays)
+    {
+        vertexArray = 0;
+    }
+}
+
+/***********************************************************
+ *  ~StaticBatchBuffers()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StaticBatchBuffers::~StaticBatchBuffers()
+{
+    Destroy();
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  Draw one batch. The batches of a set are drawn in a row,
+ *  so only the first one of a new set uploads it.
+ ***********************************************************/
+void StaticBatchBuffers::Draw(const STATIC_BATCH_SET& batches, size_t batchIndex, GLsizei instanceCount)
+{
+    if (batchIndex >= batches.batches.size())
+    {
+        return;
+    }
+    if (batches.version != m_uploadedVersion)
+    {
+        Upload(batches);
+    }
+
+    const STATIC_BATCH& batch = batches.batches[batchIndex];
+    PrimitiveMeshes::GPU_MESH gpuMesh = m_mesh;
+    gpuMesh.vertexArray = GetVertexArray();
+    PrimitiveMeshes::DrawUploadedRange(gpuMesh,
+        static_cast<GLsizei>(batch.firstIndex), static_cast<GLsizei>(batch.indexCount), instanceCount);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  Write the merged geometry of a set into the buffers,
+ *  creating them the first time. The index buffer is part
+ *  of the vertex array state, so it is written through a
+ *  vertex array that has it bound.
+ ***********************************************************/
+void StaticBatchBuffers::Upload(const STATIC_BATCH_SET& batches)
+{
+    AllocationScope scope(ALLOCATION_MESHES);
+
+    const MESH_DATA& geometry = batches.geometry;
+    if (m_mesh.vertexBuffer == 0)
+    {
+        PrimitiveMeshes::UploadMesh(geometry, VERTEX_FORMAT_FLOAT, m_mesh);
+        m_vertexArrays[PrimitiveMeshes::GetShared().GetCurrentContext()] = m_mesh.vertexArray;
+        m_mesh.vertexArray = 0;
+    }
+    else
+    {
+        const size_t vertexBytes = geometry.vertices.size() * sizeof(MESH_VERTEX);
+        const size_t indexBytes = geometry.indices.size() * sizeof(uint32_t);
+
+        glBindVertexArray(GetVertexArray());
+        glBindBuffer(GL_ARRAY_BUFFER, m_mesh.vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, geometry.vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_mesh.indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, geometry.indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        m_mesh.indexCount = static_cast<GLsizei>(geometry.indices.size());
+        m_mesh.bufferBytes = vertexBytes + indexBytes;
+    }
+    m_uploadedVersion = batches.version;
+}
+
+/***********************************************************
+ *  GetVertexArray()
+ *
+ *  Get the vertex array of the current context, creating
+ *  one over the buffers when the context has none yet.
+ ***********************************************************/
+GLuint StaticBatchBuffers::GetVertexArray()
+{
+    GLuint& vertexArray = m_vertexArrays[PrimitiveMeshes::GetShared().GetCurrentContext()];
+    if (vertexArray == 0)
+    {
+        glGenVertexArrays(1, &vertexArray);
+        glBindVertexArray(vertexArray);
+        PrimitiveMeshes::SetVertexLayout(m_mesh);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    return vertexArray;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  Delete the buffers. Nothing happens when no set was
+ *  uploaded.
+ ***********************************************************/
+void StaticBatchBuffers::Destroy()
+{
+    if (m_mesh.vertexBuffer == 0)
+    {
+        return;
+    }
+
+    GLuint& vertexArray = m_vertexArrays[PrimitiveMeshes::GetShared().GetCurrentContext()];
+    if (vertexArray != 0)
+    {
+        glDeleteVertexArrays(1, &vertexArray);
+    }
+    for (GLuint& otherVertexArray : m_vertexArrays)
+    {
+        otherVertexArray = 0;
+    }
+    PrimitiveMeshes::DeleteUploadedMesh(m_mesh);
+    m_uploadedVersion = 0;
+}
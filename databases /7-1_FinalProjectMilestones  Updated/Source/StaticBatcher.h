@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.h
+// ============
+// merge static scene objects that share their draw state into pre-transformed
+// geometry that is drawn with one call per group
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "EntityStore.h"
+#include "FramePacket.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+#include "PrimitiveMeshes.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+// objects with the same draw state, merged into one index range
+struct STATIC_BATCH
+{
+    // draw state shared by all objects of the batch
+    int materialIndex;
+    int textureSlot;
+    glm::vec4 color;
+    // world bounding sphere enclosing all of the objects
+    glm::vec4 bounds;
+    // ranges in the merged geometry of the set
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    // range of its objects in STATIC_BATCH_SET::objects
+    uint32_t firstObject;
+    uint32_t objectCount;
+};
+
+// the static batches of a scene and their merged geometry. A set
+// is never changed once built; a frame packet keeps the one it was
+// built with, so the render thread can still draw it while the
+// next set is being built
+struct STATIC_BATCH_SET
+{
+    // ordered by draw state
+    std::vector<STATIC_BATCH> batches;
+    // entities merged into the batches, grouped by batch
+    std::vector<ENTITY_HANDLE> objects;
+    // world space vertices; the indices address the whole array
+    MESH_DATA geometry;
+    // different for every set built by the process
+    uint64_t version;
+};
+
+/***********************************************************
+ *  StaticBatcher
+ *
+ *  This class groups the scene entities by material,
+ *  texture and solid color, transforms the shapes of each
+ *  group into world space and appends them to one merged
+ *  vertex and index array, so a group is drawn with a
+ *  single call and an identity model matrix.
+ *
+ *  Each rebuild makes a new set. A batch that has the same
+ *  objects as one of the previous set copies its vertices
+ *  from there instead of transforming its shapes again, so
+ *  only the batches an object joined or left are rebuilt.
+ *  The batcher runs on the thread that builds the frames
+ *  and makes no OpenGL calls.
+ ***********************************************************/
+class StaticBatcher
+{
+public:
+    // batching results of the last rebuild
+    struct STATS
+    {
+        size_t batchCount;
+        size_t objectCount;
+        size_t vertexCount;
+        // batches transformed again and batches copied over
+        size_t rebuiltBatches;
+        size_t reusedBatches;
+    };
+
+    StaticBatcher();
+
+    // regroup the entities whose pBatchable entry is set, one
+    // per slot; an object without a partner is left out, since
+    // it would not save a draw call. The entity transforms must
+    // be up to date
+    void Build(const EntityStore& entities, const uint8_t* pBatchable, MESH_OPTIMIZATION optimization);
+    // drop the batches; the frame packets may still hold them
+    void Clear();
+
+    // the current set, or nullptr before the first build
+    const std::shared_ptr<const STATIC_BATCH_SET>& GetBatches() const { return m_pBatches; }
+    const STATS& GetStats() const { return m_stats; }
+
+private:
+    // the optimized shape in model space, generated on first use
+    const MESH_DATA& GetShapeMesh(MESH_TYPE mesh, MESH_OPTIMIZATION optimization);
+
+    MESH_DATA m_shapes[MESH_COUNT];
+    bool m_bShapeGenerated[MESH_COUNT];
+    MESH_OPTIMIZATION m_shapeOptimization;
+
+    std::shared_ptr<const STATIC_BATCH_SET> m_pBatches;
+    STATS m_stats;
+};
+
+/***********************************************************
+ *  StaticBatchBuffers
+ *
+ *  This class holds the merged geometry of a batch set on
+ *  the GPU and draws its batches. A set is uploaded when a
+ *  batch of it is first drawn; the buffers are specified
+ *  again in place, so the vertex arrays over them stay
+ *  valid. Windows sharing the objects of the first context
+ *  get vertex arrays of their own, like the basic shapes.
+ *  Only used on the thread that owns the context.
+ ***********************************************************/
+class StaticBatchBuffers
+{
+public:
+    StaticBatchBuffers();
+    ~StaticBatchBuffers();
+
+    // issue the draw call of one batch of a set, once per view
+    // of a multi-view pass
+    void Draw(const STATIC_BATCH_SET& batches, size_t batchIndex, GLsizei instanceCount = 1);
+    // delete the buffers and the vertex array of the current
+    // context; those of other contexts go with their contexts
+    void Destroy();
+
+    // bytes of vertex and index data on the GPU
+    size_t GetBufferBytes() const { return m_mesh.bufferBytes; }
+
+private:
+    StaticBatchBuffers(const StaticBatchBuffers&) = delete;
+    StaticBatchBuffers& operator=(const StaticBatchBuffers&) = delete;
+
+    // write the geometry of a set into the buffers
+    void Upload(const STATIC_BATCH_SET& batches);
+    // vertex array of the current context over the buffers
+    GLuint GetVertexArray();
+
+    PrimitiveMeshes::GPU_MESH m_mesh;
+    GLuint m_vertexArrays[PrimitiveMeshes::MAX_SHARED_CONTEXTS];
+    // version of the set in the buffers, 0 when empty
+    uint64_t m_uploadedVersion;
+};
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.cpp
+// ============
+// intern texture and material tags as dense integer handles, with the
+// tags of string literals hashed at compile time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TagTable.h"
+
+#include <iostream>
+#include <utility>
+
+// the handle of a literal tag must not cost anything at run time
+static_assert(HashTag("") == TAG_HASH_OFFSET, "FNV-1a of the empty tag");
+static_assert(HashTag("a") == 0xe40c292cu, "FNV-1a test vector");
+static_assert(TAG("foobar").hash == 0xbf9cf968u, "FNV-1a test vector");
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used to add a tag to the table. Loading
+ *  code calls it once per texture or material, the draw
+ *  code only ever sees the returned handles.
+ ***********************************************************/
+int TagTable::Add(const std::string& tag)
+{
+    const uint32_t hash = HashTag(tag.c_str());
+    const int handle = static_cast<int>(m_names.size());
+    m_names.push_back(tag);
+
+    auto result = m_handles.insert(std::make_pair(hash, handle));
+    if (!result.second && m_names[result.first->second] != tag)
+    {
+        std::cout << "WARNING: Tag " << tag << " has the same hash as "
+                  << m_names[result.first->second] << " and can only be used by handle" << std::endl;
+    }
+    return handle;
+}
+
+/***********************************************************
+ *  Find()
+ *
+ *  This method is used to get the handle of a tag from its
+ *  hash, without touching any string.
+ ***********************************************************/
+int TagTable::Find(TAG_ID tag) const
+{
+    auto it = m_handles.find(tag.hash);
+    return it != m_handles.end() ? it->second : INVALID_HANDLE;
+}
+
+/***********************************************************
+ *  GetName()
+ *
+ *  This method is used to get the tag of a handle, for log
+ *  and debug output only.
+ ***********************************************************/
+const std::string& TagTable::GetName(int handle) const
+{
+    static const std::string unknownName = "<unknown>";
+    if (handle < 0 || handle >= static_cast<int>(m_names.size()))
+    {
+        return unknownName;
+    }
+    return m_names[handle];
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used to remove all tags from the table.
+ ***********************************************************/
+void TagTable::Clear()
+{
+    m_handles.clear();
+    m_names.clear();
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// tagtable.h
+// ============
+// intern texture and material tags as dense integer handles, with the
+// tags of string literals hashed at compile time
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// 32-bit FNV-1a parameters
+const uint32_t TAG_HASH_OFFSET = 2166136261u;
+const uint32_t TAG_HASH_PRIME = 16777619u;
+
+// FNV-1a hash of a tag; a constant expression for string literals
+constexpr uint32_t HashTag(const char* tag, uint32_t hash = TAG_HASH_OFFSET)
+{
+    return *tag == '\0'
+        ? hash
+        : HashTag(tag + 1, (hash ^ static_cast<uint8_t>(*tag)) * TAG_HASH_PRIME);
+}
+
+// a tag reduced to its hash
+struct TAG_ID
+{
+    uint32_t hash;
+
+    constexpr explicit TAG_ID(uint32_t tagHash = TAG_HASH_OFFSET) : hash(tagHash) {}
+    // the empty tag, which stands for no texture or material
+    constexpr bool IsEmpty() const { return hash == TAG_HASH_OFFSET; }
+};
+
+// tag of a string literal, hashed by the compiler
+#define TAG(literal) TAG_ID(std::integral_constant<uint32_t, HashTag(literal)>::value)
+
+// tag of a string known only at run time
+inline TAG_ID MakeTag(const std::string& tag)
+{
+    return TAG_ID(HashTag(tag.c_str()));
+}
+
+/***********************************************************
+ *  TagTable
+ *
+ *  This class hands out the handles 0, 1, 2, ... to tags in
+ *  the order they are added, alongside the list the tags
+ *  name, so a handle is also the material index or texture
+ *  slot. Tags are looked up by hash once at load time; the
+ *  names are only kept for log and debug output. When a tag
+ *  is added twice, or two tags share a hash, lookups return
+ *  the first handle.
+ ***********************************************************/
+class TagTable
+{
+public:
+    // handle of a tag that is not in the table
+    static const int INVALID_HANDLE = -1;
+
+    // add a tag for the next entry of the named list and return
+    // its handle, which is the position of that entry
+    int Add(const std::string& tag);
+    // handle of a tag, INVALID_HANDLE when it is unknown
+    int Find(TAG_ID tag) const;
+    // name of a handle, for debugging
+    const std::string& GetName(int handle) const;
+    // number of interned tags
+    int GetCount() const { return static_cast<int>(m_names.size()); }
+    // forget all tags; handles start from 0 again
+    void Clear();
+
+private:
+    std::unordered_map<uint32_t, int> m_handles;   // hash -> handle
+    std::vector<std::string> m_names;             // handle -> tag
+};
@@ -0,0 +1,254 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.cpp
+// ============
+// compressed vertex layout for uploaded meshes: quantized positions,
+// octahedral normals, half-float texture coordinates and 16-bit indices
+///////////////////////////////////////////////////////////////////////////////
+
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// declare the global variables
+namespace
+{
+    // largest values of the normalized integer components
+    const float POSITION_RANGE = 65535.0f;
+    const float NORMAL_RANGE = 32767.0f;
+
+    // 1 for positive values and zero, -1 for negative values
+    float SignNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    // map a value in [0, 1] to an unsigned 16-bit normalized integer
+    uint16_t QuantizeUnorm(float value)
+    {
+        value = std::min(std::max(value, 0.0f), 1.0f);
+        return static_cast<uint16_t>(std::floor(value * POSITION_RANGE + 0.5f));
+    }
+
+    // map a value in [-1, 1] to a signed 16-bit normalized integer
+    int16_t QuantizeSnorm(float value)
+    {
+        value = std::min(std::max(value, -1.0f), 1.0f);
+        return static_cast<int16_t>(std::floor(value * NORMAL_RANGE + 0.5f));
+    }
+}
+
+/***********************************************************
+ *  FloatToHalf()
+ *
+ *  This function is used to convert a float to the bits of
+ *  the nearest half float, keeping infinities and NaNs.
+ ***********************************************************/
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7fffffff;
+
+    // infinity and NaN, with a quiet NaN bit set
+    if (magnitude >= 0x7f800000)
+    {
+        return static_cast<uint16_t>(sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x0200 : 0));
+    }
+    // 65520 and up round to infinity
+    if (magnitude >= 0x477ff000)
+    {
+        return static_cast<uint16_t>(sign | 0x7c00);
+    }
+    // below the smallest normal half float, 2^-14
+    if (magnitude < 0x38800000)
+    {
+        // half of the smallest denormal or less rounds to zero
+        if (magnitude <= 0x33000000)
+        {
+            return sign;
+        }
+        const uint32_t mantissa = (magnitude & 0x007fffff) | 0x00800000;
+        const uint32_t shift = 126 - (magnitude >> 23);
+        uint32_t result = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (result & 1) != 0))
+        {
+            ++result;
+        }
+        return static_cast<uint16_t>(sign | result);
+    }
+
+    // rebias the exponent from 127 to 15 and round the mantissa
+    uint32_t result = (magnitude - 0x38000000) >> 13;
+    const uint32_t remainder = magnitude & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1) != 0))
+    {
+        ++result;
+    }
+    return static_cast<uint16_t>(sign | result);
+}
+
+/***********************************************************
+ *  HalfToFloat()
+ *
+ *  This function is used to convert the bits of a half float
+ *  back to a float.
+ ***********************************************************/
+float HalfToFloat(uint16_t value)
+{
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1f;
+    const uint32_t mantissa = value & 0x03ff;
+
+    if (exponent == 0)
+    {
+        const float denormal = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign != 0 ? -denormal : denormal;
+    }
+
+    uint32_t bits;
+    if (exponent == 31)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/***********************************************************
+ *  EncodeOctahedral()
+ *
+ *  This function is used to project a unit vector onto an
+ *  octahedron and unfold the lower half over the corners,
+ *  giving two components in [-1, 1].
+ ***********************************************************/
+glm::vec2 EncodeOctahedral(const glm::vec3& normal)
+{
+    const float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (length <= 0.0f)
+    {
+        return glm::vec2(0.0f, 0.0f);
+    }
+
+    glm::vec2 encoded(normal.x / length, normal.y / length);
+    if (normal.z < 0.0f)
+    {
+        encoded = glm::vec2((1.0f - std::fabs(encoded.y)) * SignNotZero(encoded.x),
+                            (1.0f - std::fabs(encoded.x)) * SignNotZero(encoded.y));
+    }
+    return encoded;
+}
+
+/***********************************************************
+ *  DecodeOctahedral()
+ *
+ *  This function is used to turn two octahedral components
+ *  back into a unit vector, like DecodeOctahedral() in the
+ *  scene vertex shaders.
+ ***********************************************************/
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded)
+{
+    glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+    const float fold = std::max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return glm::normalize(normal);
+}
+
+/***********************************************************
+ *  PackMesh()
+ *
+ *  This function is used to convert a mesh to the packed
+ *  vertex layout. Positions are quantized to the bounds of
+ *  the mesh, so the precision grows with smaller meshes.
+ ***********************************************************/
+void PackMesh(const MESH_DATA& mesh, PACKED_MESH_DATA& packed)
+{
+    glm::vec3 boundsMin(0.0f, 0.0f, 0.0f);
+    glm::vec3 boundsMax(0.0f, 0.0f, 0.0f);
+    if (!mesh.vertices.empty())
+    {
+        boundsMin = mesh.vertices[0].position;
+        boundsMax = mesh.vertices[0].position;
+    }
+    for (const auto& vertex : mesh.vertices)
+    {
+        boundsMin = glm::min(boundsMin, vertex.position);
+        boundsMax = glm::max(boundsMax, vertex.position);
+    }
+    packed.positionOffset = boundsMin;
+    packed.positionScale = boundsMax - boundsMin;
+
+    // flat axes quantize to zero, which decodes to the offset
+    glm::vec3 inverseScale(0.0f, 0.0f, 0.0f);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (packed.positionScale[axis] > 0.0f)
+        {
+            inverseScale[axis] = 1.0f / packed.positionScale[axis];
+        }
+    }
+
+    packed.vertices.resize(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        const MESH_VERTEX& source = mesh.vertices[i];
+        PACKED_VERTEX& target = packed.vertices[i];
+
+        const glm::vec3 position = (source.position - boundsMin) * inverseScale;
+        target.position[0] = QuantizeUnorm(position.x);
+        target.position[1] = QuantizeUnorm(position.y);
+        target.position[2] = QuantizeUnorm(position.z);
+        target.position[3] = 0;
+
+        const glm::vec2 normal = EncodeOctahedral(source.normal);
+        target.normal[0] = QuantizeSnorm(normal.x);
+        target.normal[1] = QuantizeSnorm(normal.y);
+
+        target.uv[0] = FloatToHalf(source.uv.x);
+        target.uv[1] = FloatToHalf(source.uv.y);
+    }
+
+    packed.indices16.clear();
+    packed.indices32.clear();
+    if (mesh.vertices.size() <= MAX_16BIT_INDEX_VERTICES)
+    {
+        packed.indices16.assign(mesh.indices.begin(), mesh.indices.end());
+    }
+    else
+    {
+        packed.indices32 = mesh.indices;
+    }
+}
+
+/***********************************************************
+ *  UnpackVertex()
+ *
+ *  This function is used to decode a packed vertex with the
+ *  same arithmetic as the scene vertex shaders, to measure
+ *  the error of the packed layout.
+ ***********************************************************/
+MESH_VERTEX UnpackVertex(const PACKED_MESH_DATA& packed, const PACKED_VERTEX& vertex)
+{
+    MESH_VERTEX result;
+    result.position = packed.positionOffset + glm::vec3(
+        vertex.position[0] / POSITION_RANGE,
+        vertex.position[1] / POSITION_RANGE,
+        vertex.position[2] / POSITION_RANGE) * packed.positionScale;
+    result.normal = DecodeOctahedral(glm::vec2(
+        std::max(vertex.normal[0] / NORMAL_RANGE, -1.0f),
+        std::max(vertex.normal[1] / NORMAL_RANGE, -1.0f)));
+    result.uv = glm::vec2(HalfToFloat(vertex.uv[0]), HalfToFloat(vertex.uv[1]));
+    return result;
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexformat.h
+// ============
+// compressed vertex layout for uploaded meshes: quantized positions,
+// octahedral normals, half-float texture coordinates and 16-bit indices
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MeshData.h"
+
+#include <cstdint>
+#include <vector>
+
+// vertex layout of the uploaded meshes
+enum VERTEX_FORMAT
+{
+    // MESH_VERTEX as is, 32 bytes per vertex and 32-bit indices
+    VERTEX_FORMAT_FLOAT = 0,
+    // PACKED_VERTEX, 16 bytes per vertex and 16-bit indices when
+    // the mesh has at most 65536 vertices
+    VERTEX_FORMAT_PACKED
+};
+
+// 16 byte vertex read by the scene shaders at the same locations as
+// MESH_VERTEX; the shaders decode it with the values of the mesh
+struct PACKED_VERTEX
+{
+    // position within the mesh bounds, 0 to 65535 per axis; the
+    // fourth value only pads the normal to a 4 byte boundary
+    uint16_t position[4];
+    // octahedral normal, -32767 to 32767 per component
+    int16_t normal[2];
+    // texture coordinate as half floats
+    uint16_t uv[2];
+};
+
+// a mesh converted to PACKED_VERTEX
+struct PACKED_MESH_DATA
+{
+    std::vector<PACKED_VERTEX> vertices;
+    // only one of the index lists is filled
+    std::vector<uint16_t> indices16;
+    std::vector<uint32_t> indices32;
+
+    // decoded position = positionOffset + position / 65535 * positionScale
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+};
+
+// largest vertex count that can still use 16-bit indices
+const size_t MAX_16BIT_INDEX_VERTICES = 65536;
+
+// convert a mesh to the packed layout
+void PackMesh(const MESH_DATA& mesh, PACKED_MESH_DATA& packed);
+
+// decode a packed vertex the way the scene shaders do
+MESH_VERTEX UnpackVertex(const PACKED_MESH_DATA& packed, const PACKED_VERTEX& vertex);
+
+// half float conversion with round to nearest even
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// octahedral mapping of a unit vector to two components in [-1, 1]
+glm::vec2 EncodeOctahedral(const glm::vec3& normal);
+glm::vec3 DecodeOctahedral(const glm::vec2& encoded);
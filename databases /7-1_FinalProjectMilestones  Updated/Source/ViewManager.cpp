@@ -8,37 +8,30 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "ShaderBlocks.h"
+#include "PrimitiveMeshes.h"
+#include "AllocationTracker.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <iostream>
+
+// redirects the OpenGL calls below to the capture layer
+#include "GLCaptureCalls.h"
+
 // declaration of the global variables and defines
 namespace
 {
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
-
-	// camera object used for viewing and interacting with
-	// the 3D scene
-	Camera* g_pCamera = nullptr;
-
-	// these variables are used for mouse movement processing
-	float gLastX = WINDOW_WIDTH / 2.0f;
-	float gLastY = WINDOW_HEIGHT / 2.0f;
-	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f;
-	float gLastFrame = 0.0f;
-
-	// the following variable is false when orthographic projection
-	// is off and true when it is on
-	bool bOrthographicProjection = false;
+	// longest time step applied to the camera; after the loop has
+	// been idle the first frame must not jump the camera
+	const float MAX_DELTA_TIME = 0.1f;
 }
 
 /***********************************************************
@@ -52,12 +45,25 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
-	g_pCamera = new Camera();
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
+	m_lastView = glm::mat4(0.0f);
+	m_lastProjection = glm::mat4(0.0f);
+	m_frameDataBuffer = 0;
+	m_lastX = WINDOW_WIDTH / 2.0f;
+	m_lastY = WINDOW_HEIGHT / 2.0f;
+	m_bFirstMouse = true;
+	m_deltaTime = 0.0f;
+	m_lastFrame = 0.0f;
+	m_bWindowDirty = true;
+	m_bOrthographicProjection = false;
+	m_contextIndex = 0;
+	m_pCamera = new Camera();
 	// default camera view parameters
-	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
-	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
-	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-	g_pCamera->Zoom = 80;
+	m_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
+	m_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
+	m_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	m_pCamera->Zoom = 80;
 }
 
 /***********************************************************
@@ -68,12 +74,20 @@ ViewManager::ViewManager(
 ViewManager::~ViewManager()
 {
 	// free up allocated memory
+	if (0 != m_frameDataBuffer)
+	{
+		glDeleteBuffers(1, &m_frameDataBuffer);
+		m_frameDataBuffer = 0;
+	}
+	// the vertex arrays of a shared context go away with it
+	PrimitiveMeshes::GetShared().ReleaseContext(m_contextIndex);
+	m_contextIndex = 0;
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
-	if (NULL != g_pCamera)
+	if (NULL != m_pCamera)
 	{
-		delete g_pCamera;
-		g_pCamera = NULL;
+		delete m_pCamera;
+		m_pCamera = NULL;
 	}
 }
 
@@ -81,40 +95,106 @@ ViewManager::~ViewManager()
  *  CreateDisplayWindow()
  *
  *  This method is used to create the main display window.
+ *  With a window to share with, the new context uses the
+ *  textures, buffers and shader programs of that window,
+ *  so another view of the scene loads nothing again. The
+ *  new context is current when the method returns.
  ***********************************************************/
-GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
+GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle, GLFWwindow* pShareWindow)
 {
+	AllocationScope scope(ALLOCATION_VIEW_MANAGER);
+
 	GLFWwindow* window = nullptr;
 
+	// vertex arrays are not shared, so the mesh registry keeps
+	// a set for each context of the share group
+	int contextIndex = 0;
+	if (NULL != pShareWindow)
+	{
+		contextIndex = PrimitiveMeshes::GetShared().RegisterContext();
+		if (contextIndex < 0)
+		{
+			std::cout << "Too many windows share one context" << std::endl;
+			return NULL;
+		}
+	}
+
 	// try to create the displayed OpenGL window
 	window = glfwCreateWindow(
 		WINDOW_WIDTH,
 		WINDOW_HEIGHT,
 		windowTitle,
-		NULL, NULL);
+		NULL, pShareWindow);
 	if (window == NULL)
 	{
 		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
+		PrimitiveMeshes::GetShared().ReleaseContext(contextIndex);
+		if (NULL == pShareWindow)
+		{
+			glfwTerminate();
+		}
 		return NULL;
 	}
-	glfwMakeContextCurrent(window);
+
+	m_pWindow = window;
+	m_contextIndex = contextIndex;
+	MakeContextCurrent();
+
+	// the callbacks find the view of their window through this
+	glfwSetWindowUserPointer(window, this);
 
 	// tell GLFW to capture all mouse events
 	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 	// this callback is used to receive mouse moving events
 	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
+	// these callbacks are used to redraw after the window was
+	// resized or needs its contents refreshed
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwSetWindowRefreshCallback(window, &ViewManager::Window_Refresh_Callback);
+
+	// synchronize buffer swaps with the display refresh; the
+	// windows are presented one after the other, so only the
+	// first one waits for it
+	glfwSwapInterval(NULL == pShareWindow ? 1 : 0);
 
 	// enable blending for supporting transparent rendering
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	m_pWindow = window;
-
 	return(window);
 }
 
+/***********************************************************
+ *  MakeContextCurrent()
+ *
+ *  This method is used to make the context of the display
+ *  window current on the calling thread, and to let the
+ *  mesh registry draw through the vertex arrays of it.
+ ***********************************************************/
+void ViewManager::MakeContextCurrent()
+{
+	if (NULL == m_pWindow)
+	{
+		return;
+	}
+	glfwMakeContextCurrent(m_pWindow);
+	PrimitiveMeshes::GetShared().SetCurrentContext(m_contextIndex);
+}
+
+/***********************************************************
+ *  SetCameraView()
+ *
+ *  This method is used to move the camera to a position,
+ *  looking along the passed in direction.
+ ***********************************************************/
+void ViewManager::SetCameraView(glm::vec3 position, glm::vec3 front)
+{
+	m_pCamera->Position = position;
+	m_pCamera->Front = front;
+	m_bWindowDirty = true;
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
@@ -123,19 +203,55 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
-	if (gFirstMouse)
+	ViewManager* pView = static_cast<ViewManager*>(glfwGetWindowUserPointer(window));
+	if (NULL == pView || NULL == pView->m_pCamera)
+	{
+		return;
+	}
+
+	if (pView->m_bFirstMouse)
 	{
-		gLastX = xMousePos;
-		gLastY = yMousePos;
-		gFirstMouse = false;
+		pView->m_lastX = xMousePos;
+		pView->m_lastY = yMousePos;
+		pView->m_bFirstMouse = false;
 	}
-	float xOffset = xMousePos - gLastX;
-	float yOffset = gLastY - yMousePos;
-	gLastX = xMousePos;
-	gLastY = yMousePos;
+	float xOffset = xMousePos - pView->m_lastX;
+	float yOffset = pView->m_lastY - yMousePos;
+	pView->m_lastX = xMousePos;
+	pView->m_lastY = yMousePos;
 
 	// Move the camera based on mouse movement
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	pView->m_pCamera->ProcessMouseMovement(xOffset, yOffset);
+}
+
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the framebuffer of the display window is resized.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int /*width*/, int /*height*/)
+{
+	ViewManager* pView = static_cast<ViewManager*>(glfwGetWindowUserPointer(window));
+	if (NULL != pView)
+	{
+		pView->m_bWindowDirty = true;
+	}
+}
+
+/***********************************************************
+ *  Window_Refresh_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the contents of the display window need to be redrawn.
+ ***********************************************************/
+void ViewManager::Window_Refresh_Callback(GLFWwindow* window)
+{
+	ViewManager* pView = static_cast<ViewManager*>(glfwGetWindowUserPointer(window));
+	if (NULL != pView)
+	{
+		pView->m_bWindowDirty = true;
+	}
 }
 
 /***********************************************************
@@ -147,84 +263,208 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 void ViewManager::ProcessKeyboardEvents()
 {
 	// close the window if the escape key has been pressed
-	if (NULL == g_pCamera)
+	if (NULL == m_pCamera || NULL == m_pWindow)
 	{
 		return;
 	}
 
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime); // Zoom in
+		m_pCamera->ProcessKeyboard(FORWARD, m_deltaTime); // Zoom in
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime); // Zoom out
+		m_pCamera->ProcessKeyboard(BACKWARD, m_deltaTime); // Zoom out
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime); // Pan left
+		m_pCamera->ProcessKeyboard(LEFT, m_deltaTime); // Pan left
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime); // Pan right
+		m_pCamera->ProcessKeyboard(RIGHT, m_deltaTime); // Pan right
 	}
 
 	// Toggle between perspective and orthographic projections
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
 	{
-		bOrthographicProjection = false;  // Set to perspective
+		m_bOrthographicProjection = false;  // Set to perspective
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
 	{
-		bOrthographicProjection = true;  // Set to orthographic
+		m_bOrthographicProjection = true;  // Set to orthographic
 	}
 }
 
 /***********************************************************
- *  PrepareSceneView()
+ *  UpdateSceneView()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene
- *  rendering
+ *  This method is used for updating the camera from the
+ *  current input state and calculating the view and
+ *  projection matrices. It returns true when the displayed
+ *  frame no longer matches the camera or the window.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+bool ViewManager::UpdateSceneView()
 {
-	glm::mat4 view;
-	glm::mat4 projection;
+	AllocationScope scope(ALLOCATION_VIEW_MANAGER);
 
 	// per-frame timing
 	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	m_deltaTime = currentFrame - m_lastFrame;
+	m_lastFrame = currentFrame;
+	if (m_deltaTime > MAX_DELTA_TIME)
+	{
+		m_deltaTime = MAX_DELTA_TIME;
+	}
 
 	// process any keyboard events that may be waiting in the event queue
 	ProcessKeyboardEvents();
 
 	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	m_view = m_pCamera->GetViewMatrix();
 
 	// Check whether to use perspective or orthographic projection
-	if (bOrthographicProjection)
+	if (m_bOrthographicProjection)
 	{
 		// Orthographic projection for 2D-like effect
-		projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
+		m_projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 100.0f);
 	}
 	else
 	{
 		// Perspective projection for 3D effect
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom),
+		m_projection = glm::perspective(glm::radians(m_pCamera->Zoom),
 			(GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT,
 			0.1f, 100.0f);
 	}
 
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	return m_bWindowDirty ||
+		m_view != m_lastView ||
+		m_projection != m_lastProjection;
+}
+
+/***********************************************************
+ *  ApplySceneView()
+ *
+ *  This method is used for sending the view and projection
+ *  calculated by the last camera update into the shader.
+ ***********************************************************/
+void ViewManager::ApplySceneView()
+{
+	FRAME_PACKET packet;
+	packet.frameIndex = 0;
+	CaptureSceneView(packet);
+	ApplyFrameView(packet);
+}
+
+/***********************************************************
+ *  CaptureSceneView()
+ *
+ *  This method is used for copying the view and projection
+ *  calculated by the last camera update into a frame packet.
+ *  The frame is then considered up to date, exactly as if
+ *  ApplySceneView() had been called.
+ ***********************************************************/
+void ViewManager::CaptureSceneView(FRAME_PACKET& packet)
+{
+	AllocationScope scope(ALLOCATION_VIEW_MANAGER);
+
+	packet.view = m_view;
+	packet.projection = m_projection;
+	packet.viewPosition = m_pCamera->Position;
+	packet.time = m_lastFrame;
+	packet.deltaTime = m_deltaTime;
+
+	int width = WINDOW_WIDTH;
+	int height = WINDOW_HEIGHT;
+	if (NULL != m_pWindow)
+	{
+		glfwGetFramebufferSize(m_pWindow, &width, &height);
+	}
+	packet.viewportSize = glm::vec2((float)width, (float)height);
+
+	m_lastView = m_view;
+	m_lastProjection = m_projection;
+	m_bWindowDirty = false;
+}
+
+/***********************************************************
+ *  ApplyFrameView()
+ *
+ *  This method is used for writing the camera and timing
+ *  values stored in a frame packet into the FrameData
+ *  uniform buffer, once per frame for all shader programs.
+ *  The viewport size is that of the part of the target the
+ *  frame is drawn into. It must be called from the thread
+ *  that owns the OpenGL context.
+ ***********************************************************/
+void ViewManager::ApplyFrameView(const FRAME_PACKET& packet, float resolutionScale)
+{
+	AllocationScope scope(ALLOCATION_VIEW_MANAGER);
+
+	const glm::vec2 viewportSize = packet.viewportSize * resolutionScale;
+
+	FRAME_DATA_BLOCK frameData;
+	frameData.view = packet.view;
+	frameData.projection = packet.projection;
+	frameData.viewProjection = packet.projection * packet.view;
+	frameData.inverseView = glm::inverse(packet.view);
+	frameData.inverseProjection = glm::inverse(packet.projection);
+	frameData.inverseViewProjection = glm::inverse(frameData.viewProjection);
+	frameData.viewPosition = glm::vec4(packet.viewPosition, 1.0f);
+	frameData.time = glm::vec4(packet.time, packet.deltaTime, (float)packet.frameIndex, 0.0f);
+	frameData.viewportSize = glm::vec4(
+		viewportSize.x,
+		viewportSize.y,
+		viewportSize.x > 0.0f ? 1.0f / viewportSize.x : 0.0f,
+		viewportSize.y > 0.0f ? 1.0f / viewportSize.y : 0.0f);
+
+	if (0 == m_frameDataBuffer)
+	{
+		glGenBuffers(1, &m_frameDataBuffer);
+	}
+
+	// respecify the whole store every frame so the driver can hand
+	// out fresh memory instead of waiting for the previous frame
+	glBindBuffer(GL_UNIFORM_BUFFER, m_frameDataBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(frameData), &frameData, GL_STREAM_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, m_frameDataBuffer);
+}
+
+/***********************************************************
+ *  BindFrameDataBlock()
+ *
+ *  This method is used for connecting the FrameData block of
+ *  the shader program in use to the shared binding point, so
+ *  every program reads the same buffer without any per-frame
+ *  uniform uploads.
+ ***********************************************************/
+void ViewManager::BindFrameDataBlock()
+{
+	GLint program = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	if (0 == program)
+	{
+		return;
+	}
+
+	GLuint blockIndex = glGetUniformBlockIndex((GLuint)program, FRAME_DATA_BLOCK_NAME);
+	if (GL_INVALID_INDEX == blockIndex)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		std::cout << "Shader program has no " << FRAME_DATA_BLOCK_NAME << " block" << std::endl;
+		return;
 	}
-}
\ No newline at end of file
+	glUniformBlockBinding((GLuint)program, blockIndex, FRAME_DATA_BINDING);
+}
+
+/***********************************************************
+ *  PrepareSceneView()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene
+ *  rendering
+ ***********************************************************/
+void ViewManager::PrepareSceneView()
+{
+	UpdateSceneView();
+	ApplySceneView();
+}
@@ -1,167 +1,112 @@
-#include <iostream>         // error handling and output
-#include <cstdlib>          // EXIT_FAILURE
+///////////////////////////////////////////////////////////////////////////////
+// viewmanager.h
+// ============
+// manage the viewing of 3D objects within the viewport
+//
+//  AUTHOR: Brian Battersby - SNHU Instructor / Computer Science
+//	Created for CS-330-Computational Graphics and Visualization, Nov. 1st, 2023
+///////////////////////////////////////////////////////////////////////////////
 
-#include <GL/glew.h>        // GLEW library
-#include "GLFW/glfw3.h"     // GLFW library
+#pragma once
 
-// GLM Math Header inclusions
-#include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include "SceneManager.h"
-#include "ViewManager.h"
-#include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "camera.h"
+#include "FramePacket.h"
 
-// Namespace for declaring global variables
-namespace
-{
-    // Macro for window title
-    const char* const WINDOW_TITLE = "7-1 Final Project and Milestones";
-
-    // Main GLFW window
-    GLFWwindow* g_Window = nullptr;
-
-    // scene manager object for managing the 3D scene prepare and render
-    SceneManager* g_SceneManager = nullptr;
-    // shader manager object for dynamic interaction with the shader code
-    ShaderManager* g_ShaderManager = nullptr;
-    // view manager object for managing the 3D view setup and projection to 2D
-    ViewManager* g_ViewManager = nullptr;
-}
-
-// Function declarations
-bool InitializeGLFW();
-bool InitializeGLEW();
-
-/***********************************************************
- *  main(int, char*)
- *
- *  This function gets called after the application has been
- *  launched.
- ***********************************************************/
-int main(int argc, char* argv[])
-{
-    // Initialize GLFW
-    if (!InitializeGLFW())
-    {
-        return EXIT_FAILURE;
-    }
-
-    // Create shader and view managers
-    g_ShaderManager = new ShaderManager();
-    g_ViewManager   = new ViewManager(g_ShaderManager);
-
-    // Create the main display window
-    g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
-    if (!g_Window)
-    {
-        std::cerr << "ERROR: Failed to create GLFW window." << std::endl;
-        return EXIT_FAILURE;
-    }
-
-    // Initialize GLEW
-    if (!InitializeGLEW())
-    {
-        return EXIT_FAILURE;
-    }
-
-    // load the shader code from the external GLSL files
-    g_ShaderManager->LoadShaders(
-        "../../Utilities/shaders/vertexShader.glsl",
-        "../../Utilities/shaders/fragmentShader.glsl");
-    g_ShaderManager->use();
-
-    // create a new scene manager object and prepare the 3D scene
-    g_SceneManager = new SceneManager(g_ShaderManager);
-    g_SceneManager->PrepareScene();
-
-    // Main render loop
-    while (!glfwWindowShouldClose(g_Window))
-    {
-        // Enable z-depth
-        glEnable(GL_DEPTH_TEST);
-
-        // Clear the frame and z buffers
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // convert from 3D object space to 2D view
-        g_ViewManager->PrepareSceneView();
-
-        // refresh the 3D scene
-        g_SceneManager->RenderScene();
-
-        // Swap buffers
-        glfwSwapBuffers(g_Window);
-
-        // Query the latest GLFW events
-        glfwPollEvents();
-    }
-
-    // Clean up allocated manager objects
-    delete g_SceneManager;
-    delete g_ViewManager;
-    delete g_ShaderManager;
-
-    g_SceneManager = nullptr;
-    g_ViewManager  = nullptr;
-    g_ShaderManager = nullptr;
-
-    // Terminate GLFW context
-    glfwTerminate();
-
-    // Terminates the program successfully
-    return EXIT_SUCCESS;
-}
-
-/***********************************************************
- *  InitializeGLFW()
- *
- *  This function is used to initialize the GLFW library.
- ***********************************************************/
-bool InitializeGLFW()
-{
-    if (!glfwInit())
-    {
-        std::cerr << "ERROR: Failed to initialize GLFW." << std::endl;
-        return false;
-    }
-
-#ifdef __APPLE__
-    // set the version of OpenGL and profile to use
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-    // set the version of OpenGL and profile to use
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#endif
-
-    return true;
-}
-
-/***********************************************************
- *  InitializeGLEW()
- *
- *  This function is used to initialize the GLEW library.
- ***********************************************************/
-bool InitializeGLEW()
+// GLFW library
+#include "GLFW/glfw3.h"
+
+#include <glm/glm.hpp>
+
+class ViewManager
 {
-    GLenum GLEWInitResult = glewInit();
-    if (GLEW_OK != GLEWInitResult)
-    {
-        std::cerr << "ERROR: Failed to initialize GLEW: "
-                  << glewGetErrorString(GLEWInitResult) << std::endl;
-        return false;
-    }
-
-    // Displays a successful OpenGL initialization message
-    std::cout << "INFO: OpenGL Successfully Initialized\n";
-    std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
-
-    return true;
-}
+public:
+	// constructor
+	ViewManager(
+		ShaderManager* pShaderManager);
+	// destructor
+	~ViewManager();
+
+	// mouse position callback for mouse interaction with the 3D scene
+	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
+	// window callbacks that invalidate the displayed frame
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+	static void Window_Refresh_Callback(GLFWwindow* window);
+
+private:
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// active OpenGL display window
+	GLFWwindow* m_pWindow;
+
+	// view and projection calculated by the last camera update
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	// view and projection that were last sent to the shader
+	glm::mat4 m_lastView;
+	glm::mat4 m_lastProjection;
+	// uniform buffer holding the FrameData block of every program
+	GLuint m_frameDataBuffer;
+
+	// camera object used for viewing and interacting with
+	// the 3D scene
+	Camera* m_pCamera;
+
+	// these variables are used for mouse movement processing
+	float m_lastX;
+	float m_lastY;
+	bool m_bFirstMouse;
+
+	// time between current frame and last frame
+	float m_deltaTime;
+	float m_lastFrame;
+
+	// set by the window callbacks when the displayed frame has
+	// been invalidated, e.g. resized or uncovered
+	bool m_bWindowDirty;
+
+	// false when orthographic projection is off and true when
+	// it is on
+	bool m_bOrthographicProjection;
+
+	// slot of the window context in the shared mesh registry
+	int m_contextIndex;
+
+	// process keyboard events for interaction with the 3D scene
+	void ProcessKeyboardEvents();
+
+public:
+	// create the initial OpenGL display window, or one more whose
+	// context shares the textures, buffers and shaders of the
+	// context of pShareWindow
+	GLFWwindow* CreateDisplayWindow(const char* windowTitle, GLFWwindow* pShareWindow = NULL);
+	// make the context of the display window current on the
+	// calling thread, before drawing into the window
+	void MakeContextCurrent();
+	GLFWwindow* GetWindow() const { return m_pWindow; }
+
+	// move the camera, e.g. to set up the views of an editor
+	// layout; the mouse turns it from there
+	void SetCameraView(glm::vec3 position, glm::vec3 front);
+
+	// update the camera from the input state and report whether
+	// the displayed frame is now out of date
+	bool UpdateSceneView();
+	// send the current view and projection to the shader
+	void ApplySceneView();
+
+	// copy the current view and projection into a frame packet
+	// that is drawn later, possibly on the render thread
+	void CaptureSceneView(FRAME_PACKET& packet);
+	// write the camera and timing values of a frame packet into
+	// the FrameData uniform block; the viewport size is multiplied
+	// by the dynamic resolution scale of the frame
+	void ApplyFrameView(const FRAME_PACKET& packet, float resolutionScale = 1.0f);
+
+	// connect the FrameData block of the shader program in use
+	// to the shared binding point; call after loading shaders
+	void BindFrameDataBlock();
+
+	// prepare the conversion from 3D object display to 2D scene display
+	void PrepareSceneView();
+};
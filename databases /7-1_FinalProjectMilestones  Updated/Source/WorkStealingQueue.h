@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// workstealingqueue.h
+// ============
+// fixed-capacity Chase-Lev work-stealing deque
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  WorkStealingQueue
+ *
+ *  A Chase-Lev deque of pointers. The owning worker pushes
+ *  and pops at the bottom without contention, while other
+ *  workers steal from the top. Only the last remaining item
+ *  needs a compare-and-swap between the owner and thieves.
+ *  The memory orderings follow Le et al., "Correct and
+ *  Efficient Work-Stealing for Weak Memory Models" (2013).
+ *  The capacity must be a power of two.
+ ***********************************************************/
+template <typename T, size_t Capacity>
+class WorkStealingQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "WorkStealingQueue capacity must be a power of two");
+
+public:
+    WorkStealingQueue()
+        : m_top(0),
+          m_bottom(0)
+    {
+        for (auto& item : m_items)
+        {
+            item.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    // owner only: add an item at the bottom; false when full
+    bool Push(T* pItem)
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_acquire);
+        if (bottom - top >= static_cast<int64_t>(Capacity))
+        {
+            return false;
+        }
+
+        m_items[bottom & (Capacity - 1)].store(pItem, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // owner only: remove the most recently pushed item
+    T* Pop()
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom)
+        {
+            // the deque was already empty
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* pItem = m_items[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (top == bottom)
+        {
+            // last item: race the thieves for it
+            if (!m_top.compare_exchange_strong(top, top + 1,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed))
+            {
+                pItem = nullptr;
+            }
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+        return pItem;
+    }
+
+    // any thread: remove the oldest item
+    T* Steal()
+    {
+        int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom)
+        {
+            return nullptr;
+        }
+
+        T* pItem = m_items[top & (Capacity - 1)].load(std::memory_order_relaxed);
+        if (!m_top.compare_exchange_strong(top, top + 1,
+                                           std::memory_order_seq_cst,
+                                           std::memory_order_relaxed))
+        {
+            // lost the race against the owner or another thief
+            return nullptr;
+        }
+        return pItem;
+    }
+
+    // approximate number of queued items
+    size_t Size() const
+    {
+        const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const int64_t top = m_top.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+private:
+    // 64-bit indices so they never wrap during a session
+    std::atomic<int64_t> m_top;
+    char m_topPadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> m_bottom;
+    char m_bottomPadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<T*> m_items[Capacity];
+};
@@ -0,0 +1,822 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.cpp
+// ============
+// stream the cells of a large world in and out around the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WorldStreamer.h"
+#include "ShaderBlocks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declare the global variables
+namespace
+{
+    // cells are evicted a bit further out than they are loaded,
+    // so a camera moving along a cell border does not make the
+    // same cells load and unload every frame
+    const float EVICT_RADIUS_SCALE = 1.25f;
+
+    // default streaming settings
+    const float DEFAULT_LOAD_RADIUS = 64.0f;
+    const uint64_t DEFAULT_MEMORY_BUDGET = 256ull * 1024 * 1024;
+    const double DEFAULT_UPLOAD_BUDGET_MS = 2.0;
+
+    // rank of a cell: the distance to the camera, stretched up
+    // to twice as far for cells behind the camera
+    float CalculateCellPriority(float distance, float facing)
+    {
+        return distance * (1.5f - 0.5f * facing);
+    }
+}
+
+/***********************************************************
+ *  WorldStreamer()
+ *
+ *  The constructor for the class. No threads are started
+ *  until a world is opened.
+ ***********************************************************/
+WorldStreamer::WorldStreamer(unsigned loaderThreadCount)
+    : m_pSceneManager(nullptr),
+      m_stats(),
+      m_cellSize(0.0f),
+      m_materialCount(0),
+      m_bResidentChanged(false),
+      m_texturesUploaded(0),
+      m_loaderThreadCount(std::max(1u, loaderThreadCount)),
+      m_bStopLoaders(false)
+{
+    m_settings.loadRadius = DEFAULT_LOAD_RADIUS;
+    m_settings.memoryBudget = DEFAULT_MEMORY_BUDGET;
+    m_settings.uploadBudgetMs = DEFAULT_UPLOAD_BUDGET_MS;
+}
+
+/***********************************************************
+ *  ~WorldStreamer()
+ *
+ *  The destructor for the class. Must run before the scene
+ *  manager the world was opened for is destroyed.
+ ***********************************************************/
+WorldStreamer::~WorldStreamer()
+{
+    Close();
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used to read the index of a world, to load
+ *  its tables into the scene manager with the texture slots
+ *  reserved for streaming, and to start the loader threads.
+ ***********************************************************/
+bool WorldStreamer::Open(const char* worldDirectory, SceneManager* pSceneManager)
+{
+    Close();
+
+    const std::string directory(worldDirectory);
+    std::string tablesFilename;
+    if (pSceneManager == nullptr || !ReadWorldIndex(directory, tablesFilename))
+    {
+        Close();
+        return false;
+    }
+
+    // the texture file names are only kept in the table file
+    const std::string tablesPath = directory + "/" + tablesFilename;
+    SceneFile tables;
+    if (!tables.Open(tablesPath.c_str()))
+    {
+        Close();
+        return false;
+    }
+    const uint32_t textureCount = tables.GetTextureCount();
+    if (textureCount > MAX_SHADER_TEXTURES)
+    {
+        std::cout << "ERROR::WORLD: " << tablesPath << " has " << textureCount
+                  << " textures, at most " << MAX_SHADER_TEXTURES << " can be streamed" << std::endl;
+        Close();
+        return false;
+    }
+    const SCENE_FILE_TEXTURE* pTextureTable = tables.GetSection<SCENE_FILE_TEXTURE>(SCENE_SECTION_TEXTURES);
+    for (uint32_t i = 0; i < textureCount; ++i)
+    {
+        STREAM_TEXTURE* pTexture = new STREAM_TEXTURE();
+        pTexture->filename = tables.GetString(pTextureTable[i].filename);
+        pTexture->state = TEXTURE_UNLOADED;
+        pTexture->refCount = 0;
+        pTexture->image = SceneManager::DECODED_IMAGE();
+        pTexture->bytes = 0;
+        pTexture->releaseFrame = 0;
+        m_textures.push_back(pTexture);
+    }
+    m_materialCount = static_cast<int>(tables.GetMaterialCount());
+    tables.Close();
+
+    for (const auto* pCell : m_cells)
+    {
+        if ((static_cast<uint64_t>(pCell->textureMask) >> textureCount) != 0)
+        {
+            std::cout << "ERROR::WORLD: cell " << pCell->filename
+                      << " uses textures that are not in " << tablesPath << std::endl;
+            Close();
+            return false;
+        }
+    }
+
+    if (!pSceneManager->LoadSceneFile(tablesPath.c_str(), true))
+    {
+        Close();
+        return false;
+    }
+    pSceneManager->SetupSceneLights();
+    pSceneManager->SetWorldStreamer(this);
+    m_pSceneManager = pSceneManager;
+
+    StartLoaders();
+
+    std::cout << "INFO: Opened world " << directory << " (" << m_cells.size()
+              << " cells of " << m_cellSize << " units)" << std::endl;
+    return true;
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used to stop the loader threads and to
+ *  unload every cell and texture image.
+ ***********************************************************/
+void WorldStreamer::Close()
+{
+    StopLoaders();
+
+    if (m_pSceneManager != nullptr)
+    {
+        m_pSceneManager->SetWorldStreamer(nullptr);
+        m_pSceneManager = nullptr;
+    }
+
+    for (auto* pCell : m_cells)
+    {
+        pCell->file.Close();
+        delete pCell;
+    }
+    m_cells.clear();
+    m_rankedCells.clear();
+    m_residentObjects.clear();
+
+    for (auto* pTexture : m_textures)
+    {
+        SceneManager::FreeDecodedImage(pTexture->image);
+        delete pTexture;
+    }
+    m_textures.clear();
+
+    m_cellRequests.clear();
+    m_textureRequests.clear();
+    m_stats = STATS();
+    m_texturesUploaded = 0;
+    m_bResidentChanged = false;
+}
+
+/***********************************************************
+ *  ReadWorldIndex()
+ *
+ *  This method is used to parse the world index, a text file
+ *  with one "world" line followed by one line per cell:
+ *
+ *    world <version> <cell size> <table file>
+ *    cell <x> <z> <file> <bytes> <min y> <max y> <texture mask>
+ ***********************************************************/
+bool WorldStreamer::ReadWorldIndex(const std::string& worldDirectory, std::string& tablesFilename)
+{
+    const std::string indexPath = worldDirectory + "/" + WORLD_INDEX_FILENAME;
+    std::ifstream input(indexPath);
+    if (!input)
+    {
+        std::cout << "ERROR::WORLD: cannot open " << indexPath << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    bool bHaveHeader = false;
+    while (std::getline(input, line))
+    {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string keyword;
+        if (!(fields >> keyword) || keyword[0] == '#')
+        {
+            continue;
+        }
+
+        bool bValid = false;
+        if (keyword == "world" && !bHaveHeader)
+        {
+            int version = 0;
+            bValid = (fields >> version >> m_cellSize >> tablesFilename) &&
+                     version == WORLD_INDEX_VERSION && m_cellSize > 0.0f;
+            bHaveHeader = bValid;
+        }
+        else if (keyword == "cell" && bHaveHeader)
+        {
+            STREAM_CELL* pCell = new STREAM_CELL();
+            std::string filename;
+            float minY = 0.0f;
+            float maxY = 0.0f;
+            bValid = static_cast<bool>(fields >> pCell->x >> pCell->z >> filename >> pCell->bytes
+                                              >> minY >> maxY >> pCell->textureMask);
+            pCell->filename = worldDirectory + "/" + filename;
+            pCell->center = glm::vec3(
+                (pCell->x + 0.5f) * m_cellSize, 0.5f * (minY + maxY), (pCell->z + 0.5f) * m_cellSize);
+            pCell->state = CELL_UNLOADED;
+            pCell->bTextureReferences = false;
+            pCell->distance = 0.0f;
+            pCell->priority = 0.0f;
+            m_cells.push_back(pCell);
+        }
+
+        if (!bValid)
+        {
+            std::cout << "ERROR::WORLD: " << indexPath << "(" << lineNumber << "): invalid line" << std::endl;
+            return false;
+        }
+    }
+
+    if (!bHaveHeader)
+    {
+        std::cout << "ERROR::WORLD: " << indexPath << " has no world line" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/***********************************************************
+ *  StartLoaders()
+ *  StopLoaders()
+ *
+ *  These methods are used to start and join the loader
+ *  threads. Work that was not taken yet is dropped.
+ ***********************************************************/
+void WorldStreamer::StartLoaders()
+{
+    m_bStopLoaders = false;
+    for (unsigned i = 0; i < m_loaderThreadCount; ++i)
+    {
+        m_loaders.push_back(std::thread(&WorldStreamer::LoaderMain, this));
+    }
+}
+
+void WorldStreamer::StopLoaders()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_bStopLoaders = true;
+    }
+    m_requestSignal.notify_all();
+    for (auto& loader : m_loaders)
+    {
+        loader.join();
+    }
+    m_loaders.clear();
+}
+
+/***********************************************************
+ *  LoaderMain()
+ *
+ *  This method is the entry point of the loader threads.
+ *  Texture decodes go first since they hold back cells that
+ *  are already loaded; cells are taken in priority order.
+ ***********************************************************/
+void WorldStreamer::LoaderMain()
+{
+    for (;;)
+    {
+        STREAM_CELL* pCell = nullptr;
+        int textureIndex = -1;
+        {
+            std::unique_lock<std::mutex> lock(m_requestMutex);
+            m_requestSignal.wait(lock, [this]
+            {
+                return m_bStopLoaders || !m_textureRequests.empty() || !m_cellRequests.empty();
+            });
+            if (m_bStopLoaders)
+            {
+                return;
+            }
+
+            if (!m_textureRequests.empty())
+            {
+                textureIndex = m_textureRequests.back();
+                m_textureRequests.pop_back();
+                m_textures[textureIndex]->state.store(TEXTURE_DECODING, std::memory_order_relaxed);
+            }
+            else
+            {
+                pCell = m_cellRequests.back();
+                m_cellRequests.pop_back();
+                pCell->state.store(CELL_LOADING, std::memory_order_relaxed);
+            }
+        }
+
+        if (pCell != nullptr)
+        {
+            LoadCell(pCell);
+        }
+        else
+        {
+            DecodeTexture(textureIndex);
+        }
+    }
+}
+
+/***********************************************************
+ *  LoadCell()
+ *
+ *  This method is used on a loader thread to map a cell file,
+ *  check its objects against the world tables and read it
+ *  into memory, so the frame preparation never waits on disk.
+ ***********************************************************/
+void WorldStreamer::LoadCell(STREAM_CELL* pCell)
+{
+    SceneFile& file = pCell->file;
+    bool bLoaded = file.Open(pCell->filename.c_str());
+
+    if (bLoaded)
+    {
+        const size_t objectCount = file.GetObjectCount();
+        const uint8_t* pMeshes = file.GetSection<uint8_t>(SCENE_SECTION_MESH);
+        const int16_t* pMaterials = file.GetSection<int16_t>(SCENE_SECTION_MATERIAL_INDEX);
+        const int16_t* pTextures = file.GetSection<int16_t>(SCENE_SECTION_TEXTURE_INDEX);
+        for (size_t i = 0; i < objectCount && bLoaded; ++i)
+        {
+            bLoaded = pMeshes[i] < MESH_COUNT &&
+                      pMaterials[i] >= -1 && pMaterials[i] < m_materialCount &&
+                      (pTextures[i] == -1 ||
+                       (pTextures[i] >= 0 && pTextures[i] < 32 && ((pCell->textureMask >> pTextures[i]) & 1) != 0));
+        }
+        if (!bLoaded)
+        {
+            std::cout << "ERROR::WORLD: invalid objects in cell " << pCell->filename << std::endl;
+            file.Close();
+        }
+    }
+
+    if (bLoaded)
+    {
+        file.Prefetch();
+    }
+    pCell->state.store(bLoaded ? CELL_LOADED : CELL_FAILED, std::memory_order_release);
+}
+
+/***********************************************************
+ *  DecodeTexture()
+ *
+ *  This method is used on a loader thread to decode the image
+ *  of a world texture, which is uploaded by ProcessGpuWork().
+ ***********************************************************/
+void WorldStreamer::DecodeTexture(int textureIndex)
+{
+    STREAM_TEXTURE* pTexture = m_textures[textureIndex];
+    SceneManager::DecodeTextureImage(pTexture->filename.c_str(), pTexture->image);
+
+    const SceneManager::DECODED_IMAGE& image = pTexture->image;
+    if (image.pixels == nullptr)
+    {
+        std::cout << "Could not load image: " << pTexture->filename << std::endl;
+        pTexture->state.store(TEXTURE_FAILED, std::memory_order_release);
+        return;
+    }
+
+    // the pixels, and later the texture with its mipmaps
+    pTexture->bytes = static_cast<uint64_t>(image.width) * image.height * image.colorChannels * 4 / 3;
+    pTexture->state.store(TEXTURE_DECODED, std::memory_order_release);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used on the main thread before a frame is
+ *  built. The cells are ranked for the camera, cells that
+ *  fell behind the eviction radius are unloaded, and cells
+ *  within the load radius are queued in rank order for as
+ *  long as the memory budget allows, evicting less important
+ *  cells to make room. Loaded cells whose textures are on
+ *  the GPU are handed to the scene manager.
+ ***********************************************************/
+void WorldStreamer::Update(const glm::vec3& viewPosition, const glm::vec3& viewDirection, unsigned long frameIndex)
+{
+    if (m_pSceneManager == nullptr)
+    {
+        return;
+    }
+
+    const float directionLength = glm::length(viewDirection);
+    const glm::vec3 forward = (directionLength > 0.0f) ? viewDirection / directionLength : glm::vec3(0.0f);
+    const float loadRadius = m_settings.loadRadius;
+    const float evictRadius = loadRadius * EVICT_RADIUS_SCALE;
+
+    // rank the cells that are wanted or hold memory
+    m_rankedCells.clear();
+    for (auto* pCell : m_cells)
+    {
+        const glm::vec3 offset = pCell->center - viewPosition;
+        pCell->distance = glm::length(offset);
+        const float facing = (pCell->distance > 0.0f) ? glm::dot(offset, forward) / pCell->distance : 1.0f;
+        pCell->priority = CalculateCellPriority(pCell->distance, facing);
+
+        const int state = pCell->state.load(std::memory_order_acquire);
+        if (state == CELL_FAILED && pCell->bTextureReferences)
+        {
+            ReleaseTextureReferences(pCell->textureMask);
+            pCell->bTextureReferences = false;
+        }
+        if ((state == CELL_UNLOADED && pCell->distance <= loadRadius) ||
+            (state != CELL_UNLOADED && state != CELL_FAILED))
+        {
+            m_rankedCells.push_back(pCell);
+        }
+    }
+    std::sort(m_rankedCells.begin(), m_rankedCells.end(),
+        [](const STREAM_CELL* a, const STREAM_CELL* b) { return a->priority < b->priority; });
+
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+
+        // drop everything outside the eviction radius
+        for (auto* pCell : m_rankedCells)
+        {
+            if (pCell->distance > evictRadius && IsEvictable(pCell))
+            {
+                EvictCell(pCell);
+            }
+        }
+
+        // queue the wanted cells, most important first; the least
+        // important cells make room when the budget is exceeded and
+        // are not queued again this frame
+        uint64_t memoryUsed = CalculateMemoryUsed();
+        size_t victim = m_rankedCells.size();
+        for (size_t i = 0; i < victim; ++i)
+        {
+            STREAM_CELL* pCell = m_rankedCells[i];
+            if (pCell->distance > loadRadius || pCell->state.load(std::memory_order_acquire) != CELL_UNLOADED)
+            {
+                continue;
+            }
+
+            while (memoryUsed + pCell->bytes > m_settings.memoryBudget && victim > i + 1)
+            {
+                STREAM_CELL* pVictim = m_rankedCells[--victim];
+                if (IsEvictable(pVictim))
+                {
+                    memoryUsed -= std::min(memoryUsed, pVictim->bytes);
+                    EvictCell(pVictim);
+                }
+            }
+            if (memoryUsed + pCell->bytes > m_settings.memoryBudget)
+            {
+                break;
+            }
+
+            QueueCell(pCell);
+            memoryUsed += pCell->bytes;
+        }
+
+        // the loaders take requests from the back
+        std::sort(m_cellRequests.begin(), m_cellRequests.end(),
+            [](const STREAM_CELL* a, const STREAM_CELL* b) { return a->priority > b->priority; });
+
+        UpdateTextures(frameIndex);
+    }
+    m_requestSignal.notify_all();
+
+    PublishResidentCells();
+
+    // counters
+    m_stats.residentCells = 0;
+    m_stats.loadingCells = 0;
+    m_stats.queuedCells = 0;
+    for (const auto* pCell : m_rankedCells)
+    {
+        const int state = pCell->state.load(std::memory_order_relaxed);
+        m_stats.residentCells += (state == CELL_RESIDENT) ? 1 : 0;
+        m_stats.loadingCells  += (state == CELL_LOADING || state == CELL_LOADED) ? 1 : 0;
+        m_stats.queuedCells   += (state == CELL_QUEUED) ? 1 : 0;
+    }
+    m_stats.residentTextures = 0;
+    for (const auto* pTexture : m_textures)
+    {
+        m_stats.residentTextures += (pTexture->state.load(std::memory_order_relaxed) == TEXTURE_RESIDENT) ? 1 : 0;
+    }
+    m_stats.memoryUsed = CalculateMemoryUsed();
+    m_stats.texturesUploaded = m_texturesUploaded.load(std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  IsEvictable()
+ *
+ *  This method is used to check whether a cell holds memory
+ *  that can be released now. Cells that a loader is working
+ *  on are evicted once the load has finished.
+ ***********************************************************/
+bool WorldStreamer::IsEvictable(const STREAM_CELL* pCell) const
+{
+    const int state = pCell->state.load(std::memory_order_acquire);
+    return state == CELL_QUEUED || state == CELL_LOADED || state == CELL_RESIDENT;
+}
+
+/***********************************************************
+ *  QueueCell()
+ *
+ *  This method is used to hand a cell to the loader threads;
+ *  the request mutex must be held. The textures of the cell
+ *  are referenced right away so they decode in parallel.
+ ***********************************************************/
+void WorldStreamer::QueueCell(STREAM_CELL* pCell)
+{
+    pCell->state.store(CELL_QUEUED, std::memory_order_relaxed);
+    m_cellRequests.push_back(pCell);
+    AddTextureReferences(pCell->textureMask);
+    pCell->bTextureReferences = true;
+}
+
+/***********************************************************
+ *  EvictCell()
+ *
+ *  This method is used to unload a queued, loaded or resident
+ *  cell; the request mutex must be held. A resident cell is
+ *  removed from the scene before the next frame is built.
+ ***********************************************************/
+void WorldStreamer::EvictCell(STREAM_CELL* pCell)
+{
+    const int state = pCell->state.load(std::memory_order_acquire);
+    if (state == CELL_QUEUED)
+    {
+        m_cellRequests.erase(std::remove(m_cellRequests.begin(), m_cellRequests.end(), pCell),
+                             m_cellRequests.end());
+    }
+    else if (state == CELL_RESIDENT)
+    {
+        // closed once the scene no longer points into it
+        m_bResidentChanged = true;
+        ++m_stats.cellsEvicted;
+    }
+    else
+    {
+        pCell->file.Close();
+        ++m_stats.cellsEvicted;
+    }
+
+    if (pCell->bTextureReferences)
+    {
+        ReleaseTextureReferences(pCell->textureMask);
+        pCell->bTextureReferences = false;
+    }
+    pCell->state.store(CELL_UNLOADED, std::memory_order_relaxed);
+}
+
+/***********************************************************
+ *  AddTextureReferences()
+ *  ReleaseTextureReferences()
+ *
+ *  These methods are used to count the cells that need each
+ *  world texture. UpdateTextures() acts on the counts.
+ ***********************************************************/
+void WorldStreamer::AddTextureReferences(uint32_t textureMask)
+{
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        if ((textureMask >> i) & 1)
+        {
+            ++m_textures[i]->refCount;
+        }
+    }
+}
+
+void WorldStreamer::ReleaseTextureReferences(uint32_t textureMask)
+{
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        if ((textureMask >> i) & 1)
+        {
+            --m_textures[i]->refCount;
+        }
+    }
+}
+
+/***********************************************************
+ *  UpdateTextures()
+ *
+ *  This method is used to queue the decodes of referenced
+ *  textures and to release unreferenced ones; the request
+ *  mutex must be held. A texture on the GPU is deleted by
+ *  ProcessGpuWork() once the frames drawn with it are done.
+ ***********************************************************/
+void WorldStreamer::UpdateTextures(unsigned long frameIndex)
+{
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        STREAM_TEXTURE* pTexture = m_textures[i];
+        int state = pTexture->state.load(std::memory_order_acquire);
+
+        if (pTexture->refCount > 0)
+        {
+            if (state == TEXTURE_UNLOADED)
+            {
+                pTexture->state.store(TEXTURE_QUEUED, std::memory_order_relaxed);
+                m_textureRequests.push_back(static_cast<int>(i));
+            }
+            continue;
+        }
+
+        if (state == TEXTURE_QUEUED)
+        {
+            m_textureRequests.erase(
+                std::remove(m_textureRequests.begin(), m_textureRequests.end(), static_cast<int>(i)),
+                m_textureRequests.end());
+            pTexture->state.store(TEXTURE_UNLOADED, std::memory_order_relaxed);
+        }
+        else if (state == TEXTURE_DECODED)
+        {
+            // the OpenGL thread may be taking it for upload
+            if (pTexture->state.compare_exchange_strong(state, TEXTURE_UNLOADED, std::memory_order_acq_rel))
+            {
+                SceneManager::FreeDecodedImage(pTexture->image);
+                pTexture->bytes = 0;
+            }
+        }
+        else if (state == TEXTURE_RESIDENT)
+        {
+            pTexture->releaseFrame = frameIndex;
+            pTexture->state.store(TEXTURE_RELEASING, std::memory_order_release);
+        }
+    }
+}
+
+/***********************************************************
+ *  AreTexturesResident()
+ *
+ *  This method is used to check whether all the textures a
+ *  cell uses are on the GPU. Textures that failed to load
+ *  do not hold the cell back.
+ ***********************************************************/
+bool WorldStreamer::AreTexturesResident(uint32_t textureMask) const
+{
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        if ((textureMask >> i) & 1)
+        {
+            const int state = m_textures[i]->state.load(std::memory_order_acquire);
+            if (state != TEXTURE_RESIDENT && state != TEXTURE_FAILED)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/***********************************************************
+ *  CalculateMemoryUsed()
+ *
+ *  This method is used to add up the bytes of the cells that
+ *  are queued or in memory and of the decoded textures.
+ ***********************************************************/
+uint64_t WorldStreamer::CalculateMemoryUsed() const
+{
+    uint64_t memoryUsed = 0;
+    for (const auto* pCell : m_rankedCells)
+    {
+        const int state = pCell->state.load(std::memory_order_relaxed);
+        if (state != CELL_UNLOADED && state != CELL_FAILED)
+        {
+            memoryUsed += pCell->bytes;
+        }
+    }
+    for (const auto* pTexture : m_textures)
+    {
+        const int state = pTexture->state.load(std::memory_order_acquire);
+        if (state >= TEXTURE_DECODED && state <= TEXTURE_RELEASING)
+        {
+            memoryUsed += pTexture->bytes;
+        }
+    }
+    return memoryUsed;
+}
+
+/***********************************************************
+ *  PublishResidentCells()
+ *
+ *  This method is used to make loaded cells resident once
+ *  their textures are on the GPU, to close the files of the
+ *  evicted cells, and to hand the object arrays of the
+ *  resident cells to the scene manager when they changed.
+ ***********************************************************/
+void WorldStreamer::PublishResidentCells()
+{
+    for (auto* pCell : m_cells)
+    {
+        const int state = pCell->state.load(std::memory_order_acquire);
+        if (state == CELL_LOADED && AreTexturesResident(pCell->textureMask))
+        {
+            pCell->state.store(CELL_RESIDENT, std::memory_order_relaxed);
+            m_bResidentChanged = true;
+            ++m_stats.cellsLoaded;
+        }
+    }
+
+    if (!m_bResidentChanged)
+    {
+        return;
+    }
+    m_bResidentChanged = false;
+
+    m_residentObjects.clear();
+    for (const auto* pCell : m_cells)
+    {
+        if (pCell->state.load(std::memory_order_relaxed) != CELL_RESIDENT)
+        {
+            continue;
+        }
+
+        const SceneFile& file = pCell->file;
+        SceneManager::SCENE_OBJECT_ARRAYS objects;
+        objects.count           = file.GetObjectCount();
+        objects.scaleXYZ        = file.GetSection<glm::vec3>(SCENE_SECTION_SCALE);
+        objects.rotationDegrees = file.GetSection<glm::vec3>(SCENE_SECTION_ROTATION);
+        objects.positionXYZ     = file.GetSection<glm::vec3>(SCENE_SECTION_POSITION);
+        objects.color           = file.GetSection<glm::vec4>(SCENE_SECTION_COLOR);
+        objects.mesh            = file.GetSection<uint8_t>(SCENE_SECTION_MESH);
+        objects.materialIndex   = file.GetSection<int16_t>(SCENE_SECTION_MATERIAL_INDEX);
+        objects.textureSlot     = file.GetSection<int16_t>(SCENE_SECTION_TEXTURE_INDEX);
+        objects.model           = nullptr;
+        objects.worldBounds     = nullptr;
+        objects.flags           = nullptr;
+        m_residentObjects.push_back(objects);
+    }
+    m_pSceneManager->SetStreamedObjects(m_residentObjects);
+
+    // the scene no longer points into the evicted cells
+    for (auto* pCell : m_cells)
+    {
+        if (pCell->state.load(std::memory_order_relaxed) == CELL_UNLOADED && pCell->file.IsOpen())
+        {
+            pCell->file.Close();
+        }
+    }
+}
+
+/***********************************************************
+ *  ProcessGpuWork()
+ *
+ *  This method is used on the OpenGL thread before a frame
+ *  is drawn. Textures released before this frame was built
+ *  are deleted, then decoded textures are uploaded until the
+ *  upload budget is spent; at least one upload is made per
+ *  frame so streaming always makes progress.
+ ***********************************************************/
+void WorldStreamer::ProcessGpuWork(unsigned long frameIndex)
+{
+    if (m_pSceneManager == nullptr)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        STREAM_TEXTURE* pTexture = m_textures[i];
+        if (pTexture->state.load(std::memory_order_acquire) == TEXTURE_RELEASING &&
+            frameIndex >= pTexture->releaseFrame)
+        {
+            m_pSceneManager->ReleaseStreamedTexture(static_cast<int>(i));
+            pTexture->bytes = 0;
+            pTexture->state.store(TEXTURE_UNLOADED, std::memory_order_release);
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        STREAM_TEXTURE* pTexture = m_textures[i];
+        int expected = TEXTURE_DECODED;
+        if (!pTexture->state.compare_exchange_strong(expected, TEXTURE_UPLOADING, std::memory_order_acq_rel))
+        {
+            continue;
+        }
+
+        const bool bUploaded = m_pSceneManager->SetStreamedTexture(static_cast<int>(i), pTexture->image);
+        pTexture->state.store(bUploaded ? TEXTURE_RESIDENT : TEXTURE_FAILED, std::memory_order_release);
+        m_texturesUploaded.fetch_add(1, std::memory_order_relaxed);
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() >= m_settings.uploadBudgetMs)
+        {
+            break;
+        }
+    }
+}
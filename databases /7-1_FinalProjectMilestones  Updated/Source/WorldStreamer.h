@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.h
+// ============
+// stream the cells of a large world in and out around the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "SceneFile.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// name of the index file in a world directory
+const char* const WORLD_INDEX_FILENAME = "world.index";
+// version of the world index format
+const int WORLD_INDEX_VERSION = 1;
+
+/***********************************************************
+ *  WorldStreamer
+ *
+ *  A world is a directory with a scene file holding the
+ *  material, texture and light tables, and one scene file
+ *  per square cell of the XZ plane holding the objects in
+ *  that cell (see BuildWorldCells()).
+ *
+ *  Every frame, Update() ranks the cells by their distance
+ *  to the camera, weighted so cells ahead of the camera come
+ *  first, and queues the cells within the load radius for
+ *  the loader threads. The loaders map the cell files and
+ *  decode the textures the cells use. Once all of its
+ *  textures are on the GPU, a cell is handed to the scene
+ *  manager. Cells past the load radius, or the least
+ *  important ones when the memory budget is exceeded, are
+ *  evicted.
+ *
+ *  Texture uploads and deletes happen in ProcessGpuWork(),
+ *  which is called on the OpenGL thread and stops after a
+ *  time budget, so streaming does not make frames hitch.
+ ***********************************************************/
+class WorldStreamer
+{
+public:
+    // tuning values, applied on the next Update()
+    struct SETTINGS
+    {
+        // cells whose center is closer than this are loaded
+        float loadRadius;
+        // most bytes of cell files and texture images in memory
+        uint64_t memoryBudget;
+        // OpenGL time spent on uploads per frame, in milliseconds
+        double uploadBudgetMs;
+    };
+
+    // streaming counters, for display and tests
+    struct STATS
+    {
+        int residentCells;
+        int loadingCells;
+        int queuedCells;
+        int residentTextures;
+        uint64_t memoryUsed;
+        int cellsLoaded;
+        int cellsEvicted;
+        int texturesUploaded;
+    };
+
+    explicit WorldStreamer(unsigned loaderThreadCount = 2);
+    ~WorldStreamer();
+
+    // read the world index, replace the materials, lights and
+    // texture slots of the scene manager with the world tables
+    // and start the loader threads
+    bool Open(const char* worldDirectory, SceneManager* pSceneManager);
+    // stop loading and unload every cell
+    void Close();
+
+    void SetSettings(const SETTINGS& settings) { m_settings = settings; }
+    const SETTINGS& GetSettings() const { return m_settings; }
+    STATS GetStats() const { return m_stats; }
+
+    // main thread, before a frame is built: rank the cells for
+    // the camera, queue loads, evict, and publish loaded cells
+    void Update(const glm::vec3& viewPosition, const glm::vec3& viewDirection, unsigned long frameIndex);
+
+    // OpenGL thread, before a frame is drawn: delete released
+    // textures and upload decoded ones within the time budget
+    void ProcessGpuWork(unsigned long frameIndex);
+
+private:
+    // life cycle of a cell; only the loader threads move a
+    // cell out of CELL_LOADING, everything else happens on the
+    // main thread
+    enum CELL_STATE
+    {
+        CELL_UNLOADED = 0,
+        CELL_QUEUED,
+        CELL_LOADING,
+        CELL_LOADED,
+        CELL_RESIDENT,
+        CELL_FAILED
+    };
+
+    // life cycle of a world texture
+    enum TEXTURE_STATE
+    {
+        TEXTURE_UNLOADED = 0,
+        TEXTURE_QUEUED,
+        TEXTURE_DECODING,
+        TEXTURE_DECODED,
+        TEXTURE_UPLOADING,
+        TEXTURE_RESIDENT,
+        TEXTURE_RELEASING,
+        TEXTURE_FAILED
+    };
+
+    struct STREAM_CELL
+    {
+        int x;
+        int z;
+        std::string filename;
+        uint64_t bytes;
+        glm::vec3 center;
+        // bit i is set when the cell uses world texture i
+        uint32_t textureMask;
+
+        std::atomic<int> state;
+        SceneFile file;
+        // the cell holds references on its textures; main thread only
+        bool bTextureReferences;
+        float distance;
+        float priority;
+    };
+
+    struct STREAM_TEXTURE
+    {
+        std::string filename;
+        std::atomic<int> state;
+        // cells that are queued, loading, loaded or resident and
+        // use the texture; main thread only
+        int refCount;
+        SceneManager::DECODED_IMAGE image;
+        uint64_t bytes;
+        // first frame that no longer draws with the texture
+        unsigned long releaseFrame;
+    };
+
+    bool ReadWorldIndex(const std::string& worldDirectory, std::string& tablesFilename);
+    void StartLoaders();
+    void StopLoaders();
+
+    // loader thread entry point and work items
+    void LoaderMain();
+    void LoadCell(STREAM_CELL* pCell);
+    void DecodeTexture(int textureIndex);
+
+    // main thread helpers
+    void QueueCell(STREAM_CELL* pCell);
+    void EvictCell(STREAM_CELL* pCell);
+    bool IsEvictable(const STREAM_CELL* pCell) const;
+    void AddTextureReferences(uint32_t textureMask);
+    void ReleaseTextureReferences(uint32_t textureMask);
+    void UpdateTextures(unsigned long frameIndex);
+    bool AreTexturesResident(uint32_t textureMask) const;
+    uint64_t CalculateMemoryUsed() const;
+    void PublishResidentCells();
+
+    SceneManager* m_pSceneManager;
+    SETTINGS m_settings;
+    STATS m_stats;
+
+    float m_cellSize;
+    int m_materialCount;
+    std::vector<STREAM_CELL*> m_cells;
+    std::vector<STREAM_TEXTURE*> m_textures;
+    // cells ordered by priority, most important first
+    std::vector<STREAM_CELL*> m_rankedCells;
+    // object arrays of the resident cells, handed to the scene
+    std::vector<SceneManager::SCENE_OBJECT_ARRAYS> m_residentObjects;
+    bool m_bResidentChanged;
+
+    // work for the loader threads, guarded by m_requestMutex
+    std::vector<STREAM_CELL*> m_cellRequests;
+    std::vector<int> m_textureRequests;
+    std::mutex m_requestMutex;
+    std::condition_variable m_requestSignal;
+
+    // written by the OpenGL thread, read by Update()
+    std::atomic<int> m_texturesUploaded;
+
+    unsigned m_loaderThreadCount;
+    std::vector<std::thread> m_loaders;
+    bool m_bStopLoaders;
+};
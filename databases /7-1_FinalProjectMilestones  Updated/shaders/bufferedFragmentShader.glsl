@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// bufferedFragmentShader.glsl
+// ============
+// fragment shader for the GPU ring buffer path; same Phong lighting
+// model as the default shaders, with the material looked up in a
+// material table by the index stored in the per-draw object data
+///////////////////////////////////////////////////////////////////////////////
+#version 440 core
+
+#define TOTAL_LIGHTS 4
+#define MAX_MATERIALS 16
+#define MAX_TEXTURES 16
+
+struct LightSource
+{
+    vec3 position;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float focalStrength;
+    float specularIntensity;
+};
+
+struct MaterialEntry
+{
+    vec4 ambientColorStrength;      // rgb ambient color, a ambient strength
+    vec4 diffuseColor;
+    vec4 specularColorShininess;    // rgb specular color, a shininess
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+// camera and timing values, shared by every program
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 viewPosition;
+    vec4 time;              // seconds, delta seconds, frame index
+    vec4 viewportSize;      // pixels, reciprocal pixels
+};
+
+layout (std140, binding = 1) uniform ObjectData
+{
+    mat4 model;
+    vec4 objectColor;
+    vec4 uvScale;
+    ivec4 objectFlags;      // material index, texture slot, use texture, use lighting
+};
+
+// written once when the materials are defined
+layout (std140, binding = 2) uniform MaterialData
+{
+    MaterialEntry materials[MAX_MATERIALS];
+};
+
+uniform LightSource lightSources[TOTAL_LIGHTS];
+uniform sampler2D objectTextures[MAX_TEXTURES];
+
+vec3 CalcLightSource(LightSource light, MaterialEntry material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+    // diffuse
+    vec3 lightDirection = normalize(light.position - vertexPosition);
+    float impact = max(dot(lightNormal, lightDirection), 0.0f);
+    vec3 diffuse = impact * material.diffuseColor.rgb * light.diffuseColor;
+
+    // specular
+    vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+    float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+    vec3 specular = light.specularIntensity * specularComponent * material.specularColorShininess.rgb * light.specularColor;
+
+    return diffuse + specular;
+}
+
+void main()
+{
+    vec4 baseColor = objectColor;
+    if (objectFlags.z != 0)
+    {
+        // the texture slot is the same for the whole draw, so the
+        // sampler array index is dynamically uniform
+        baseColor = texture(objectTextures[objectFlags.y], fragmentTextureCoordinate);
+    }
+
+    if (objectFlags.w == 0)
+    {
+        outFragmentColor = baseColor;
+        return;
+    }
+
+    MaterialEntry material = materials[max(objectFlags.x, 0)];
+    vec3 lightNormal = normalize(fragmentVertexNormal);
+    vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+
+    vec3 phongResult = material.ambientColorStrength.a * material.ambientColorStrength.rgb;
+    for (int i = 0; i < TOTAL_LIGHTS; i++)
+    {
+        phongResult += CalcLightSource(lightSources[i], material, lightNormal, fragmentPosition, viewDirection);
+    }
+
+    outFragmentColor = vec4(phongResult * baseColor.rgb, baseColor.a);
+}
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthPyramidCompute.glsl
+// ============
+// compute shader that builds one level of the depth pyramid of the GPU
+// culling; every texel keeps the farthest depth of the texels it covers on
+// the level above, level 0 is a copy of the depth buffer
+///////////////////////////////////////////////////////////////////////////////
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// the depth copy for level 0, the pyramid itself for the others
+uniform sampler2D sourceDepth;
+uniform int sourceLevel;
+
+layout (r32f, binding = 0) uniform writeonly image2D targetLevel;
+
+void main()
+{
+    ivec2 target = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 targetSize = imageSize(targetLevel);
+    if (any(greaterThanEqual(target, targetSize)))
+    {
+        return;
+    }
+
+    ivec2 sourceSize = textureSize(sourceDepth, sourceLevel);
+    if (sourceSize == targetSize)
+    {
+        imageStore(targetLevel, target, vec4(texelFetch(sourceDepth, target, sourceLevel).r));
+        return;
+    }
+
+    // the 2x2 texels above; the last column and row also take the odd
+    // texel left over when the size above is odd
+    ivec2 first = target * 2;
+    ivec2 last = first + 1;
+    if (target.x == targetSize.x - 1 && (sourceSize.x & 1) != 0)
+    {
+        last.x += 1;
+    }
+    if (target.y == targetSize.y - 1 && (sourceSize.y & 1) != 0)
+    {
+        last.y += 1;
+    }
+    last = min(last, sourceSize - 1);
+
+    float farthestDepth = 0.0f;
+    for (int y = first.y; y <= last.y; y++)
+    {
+        for (int x = first.x; x <= last.x; x++)
+        {
+            farthestDepth = max(farthestDepth, texelFetch(sourceDepth, ivec2(x, y), sourceLevel).r);
+        }
+    }
+    imageStore(targetLevel, target, vec4(farthestDepth));
+}
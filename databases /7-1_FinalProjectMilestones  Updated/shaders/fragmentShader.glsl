@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// fragmentShader.glsl
+// ============
+// default fragment shader; Phong lighting from up to four light
+// sources, with the camera position read from the shared FrameData
+// block
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+#define TOTAL_LIGHTS 4
+
+struct Material
+{
+    vec3 ambientColor;
+    float ambientStrength;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+struct LightSource
+{
+    vec3 position;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float focalStrength;
+    float specularIntensity;
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+// camera and timing values, shared by every program
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 viewPosition;
+    vec4 time;              // seconds, delta seconds, frame index
+    vec4 viewportSize;      // pixels, reciprocal pixels
+};
+
+uniform bool bUseTexture;
+uniform bool bUseLighting;
+uniform vec4 objectColor;
+uniform sampler2D objectTexture;
+uniform vec2 UVscale;
+uniform Material material;
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+    // diffuse
+    vec3 lightDirection = normalize(light.position - vertexPosition);
+    float impact = max(dot(lightNormal, lightDirection), 0.0f);
+    vec3 diffuse = impact * material.diffuseColor * light.diffuseColor;
+
+    // specular
+    vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+    float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+    vec3 specular = light.specularIntensity * specularComponent * material.specularColor * light.specularColor;
+
+    return diffuse + specular;
+}
+
+void main()
+{
+    vec4 baseColor = objectColor;
+    if (bUseTexture)
+    {
+        baseColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+    }
+
+    if (!bUseLighting)
+    {
+        outFragmentColor = baseColor;
+        return;
+    }
+
+    vec3 lightNormal = normalize(fragmentVertexNormal);
+    vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+
+    vec3 phongResult = material.ambientStrength * material.ambientColor;
+    for (int i = 0; i < TOTAL_LIGHTS; i++)
+    {
+        phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection);
+    }
+
+    outFragmentColor = vec4(phongResult * baseColor.rgb, baseColor.a);
+}
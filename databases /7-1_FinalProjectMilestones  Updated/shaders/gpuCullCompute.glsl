@@ -0,0 +1,220 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuCullCompute.glsl
+// ============
+// compute shader of the GPU culling; tests every object of the object table
+// against the view frustum and the depth pyramid of the previous frame and
+// appends an indirect draw command for each one that is kept, or for each of
+// its meshlets in view
+///////////////////////////////////////////////////////////////////////////////
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+#define SKIP_CULLING 1
+
+struct ObjectEntry
+{
+    mat4 model;
+    vec4 color;
+    vec4 bounds;            // world bounding sphere
+    ivec4 state;            // mesh, material index, texture slot, flags
+};
+
+struct MeshEntry
+{
+    uint indexCount;
+    uint firstIndex;
+    int baseVertex;
+    uint firstMeshlet;
+    uint meshletCount;
+    uint padding[3];
+};
+
+struct MeshletEntry
+{
+    vec4 bounds;            // model space bounding sphere
+    vec4 cone;              // normal cone axis, cosine of its angle
+    uint firstIndex;
+    uint indexCount;
+    uint padding[2];
+};
+
+struct DrawCommand
+{
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer ObjectTable
+{
+    ObjectEntry objects[];
+};
+
+layout (std430, binding = 1) readonly buffer MeshTable
+{
+    MeshEntry meshes[];
+};
+
+layout (std430, binding = 2) writeonly buffer DrawCommands
+{
+    DrawCommand commands[];
+};
+
+// the draw count of the indirect call, cleared before the dispatch
+layout (std430, binding = 3) buffer DrawCount
+{
+    uint drawCount;
+};
+
+layout (std430, binding = 4) readonly buffer MeshletTable
+{
+    MeshletEntry meshlets[];
+};
+
+// normalized planes pointing into the frustum
+uniform vec4 frustumPlanes[6];
+uniform uint objectCount;
+
+// max-reduced depth of the previous frame and its camera
+uniform bool bUseOcclusion;
+uniform mat4 previousViewProjection;
+uniform int pyramidLevels;
+uniform sampler2D depthPyramid;
+
+// draw the meshlets of each object that are in view instead of
+// the whole shape
+uniform bool bUseMeshlets;
+uniform vec3 viewPosition;
+
+bool IsInFrustum(vec4 sphere)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// true when the box around the sphere is behind the farthest depth of
+// every pyramid texel it covers in the previous frame
+bool IsOccluded(vec4 sphere)
+{
+    vec2 minUV = vec2(1.0f);
+    vec2 maxUV = vec2(0.0f);
+    float nearestDepth = 1.0f;
+    for (int i = 0; i < 8; i++)
+    {
+        vec3 corner = sphere.xyz + sphere.w * vec3(
+            (i & 1) != 0 ? 1.0f : -1.0f,
+            (i & 2) != 0 ? 1.0f : -1.0f,
+            (i & 4) != 0 ? 1.0f : -1.0f);
+        vec4 clip = previousViewProjection * vec4(corner, 1.0f);
+        if (clip.w <= 0.0f)
+        {
+            // reaches behind the camera, so its screen rectangle is unknown
+            return false;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        minUV = min(minUV, ndc.xy * 0.5f + 0.5f);
+        maxUV = max(maxUV, ndc.xy * 0.5f + 0.5f);
+        nearestDepth = min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+    minUV = clamp(minUV, 0.0f, 1.0f);
+    maxUV = clamp(maxUV, 0.0f, 1.0f);
+
+    // the level on which the rectangle spans at most 2x2 texels; a texel
+    // of level n covers 2^n pixels of level 0 in each direction, the last
+    // one of a row or column also the odd pixels left over
+    ivec2 baseSize = textureSize(depthPyramid, 0);
+    vec2 extent = (maxUV - minUV) * vec2(baseSize);
+    int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0f)))), 0, pyramidLevels - 1);
+    ivec2 levelSize = max(baseSize >> level, ivec2(1));
+    ivec2 texelMin = min(ivec2(minUV * vec2(baseSize)) >> level, levelSize - 1);
+    ivec2 texelMax = min(ivec2(maxUV * vec2(baseSize)) >> level, levelSize - 1);
+
+    float farthestDepth = max(
+        max(texelFetch(depthPyramid, texelMin, level).r,
+            texelFetch(depthPyramid, ivec2(texelMax.x, texelMin.y), level).r),
+        max(texelFetch(depthPyramid, ivec2(texelMin.x, texelMax.y), level).r,
+            texelFetch(depthPyramid, texelMax, level).r));
+
+    return nearestDepth > farthestDepth;
+}
+
+// true when every triangle of the meshlet faces away from the view
+// position, wherever it is in the bounding sphere. The normal turned
+// furthest toward the view is at the angle of the cone plus the angle
+// between the axis and the direction to the sphere, and that normal must
+// still point away by more than the radius allows
+bool IsBackFacing(MeshletEntry meshlet, vec3 modelViewPosition)
+{
+    if (meshlet.cone.xyz == vec3(0.0f))
+    {
+        return false;
+    }
+    vec3 offset = meshlet.bounds.xyz - modelViewPosition;
+    float distance = length(offset);
+    if (distance <= meshlet.bounds.w)
+    {
+        return false;
+    }
+    float cosView = dot(offset, meshlet.cone.xyz) / distance;
+    float sinView = sqrt(max(1.0f - cosView * cosView, 0.0f));
+    float sinCone = sqrt(max(1.0f - meshlet.cone.w * meshlet.cone.w, 0.0f));
+    return cosView * meshlet.cone.w - sinView * sinCone > meshlet.bounds.w / distance;
+}
+
+void main()
+{
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= objectCount)
+    {
+        return;
+    }
+
+    ObjectEntry object = objects[index];
+    if ((object.state.w & SKIP_CULLING) != 0 || !IsInFrustum(object.bounds))
+    {
+        return;
+    }
+    if (bUseOcclusion && IsOccluded(object.bounds))
+    {
+        return;
+    }
+
+    // the base instance tells the vertex shader which object it draws
+    MeshEntry mesh = meshes[object.state.x];
+    if (!bUseMeshlets || mesh.meshletCount == 0u)
+    {
+        uint slot = atomicAdd(drawCount, 1u);
+        commands[slot] = DrawCommand(mesh.indexCount, 1u, mesh.firstIndex, mesh.baseVertex, index);
+        return;
+    }
+
+    // the cones are tested in model space, where facing away is the
+    // same as in the world for any transform. Seen from inside the
+    // object, the far side of a closed shape faces away and is still
+    // what is seen, so nothing is culled by the cones there
+    bool bTestCones = distance(viewPosition, object.bounds.xyz) > object.bounds.w;
+    vec3 modelViewPosition = (inverse(object.model) * vec4(viewPosition, 1.0f)).xyz;
+    float scale = sqrt(max(max(dot(object.model[0].xyz, object.model[0].xyz),
+                               dot(object.model[1].xyz, object.model[1].xyz)),
+                           dot(object.model[2].xyz, object.model[2].xyz)));
+    for (uint i = 0u; i < mesh.meshletCount; i++)
+    {
+        MeshletEntry meshlet = meshlets[mesh.firstMeshlet + i];
+        vec4 sphere = vec4((object.model * vec4(meshlet.bounds.xyz, 1.0f)).xyz, meshlet.bounds.w * scale);
+        if (!IsInFrustum(sphere) || (bTestCones && IsBackFacing(meshlet, modelViewPosition)))
+        {
+            continue;
+        }
+        uint slot = atomicAdd(drawCount, 1u);
+        commands[slot] = DrawCommand(meshlet.indexCount, 1u, meshlet.firstIndex, mesh.baseVertex, index);
+    }
+}
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuDrivenVertexShader.glsl
+// ============
+// vertex shader for the GPU culling path; the draws are written by the
+// culling shader, and each one reads its object from the object table by
+// its base instance
+///////////////////////////////////////////////////////////////////////////////
+#version 440 core
+#extension GL_ARB_shader_draw_parameters : require
+
+// the merged shapes are always in the float layout, so there are no
+// decode values
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out vec4 fragmentObjectColor;
+flat out ivec4 fragmentObjectState;
+
+// camera and timing values, shared by every program
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 viewPosition;
+    vec4 time;              // seconds, delta seconds, frame index
+    vec4 viewportSize;      // pixels, reciprocal pixels
+};
+
+struct ObjectEntry
+{
+    mat4 model;
+    vec4 color;
+    vec4 bounds;            // world bounding sphere
+    ivec4 state;            // mesh, material index, texture slot, flags
+};
+
+layout (std430, binding = 0) readonly buffer ObjectTable
+{
+    ObjectEntry objects[];
+};
+
+void main()
+{
+    ObjectEntry object = objects[gl_BaseInstanceARB];
+
+    vec4 worldPosition = object.model * vec4(inVertexPosition, 1.0f);
+
+    gl_Position = viewProjection * worldPosition;
+
+    fragmentPosition = vec3(worldPosition);
+    fragmentVertexNormal = mat3(transpose(inverse(object.model))) * inVertexNormal;
+    fragmentTextureCoordinate = inTextureCoordinate;
+    fragmentObjectColor = object.color;
+    fragmentObjectState = object.state;
+}
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiViewFragmentShader.glsl
+// ============
+// fragment shader for drawing several cameras in one pass; the default
+// Phong lighting, with the camera position of the view being drawn
+///////////////////////////////////////////////////////////////////////////////
+#version 410 core
+
+#define TOTAL_LIGHTS 4
+#define MAX_VIEWS 16
+
+struct Material
+{
+    vec3 ambientColor;
+    float ambientStrength;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float shininess;
+};
+
+struct LightSource
+{
+    vec3 position;
+    vec3 diffuseColor;
+    vec3 specularColor;
+    float focalStrength;
+    float specularIntensity;
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in int fragmentViewIndex;
+
+out vec4 outFragmentColor;
+
+// the cameras of the pass
+layout (std140) uniform MultiViewData
+{
+    mat4 viewProjections[MAX_VIEWS];
+    vec4 viewPositions[MAX_VIEWS];
+};
+
+uniform bool bUseTexture;
+uniform bool bUseLighting;
+uniform vec4 objectColor;
+uniform sampler2D objectTexture;
+uniform vec2 UVscale;
+uniform Material material;
+uniform LightSource lightSources[TOTAL_LIGHTS];
+
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+    // diffuse
+    vec3 lightDirection = normalize(light.position - vertexPosition);
+    float impact = max(dot(lightNormal, lightDirection), 0.0f);
+    vec3 diffuse = impact * material.diffuseColor * light.diffuseColor;
+
+    // specular
+    vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+    float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+    vec3 specular = light.specularIntensity * specularComponent * material.specularColor * light.specularColor;
+
+    return diffuse + specular;
+}
+
+void main()
+{
+    vec4 baseColor = objectColor;
+    if (bUseTexture)
+    {
+        baseColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+    }
+
+    if (!bUseLighting)
+    {
+        outFragmentColor = baseColor;
+        return;
+    }
+
+    vec3 lightNormal = normalize(fragmentVertexNormal);
+    vec3 viewDirection = normalize(viewPositions[fragmentViewIndex].xyz - fragmentPosition);
+
+    vec3 phongResult = material.ambientStrength * material.ambientColor;
+    for (int i = 0; i < TOTAL_LIGHTS; i++)
+    {
+        phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection);
+    }
+
+    outFragmentColor = vec4(phongResult * baseColor.rgb, baseColor.a);
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiViewVertexShader.glsl
+// ============
+// vertex shader for drawing several cameras in one pass; each instance
+// of a draw is one view, sent to its own layer or viewport
+///////////////////////////////////////////////////////////////////////////////
+#version 410 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+
+#define MAX_VIEWS 16
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+// decode values of the current mesh, set by DrawUploadedMesh(); the
+// xyz scale and offset map quantized positions back to the mesh
+// bounds, a w of 1 marks octahedral normals in inVertexNormal.xy
+layout (location = 3) in vec4 inPositionScale;
+layout (location = 4) in vec3 inPositionOffset;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentViewIndex;
+
+// the cameras of the pass
+layout (std140) uniform MultiViewData
+{
+    mat4 viewProjections[MAX_VIEWS];
+    vec4 viewPositions[MAX_VIEWS];
+};
+
+uniform mat4 model;
+// view of instance 0; without the layer extension every view is
+// drawn in a pass of its own
+uniform int firstView;
+
+// unfold an octahedral normal back onto the unit sphere
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return normalize(normal);
+}
+
+void main()
+{
+    int viewIndex = firstView + gl_InstanceID;
+
+    vec3 position = inPositionOffset + inVertexPosition * inPositionScale.xyz;
+    vec3 normal = inPositionScale.w > 0.5f ? DecodeOctahedral(inVertexNormal.xy) : inVertexNormal;
+
+    vec4 worldPosition = model * vec4(position, 1.0f);
+
+    gl_Position = viewProjections[viewIndex] * worldPosition;
+
+#ifdef GL_ARB_shader_viewport_layer_array
+    // the layer is ignored by a target without layers, and the
+    // viewports all match when the views are layers
+    gl_Layer = viewIndex;
+    gl_ViewportIndex = viewIndex;
+#endif
+
+    fragmentPosition = vec3(worldPosition);
+    fragmentVertexNormal = mat3(transpose(inverse(model))) * normal;
+    fragmentTextureCoordinate = inTextureCoordinate;
+    fragmentViewIndex = viewIndex;
+}
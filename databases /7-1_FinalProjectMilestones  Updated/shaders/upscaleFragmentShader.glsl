@@ -0,0 +1,47 @@
+///////////////////////////////////////////////////////////////////////////////
+// upscaleFragmentShader.glsl
+// ============
+// stretch the frame drawn at a reduced resolution over the window, with
+// bilinear filtering and optional sharpening
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec2 fragmentTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+// target the scene was drawn into; only its lower left part is used
+uniform sampler2D sceneColor;
+// share of the target covered by this frame
+uniform vec2 sourceScale;
+// size of one texel of the target
+uniform vec2 sourceTexelSize;
+// 0 for plain bilinear filtering, up to 1 for full sharpening
+uniform float sharpness;
+
+void main()
+{
+    // stay half a texel inside the drawn part, so the filter never
+    // reads pixels left over from a frame at a larger scale
+    vec2 minimum = 0.5 * sourceTexelSize;
+    vec2 maximum = sourceScale - 0.5 * sourceTexelSize;
+    vec2 uv = clamp(fragmentTextureCoordinate * sourceScale, minimum, maximum);
+
+    vec3 center = texture(sceneColor, uv).rgb;
+    if (sharpness > 0.0)
+    {
+        vec3 left = texture(sceneColor, clamp(uv - vec2(sourceTexelSize.x, 0.0), minimum, maximum)).rgb;
+        vec3 right = texture(sceneColor, clamp(uv + vec2(sourceTexelSize.x, 0.0), minimum, maximum)).rgb;
+        vec3 below = texture(sceneColor, clamp(uv - vec2(0.0, sourceTexelSize.y), minimum, maximum)).rgb;
+        vec3 above = texture(sceneColor, clamp(uv + vec2(0.0, sourceTexelSize.y), minimum, maximum)).rgb;
+
+        // unsharp mask, limited to the range of the neighbours so
+        // edges do not ring
+        vec3 lowest = min(center, min(min(left, right), min(below, above)));
+        vec3 highest = max(center, max(max(left, right), max(below, above)));
+        vec3 blurred = 0.25 * (left + right + below + above);
+        center = clamp(center + sharpness * (center - blurred), lowest, highest);
+    }
+
+    outFragmentColor = vec4(center, 1.0);
+}
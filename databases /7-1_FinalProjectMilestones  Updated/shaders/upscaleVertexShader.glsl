@@ -0,0 +1,18 @@
+///////////////////////////////////////////////////////////////////////////////
+// upscaleVertexShader.glsl
+// ============
+// one triangle covering the window, for stretching the frame drawn at a
+// reduced resolution over it
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out vec2 fragmentTextureCoordinate;
+
+void main()
+{
+    // vertices (0,0), (2,0) and (0,2) in texture space; the part
+    // outside the window is clipped
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    fragmentTextureCoordinate = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
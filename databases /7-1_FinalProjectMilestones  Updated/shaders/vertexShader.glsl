@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexShader.glsl
+// ============
+// default vertex shader; the camera values are read from the
+// FrameData block shared by all programs, the object values are
+// set as plain uniforms
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+// decode values of the current mesh, set by DrawUploadedMesh(); the
+// xyz scale and offset map quantized positions back to the mesh
+// bounds, a w of 1 marks octahedral normals in inVertexNormal.xy
+layout (location = 3) in vec4 inPositionScale;
+layout (location = 4) in vec3 inPositionOffset;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+
+// camera and timing values, shared by every program
+layout (std140) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    mat4 inverseView;
+    mat4 inverseProjection;
+    mat4 inverseViewProjection;
+    vec4 viewPosition;
+    vec4 time;              // seconds, delta seconds, frame index
+    vec4 viewportSize;      // pixels, reciprocal pixels
+};
+
+uniform mat4 model;
+
+// unfold an octahedral normal back onto the unit sphere
+vec3 DecodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -fold : fold;
+    normal.y += normal.y >= 0.0f ? -fold : fold;
+    return normalize(normal);
+}
+
+void main()
+{
+    vec3 position = inPositionOffset + inVertexPosition * inPositionScale.xyz;
+    vec3 normal = inPositionScale.w > 0.5f ? DecodeOctahedral(inVertexNormal.xy) : inVertexNormal;
+
+    vec4 worldPosition = model * vec4(position, 1.0f);
+
+    gl_Position = viewProjection * worldPosition;
+
+    fragmentPosition = vec3(worldPosition);
+    fragmentVertexNormal = mat3(transpose(inverse(model))) * normal;
+    fragmentTextureCoordinate = inTextureCoordinate;
+}